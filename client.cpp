@@ -0,0 +1,38 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "CompileProtocol.h"
+
+using namespace std;
+
+// A thin client for a server started with Compiler -serve: takes the same command line as
+// Compiler, sends it to the server at $COMPILER_SOCKET (or the default socket) and prints what
+// comes back.
+int main(int argc, char* argv[]) {
+    const char *path = getenv("COMPILER_SOCKET");
+    string socketPath = path != nullptr ? path : DefaultSocketPath();
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connection < 0 || connect(connection, (sockaddr*) &address, sizeof(address)) != 0) {
+        cerr << "Cannot connect to the compile server at " << socketPath << endl;
+        return 2;
+    }
+    char directory[PATH_MAX];
+    if (getcwd(directory, sizeof(directory)) == nullptr)
+        directory[0] = '\0';
+    CompileRequest request(directory, vector<string>(argv + 1, argv + argc));
+    CompileResponse response;
+    if (!request.Send(connection) || !CompileResponse::Receive(connection, response)) {
+        cerr << "The compile server at " << socketPath << " closed the connection" << endl;
+        return 2;
+    }
+    close(connection);
+    cout << response.GetOutput();
+    return response.GetStatus();
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <map>
+#include <mutex>
+#include <memory>
+#include "Scanner.h"
+#include "Symbols.h"
+#include "Node.h"
+
+// A procedure body as an earlier run parsed and checked it, with the line its begin was on then.
+class CachedBody {
+public:
+    CachedBody(std::string key, int line, PNode tree, int run);
+private:
+    friend class AnalysisCache;
+    std::string key;
+    int line;
+    PNode tree;
+    int run;
+};
+
+// Procedure bodies kept between runs of the parser over versions of one file, for an editor that
+// parses the file again after every edit. A body is found by a hash of its text and of the
+// declaration each identifier in it resolves to, so only a body that was edited, or that uses
+// something now declared differently, is parsed again; one found here is moved to its new line and
+// bound to the symbols of the current run. A run ends by dropping the bodies it did not use. One
+// parser at a time may use a cache, and trees from an earlier run must not be used after a later
+// one has started.
+class AnalysisCache {
+public:
+    AnalysisCache();
+    void Start();
+    void Finish();
+    PNode Find(const std::string &key, int line, PSymbolTableStack scope);
+    void Store(const std::string &key, int line, PNode tree);
+    static std::string GetKey(const std::string &text, const ScannerPosition &position, PSymbolTableStack scope);
+private:
+    std::multimap<unsigned long long, CachedBody> bodies;
+    std::mutex mutex;
+    int run;
+};
+typedef std::shared_ptr<AnalysisCache> PAnalysisCache;
@@ -0,0 +1,250 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <ostream>
+
+enum class Register {
+    Rax, Rcx, Rdx, Rbx, Rsp, Rbp, Rsi, Rdi,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+    Xmm0, Xmm1, Xmm2, Xmm3, Xmm4, Xmm5, Xmm6, Xmm7,
+    Xmm8, Xmm9, Xmm10, Xmm11, Xmm12, Xmm13, Xmm14, Xmm15,
+    Rip,
+    None
+};
+
+static const std::map<Register, std::string> registerName = {
+        { Register::Rax, "rax" }, { Register::Rcx, "rcx" }, { Register::Rdx, "rdx" }, { Register::Rbx, "rbx" },
+        { Register::Rsp, "rsp" }, { Register::Rbp, "rbp" }, { Register::Rsi, "rsi" }, { Register::Rdi, "rdi" },
+        { Register::R8,  "r8"  }, { Register::R9,  "r9"  }, { Register::R10, "r10" }, { Register::R11, "r11" },
+        { Register::R12, "r12" }, { Register::R13, "r13" }, { Register::R14, "r14" }, { Register::R15, "r15" },
+        { Register::Xmm0,  "xmm0"  }, { Register::Xmm1,  "xmm1"  }, { Register::Xmm2,  "xmm2"  },
+        { Register::Xmm3,  "xmm3"  }, { Register::Xmm4,  "xmm4"  }, { Register::Xmm5,  "xmm5"  },
+        { Register::Xmm6,  "xmm6"  }, { Register::Xmm7,  "xmm7"  }, { Register::Xmm8,  "xmm8"  },
+        { Register::Xmm9,  "xmm9"  }, { Register::Xmm10, "xmm10" }, { Register::Xmm11, "xmm11" },
+        { Register::Xmm12, "xmm12" }, { Register::Xmm13, "xmm13" }, { Register::Xmm14, "xmm14" },
+        { Register::Xmm15, "xmm15" },
+        { Register::Rip, "rip" }
+};
+
+static const std::map<Register, std::string> register32Name = {
+        { Register::Rax, "eax"  }, { Register::Rcx, "ecx"  }, { Register::Rdx, "edx"  }, { Register::Rbx, "ebx"  },
+        { Register::Rsp, "esp"  }, { Register::Rbp, "ebp"  }, { Register::Rsi, "esi"  }, { Register::Rdi, "edi"  },
+        { Register::R8,  "r8d"  }, { Register::R9,  "r9d"  }, { Register::R10, "r10d" }, { Register::R11, "r11d" },
+        { Register::R12, "r12d" }, { Register::R13, "r13d" }, { Register::R14, "r14d" }, { Register::R15, "r15d" }
+};
+
+static const std::map<Register, std::string> register8Name = {
+        { Register::Rax, "al"   }, { Register::Rcx, "cl"   }, { Register::Rdx, "dl"   }, { Register::Rbx, "bl"   },
+        { Register::Rsp, "spl"  }, { Register::Rbp, "bpl"  }, { Register::Rsi, "sil"  }, { Register::Rdi, "dil"  },
+        { Register::R8,  "r8b"  }, { Register::R9,  "r9b"  }, { Register::R10, "r10b" }, { Register::R11, "r11b" },
+        { Register::R12, "r12b" }, { Register::R13, "r13b" }, { Register::R14, "r14b" }, { Register::R15, "r15b" }
+};
+
+static const std::vector<Register> intArgRegisters = {
+        Register::Rdi, Register::Rsi, Register::Rdx, Register::Rcx, Register::R8, Register::R9
+};
+
+static const std::vector<Register> doubleArgRegisters = {
+        Register::Xmm0, Register::Xmm1, Register::Xmm2, Register::Xmm3,
+        Register::Xmm4, Register::Xmm5, Register::Xmm6, Register::Xmm7
+};
+
+enum class Condition {
+    None,
+    E,
+    NE,
+    L,
+    LE,
+    G,
+    GE,
+    B,
+    BE,
+    A,
+    AE
+};
+
+static const std::map<Condition, std::string> conditionName = {
+        { Condition::E,  "e"  },
+        { Condition::NE, "ne" },
+        { Condition::L,  "l"  },
+        { Condition::LE, "le" },
+        { Condition::G,  "g"  },
+        { Condition::GE, "ge" },
+        { Condition::B,  "b"  },
+        { Condition::BE, "be" },
+        { Condition::A,  "a"  },
+        { Condition::AE, "ae" }
+};
+
+enum class OpCode {
+    Label,
+    Mov,
+    Movsx,
+    Movzx,
+    Lea,
+    Add,
+    Sub,
+    Imul,
+    Idiv,
+    Cdq,
+    Neg,
+    Not,
+    And,
+    Or,
+    Xor,
+    Sal,
+    Sar,
+    Btc,
+    Cmp,
+    Test,
+    Set,
+    Jmp,
+    J,
+    Call,
+    Ret,
+    Push,
+    Pop,
+    Leave,
+    RepMovsb,
+    Movsd,
+    Movq,
+    Addsd,
+    Subsd,
+    Mulsd,
+    Divsd,
+    Ucomisd,
+    Cvtsi2sd,
+    Cvttsd2si
+};
+
+static const std::map<OpCode, std::string> opCodeName = {
+        { OpCode::Mov,       "mov"       },
+        { OpCode::Movsx,     "movs"      },
+        { OpCode::Movzx,     "movz"      },
+        { OpCode::Lea,       "lea"       },
+        { OpCode::Add,       "add"       },
+        { OpCode::Sub,       "sub"       },
+        { OpCode::Imul,      "imul"      },
+        { OpCode::Idiv,      "idiv"      },
+        { OpCode::Neg,       "neg"       },
+        { OpCode::Not,       "not"       },
+        { OpCode::And,       "and"       },
+        { OpCode::Or,        "or"        },
+        { OpCode::Xor,       "xor"       },
+        { OpCode::Sal,       "sal"       },
+        { OpCode::Sar,       "sar"       },
+        { OpCode::Btc,       "btc"       },
+        { OpCode::Cmp,       "cmp"       },
+        { OpCode::Test,      "test"      },
+        { OpCode::Set,       "set"       },
+        { OpCode::Jmp,       "jmp"       },
+        { OpCode::J,         "j"         },
+        { OpCode::Call,      "call"      },
+        { OpCode::Ret,       "ret"       },
+        { OpCode::Push,      "push"      },
+        { OpCode::Pop,       "pop"       },
+        { OpCode::Leave,     "leave"     },
+        { OpCode::RepMovsb,  "rep movsb" },
+        { OpCode::Movsd,     "movsd"     },
+        { OpCode::Movq,      "movq"      },
+        { OpCode::Addsd,     "addsd"     },
+        { OpCode::Subsd,     "subsd"     },
+        { OpCode::Mulsd,     "mulsd"     },
+        { OpCode::Divsd,     "divsd"     },
+        { OpCode::Ucomisd,   "ucomisd"   },
+        { OpCode::Cvtsi2sd,  "cvtsi2sd"  },
+        { OpCode::Cvttsd2si, "cvttsd2si" }
+};
+
+enum class OperandType {
+    Register,
+    Immediate,
+    Memory,
+    Label
+};
+
+class Operand {
+public:
+    static Operand Reg(Register reg, int size = 8);
+    static Operand Imm(long long value);
+    static Operand Mem(Register base, int disp = 0);
+    static Operand Mem(Register base, Register index, int scale, int disp = 0);
+    static Operand Rip(std::string label, int disp = 0);
+    static Operand Label(std::string label);
+    static Operand External(std::string label);
+    OperandType GetType() const;
+    Register GetRegister() const;
+    Register GetIndex() const;
+    int GetScale() const;
+    int GetSize() const;
+    long long GetValue() const;
+    const std::string &GetLabel() const;
+    bool IsExternal() const;
+    bool IsDouble() const;
+    void SetValue(long long value);
+    const std::string GetText() const;
+private:
+    OperandType type;
+    Register reg = Register::None;
+    Register index = Register::None;
+    int scale = 1;
+    int size = 8;
+    long long value = 0;
+    std::string label;
+    bool external = false;
+};
+
+class AsmInstruction {
+public:
+    AsmInstruction(OpCode op, int size = 8, std::vector<Operand> operands = {},
+                   Condition condition = Condition::None);
+    AsmInstruction(std::string label);
+    OpCode GetOpCode() const;
+    int GetSize() const;
+    Condition GetCondition() const;
+    const std::vector<Operand> &GetOperands() const;
+    std::vector<Operand> &GetOperands();
+    const std::string &GetLabel() const;
+    const std::string GetText() const;
+private:
+    OpCode op;
+    int size;
+    Condition condition;
+    std::vector<Operand> operands;
+    std::string label;
+    static const std::string GetSuffix(int size);
+};
+
+class AsmData {
+public:
+    AsmData(std::string label, std::vector<unsigned char> bytes, int align, bool readOnly);
+    const std::string &GetLabel() const;
+    const std::vector<unsigned char> &GetBytes() const;
+    int GetAlign() const;
+    bool IsReadOnly() const;
+    void Print(std::ostream &out) const;
+private:
+    std::string label;
+    std::vector<unsigned char> bytes;
+    int align;
+    bool readOnly;
+    static const int bytesPerLine = 16;
+};
+
+class AsmProgram {
+public:
+    void Emit(AsmInstruction instruction);
+    void AddData(AsmData data);
+    void AddGlobal(std::string label);
+    std::vector<AsmInstruction> &GetCode();
+    const std::vector<AsmData> &GetData() const;
+    const std::vector<std::string> &GetGlobals() const;
+    void Print(std::ostream &out) const;
+private:
+    std::vector<AsmInstruction> code;
+    std::vector<AsmData> data;
+    std::vector<std::string> globals;
+};
+typedef std::shared_ptr<AsmProgram> PAsmProgram;
@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <ostream>
+#include <memory>
+
+// Outcome of one file of a batch: what the single-file mode would have printed for it, and
+// whether that ended in a diagnostic.
+class BatchResult {
+public:
+    BatchResult(std::string fileName);
+    const std::string &GetFileName() const;
+    const std::string &GetOutput() const;
+    bool IsOk() const;
+    double GetSeconds() const;
+private:
+    friend class Batch;
+    std::string fileName;
+    std::string output;
+    bool ok;
+    double seconds;
+};
+
+// Runs one front-end mode (-s, -pe, -pd or -ps) over every file named by a manifest, or found
+// under a directory, spreading the files over a pool of threads. Results keep the input order.
+class Batch {
+public:
+    Batch(std::string mode, std::string path, int threads);
+    static bool IsMode(const std::string &mode);
+    static bool Run(const std::string &mode, const char *fileName, std::ostream &out, int threads = 1,
+                    bool pipelined = false);
+    const std::vector<BatchResult> &GetResults() const;
+    void Write(const std::string &outputDir) const;
+    void Print(std::ostream &out) const;
+    void PrintSummary(std::ostream &out) const;
+private:
+    std::string mode;
+    std::string root;
+    std::vector<BatchResult> results;
+    int threads;
+    double seconds;
+    void ReadManifest(const std::string &path);
+    void ReadDirectory(const std::string &path);
+};
+typedef std::shared_ptr<Batch> PBatch;
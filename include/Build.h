@@ -0,0 +1,71 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <memory>
+#include "ThreadPool.h"
+
+enum class BuildState {
+    Pending,
+    Compiled,
+    UpToDate,
+    Failed,
+    Skipped
+};
+
+// One node of a build: a unit, or the program at the root, with the units it uses and what
+// became of it.
+class BuildUnit {
+public:
+    BuildUnit(std::string name, std::string sourceFileName, std::string interfaceFileName);
+    const std::string &GetName() const;
+    const std::string &GetSourceFileName() const;
+    BuildState GetState() const;
+    const std::string &GetOutput() const;
+    double GetSeconds() const;
+private:
+    friend class Build;
+    std::string name;
+    std::string sourceFileName;
+    std::string interfaceFileName;
+    std::vector<BuildUnit*> uses;
+    std::vector<BuildUnit*> users;
+    int waiting;
+    BuildState state;
+    std::string output;
+    unsigned long long hash;
+    double seconds;
+};
+typedef std::shared_ptr<BuildUnit> PBuildUnit;
+
+// Builds a program or unit with every unit it uses, directly or not. The uses clauses alone give
+// the graph, which must have no cycles; a unit is compiled once all the units it uses are, several
+// at a time on a pool of threads. A unit whose interface file records the hash of its current
+// source and the current interfaces of the units it uses is not compiled again, so an edit that
+// leaves an interface alone stops at that unit. The program at the root is always parsed.
+class Build {
+public:
+    Build(std::string fileName, int threads);
+    const std::vector<PBuildUnit> &GetUnits() const;
+    bool IsOk() const;
+    void Print(std::ostream &out) const;
+    void PrintCriticalPath(std::ostream &out) const;
+private:
+    std::vector<PBuildUnit> units;
+    std::map<std::string, BuildUnit*> unitNames;
+    std::mutex mutex;
+    PThreadPool pool;
+    int threads;
+    double seconds;
+    BuildUnit *AddUnit(const std::string &name, const std::string &sourceFileName,
+                       const std::string &interfaceFileName);
+    void ReadUses(BuildUnit *unit);
+    void CheckCycles();
+    void Start(BuildUnit *unit);
+    void Finish(BuildUnit *unit);
+    bool IsCurrent(BuildUnit *unit);
+    void Compile(BuildUnit *unit);
+};
+typedef std::shared_ptr<Build> PBuild;
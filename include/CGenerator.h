@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <ostream>
+#include "Ir.h"
+
+class CGenerator {
+public:
+    CGenerator(PIrModule module);
+    void Print(std::ostream &out);
+    void Build(const std::string &output);
+private:
+    PIrModule module;
+    PIrFunction function;
+    std::ostringstream prototypes;
+    std::ostringstream globals;
+    std::ostringstream functions;
+    bool runtimeUsed;
+    bool rangeChecked;
+    bool divideChecked;
+    void Run();
+    void GenerateGlobals();
+    void GenerateFunction(PIrFunction irFunction);
+    void GenerateRuntime(std::ostream &out);
+    void GenerateRangeError(std::ostream &out);
+    void GenerateDivideError(std::ostream &out);
+    std::string GenerateHeader(PIrFunction irFunction);
+    void GenBlock(IrBlock *block, IrBlock *next, std::ostream &out);
+    void GenInstruction(IrInstruction *instruction, std::ostream &out);
+    void GenPhiCopies(IrBlock *from, IrBlock *to, std::ostream &out);
+    void GenTerminator(IrInstruction *instruction, IrBlock *next, std::ostream &out);
+    std::string GenExpression(IrInstruction *instruction);
+    std::string GenIndex(IrInstruction *instruction);
+    std::string GetValue(IrInstruction *value);
+    static std::string GetName(const std::string &label);
+    static std::string GetBlockName(IrBlock *block);
+    static std::string GetTypeName(IrType type);
+    static std::string GetStorage(int size, const std::string &name);
+    static bool IsInlined(IrInstruction *value);
+    static std::string IntText(long long value);
+    static std::string Quote(const std::string &value);
+    static std::string DoubleText(double value);
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include <map>
+#include <set>
+#include <memory>
+#include "Node.h"
+#include "Symbols.h"
+
+// Procedures called from each body, read off the call sites in the tree, and the procedures
+// reachable from the main block. The main block itself is keyed by nullptr.
+class CallGraph {
+public:
+    CallGraph(PNode tree, PSymbolTable globals);
+    const std::set<Symbol*> &GetCallees(Symbol *procedure) const;
+    bool IsReachable(Symbol *procedure) const;
+    int GetProcedureCount() const;
+    int GetRemovedCount() const;
+    int GetRemovedSize() const;
+private:
+    std::map<Symbol*, std::set<Symbol*>> callees;
+    std::map<Symbol*, int> sizes;
+    std::set<Symbol*> reachable;
+    void AddProcedures(PSymbolTable table);
+    void AddBody(Symbol *procedure, PNode body);
+    void Visit(PNode node, std::set<Symbol*> &calls, int &size);
+    void FindReachable();
+};
+typedef std::shared_ptr<CallGraph> PCallGraph;
@@ -0,0 +1,100 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <ostream>
+#include "Asm.h"
+#include "Ir.h"
+#include "Encoder.h"
+#include "RegisterAllocator.h"
+
+static const std::map<IrCondition, Condition> intCondition = {
+        { IrCondition::Eq, Condition::E  },
+        { IrCondition::Ne, Condition::NE },
+        { IrCondition::Lt, Condition::L  },
+        { IrCondition::Le, Condition::LE },
+        { IrCondition::Gt, Condition::G  },
+        { IrCondition::Ge, Condition::GE }
+};
+
+static const std::map<IrCondition, Condition> doubleCondition = {
+        { IrCondition::Eq, Condition::E  },
+        { IrCondition::Ne, Condition::NE },
+        { IrCondition::Lt, Condition::B  },
+        { IrCondition::Le, Condition::BE },
+        { IrCondition::Gt, Condition::A  },
+        { IrCondition::Ge, Condition::AE }
+};
+
+class CodeGenerator {
+public:
+    CodeGenerator(PIrModule module);
+    void Print(std::ostream &out);
+    void Build(const std::string &output);
+    void BuildObject(const std::string &output);
+    void BuildStatic(const std::string &output);
+    int RunJit();
+    const PAsmProgram GetProgram() const;
+private:
+    PIrModule module;
+    PAsmProgram program;
+    PIrFunction function;
+    std::map<IrInstruction*, int> offsets;
+    std::map<IrInstruction*, Register> homes;
+    std::vector<std::pair<Register, int>> savedRegisters;
+    std::vector<int> slotOffsets;
+    std::map<IrBlock*, std::string> blockLabels;
+    std::map<std::string, std::string> formats;
+    std::map<long long, std::string> doubles;
+    std::string exitLabel;
+    int frameSize;
+    int spillBase;
+    int labelCount;
+    bool runtimeUsed;
+    bool rangeChecked;
+    bool divideChecked;
+    void Run();
+    void GenerateGlobals();
+    void GenerateFunction(PIrFunction irFunction);
+    void GenerateRuntime();
+    void GenerateRangeError();
+    void GenerateDivideError();
+    void GeneratePrologue(std::string label);
+    void GenerateParams();
+    void GenerateEpilogue(int frameInstruction);
+    void RestoreRegisters();
+    void GenBlock(IrBlock *block, IrBlock *next);
+    void GenInstruction(IrInstruction *instruction);
+    void GenIntOp(IrInstruction *instruction);
+    void GenDoubleOp(IrInstruction *instruction);
+    void GenIndex(IrInstruction *instruction);
+    void GenLoad(IrInstruction *instruction);
+    void GenStore(IrInstruction *instruction);
+    void GenCopy(IrInstruction *instruction);
+    void GenCheck(IrInstruction *instruction);
+    void GenCall(IrInstruction *instruction);
+    bool IsSiblingCall(IrInstruction *instruction);
+    void GenSiblingCall(IrInstruction *instruction);
+    void GenWrite(IrInstruction *instruction);
+    void GenPhiCopies(IrBlock *from, IrBlock *to);
+    void GenTerminator(IrInstruction *instruction, IrBlock *next);
+    void LoadValue(IrInstruction *value, Register reg);
+    void LoadWord(IrInstruction *value, Register reg);
+    void StoreValue(IrInstruction *value, Register reg);
+    void StoreWord(IrInstruction *value, Register reg);
+    bool HasHome(IrInstruction *value) const;
+    Operand GetAddress(IrInstruction *address, Register reg);
+    void CallPrintf(std::string format, int doubleCount = 0);
+    void LoadDouble(double value, Register reg);
+    std::string AddFormat(std::string value);
+    int Allocate(int size);
+    std::string NewLabel();
+    static bool IsRematerialized(IrInstruction *value);
+    void Emit(OpCode op, int size = 8, std::vector<Operand> operands = {});
+    void EmitJump(Condition condition, std::string label);
+    void EmitLabel(std::string label);
+    static const int slotSize = 8;
+    static const int stackAlign = 16;
+    static const int maxIntArgs = 6;
+    static const int maxDoubleArgs = 8;
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+
+// What one run of the compiler left behind: everything it printed, diagnostics included, whether
+// it succeeded and the file it built, if it built one.
+class CachedRun {
+public:
+    CachedRun(std::string output = "", bool ok = true, bool built = false, std::string artifact = "", int fileMode = 0);
+    const std::string &GetOutput() const;
+    bool IsOk() const;
+    bool IsBuilt() const;
+    const std::string &GetArtifact() const;
+    int GetFileMode() const;
+private:
+    friend class CompileCache;
+    std::string output;
+    bool ok;
+    bool built;
+    std::string artifact;
+    int fileMode;
+};
+
+// Runs kept on disk, one file per run, named by a hash of the source, the compiler binary and the
+// flags that change the output. Reading an entry marks it used; storing one evicts the least
+// recently used entries until the directory is within its limit.
+class CompileCache {
+public:
+    CompileCache(std::string directory, long long limit = defaultLimit);
+    std::string GetKey(const std::string &fileName, const std::vector<std::string> &flags) const;
+    bool Load(const std::string &key, CachedRun &run) const;
+    void Store(const std::string &key, const CachedRun &run) const;
+    static unsigned long long Hash(const char *data, size_t size, unsigned long long seed = 0);
+    static const long long defaultLimit = 256LL << 20;
+private:
+    std::string directory;
+    long long limit;
+    static unsigned long long GetVersion();
+    void Evict() const;
+};
+typedef std::shared_ptr<CompileCache> PCompileCache;
@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// What travels over the compile server's socket. A request is the client's working directory
+// followed by its command line; a response is an exit status followed by what the command
+// printed. Strings go as a 32-bit length and the bytes.
+class CompileRequest {
+public:
+    CompileRequest(std::string directory = "", std::vector<std::string> args = {});
+    const std::string &GetDirectory() const;
+    const std::vector<std::string> &GetArgs() const;
+    bool Send(int socket) const;
+    static bool Receive(int socket, CompileRequest &request);
+private:
+    std::string directory;
+    std::vector<std::string> args;
+};
+
+class CompileResponse {
+public:
+    CompileResponse(int status = 0, std::string output = "");
+    int GetStatus() const;
+    const std::string &GetOutput() const;
+    bool Send(int socket) const;
+    static bool Receive(int socket, CompileResponse &response);
+private:
+    int status;
+    std::string output;
+};
+
+// The socket used when COMPILER_SOCKET is not set: one per user under /tmp.
+std::string DefaultSocketPath();
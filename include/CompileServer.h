@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include "CompileProtocol.h"
+#include "ThreadPool.h"
+
+// What a file printed in one mode, and the state of the file it was printed from and of the unit
+// interfaces beside it.
+class CachedOutput {
+public:
+    CachedOutput(long long modified = 0, long long size = 0, unsigned long long units = 0, std::string output = "");
+    bool IsCurrent(long long modified, long long size, unsigned long long units) const;
+    const std::string &GetOutput() const;
+    unsigned long long GetLastUse() const;
+    void SetLastUse(unsigned long long lastUse);
+private:
+    long long modified;
+    long long size;
+    unsigned long long units;
+    std::string output;
+    unsigned long long lastUse;
+};
+
+// A resident compiler answering the front-end modes (-s, -pe, -pd, -ps) over a Unix domain socket,
+// several requests at a time, each on one thread. The scanner tables and symbol tables built at
+// startup stay warm between requests, and so does the output for every file until it changes
+// on disk. -status reports requests and cache hits; -stop shuts the server down.
+class CompileServer {
+public:
+    CompileServer(std::string socketPath, int threads);
+    ~CompileServer();
+    void Run();
+    static const int maxCached = 4096;
+private:
+    std::string socketPath;
+    int listener;
+    PThreadPool pool;
+    std::mutex mutex;
+    std::map<std::string, CachedOutput> cache;
+    unsigned long long requests;
+    unsigned long long hits;
+    std::atomic<bool> stopping;
+    void Serve(int connection);
+    CompileResponse Handle(const CompileRequest &request);
+    CompileResponse Compile(const std::string &mode, const std::string &fileName);
+};
+typedef std::shared_ptr<CompileServer> PCompileServer;
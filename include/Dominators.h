@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+#include <map>
+#include <set>
+#include "Ir.h"
+
+class IrLoop {
+public:
+    IrLoop(IrBlock *header);
+    IrBlock *GetHeader() const;
+    const std::set<IrBlock*> &GetBlocks() const;
+    const std::vector<IrBlock*> &GetLatches() const;
+    bool Contains(IrBlock *block) const;
+    bool Contains(IrInstruction *instruction) const;
+    void AddBlock(IrBlock *block);
+    void AddLatch(IrBlock *latch);
+private:
+    IrBlock *header;
+    std::set<IrBlock*> blocks;
+    std::vector<IrBlock*> latches;
+};
+
+class DominatorTree {
+public:
+    DominatorTree(PIrFunction function);
+    IrBlock *GetIdom(IrBlock *block) const;
+    const std::vector<IrBlock*> &GetChildren(IrBlock *block) const;
+    const std::vector<IrBlock*> &GetOrder() const;
+    bool Dominates(IrBlock *dominator, IrBlock *block) const;
+    bool Dominates(IrInstruction *definition, IrInstruction *use) const;
+    std::vector<IrLoop> FindLoops() const;
+private:
+    PIrFunction function;
+    std::vector<IrBlock*> order;
+    std::map<IrBlock*, int> index;
+    std::map<IrBlock*, IrBlock*> idoms;
+    std::map<IrBlock*, std::vector<IrBlock*>> children;
+    IrBlock *Intersect(IrBlock *first, IrBlock *second) const;
+};
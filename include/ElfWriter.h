@@ -0,0 +1,21 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include "Encoder.h"
+
+class ElfWriter {
+public:
+    ElfWriter(const Encoder &encoder);
+    void WriteObject(const std::string &fileName);
+    void WriteExecutable(const std::string &fileName);
+private:
+    const Encoder &encoder;
+    std::vector<unsigned char> file;
+    void Write(const std::string &fileName, bool executable);
+    void Append(const void *data, size_t size);
+    void Align(size_t align);
+    static int AddString(std::vector<unsigned char> &table, const std::string &value);
+    static const unsigned long long baseAddress = 0x400000;
+    static const unsigned long long pageSize = 0x1000;
+};
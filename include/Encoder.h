@@ -0,0 +1,109 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include "Asm.h"
+
+enum class SectionType {
+    Text,
+    ReadOnlyData,
+    Data,
+    Undefined
+};
+
+static const std::map<Condition, int> conditionCode = {
+        { Condition::B,  0x2 },
+        { Condition::AE, 0x3 },
+        { Condition::E,  0x4 },
+        { Condition::NE, 0x5 },
+        { Condition::BE, 0x6 },
+        { Condition::A,  0x7 },
+        { Condition::L,  0xC },
+        { Condition::GE, 0xD },
+        { Condition::LE, 0xE },
+        { Condition::G,  0xF }
+};
+
+enum class RelocationType {
+    PC32,
+    PLT32
+};
+
+class ObjectSymbol {
+public:
+    ObjectSymbol(std::string name, SectionType section, long long offset, bool global, bool function);
+    const std::string &GetName() const;
+    SectionType GetSection() const;
+    long long GetOffset() const;
+    long long GetSize() const;
+    void SetSize(long long size);
+    bool IsGlobal() const;
+    bool IsFunction() const;
+private:
+    std::string name;
+    SectionType section;
+    long long offset;
+    long long size = 0;
+    bool global;
+    bool function;
+};
+
+class Relocation {
+public:
+    Relocation(long long offset, std::string symbol, RelocationType type, long long addend);
+    long long GetOffset() const;
+    const std::string &GetSymbol() const;
+    RelocationType GetType() const;
+    long long GetAddend() const;
+private:
+    long long offset;
+    std::string symbol;
+    RelocationType type;
+    long long addend;
+};
+
+class Encoder {
+public:
+    Encoder(PAsmProgram program);
+    const std::vector<unsigned char> &GetSection(SectionType section) const;
+    int GetAlign(SectionType section) const;
+    const std::vector<ObjectSymbol> &GetSymbols() const;
+    const std::vector<Relocation> &GetRelocations() const;
+    const ObjectSymbol *FindSymbol(const std::string &name) const;
+private:
+    PAsmProgram program;
+    std::map<SectionType, std::vector<unsigned char>> sections;
+    std::map<SectionType, int> aligns;
+    std::vector<ObjectSymbol> symbols;
+    std::map<std::string, int> symbolNames;
+    std::vector<Relocation> relocations;
+    std::vector<Relocation> fixups;
+    std::vector<std::pair<int, Relocation>> shortFixups;
+    std::set<std::string> localLabels;
+    std::set<int> longBranches;
+    int current;
+    void EncodeData();
+    void EncodeCode();
+    void ClearCode(int dataSymbols);
+    bool ResolveFixups();
+    void AddSymbol(ObjectSymbol symbol);
+    void Encode(const AsmInstruction &instruction);
+    void EncodeAlu(const AsmInstruction &instruction, int extension, unsigned char opCode);
+    void EncodeShift(const AsmInstruction &instruction, int extension);
+    void EncodeUnary(const AsmInstruction &instruction, int extension);
+    void EncodeSse(unsigned char prefix, unsigned char opCode, const Operand &reg, const Operand &rm,
+                   bool wide = false);
+    void EncodeBranch(std::vector<unsigned char> opCode, const Operand &target);
+    bool IsShort(const Operand &target) const;
+    void EncodeShortBranch(unsigned char opCode, const Operand &target);
+    void EmitFixup(const std::string &label, RelocationType type, long long addend);
+    void EmitRex(bool wide, int reg, const Operand &rm, bool byteRm = false, bool byteReg = false);
+    void EmitModRm(int reg, const Operand &rm, int immSize = 0);
+    void EmitImm(long long value, int size);
+    void EmitByte(unsigned char byte);
+    static int GetCode(Register reg);
+    static bool IsByte(long long value);
+};
+typedef std::shared_ptr<Encoder> PEncoder;
@@ -20,7 +20,7 @@ enum class ErrorType {
     InvalidVariable
 };
 
-static std::map<ErrorType, std::string> errorName = {
+static const std::map<ErrorType, std::string> errorName = {
         { ErrorType::IllegalExpression,     "Illegal expression"                   },
         { ErrorType::IllegalStatement,      "Illegal statement"                    },
         { ErrorType::IllegalQualifier,      "Illegal qualifier"                    },
@@ -86,4 +86,43 @@ public:
 class WrongCountParameters: public Error {
 public:
     WrongCountParameters(Token&, std::string);
-};
\ No newline at end of file
+};
+class UnitNotFound: public Error {
+public:
+    UnitNotFound(Token&, std::string);
+};
+
+class ForwardNotSolved: public Error {
+public:
+    ForwardNotSolved(Token&, std::string);
+};
+
+class NotSupported: public Error {
+public:
+    NotSupported(Token&, std::string);
+};
+
+class BuildError: public Error {
+public:
+    BuildError(std::string command, std::string diagnostics = "");
+};
+
+class FileNotWritten: public Error {
+public:
+    FileNotWritten(std::string);
+};
+
+class UndefinedSymbol: public Error {
+public:
+    UndefinedSymbol(std::string);
+};
+
+class InvalidInterface: public Error {
+public:
+    InvalidInterface(std::string);
+};
+
+class JitError: public Error {
+public:
+    JitError(std::string);
+};
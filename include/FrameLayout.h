@@ -0,0 +1,24 @@
+#pragma once
+#include <vector>
+#include <map>
+#include "Ir.h"
+
+// Places a function's slots in its frame. A slot is live from the first to the last instruction
+// that reaches it through its address or a pointer derived from it, widened over any loop it is
+// used in; slots whose lifetimes do not overlap share storage.
+class FrameLayout {
+public:
+    FrameLayout(PIrFunction function);
+    int GetOffset(int slot) const;
+    int GetSize() const;
+private:
+    PIrFunction function;
+    std::vector<int> starts;
+    std::vector<int> ends;
+    std::vector<int> offsets;
+    int size;
+    void FindLifetimes();
+    void Place();
+    static int AlignUp(int value, int align);
+    static const int minAlign = 8;
+};
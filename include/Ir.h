@@ -0,0 +1,297 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <ostream>
+
+enum class IrType {
+    Void,
+    Int,
+    Double,
+    Pointer
+};
+
+static const std::map<IrType, std::string> irTypeName = {
+        { IrType::Void,    "void"   },
+        { IrType::Int,     "int"    },
+        { IrType::Double,  "double" },
+        { IrType::Pointer, "ptr"    }
+};
+
+enum class IrOp {
+    Const,
+    Param,
+    Phi,
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Mod,
+    And,
+    Or,
+    Xor,
+    Shl,
+    Shr,
+    Neg,
+    Not,
+    FAdd,
+    FSub,
+    FMul,
+    FDiv,
+    FNeg,
+    Cmp,
+    FCmp,
+    IntToDouble,
+    DoubleToInt,
+    SlotAddr,
+    GlobalAddr,
+    Index,
+    Load,
+    Store,
+    Copy,
+    Check,
+    Call,
+    Write,
+    Jump,
+    Branch,
+    Return
+};
+
+static const std::map<IrOp, std::string> irOpName = {
+        { IrOp::Const,       "const"    },
+        { IrOp::Param,       "param"    },
+        { IrOp::Phi,         "phi"      },
+        { IrOp::Add,         "add"      },
+        { IrOp::Sub,         "sub"      },
+        { IrOp::Mul,         "mul"      },
+        { IrOp::Div,         "div"      },
+        { IrOp::Mod,         "mod"      },
+        { IrOp::And,         "and"      },
+        { IrOp::Or,          "or"       },
+        { IrOp::Xor,         "xor"      },
+        { IrOp::Shl,         "shl"      },
+        { IrOp::Shr,         "shr"      },
+        { IrOp::Neg,         "neg"      },
+        { IrOp::Not,         "not"      },
+        { IrOp::FAdd,        "fadd"     },
+        { IrOp::FSub,        "fsub"     },
+        { IrOp::FMul,        "fmul"     },
+        { IrOp::FDiv,        "fdiv"     },
+        { IrOp::FNeg,        "fneg"     },
+        { IrOp::Cmp,         "cmp"      },
+        { IrOp::FCmp,        "fcmp"     },
+        { IrOp::IntToDouble, "itod"     },
+        { IrOp::DoubleToInt, "dtoi"     },
+        { IrOp::SlotAddr,    "slotaddr" },
+        { IrOp::GlobalAddr,  "global"   },
+        { IrOp::Index,       "index"    },
+        { IrOp::Load,        "load"     },
+        { IrOp::Store,       "store"    },
+        { IrOp::Copy,        "copy"     },
+        { IrOp::Check,       "check"    },
+        { IrOp::Call,        "call"     },
+        { IrOp::Write,       "write"    },
+        { IrOp::Jump,        "jmp"      },
+        { IrOp::Branch,      "br"       },
+        { IrOp::Return,      "ret"      }
+};
+
+enum class IrCondition {
+    Eq,
+    Ne,
+    Lt,
+    Le,
+    Gt,
+    Ge
+};
+
+static const std::map<IrCondition, std::string> irConditionName = {
+        { IrCondition::Eq, "eq" },
+        { IrCondition::Ne, "ne" },
+        { IrCondition::Lt, "lt" },
+        { IrCondition::Le, "le" },
+        { IrCondition::Gt, "gt" },
+        { IrCondition::Ge, "ge" }
+};
+
+enum class IrWrite {
+    Int,
+    Char,
+    Double,
+    String,
+    NewLine
+};
+
+static const std::map<IrWrite, std::string> irWriteName = {
+        { IrWrite::Int,     "int"     },
+        { IrWrite::Char,    "char"    },
+        { IrWrite::Double,  "double"  },
+        { IrWrite::String,  "string"  },
+        { IrWrite::NewLine, "newline" }
+};
+
+class IrBlock;
+
+class IrInstruction {
+public:
+    IrInstruction(IrOp op, IrType type, std::vector<IrInstruction*> operands = {});
+    IrOp GetOp() const;
+    void SetOp(IrOp op);
+    IrType GetType() const;
+    int GetId() const;
+    void SetId(int id);
+    const std::vector<IrInstruction*> &GetOperands() const;
+    IrInstruction *GetOperand(int index) const;
+    void SetOperand(int index, IrInstruction *operand);
+    void AddOperand(IrInstruction *operand);
+    void RemoveOperand(int index);
+    void ClearOperands();
+    const std::vector<IrBlock*> &GetTargets() const;
+    void SetTarget(int index, IrBlock *target);
+    void AddTarget(IrBlock *target);
+    void RemoveTarget(int index);
+    void ClearTargets();
+    IrBlock *GetBlock() const;
+    void SetBlock(IrBlock *block);
+    long long GetInt() const;
+    void SetInt(long long value);
+    double GetDouble() const;
+    void SetDouble(double value);
+    IrCondition GetCondition() const;
+    void SetCondition(IrCondition condition);
+    const std::string &GetName() const;
+    void SetName(const std::string &name);
+    int GetSize() const;
+    void SetSize(int size);
+    IrWrite GetWrite() const;
+    void SetWrite(IrWrite write);
+    bool IsTerminator() const;
+    bool HasSideEffects() const;
+    bool IsPure() const;
+    bool IsCommutative() const;
+    bool IsTailCall() const;
+    bool PassesFrameAddress() const;
+    void Print(std::ostream &out) const;
+private:
+    IrOp op;
+    IrType type;
+    int id = -1;
+    std::vector<IrInstruction*> operands;
+    std::vector<IrBlock*> targets;
+    IrBlock *block = nullptr;
+    long long intValue = 0;
+    double doubleValue = 0.0;
+    IrCondition condition = IrCondition::Eq;
+    std::string name;
+    int size = 0;
+    IrWrite write = IrWrite::Int;
+};
+
+class IrBlock {
+public:
+    IrBlock(int id);
+    int GetId() const;
+    void SetId(int id);
+    std::vector<IrInstruction*> &GetInstructions();
+    IrInstruction *GetTerminator() const;
+    std::vector<IrBlock*> GetSuccessors() const;
+    std::vector<IrBlock*> &GetPredecessors();
+    std::vector<IrInstruction*> GetPhis() const;
+    void Append(IrInstruction *instruction);
+    void Insert(int index, IrInstruction *instruction);
+    void InsertBeforeTerminator(IrInstruction *instruction);
+    void InsertAfterPhis(IrInstruction *instruction);
+    void Remove(IrInstruction *instruction);
+    void RemovePhiIncoming(IrBlock *predecessor);
+    void ReplaceSuccessor(IrBlock *from, IrBlock *to);
+    void Print(std::ostream &out) const;
+private:
+    int id;
+    std::vector<IrInstruction*> instructions;
+    std::vector<IrBlock*> predecessors;
+};
+
+class IrSlot {
+public:
+    IrSlot(int size, int align, std::string name);
+    int GetSize() const;
+    int GetAlign() const;
+    const std::string &GetName() const;
+private:
+    int size;
+    int align;
+    std::string name;
+};
+
+class IrFunction {
+public:
+    IrFunction(std::string name, IrType returnType, bool exported = false);
+    const std::string &GetName() const;
+    IrType GetReturnType() const;
+    bool IsExported() const;
+    const std::vector<IrType> &GetParamTypes() const;
+    void AddParamType(IrType type);
+    const std::vector<IrSlot> &GetSlots() const;
+    int AddSlot(int size, int align, std::string name);
+    std::vector<IrBlock*> GetBlocks() const;
+    IrBlock *GetEntry() const;
+    IrBlock *NewBlock();
+    void MoveBlockToEnd(IrBlock *block);
+    void MoveBlockAfter(IrBlock *block, IrBlock *after);
+    IrInstruction *NewInstruction(IrOp op, IrType type, std::vector<IrInstruction*> operands = {});
+    void RemoveBlock(IrBlock *block);
+    void RemoveBlocks(const std::set<IrBlock*> &removed);
+    void RemoveUnreachableBlocks();
+    void ReplaceAllUses(IrInstruction *from, IrInstruction *to);
+    bool RemoveTrivialPhis();
+    bool MergeBlocks();
+    std::vector<IrInstruction*> GetUsers(IrInstruction *value) const;
+    void ComputePredecessors();
+    IrBlock *SplitEdge(IrBlock *from, IrBlock *to);
+    IrBlock *InsertPreheader(IrBlock *header, const std::set<IrBlock*> &loop);
+    void SplitCriticalEdges();
+    void Renumber();
+    void Print(std::ostream &out);
+private:
+    std::string name;
+    IrType returnType;
+    bool exported;
+    std::vector<IrType> paramTypes;
+    std::vector<IrSlot> slots;
+    std::vector<std::unique_ptr<IrBlock>> blocks;
+    std::vector<std::unique_ptr<IrInstruction>> pool;
+    int blockCount = 0;
+};
+typedef std::shared_ptr<IrFunction> PIrFunction;
+
+class IrGlobal {
+public:
+    IrGlobal(std::string name, std::vector<unsigned char> bytes, int align, bool readOnly);
+    const std::string &GetName() const;
+    const std::vector<unsigned char> &GetBytes() const;
+    int GetAlign() const;
+    bool IsReadOnly() const;
+private:
+    std::string name;
+    std::vector<unsigned char> bytes;
+    int align;
+    bool readOnly;
+};
+
+class IrModule {
+public:
+    const std::vector<IrGlobal> &GetGlobals() const;
+    void AddGlobal(IrGlobal global);
+    std::string AddString(const std::string &value);
+    const std::vector<PIrFunction> &GetFunctions() const;
+    void AddFunction(PIrFunction function);
+    PIrFunction FindFunction(const std::string &name) const;
+    void Print(std::ostream &out);
+private:
+    std::vector<IrGlobal> globals;
+    std::vector<PIrFunction> functions;
+    std::map<std::string, std::string> strings;
+};
+typedef std::shared_ptr<IrModule> PIrModule;
@@ -0,0 +1,100 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include "Ir.h"
+#include "Node.h"
+#include "Symbols.h"
+#include "Layout.h"
+#include "CallGraph.h"
+
+class IrBuilder {
+public:
+    IrBuilder(PNode tree, PSymbolTableStack tableStack, int unrollFactor = defaultUnrollFactor);
+    const PIrModule GetModule() const;
+    const std::vector<std::string> &GetLog() const;
+    static const int defaultUnrollFactor = 4;
+private:
+    PNode tree;
+    PSymbolTableStack tableStack;
+    PIrModule module;
+    PIrFunction function;
+    IrBlock *block;
+    PSymbolProcedure procedure;
+    std::map<Symbol*, std::string> labels;
+    std::map<Symbol*, int> slots;
+    std::map<Symbol*, std::vector<IrInstruction*>> openArrays;
+    std::map<Symbol*, IrType> variables;
+    std::map<Symbol*, std::map<IrBlock*, IrInstruction*>> definitions;
+    std::map<IrBlock*, std::map<Symbol*, IrInstruction*>> incompletePhis;
+    std::set<IrBlock*> sealedBlocks;
+    std::set<Symbol*> sharedGlobals;
+    TypeLayout layout;
+    PCallGraph callGraph;
+    int labelCount;
+    int unrollFactor;
+    std::vector<std::string> log;
+    void Run();
+    void CollectLabels(PSymbolTable table);
+    void LowerGlobals(PSymbolTable table);
+    void LowerProcedures(PSymbolTable table);
+    void LowerProcedure(PSymbolProcedure symbol);
+    void LowerMain();
+    void LowerArguments(PSymbolProcHeader header);
+    void LowerLocals(PSymbolTable locals);
+    void PromoteVariable(PSymbolComplex symbol);
+    void BeginFunction(std::string name, IrType returnType, bool exported = false);
+    void EndFunction();
+    void LowerStatement(PNode node);
+    void LowerCompoundStatement(PNodeCompoundStatement node);
+    void LowerAssignment(PNodeAssignmentOp node);
+    void LowerIfStatement(PNodeIfStatement node);
+    void LowerForStatement(PNodeForStatement node);
+    void LowerCountedLoop(PNodeForStatement node, IrInstruction *finalValue);
+    void LowerUnrolledLoop(PNodeForStatement node, Symbol *variable, long long first, long long count);
+    bool IsUnrollable(PNode node, Symbol *variable);
+    void LowerWhileStatement(PNodeWhileStatement node);
+    void LowerRepeatStatement(PNodeRepeatStatement node);
+    void LowerWriteStatement(PNodeWriteStatement node);
+    IrInstruction *LowerExpression(PNodeOp node);
+    IrInstruction *LowerBinOp(PNodeBinOp node);
+    IrInstruction *LowerDoubleBinOp(PNodeBinOp node);
+    IrInstruction *LowerIntBinOp(PNodeBinOp node);
+    IrInstruction *LowerUnOp(PNodeUnOp node);
+    IrInstruction *LowerValue(PNodeValue node);
+    IrInstruction *LowerAddress(PNodeOp node);
+    IrInstruction *LowerBrackets(PNodeBrackets node);
+    IrInstruction *LowerStaticIndex(PNodeBrackets node, int first, int rank, IrInstruction *address,
+                                    const ArrayLayout &array);
+    IrInstruction *LowerPeriod(PNodePeriod node);
+    IrInstruction *LowerCall(PNodeOp name, const std::vector<PNodeOp> &parameters);
+    IrInstruction *Convert(IrInstruction *value, IrType type);
+    Symbol *GetVariable(PNodeOp node);
+    void WriteVariable(Symbol *variable, IrBlock *target, IrInstruction *value);
+    IrInstruction *ReadVariable(Symbol *variable, IrBlock *target);
+    IrInstruction *ReadVariableRecursive(Symbol *variable, IrBlock *target);
+    void AddPhiOperands(Symbol *variable, IrInstruction *phi);
+    void SealBlock(IrBlock *target);
+    IrInstruction *NewPhi(Symbol *variable, IrBlock *target);
+    IrInstruction *Emit(IrOp op, IrType type, std::vector<IrInstruction*> operands = {});
+    IrInstruction *EmitConst(IrType type, long long value);
+    IrInstruction *EmitConst(double value);
+    IrInstruction *EmitIndex(IrInstruction *base, IrInstruction *index, int scale, long long disp);
+    IrInstruction *EmitLoad(IrType type, int size, IrInstruction *address);
+    void EmitStore(int size, IrInstruction *address, IrInstruction *value);
+    void EmitJump(IrBlock *target);
+    void EmitBranch(IrInstruction *condition, IrBlock *trueTarget, IrBlock *falseTarget);
+    void EmitWrite(IrWrite write, IrInstruction *value = nullptr);
+    IrBlock *NewBlock();
+    void StartBlock(IrBlock *target);
+    IrType GetIrType(PSymbolBase type);
+    int GetMemorySize(PSymbolBase type);
+    int GetSize(PSymbolBase type);
+    int GetFieldOffset(PSymbolRecord record, std::string field, PSymbolBase &type);
+    std::vector<unsigned char> GetInitBytes(PSymbolBase type, std::any value);
+    static bool GetConstant(IrInstruction *value, long long &result);
+    static bool IsAggregate(PSymbolBase type);
+    static bool IsType(PSymbolBase type, BaseType base);
+    static const int slotSize = 8;
+};
@@ -0,0 +1,245 @@
+#pragma once
+#include <string>
+#include <climits>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <ostream>
+#include "Ir.h"
+#include "Dominators.h"
+
+class IrPass {
+public:
+    virtual ~IrPass() {}
+    virtual const std::string GetName() const = 0;
+    virtual void Prepare(PIrModule module) {}
+    virtual bool Run(PIrFunction function) = 0;
+    virtual void PrintStatistics(std::ostream &out) const {}
+};
+typedef std::shared_ptr<IrPass> PIrPass;
+
+class PassManager {
+public:
+    PassManager(std::ostream *dump = nullptr);
+    void AddPass(PIrPass pass);
+    void AddStandardPasses();
+    void Run(PIrModule module);
+    void PrintStatistics(std::ostream &out) const;
+private:
+    std::vector<PIrPass> passes;
+    std::ostream *dump;
+};
+
+class InlinePass: public IrPass {
+public:
+    const std::string GetName() const { return "inline"; }
+    void Prepare(PIrModule module);
+    bool Run(PIrFunction function);
+    void PrintStatistics(std::ostream &out) const;
+    static const int maxCost = 12;
+private:
+    PIrModule module;
+    std::set<std::string> recursive;
+    int calls = 0;
+    int inlined = 0;
+    int GetCost(IrInstruction *call, PIrFunction callee) const;
+    void Inline(PIrFunction function, IrInstruction *call, PIrFunction callee);
+};
+
+class TailRecursionPass: public IrPass {
+public:
+    const std::string GetName() const { return "tailrec"; }
+    bool Run(PIrFunction function);
+    void PrintStatistics(std::ostream &out) const;
+private:
+    int eliminated = 0;
+};
+
+enum class LatticeState {
+    Top,
+    Constant,
+    Bottom
+};
+
+class LatticeValue {
+public:
+    LatticeValue();
+    static LatticeValue Int(long long value);
+    static LatticeValue Double(double value);
+    static LatticeValue Bottom();
+    LatticeState GetState() const;
+    long long GetInt() const;
+    double GetDouble() const;
+    bool Meet(const LatticeValue &other);
+    bool operator==(const LatticeValue &other) const;
+private:
+    LatticeState state;
+    long long intValue;
+    double doubleValue;
+};
+
+class SccpPass: public IrPass {
+public:
+    const std::string GetName() const { return "sccp"; }
+    bool Run(PIrFunction function);
+private:
+    std::map<IrInstruction*, LatticeValue> values;
+    std::map<IrInstruction*, std::vector<IrInstruction*>> users;
+    std::set<std::pair<IrBlock*, IrBlock*>> executableEdges;
+    std::set<IrBlock*> executableBlocks;
+    std::vector<std::pair<IrBlock*, IrBlock*>> flowWork;
+    std::vector<IrInstruction*> valueWork;
+    void Visit(IrInstruction *instruction);
+    void MarkEdge(IrBlock *from, IrBlock *to);
+    void Update(IrInstruction *instruction, const LatticeValue &value);
+    LatticeValue Evaluate(IrInstruction *instruction);
+    static bool Fold(IrInstruction *instruction, const std::vector<LatticeValue> &operands, LatticeValue &result);
+    bool Rewrite(PIrFunction function);
+};
+
+class GvnPass: public IrPass {
+public:
+    const std::string GetName() const { return "gvn"; }
+    bool Run(PIrFunction function);
+private:
+    typedef std::pair<std::vector<long long>, std::string> ValueKey;
+    std::map<ValueKey, IrInstruction*> table;
+    std::map<IrInstruction*, IrInstruction*> replacements;
+    void Number(const DominatorTree &tree, IrBlock *block);
+    static ValueKey GetKey(IrInstruction *instruction);
+};
+
+class DcePass: public IrPass {
+public:
+    const std::string GetName() const { return "dce"; }
+    bool Run(PIrFunction function);
+};
+
+class LicmPass: public IrPass {
+public:
+    const std::string GetName() const { return "licm"; }
+    bool Run(PIrFunction function);
+    static bool MayTrap(IrInstruction *instruction);
+private:
+    bool Hoist(const DominatorTree &tree, const IrLoop &loop);
+};
+
+class InductionForm {
+public:
+    InductionForm(IrInstruction *phi = nullptr, long long factor = 1, long long offset = 0,
+                  IrInstruction *addend = nullptr);
+    IrInstruction *GetPhi() const;
+    long long GetFactor() const;
+    long long GetOffset() const;
+    IrInstruction *GetAddend() const;
+private:
+    IrInstruction *phi;
+    long long factor;
+    long long offset;
+    IrInstruction *addend;
+};
+
+class IvPass: public IrPass {
+public:
+    const std::string GetName() const { return "ivsr"; }
+    bool Run(PIrFunction function);
+private:
+    PIrFunction function;
+    std::map<IrInstruction*, InductionForm> forms;
+    std::map<IrInstruction*, long long> steps;
+    bool Reduce(const DominatorTree &tree, const IrLoop &loop);
+    void FindBasic(const IrLoop &loop, IrBlock *preheader, IrBlock *latch);
+    bool FindDerived(const IrLoop &loop, IrInstruction *instruction);
+    IrInstruction *EmitStart(IrBlock *preheader, const InductionForm &form, int incoming);
+    IrInstruction *EmitConst(IrBlock *target, long long value);
+    static long long Wrap(long long value);
+};
+
+class ValueRange {
+public:
+    ValueRange(long long low = INT_MIN, long long high = INT_MAX);
+    long long GetLow() const;
+    long long GetHigh() const;
+    bool Contains(const ValueRange &other) const;
+    ValueRange Intersect(const ValueRange &other) const;
+    ValueRange Union(const ValueRange &other) const;
+    ValueRange Add(const ValueRange &other) const;
+    ValueRange Sub(const ValueRange &other) const;
+    ValueRange Scale(long long factor) const;
+    bool IsWrapping() const;
+private:
+    long long low;
+    long long high;
+};
+
+class InductionBound {
+public:
+    InductionBound(const IrLoop *loop = nullptr, IrBlock *preheader = nullptr, IrBlock *test = nullptr,
+                   IrInstruction *start = nullptr, IrInstruction *end = nullptr);
+    const IrLoop *GetLoop() const;
+    IrBlock *GetPreheader() const;
+    IrBlock *GetTest() const;
+    IrInstruction *GetStart() const;
+    IrInstruction *GetEnd() const;
+private:
+    const IrLoop *loop;
+    IrBlock *preheader;
+    IrBlock *test;
+    IrInstruction *start;
+    IrInstruction *end;
+};
+
+// A loop whose checks are dropped from a copy of it, run when the guard computed in the preheader
+// shows that none of them can fail; the original loop, checks and all, runs otherwise.
+class LoopVersion {
+public:
+    LoopVersion(const IrLoop *loop = nullptr, IrBlock *preheader = nullptr, IrBlock *test = nullptr);
+    const IrLoop *GetLoop() const;
+    IrBlock *GetPreheader() const;
+    IrBlock *GetTest() const;
+    IrInstruction *GetGuard() const;
+    void SetGuard(IrInstruction *guard);
+    const std::vector<IrInstruction*> &GetChecks() const;
+    void AddCheck(IrInstruction *check);
+private:
+    const IrLoop *loop;
+    IrBlock *preheader;
+    IrBlock *test;
+    IrInstruction *guard;
+    std::vector<IrInstruction*> checks;
+};
+
+class BcePass: public IrPass {
+public:
+    const std::string GetName() const { return "bce"; }
+    bool Run(PIrFunction function);
+    void PrintStatistics(std::ostream &out) const;
+private:
+    PIrFunction function;
+    std::vector<IrLoop> loops;
+    std::map<IrInstruction*, ValueRange> facts;
+    std::map<IrInstruction*, ValueRange> inductions;
+    std::map<IrInstruction*, InductionBound> bounds;
+    std::vector<std::pair<IrInstruction*, IrCondition>> conditions;
+    std::map<IrBlock*, LoopVersion> versions;
+    int checks = 0;
+    int removed = 0;
+    int hoisted = 0;
+    int kept = 0;
+    bool Visit(const DominatorTree &tree, IrBlock *block);
+    void AddEdgeFacts(IrBlock *block, std::vector<std::pair<IrInstruction*, ValueRange>> &saved);
+    void FindInductions(const DominatorTree &tree, const IrLoop &loop);
+    void Restrict(IrInstruction *value, const ValueRange &range,
+                  std::vector<std::pair<IrInstruction*, ValueRange>> &saved);
+    ValueRange GetRange(IrInstruction *value, int depth = 0, bool useFacts = true);
+    bool Implies(IrInstruction *left, IrCondition condition, IrInstruction *right);
+    bool Hoist(const DominatorTree &tree, IrInstruction *check);
+    const IrLoop *GetInnermost(IrBlock *block) const;
+    IrInstruction *EmitCompare(IrBlock *target, IrInstruction *left, IrCondition condition, long long right);
+    void Version(const LoopVersion &version);
+    IrInstruction *EmitConst(IrBlock *target, long long value);
+    static IrCondition Negate(IrCondition condition);
+    static IrCondition Swap(IrCondition condition);
+    static const int maxDepth = 8;
+};
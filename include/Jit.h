@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <map>
+#include "Asm.h"
+#include "Encoder.h"
+
+class Jit {
+public:
+    Jit(PAsmProgram program);
+    ~Jit();
+    int Run();
+    void WritePerfMap();
+private:
+    Encoder encoder;
+    unsigned char *memory;
+    size_t memorySize;
+    std::map<SectionType, unsigned char*> sections;
+    std::map<std::string, unsigned char*> stubs;
+    void Load();
+    void Link();
+    void Protect();
+    unsigned char *GetAddress(const std::string &symbol);
+    static size_t PageAlign(size_t size);
+    static const int stubSize = 14;
+};
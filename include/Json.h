@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+
+enum class JsonType {
+    Null,
+    Bool,
+    Number,
+    String,
+    Array,
+    Object
+};
+
+// A JSON value, as the language server reads and writes them. Looking up a member or an element
+// that is not there gives null, so that optional parts of a message need no checks of their own.
+class Json {
+public:
+    Json();
+    Json(bool value);
+    Json(int value);
+    Json(double value);
+    Json(const char *value);
+    Json(std::string value);
+    static Json Array();
+    static Json Object();
+    static Json Parse(const std::string &text);
+    JsonType GetType() const;
+    bool IsNull() const;
+    bool GetBool() const;
+    double GetNumber() const;
+    const std::string &GetString() const;
+    size_t Size() const;
+    bool Has(const std::string &key) const;
+    const Json &operator[](const std::string &key) const;
+    const Json &operator[](size_t index) const;
+    Json &Set(const std::string &key, Json value);
+    Json &Add(Json value);
+    std::string Write() const;
+private:
+    JsonType type;
+    bool boolean;
+    double number;
+    std::string text;
+    std::vector<Json> elements;
+    std::map<std::string, Json> members;
+    void Write(std::string &out) const;
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include "Json.h"
+#include "Parser.h"
+#include "AnalysisCache.h"
+
+// An open document: the text the client last sent, and the analysis of the last version of it
+// that parsed. Each version is written to a scratch file of its own for the parser, beside links
+// to the unit interfaces in the document's directory.
+class Document {
+public:
+    Document(std::string uri, std::string directory, std::string scratchFileName);
+    const std::string &GetText() const;
+    const std::shared_ptr<Parser> GetAnalysis() const;
+    const std::string &GetError() const;
+private:
+    friend class LanguageServer;
+    std::string uri;
+    std::string directory;
+    std::string scratchFileName;
+    std::string text;
+    PAnalysisCache cache;
+    std::shared_ptr<Parser> analysis;
+    std::map<Symbol*, Token> declarations;
+    std::string error;
+};
+typedef std::shared_ptr<Document> PDocument;
+
+// A Language Server Protocol server over standard input and output. Documents are kept in memory
+// and parsed again, body by body through an AnalysisCache, whenever they change; definition,
+// hover and completion are then answered from that analysis without parsing, and diagnostics are
+// published after every change. Positions count bytes, which is what UTF-16 gives for Pascal's
+// ASCII sources. On exit the time taken by requests is reported on standard error.
+class LanguageServer {
+public:
+    LanguageServer(std::istream &in, std::ostream &out, int threads);
+    ~LanguageServer();
+    bool Run();
+    static const int maxCompletions = 100;
+private:
+    std::istream &in;
+    std::ostream &out;
+    int threads;
+    std::string scratchDirectory;
+    std::map<std::string, PDocument> documents;
+    int scratchCount;
+    bool shutdown;
+    std::vector<double> latencies;
+    bool Read(std::string &body);
+    void Send(const Json &message);
+    void Reply(const Json &id, const Json &result);
+    void ReplyError(const Json &id, int code, const std::string &message);
+    bool Handle(const Json &message);
+    bool Call(const std::string &method, const Json &params, Json &result);
+    void Open(const std::string &uri, const std::string &text);
+    void Analyze(Document &document);
+    void PublishDiagnostics(const Document &document);
+    Json FindDefinition(const Json &params);
+    Json Hover(const Json &params);
+    Json Complete(const Json &params);
+    PDocument GetDocument(const Json &params) const;
+    PSymbolTableStack GetScope(const Document &document, int line) const;
+    PSymbolComplex FindSymbol(const Document &document, const Json &position, Json &range) const;
+    PSymbolBase FindQualifier(PSymbolTableStack scope, const std::string &line, size_t end) const;
+    void PrintLatencies() const;
+};
+typedef std::shared_ptr<LanguageServer> PLanguageServer;
@@ -0,0 +1,58 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include "Symbols.h"
+
+// Row-major layout of a chain of nested static arrays: array[1..N, 1..M] of T and
+// array[1..N] of array[1..M] of T both have rank 2 and the same strides.
+class ArrayLayout {
+public:
+    ArrayLayout();
+    int GetRank() const;
+    int GetSize() const;
+    long long GetLow(int dimension) const;
+    long long GetHigh(int dimension) const;
+    long long GetExtent(int dimension) const;
+    long long GetStride(int dimension) const;
+    long long GetBaseOffset(int rank) const;
+    PSymbolBase GetType(int dimension) const;
+    void AddDimension(PSymbolSubRange range, PSymbolBase type);
+    void SetElementSize(int elementSize);
+private:
+    std::vector<long long> lows;
+    std::vector<long long> highs;
+    std::vector<long long> strides;
+    std::vector<PSymbolBase> types;
+    int size;
+};
+
+// Field offsets of a record in declaration order, with the record's size rounded up to its
+// alignment so that arrays of records keep every element aligned.
+class RecordLayout {
+public:
+    RecordLayout();
+    int GetSize() const;
+    int GetAlign() const;
+    int GetOffset(const std::string &field) const;
+    PSymbolBase GetType(const std::string &field) const;
+    void AddField(const std::string &field, PSymbolBase type, int offset);
+    void SetSize(int size, int align);
+private:
+    std::map<std::string, std::pair<int, PSymbolBase>> fields;
+    int size;
+    int align;
+};
+
+class TypeLayout {
+public:
+    int GetSize(PSymbolBase type);
+    int GetAlign(PSymbolBase type);
+    const ArrayLayout &GetArrayLayout(PSymbolStaticArray array);
+    const RecordLayout &GetRecordLayout(PSymbolRecord record);
+private:
+    std::map<SymbolBase*, ArrayLayout> arrays;
+    std::map<SymbolBase*, RecordLayout> records;
+    static int AlignUp(int offset, int align);
+    static const int slotSize = 8;
+};
@@ -3,6 +3,7 @@
 #include <map>
 #include <set>
 #include <any>
+#include <ostream>
 #include "Token.h"
 #include "Symbols.h"
 
@@ -18,10 +19,11 @@ enum class NodeType {
     NodeCompoundStatement,
     NodeForStatement,
     NodePeriod,
-    NodeAssignmentOp
+    NodeAssignmentOp,
+    NodeWriteStatement
 };
 
-static std::set<State> assignmetOp {
+static const std::set<State> assignmetOp {
         ColonEqual,
         PlusEqual,
         MinusEqual,
@@ -29,7 +31,7 @@ static std::set<State> assignmetOp {
         SlashEqual
 };
 
-static std::set<State> baseArithmeticOp {
+static const std::set<State> baseArithmeticOp {
         Plus,
         Minus,
         Asterisk,
@@ -37,12 +39,12 @@ static std::set<State> baseArithmeticOp {
 };
 
 
-static std::set<State> intArithmeticOp {
+static const std::set<State> intArithmeticOp {
         Mod,
         Div
 };
 
-static std::set<State> logicalOp {
+static const std::set<State> logicalOp {
         Not,
         And,
         Or,
@@ -53,7 +55,7 @@ static std::set<State> logicalOp {
         GreaterThanGreaterThan
 };
 
-static std::set<State> relationalOp {
+static const std::set<State> relationalOp {
         Equal,
         LessThanGreaterThan,
         LessThan,
@@ -65,7 +67,9 @@ static std::set<State> relationalOp {
 class Node {
 public:
     Node(PToken token);
-    virtual void Print(int depth = 0) = 0;
+    virtual NodeType GetNodeType() = 0;
+    virtual void Print(std::ostream &out, int depth = 0) = 0;
+    virtual void Relocate(int lines, PSymbolTableStack tableStack);
     virtual const PToken GetToken() const;
 protected:
     static const int spacesCount = 4;
@@ -96,7 +100,8 @@ public:
     virtual void SetRight(PNodeOp);
     virtual const PNodeOp GetLeft() const;
     virtual const PNodeOp GetRight() const;
-    virtual void Print(int depth = 0);
+    virtual void Print(std::ostream &out, int depth = 0);
+    void Relocate(int lines, PSymbolTableStack tableStack);
     std::any CalcValue(PSymbolTableStack);
 protected:
     PNodeOp left;
@@ -131,7 +136,10 @@ public:
     void CalcType();
     void SetName(PNodeOp);
     void SetField(PToken);
-    void Print(int depth = 0);
+    const PNodeOp GetName() const;
+    const Token &GetField() const;
+    void Print(std::ostream &out, int depth = 0);
+    void Relocate(int lines, PSymbolTableStack tableStack);
 protected:
     PNodeOp name;
     Token field;
@@ -145,7 +153,8 @@ public:
     void CalcType();
     void SetNode(PNodeOp);
     const PNodeOp GetNode() const;
-    void Print(int depth = 0);
+    void Print(std::ostream &out, int depth = 0);
+    void Relocate(int lines, PSymbolTableStack tableStack);
     std::any CalcValue(PSymbolTableStack);
 protected:
     PNodeOp node;
@@ -161,8 +170,13 @@ public:
     NodeValue(PToken token);
     NodeType GetNodeType() { return NodeType::NodeValue; };
     void CalcType() {};
-    void Print(int depth = 0);
+    void Print(std::ostream &out, int depth = 0);
+    void Relocate(int lines, PSymbolTableStack tableStack);
     std::any CalcValue(PSymbolTableStack);
+    void SetSymbol(PSymbolComplex);
+    const PSymbolComplex GetSymbol() const;
+protected:
+    PSymbolComplex symbol;
 };
 typedef std::shared_ptr<NodeValue> PNodeValue;
 
@@ -171,7 +185,10 @@ public:
     NodeStructured(PToken token, PNodeOp name);
     virtual void AddParameter(PNodeOp node);
     virtual void CalcType() = 0;
-    void Print(std::string value, int depth = 0);
+    const PNodeOp GetName() const;
+    const std::vector<PNodeOp> &GetParameters() const;
+    void Print(std::ostream &out, std::string value, int depth = 0);
+    void Relocate(int lines, PSymbolTableStack tableStack);
 protected:
     std::vector<PNodeOp> parameters;
     PNodeOp name;
@@ -182,8 +199,12 @@ class NodeBrackets: public NodeStructured {
 public:
     NodeBrackets(PToken token, PNodeOp name);
     NodeType GetNodeType() { return NodeType::NodeBrackets; };
-    void Print(int depth = 0);
+    void Print(std::ostream &out, int depth = 0);
     void CalcType();
+    void SetRangeChecked(bool checked);
+    bool IsRangeChecked() const;
+private:
+    bool rangeChecked = false;
 };
 typedef std::shared_ptr<NodeBrackets> PNodeBrackets;
 
@@ -191,7 +212,7 @@ class NodeParenthesiss: public NodeStructured {
 public:
     NodeParenthesiss(PToken token, PNodeOp name);
     NodeType GetNodeType() { return NodeType::NodeParentehsiss; };
-    void Print(int depth = 0);
+    void Print(std::ostream &out, int depth = 0);
     void CalcType();
 };
 typedef std::shared_ptr<NodeParenthesiss> PNodeParenthesiss;
@@ -200,8 +221,10 @@ class NodeCompoundStatement: public Node {
 public:
     NodeCompoundStatement(PToken token);
     NodeType GetNodeType() { return NodeType::NodeCompoundStatement; };
-    void Print(int depth = 0);
+    void Print(std::ostream &out, int depth = 0);
+    void Relocate(int lines, PSymbolTableStack tableStack);
     void AddStatement(PNode node);
+    const std::vector<PNode> &GetStatements() const;
 protected:
     std::vector<PNode> statements;
 
@@ -212,10 +235,14 @@ class NodeIfStatement: public Node {
 public:
     NodeIfStatement(PToken token);
     NodeType GetNodeType() { return NodeType::NodeIfStatement; };
-    void Print(int depth = 0);
+    void Print(std::ostream &out, int depth = 0);
+    void Relocate(int lines, PSymbolTableStack tableStack);
     void SetIfNode(PNodeOp node);
     void SetThenNode(PNode node);
     void SetElseNode(PNode node);
+    const PNodeOp GetIfNode() const;
+    const PNode GetThenNode() const;
+    const PNode GetElseNode() const;
 protected:
     PNodeOp ifNode;
     PNode thenNode;
@@ -227,11 +254,16 @@ class NodeForStatement: public Node {
 public:
     NodeForStatement(PToken token);
     NodeType GetNodeType() { return NodeType::NodeForStatement; };
-    void Print(int depth = 0);
+    void Print(std::ostream &out, int depth = 0);
+    void Relocate(int lines, PSymbolTableStack tableStack);
     void SetToType(PToken toType);
     void SetControlVar(PNodeAssignmentOp controlVar);
     void SetFinalVar(PNodeOp finalVar);
     void SetDoSt(PNode doSt);
+    const Token &GetToType() const;
+    const PNodeAssignmentOp GetControlVar() const;
+    const PNodeOp GetFinalVar() const;
+    const PNode GetDoSt() const;
 protected:
     Token toType;
     PNodeAssignmentOp controlVar;
@@ -244,9 +276,12 @@ class NodeWhileStatement: public Node {
 public:
     NodeWhileStatement(PToken token);
     virtual NodeType GetNodeType() { return NodeType::NodeWhileStatement; };
-    virtual void Print(int depth = 0);
+    virtual void Print(std::ostream &out, int depth = 0);
+    void Relocate(int lines, PSymbolTableStack tableStack);
     virtual void AddStatement(PNode statement);
     virtual void SetCondition(PNodeOp condition);
+    virtual const std::vector<PNode> &GetStatements() const;
+    virtual const PNodeOp GetCondition() const;
 protected:
     std::vector<PNode> statements;
     PNodeOp condition;
@@ -259,3 +294,18 @@ public:
     NodeType GetNodeType() { return NodeType::NodeRepeatStatement; };
 };
 typedef std::shared_ptr<NodeRepeatStatement> PNodeRepeatStatement;
+
+class NodeWriteStatement: public Node {
+public:
+    NodeWriteStatement(PToken token, bool newLine);
+    NodeType GetNodeType() { return NodeType::NodeWriteStatement; };
+    void Print(std::ostream &out, int depth = 0);
+    void Relocate(int lines, PSymbolTableStack tableStack);
+    void AddParameter(PNodeOp node);
+    const std::vector<PNodeOp> &GetParameters() const;
+    bool IsNewLine() const;
+protected:
+    std::vector<PNodeOp> parameters;
+    bool newLine;
+};
+typedef std::shared_ptr<NodeWriteStatement> PNodeWriteStatement;
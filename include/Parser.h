@@ -2,10 +2,15 @@
 #include <vector>
 #include <set>
 #include <vector>
+#include <atomic>
 #include "Scanner.h"
+#include "PipelinedScanner.h"
 #include "Error.h"
 #include "Symbols.h"
 #include "Node.h"
+#include "ThreadPool.h"
+#include "UnitInterface.h"
+#include "AnalysisCache.h"
 
 enum class ExprType {
     Const,
@@ -14,7 +19,8 @@ enum class ExprType {
 
 enum class ParserConfig {
     ParseExpression,
-    ParseProgram
+    ParseProgram,
+    ParseUnit
 };
 
 enum class Priority {
@@ -24,18 +30,68 @@ enum class Priority {
     Third  = 3
 };
 
+// The lines of a procedure, from its heading up to the line the next thing after it starts on, and
+// the symbols seen there.
+class ProcedureScope {
+public:
+    ProcedureScope(int firstLine, int endLine, PSymbolTableStack symbols);
+    int GetFirstLine() const;
+    int GetEndLine() const;
+    const PSymbolTableStack GetSymbols() const;
+private:
+    int firstLine;
+    int endLine;
+    PSymbolTableStack symbols;
+};
+
+// A name where it was declared: the token that named it, the table it was checked against and the
+// innermost table of the scope it was declared in.
+class Declaration {
+public:
+    Declaration(PSymbolTable table, PSymbolTable top, const Token &token);
+    const Token &GetToken() const;
+    PSymbolComplex FindSymbol() const;
+private:
+    PSymbolTable table;
+    PSymbolTable top;
+    Token token;
+};
+
 class Parser {
 public:
-    Parser(const char* fileName, ParserConfig);
+    Parser(const char* fileName, ParserConfig, int threads = 1, bool pipelined = false,
+           PAnalysisCache cache = nullptr);
     const PNode GetTree() const;
-    void PrintTree();
-    void PrintStack();
+    const PSymbolTableStack GetTableStack() const;
+    const PUnitInterface GetUnit() const;
+    const std::vector<PUnitInterface> &GetUnits() const;
+    const std::vector<std::string> &GetRecomputed() const;
+    const std::vector<ProcedureScope> &GetScopes() const;
+    const std::vector<Declaration> &GetDeclarations() const;
+    void PrintTree(std::ostream &out = std::cout);
+    void PrintStack(std::ostream &out = std::cout);
 private:
+    Parser(PScanner scanner, PSymbolTableStack tableStack, PSymbolFunction currentFunction);
     PScanner scanner;
-    void PrintTree(PNode node);
+    void PrintTree(std::ostream &out, PNode node);
     ParserConfig parserConfig;
     PNode tree;
     PSymbolTableStack tableStack;
+    PSymbolFunction currentFunction;
+    std::string fileName;
+    int threads;
+    std::atomic<bool> bodyFailed;
+    PThreadPool pool;
+    std::vector<std::function<void()>> bodies;
+    std::vector<PUnitInterface> units;
+    PUnitInterface unit;
+    bool interfaceSection;
+    std::vector<PSymbolProcedure> forwards;
+    PAnalysisCache cache;
+    std::string source;
+    std::vector<std::string> recomputed;
+    std::vector<ProcedureScope> scopes;
+    std::vector<Declaration> declarations;
     PNodeOp ParseFactor(ExprType);
     void AddBaseTypesToTable(PSymbolTable);
     void CreateGlobalTable();
@@ -48,10 +104,17 @@ private:
     PNodeOp ParseExprIdentifier(PNodeOp left, ExprType);
     PNodeOp ParseParenthesis(ExprType exprType);
     void ParseProgram();
+    void ParseUnit();
+    void ParseUses();
+    PSymbolProcedure FindForward(PSymbolTable table);
+    PSymbolProcedure DeclareProcedure(PSymbolProcedure procedure, PSymbolProcedure forward, Token &name);
+    void ParseProgramInParallel();
+    void ParseBody(PSymbolProcedure procedure);
+    void SkipCompoundStatement();
     PNode ParseStatement();
     PSymbolComplex ParseExistingIdentifier();
     std::string ParseIdentifier(PSymbolTable);
-    std::set<std::string> ParseIdentifiers(PSymbolTable);
+    std::vector<std::string> ParseIdentifiers(PSymbolTable);
     PNodeAssignmentOp ParseAssignmentOperator();
     void ParseFunctionDeclaration(PSymbolTable);
     PNodeOp ParseExprParameters(PNodeStructed node, State stopState, ExprType);
@@ -60,6 +123,8 @@ private:
     PNode ParseRepeatStatement();
     PNode ParseWhileStatement();
     PNode ParseProcedureStatement();
+    bool IsWriteStatement();
+    PNode ParseWriteStatement();
     PSymbolBase ParseSimpleType();
     void ParseConstDeclaration(PSymbolTable table);
     PNode ParseComplexStatement();
@@ -85,7 +150,6 @@ private:
     void CalcNodeType(PNodeOp);
     std::any ParseValue(PSymbolBase type, int size);
     PSymbolType ParseExistingType();
-    std::vector<std::set<State>> priorityTable;
     bool CheckNodeType(PNodeOp, std::string);
     void SetCorrectType(PNodeOp, std::string);
     bool CheckCorrectToken(int priority);
@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+#include "Scanner.h"
+
+// A token as the scanner produced it, with where it started and the directives in force after it.
+// A token that could not be scanned carries the exception instead.
+class ScannedToken {
+public:
+    ScannedToken();
+    ScannedToken(const Token &token, const ScannerPosition &position, bool endOfFile);
+    ScannedToken(std::exception_ptr error);
+    const Token &GetToken() const;
+    const ScannerPosition &GetPosition() const;
+    bool IsEndOfFile() const;
+    bool IsFailed() const;
+    void Rethrow() const;
+private:
+    Token token;
+    ScannerPosition position;
+    bool endOfFile;
+    std::exception_ptr error;
+};
+
+// A bounded ring between one producing and one consuming thread. Each side owns its index and
+// only reads the other's, so neither ever takes a lock.
+class TokenRing {
+public:
+    TokenRing(int capacity);
+    bool Push(ScannedToken &entry);
+    bool Pop(ScannedToken &entry);
+private:
+    std::vector<ScannedToken> entries;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+};
+
+// Scans on a thread of its own, running ahead of the parser by up to a ring's worth of tokens.
+// The parser sees the same tokens, positions and directives a Scanner would give it: going back
+// a token replays the last one taken from the ring, and skipping a block balances begin and end
+// over the tokens rather than the characters.
+class PipelinedScanner: public Scanner {
+public:
+    PipelinedScanner(const char* fileName);
+    ~PipelinedScanner();
+    void NextToken() override;
+    bool IsEndOfFile() override;
+    void PrevToken() override;
+    bool SkipBlock() override;
+    bool IsRangeChecking() const override;
+    bool IsPackingRecords() const override;
+    bool IsReorderingRecords() const override;
+    ScannerPosition GetPosition() const override;
+    static const int ringCapacity = 1024;
+private:
+    PScanner scanner;
+    TokenRing ring;
+    ScannedToken current;
+    std::atomic<bool> finished;
+    std::atomic<bool> stopping;
+    std::thread producer;
+    void Produce();
+    bool Advance();
+};
+typedef std::shared_ptr<PipelinedScanner> PPipelinedScanner;
@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include <map>
+#include <set>
+#include "Ir.h"
+#include "Asm.h"
+
+// The span of positions over which a value must be kept, from its definition to its last use,
+// with the holes between blocks filled in.
+class LiveInterval {
+public:
+    LiveInterval(IrInstruction *value = nullptr, int start = 0, int end = 0);
+    IrInstruction *GetValue() const;
+    int GetStart() const;
+    int GetEnd() const;
+    double GetWeight() const;
+    bool IsDouble() const;
+    void Cover(int position);
+    void AddWeight(double weight);
+private:
+    IrInstruction *value;
+    int start;
+    int end;
+    double weight;
+};
+
+// Linear scan over live intervals (Poletto and Sarkar, "Linear Scan Register Allocation").
+// Values that live across a call only get callee-saved registers; when registers run out the
+// interval with the least weight, counted in uses scaled by loop depth, stays in memory. Values
+// left in memory share spill slots when their intervals do not overlap.
+class RegisterAllocator {
+public:
+    RegisterAllocator(PIrFunction function);
+    Register GetRegister(IrInstruction *value) const;
+    const std::vector<Register> &GetSavedRegisters() const;
+    int GetSpillSlot(IrInstruction *value) const;
+    int GetSpillSlotCount() const;
+private:
+    PIrFunction function;
+    std::map<IrInstruction*, int> positions;
+    std::map<IrBlock*, std::pair<int, int>> spans;
+    std::map<IrInstruction*, LiveInterval> intervals;
+    std::vector<int> calls;
+    std::map<IrInstruction*, Register> registers;
+    std::vector<Register> savedRegisters;
+    std::map<IrInstruction*, int> spillSlots;
+    int spillSlotCount;
+    void Number();
+    void BuildIntervals();
+    void Allocate(bool isDouble);
+    void AssignSpillSlots();
+    bool CrossesCall(const LiveInterval &interval) const;
+    static bool NeedsHome(IrInstruction *value);
+    static bool IsCalleeSaved(Register reg);
+    static const int maxLoopDepth = 6;
+};
@@ -1,38 +1,76 @@
 #pragma once
 #include <string>
 #include <fstream>
+#include <iostream>
 #include "Token.h"
 #include <vector>
 
+// Where a scanner stands before its current token, with the directives in force there.
+class ScannerPosition {
+public:
+    ScannerPosition(long offset = 0, int line = 1, int column = 0, bool rangeChecks = false,
+                    bool packRecords = false, bool reorderRecords = false);
+    long GetOffset() const;
+    int GetLine() const;
+    int GetColumn() const;
+    bool IsRangeChecking() const;
+    bool IsPackingRecords() const;
+    bool IsReorderingRecords() const;
+private:
+    long offset;
+    int line;
+    int column;
+    bool rangeChecks;
+    bool packRecords;
+    bool reorderRecords;
+};
+
+typedef std::map<State, std::vector<State>> StatesTable;
+
 class Scanner {
 public:
     Scanner(const char* fileName);
-    ~Scanner();
-    void NextToken();
+    Scanner(const char* fileName, const ScannerPosition &position);
+    virtual ~Scanner();
+    virtual void NextToken();
     PToken GetNextToken();
-    void PrintToken();
-    bool IsEndOfFile();
+    void PrintToken(std::ostream &out = std::cout);
+    virtual bool IsEndOfFile();
     const PToken GetToken() const;
-    void PrevToken();
+    virtual void PrevToken();
+    virtual bool SkipBlock();
     bool IsGettedToken();
+    virtual bool IsRangeChecking() const;
+    virtual bool IsPackingRecords() const;
+    virtual bool IsReorderingRecords() const;
+    virtual ScannerPosition GetPosition() const;
+protected:
+    Scanner();
+    PToken token;
+    bool gettedToken;
 private:
-    std::map<State, std::vector<State>> statesTable;
+    const StatesTable &statesTable;
     std::ifstream fin;
-    PToken token;
     int line, column;
     int prevColumn;
-    void FillStatesTable();
+    long offset;
+    long tokenOffset;
+    static const StatesTable &GetStatesTable();
+    static void FillStatesTable(StatesTable &table);
     void CheckReservedWord();
-    void InitStatesTable();
-    void SetState(State oldstate, int transition, State newstate);
+    static void InitStatesTable(StatesTable &table);
+    static void SetState(StatesTable &table, State oldstate, int transition, State newstate);
     char ReadChar();
     void UnGetChar(int count = 1);
     void ClearToken();
     void CheckError(State state);
     bool IsComment(State state);
-    void SetStates(State state, std::vector<std::pair<char, State>> ts);
-    void SetStatesInRange(State state, std::vector<std::tuple<char, char, State>> ts);
-    bool gettedToken;
+    void ApplyDirective(std::string comment);
+    static void SetStates(StatesTable &table, State state, std::vector<std::pair<char, State>> ts);
+    static void SetStatesInRange(StatesTable &table, State state, std::vector<std::tuple<char, char, State>> ts);
+    bool rangeChecks;
+    bool packRecords;
+    bool reorderRecords;
     static const int lineWidth = 4;
     static const int columnWidth = 4;
     static const int typeWidth = 15;
@@ -5,6 +5,7 @@
 #include <vector>
 #include <memory>
 #include <any>
+#include <ostream>
 
 enum class BaseType {
     Integer,
@@ -13,14 +14,14 @@ enum class BaseType {
     Untyped
 };
 
-static std::map<BaseType, std::string> baseType = {
+static const std::map<BaseType, std::string> baseType = {
         { BaseType::Integer, "integer" },
         { BaseType::Double,  "double"  },
         { BaseType::Char,    "char"    },
         { BaseType::Untyped, "untyped" }
 };
 
-static std::map<BaseType, std::any> baseTypeInitValue = {
+static const std::map<BaseType, std::any> baseTypeInitValue = {
         { BaseType::Integer, std::make_any<int>(0)          },
         { BaseType::Double,  std::make_any<double>(0.0)     },
         { BaseType::Char,    std::make_any<std::string>("") }
@@ -45,7 +46,7 @@ enum class SymType {
     OpenArray
 };
 
-static std::map<SymType, std::string> symTypeName {
+static const std::map<SymType, std::string> symTypeName {
         { SymType::VarInitialized, "var"         },
         { SymType::Var,            "var"         },
         { SymType::Type,           "type"        },
@@ -66,11 +67,14 @@ static std::map<SymType, std::string> symTypeName {
 
 class SymbolTableStack;
 
+class Node;
+typedef std::shared_ptr<Node> PNode;
+
 class Symbol {
 public:
     virtual const SymType GetSymType() const = 0;
     virtual const std::string GetTypeName() const = 0;
-    virtual void PrintTypeName(unsigned int depth = 0) = 0;
+    virtual void PrintTypeName(std::ostream &out, unsigned int depth = 0) = 0;
 
     static const int nameWidth = 15;
     static const int symTypeWidth = 15;
@@ -82,7 +86,7 @@ class SymbolBase: public Symbol {
 public:
     const SymType GetSymType() const override = 0;
     const std::string GetTypeName() const override = 0;
-    void PrintTypeName(unsigned int depth = 0) override = 0;
+    void PrintTypeName(std::ostream &out, unsigned int depth = 0) override = 0;
     virtual const std::any GetInitValue() const { return std::any(); };
 protected:
 };
@@ -91,10 +95,10 @@ typedef std::shared_ptr<SymbolBase> PSymbolBase;
 class SymbolComplex: public Symbol {
 public:
     SymbolComplex(std::string name, PSymbolBase type);
-    virtual void Print(unsigned int depth = 0);
+    virtual void Print(std::ostream &out, unsigned int depth = 0);
     const SymType GetSymType() const override = 0;
     const std::string GetTypeName() const override;
-    void PrintTypeName(unsigned int depth = 0) override;
+    void PrintTypeName(std::ostream &out, unsigned int depth = 0) override;
     virtual const PSymbolBase GetType() const;
     virtual void SetName(const std::string name);
     virtual const std::string GetName() const;
@@ -107,7 +111,7 @@ typedef std::shared_ptr<SymbolComplex> PSymbolComplex;
 class SymbolComplexWithValue: public SymbolComplex {
 public:
     SymbolComplexWithValue(std::string name, PSymbolBase type, std::any value);
-    void Print(unsigned int depth = 0) override;
+    void Print(std::ostream &out, unsigned int depth = 0) override;
     virtual const std::any GetValue() const;
     virtual const std::string GetValueText() const;
     const SymType GetSymType() const override = 0;
@@ -120,9 +124,10 @@ class SymbolTable {
 public:
     void AddSymbol(PSymbolComplex symbol);
     PSymbolComplex FindSymbol(std::string name);
+    PSymbolComplex FindSymbol(std::string name, int limit);
     bool HaveSymbol(std::string name);
     unsigned int Size();
-    void Print(unsigned int depth = 0);
+    void Print(std::ostream &out, unsigned int depth = 0);
     const std::string GetSymbolTypeNames() const;
     const std::vector<PSymbolComplex> &GetSymbols() const;
 private:
@@ -139,9 +144,12 @@ public:
     PSymbolComplex FindSymbol(std::string name);
     PSymbolTable Top();
     void Pop();
-    void Print(unsigned int depth = 0);
+    void Print(std::ostream &out, unsigned int depth = 0);
+    std::shared_ptr<SymbolTableStack> Snapshot() const;
+    std::vector<PSymbolComplex> GetSymbols() const;
 private:
     std::vector<PSymbolTable> tables;
+    std::vector<int> limits;
 };
 typedef std::shared_ptr<SymbolTableStack> PSymbolTableStack;
 
@@ -187,16 +195,25 @@ public:
 };
 typedef std::shared_ptr<SymbolRecordField> PSymbolRecordField;
 
+enum class RecordPacking {
+    Aligned,
+    Packed,
+    Reordered
+};
+
 class SymbolRecord: public SymbolBase {
 public:
     SymbolRecord();
     const SymType GetSymType() const { return SymType::Record; };
-    void PrintTypeName(unsigned int depth = 0);
+    void PrintTypeName(std::ostream &out, unsigned int depth = 0);
     const std::string GetTypeName() const;
     const PSymbolTable GetFields() const;
     void AddField(PSymbolRecordField);
+    RecordPacking GetPacking() const;
+    void SetPacking(RecordPacking packing);
 protected:
     PSymbolTable fields;
+    RecordPacking packing;
 };
 typedef std::shared_ptr<SymbolRecord> PSymbolRecord;
 
@@ -204,7 +221,7 @@ class SymbolProcHeader: public SymbolBase {
 public:
     SymbolProcHeader();
     const SymType GetSymType() const { return SymType::ProcHeader; };
-    void PrintTypeName(unsigned int depth = 0);
+    void PrintTypeName(std::ostream &out, unsigned int depth = 0);
     virtual const PSymbolTable GetArgs() const;
     virtual const std::string GetTypeName() const;
     virtual const PSymbolBase GetReturnType() const;
@@ -219,7 +236,7 @@ public:
     SymbolFuncHeader();
     void SetReturnType(const PSymbolBase returnType);
     const SymType GetSymType() const { return SymType::FuncHeader; };
-    void PrintTypeName(unsigned int depth = 0);
+    void PrintTypeName(std::ostream &out, unsigned int depth = 0);
     const std::string GetTypeName() const;
 };
 typedef std::shared_ptr<SymbolFuncHeader> PSymbolFuncHeader;
@@ -227,10 +244,14 @@ typedef std::shared_ptr<SymbolFuncHeader> PSymbolFuncHeader;
 class SymbolProcedure: public SymbolComplex {
 public:
     SymbolProcedure(std::string name, PSymbolProcHeader type, PSymbolTable locals);
-    void Print(unsigned int depth = 0);
+    void Print(std::ostream &out, unsigned int depth = 0);
     const SymType GetSymType() const { return SymType::Procedure; };
+    const PSymbolTable GetLocals() const;
+    void SetBody(PNode body);
+    const PNode GetBody() const;
 protected:
     PSymbolTable locals;
+    PNode body;
 };
 typedef std::shared_ptr<SymbolProcedure> PSymbolProcedure;
 
@@ -248,7 +269,7 @@ public:
     SymbolBaseType(BaseType type);
     const SymType GetSymType() const { return SymType::BaseType; }
     const std::string GetTypeName() const;
-    void PrintTypeName(unsigned int depth = 0);
+    void PrintTypeName(std::ostream &out, unsigned int depth = 0);
     const std::any GetInitValue() const;
 protected:
     BaseType type;
@@ -259,9 +280,11 @@ class SymbolSubRange: public SymbolBase {
 public:
     SymbolSubRange(int left, int right);
     const SymType GetSymType() const { return SymType::SubRange; }
-    void PrintTypeName(unsigned int depth = 0);
+    void PrintTypeName(std::ostream &out, unsigned int depth = 0);
     const std::string GetTypeName() const;
     const std::string GetValue() const;
+    int GetLeft() const;
+    int GetRight() const;
 protected:
     int left, right;
 };
@@ -285,7 +308,7 @@ public:
     SymbolOpenArray(PSymbolBase);
     const SymType GetSymType() const { return SymType::OpenArray; }
     const std::string GetTypeName() const;
-    void PrintTypeName(unsigned int depth = 0);
+    void PrintTypeName(std::ostream &out, unsigned int depth = 0);
 };
 typedef std::shared_ptr<SymbolOpenArray> PSymbolOpenArray;
 
@@ -293,7 +316,8 @@ class SymbolStaticArray: public SymbolArray {
 public:
     SymbolStaticArray(PSymbolBase type, PSymbolSubRange subRange);
     const std::string GetTypeName() const;
-    void PrintTypeName(unsigned int depth = 0);
+    void PrintTypeName(std::ostream &out, unsigned int depth = 0);
+    const PSymbolSubRange GetSubRange() const;
 protected:
     PSymbolSubRange subRange;
 };
@@ -303,11 +327,11 @@ class SymbolDynamicArray: public SymbolArray {
 public:
     SymbolDynamicArray(PSymbolBase type);
     const std::string GetTypeName() const;
-    void PrintTypeName(unsigned int depth = 0);
+    void PrintTypeName(std::ostream &out, unsigned int depth = 0);
 };
 typedef std::shared_ptr<SymbolDynamicArray> PSymbolDynamicArray;
 
-static std::map<BaseType, PSymbolBaseType> basicSymbol = {
+static const std::map<BaseType, PSymbolBaseType> basicSymbol = {
         { BaseType::Integer, PSymbolBaseType(new SymbolBaseType(BaseType::Integer)) },
         { BaseType::Double,  PSymbolBaseType(new SymbolBaseType(BaseType::Double))  },
         { BaseType::Char,    PSymbolBaseType(new SymbolBaseType(BaseType::Char))    }
@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+
+// A fixed set of worker threads, each with its own queue of tasks. A worker runs its own tasks
+// newest first and, once they are gone, steals the oldest task of another worker.
+class ThreadPool {
+public:
+    ThreadPool(int threads);
+    ~ThreadPool();
+    void Submit(std::function<void()> task);
+    void Wait();
+private:
+    class WorkQueue {
+    public:
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::condition_variable done;
+    std::atomic<int> queued;
+    std::atomic<int> pending;
+    std::atomic<unsigned int> next;
+    bool stopping;
+    bool Take(int index, std::function<void()> &task);
+    void Work(int index);
+};
+typedef std::shared_ptr<ThreadPool> PThreadPool;
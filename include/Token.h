@@ -129,7 +129,7 @@ enum State {
     Xor
 };
 
-static std::map<std::string, State> reservedWordState = { 
+static const std::map<std::string, State> reservedWordState = { 
         { "absolute",       Absolute       },
         { "and",            And            },
         { "array",          Array          },
@@ -203,7 +203,7 @@ namespace TK {
     };
 }
 
-static std::map<TK::TokenType, std::string> tokenName = {
+static const std::map<TK::TokenType, std::string> tokenName = {
         { TK::Double,       "double"        },
         { TK::EOFF,         "EOF"           },
         { TK::Identifier,   "identifier"    },
@@ -214,7 +214,7 @@ static std::map<TK::TokenType, std::string> tokenName = {
         { TK::String,       "string"        }
 };
 
-static std::map<State, std::string> stateName = {
+static const std::map<State, std::string> stateName = {
         { Begin,            "begin" },
         { End,              "end"   },
         { Period,           "."     },
@@ -227,10 +227,14 @@ static std::map<State, std::string> stateName = {
         { Then,             "then"  },
         { To,               "to"    },
         { ColonEqual,       ":="    },
-        { Do,               "do"    }
+        { Do,               "do"    },
+        { Record,           "record" },
+        { Unit,             "unit" },
+        { Interface,        "interface" },
+        { Implementation,   "implementation" }
 };
 
-static std::map<State, TK::TokenType> tokenType = {
+static const std::map<State, TK::TokenType> tokenType = {
         { DoubleValue,                    TK::Double },
         { DoubleValueDigit,               TK::Double },
         { DoubleValueDigitScaleSignDigit, TK::Double },
@@ -280,7 +284,7 @@ static std::map<State, TK::TokenType> tokenType = {
         { String, TK::String }
 };
 
-static std::set<State> assignmentOperators = {
+static const std::set<State> assignmentOperators = {
         ColonEqual,
         PlusEqual,
         MinusEqual,
@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+#include "Symbols.h"
+
+// The exported part of a compiled unit: the symbols of its interface section, with what they were
+// compiled from. Its file holds the source's hash and the hash of every interface it used, so a
+// build can tell whether it is current without parsing anything; the hash of the symbols themselves
+// changes only when the interface does, not when just the implementation is edited.
+class UnitInterface {
+public:
+    UnitInterface(std::string name, const std::string &sourceFileName, PSymbolTable symbols,
+                  const std::vector<std::shared_ptr<UnitInterface>> &uses);
+    UnitInterface(const std::string &fileName);
+    void Save(const std::string &fileName) const;
+    const std::string &GetName() const;
+    const PSymbolTable GetSymbols() const;
+    unsigned long long GetSourceHash() const;
+    unsigned long long GetHash() const;
+    const std::vector<std::pair<std::string, unsigned long long>> &GetUses() const;
+    static std::string GetFileName(const std::string &sourceFileName, const std::string &unitName);
+    static unsigned long long HashFile(const std::string &fileName);
+    static unsigned long long GetStamp(const std::string &sourceFileName);
+private:
+    std::string name;
+    PSymbolTable symbols;
+    unsigned long long sourceHash;
+    std::vector<std::pair<std::string, unsigned long long>> uses;
+    std::string encoded;
+    unsigned long long hash;
+    void Decode(const char *data, size_t size, const std::string &fileName);
+};
+typedef std::shared_ptr<UnitInterface> PUnitInterface;
@@ -1,52 +1,273 @@
 #include <iostream>
 #include <fstream>
 #include <cstring>
+#include <cstdlib>
+#include <thread>
+#include <sstream>
+#include <iterator>
+#include <sys/stat.h>
 #include "Scanner.h"
 #include "Parser.h"
+#include "CodeGenerator.h"
+#include "CGenerator.h"
+#include "IrBuilder.h"
+#include "IrPasses.h"
 #include "Error.h"
+#include "Batch.h"
+#include "CompileServer.h"
+#include "CompileCache.h"
+#include "Build.h"
+#include "LanguageServer.h"
 
 using namespace std;
 
+static int unrollFactor = IrBuilder::defaultUnrollFactor;
+static int threads = 0;
+static bool pipelined = false;
+static const char *cacheDirectory = nullptr;
+static long long cacheLimit = CompileCache::defaultLimit;
+
+// Printed for a command line naming no known mode.
+static const char usage[] =
+        "Usage: Compiler [options] <mode> <file> [output]\n"
+        "Options, before the mode:\n"
+        "  -unroll <n>           unroll counted loops n times; below 2 turns unrolling off\n"
+        "  -j <n>                parse procedure bodies on n threads\n"
+        "  -pipe                 scan on a thread of its own, ahead of the parser\n"
+        "  -cache <directory>    reuse the output and built files of every mode but -jit\n"
+        "  -cache-limit <MB>     bound the cache directory, 256 by default\n"
+        "Modes:\n"
+        "  -s, -pe, -pd, -ps     print the tokens, an expression, the declarations or the program tree\n"
+        "  -ir, -stats           print the IR around every pass, or what the passes did\n"
+        "  -S, -C                print x86-64 assembly or C\n"
+        "  -c, -obj, -static     build an executable, an object file or a static executable\n"
+        "  -cc                   build an executable from C with cc\n"
+        "  -jit                  run the program in memory\n"
+        "  -unit                 write the interface of a unit to <file minus extension>.ppi\n"
+        "  -batch <mode> <manifest or directory> [output directory]\n"
+        "                        run -s, -pe, -pd or -ps over many files on -j threads\n"
+        "  -build <file>         build a program and the units it uses, compiling only what changed\n"
+        "  -reanalyze <file>...  parse versions of one file, reusing the unchanged procedure bodies\n"
+        "  -serve <socket>       answer -s, -pe, -pd and -ps for CompilerClient until it sends -stop\n"
+        "  -lsp                  serve the Language Server Protocol on standard input and output\n";
+
+static PIrModule Lower(const char *file, std::ostream *dump = nullptr, std::ostream *stats = nullptr) {
+    Parser parser(file, ParserConfig::ParseProgram, threads, pipelined);
+    IrBuilder builder(parser.GetTree(), parser.GetTableStack(), unrollFactor);
+    PIrModule module = builder.GetModule();
+    PassManager passes(dump);
+    passes.AddStandardPasses();
+    passes.Run(module);
+    if (stats != nullptr) {
+        for (const auto &line: builder.GetLog())
+            *stats << line << endl;
+        passes.PrintStatistics(*stats);
+    }
+    return module;
+}
+
+static bool IsCompileMode(const std::string &mode) {
+    return Batch::IsMode(mode) || mode == "-ir" || mode == "-stats" || mode == "-S" || mode == "-C" ||
+           mode == "-c" || mode == "-obj" || mode == "-cc" || mode == "-static" || mode == "-unit";
+}
+
+static bool IsBuildMode(const std::string &mode) {
+    return mode == "-c" || mode == "-obj" || mode == "-cc" || mode == "-static" || mode == "-unit";
+}
+
+static std::string GetDefaultOutput(const std::string &mode, const std::string &file) {
+    string base = file.substr(0, file.rfind('.'));
+    if (mode == "-unit")
+        return base + ".ppi";
+    return mode == "-obj" ? base + ".o" : base;
+}
+
+// Runs every mode that prints to out or builds a file; false when the source had an error.
+static bool Compile(const std::string &mode, const char *file, const std::string &output, std::ostream &out) {
+    if (Batch::IsMode(mode))
+        return Batch::Run(mode, file, out, threads, pipelined);
+    try {
+        if (mode == "-ir") {
+            Lower(file, &out);
+        }
+        else if (mode == "-stats") {
+            Lower(file, nullptr, &out);
+        }
+        else if (mode == "-S") {
+            CodeGenerator generator(Lower(file));
+            generator.Print(out);
+        }
+        else if (mode == "-c") {
+            CodeGenerator generator(Lower(file));
+            generator.Build(output);
+        }
+        else if (mode == "-obj") {
+            CodeGenerator generator(Lower(file));
+            generator.BuildObject(output);
+        }
+        else if (mode == "-C") {
+            CGenerator generator(Lower(file));
+            generator.Print(out);
+        }
+        else if (mode == "-cc") {
+            CGenerator generator(Lower(file));
+            generator.Build(output);
+        }
+        else if (mode == "-static") {
+            CodeGenerator generator(Lower(file));
+            generator.BuildStatic(output);
+        }
+        else if (mode == "-unit") {
+            Parser parser(file, ParserConfig::ParseUnit, threads, pipelined);
+            parser.GetUnit()->Save(output);
+        }
+    }
+    catch (Error error) {
+        out << error.GetMessage();
+        return false;
+    }
+    return true;
+}
+
+// A hit replays what the run printed and rewrites the file it built without looking at the
+// source again. Besides the source, only the mode, the unroll factor and the interfaces of the
+// units it may use change what a run produces. False, as for Compile, when the source had an error.
+static bool CompileCached(const std::string &mode, const char *file, const std::string &output) {
+    CompileCache cache(cacheDirectory, cacheLimit);
+    string key = cache.GetKey(file, { mode, to_string(unrollFactor), to_string(UnitInterface::GetStamp(file)) });
+    CachedRun run;
+    if (key.empty() || !cache.Load(key, run)) {
+        ostringstream out;
+        bool ok = Compile(mode, file, output, out), built = ok && IsBuildMode(mode);
+        struct stat info;
+        ifstream artifact(output, ios::binary);
+        if (built && stat(output.c_str(), &info) == 0 && artifact.is_open())
+            run = CachedRun(out.str(), ok, true,
+                            string(istreambuf_iterator<char>(artifact), istreambuf_iterator<char>()),
+                            info.st_mode & 0777);
+        else
+            run = CachedRun(out.str(), ok);
+        if (!key.empty())
+            cache.Store(key, run);
+    }
+    else if (run.IsBuilt()) {
+        ofstream artifact(output, ios::binary | ios::trunc);
+        artifact << run.GetArtifact();
+        artifact.close();
+        chmod(output.c_str(), run.GetFileMode());
+    }
+    cout << run.GetOutput();
+    return run.IsOk();
+}
+
 int main(int argc, char* argv[]) {
-    if (!strcmp(argv[1], "-s")) {
+    while (argc > 2 && (!strcmp(argv[1], "-unroll") || !strcmp(argv[1], "-j") || !strcmp(argv[1], "-pipe") ||
+                        !strcmp(argv[1], "-cache") || !strcmp(argv[1], "-cache-limit"))) {
+        if (!strcmp(argv[1], "-pipe")) {
+            pipelined = true;
+            argv++;
+            argc--;
+            continue;
+        }
+        if (!strcmp(argv[1], "-unroll"))
+            unrollFactor = atoi(argv[2]);
+        else if (!strcmp(argv[1], "-cache"))
+            cacheDirectory = argv[2];
+        else if (!strcmp(argv[1], "-cache-limit"))
+            cacheLimit = atoll(argv[2]) << 20;
+        else
+            threads = atoi(argv[2]);
+        argv += 2;
+        argc -= 2;
+    }
+    if (argc < 2 || (argc < 3 && strcmp(argv[1], "-lsp"))) {
+        cerr << usage;
+        return 1;
+    }
+    if (!strcmp(argv[1], "-batch") && argc > 3 && Batch::IsMode(argv[2])) {
         try {
-            Scanner scanner(argv[2]);
-            while (!scanner.IsEndOfFile()) {
-                scanner.NextToken();
-                scanner.PrintToken();
-            }
+            Batch batch(argv[2], argv[3], threads > 0 ? threads : thread::hardware_concurrency());
+            if (argc > 4)
+                batch.Write(argv[4]);
+            else
+                batch.Print(cout);
+            batch.PrintSummary(cout);
         }
-        catch (Error error) {
-            cout << error.GetMessage();
+        catch (exception &exception) {
+            cout << exception.what() << endl;
+            return 1;
         }
     }
-    else if (!strcmp(argv[1], "-pe")) {
+    else if (!strcmp(argv[1], "-build")) {
         try {
-            Parser parser(argv[2], ParserConfig::ParseExpression);
-            parser.PrintTree();
+            Build build(argv[2], threads > 0 ? threads : thread::hardware_concurrency());
+            build.Print(cout);
+            build.PrintCriticalPath(cout);
+            if (!build.IsOk())
+                return 1;
         }
-        catch (Error error) {
-            cout << error.GetMessage();
+        catch (exception &exception) {
+            cout << exception.what() << endl;
+            return 1;
         }
     }
-    else if (!strcmp(argv[1], "-pd")) {
+    else if (!strcmp(argv[1], "-reanalyze")) {
+        PAnalysisCache cache(new AnalysisCache());
+        for (int i = 2; i < argc; i++) {
+            try {
+                Parser parser(argv[i], ParserConfig::ParseProgram, threads, pipelined, cache);
+                parser.PrintTree(cout);
+                cout << "recomputed:";
+                for (const auto &name: parser.GetRecomputed())
+                    cout << " " << name;
+                cout << endl;
+            }
+            catch (Error error) {
+                cout << error.GetMessage() << endl;
+            }
+        }
+    }
+    else if (!strcmp(argv[1], "-lsp")) {
         try {
-            Parser parser(argv[2], ParserConfig::ParseProgram);
-            parser.PrintStack();
+            LanguageServer server(cin, cout, threads > 0 ? threads : 1);
+            if (!server.Run())
+                return 1;
         }
-        catch (Error error) {
-            cout << error.GetMessage();
+        catch (exception &exception) {
+            cerr << exception.what() << endl;
+            return 1;
+        }
+    }
+    else if (!strcmp(argv[1], "-serve")) {
+        try {
+            CompileServer server(argv[2], threads > 0 ? threads : thread::hardware_concurrency());
+            server.Run();
+        }
+        catch (exception &exception) {
+            cout << exception.what() << endl;
+            return 1;
         }
     }
-    else if (!strcmp(argv[1], "-ps")) {
+    else if (IsCompileMode(argv[1])) {
+        string output = argc > 3 ? argv[3] : GetDefaultOutput(argv[1], argv[2]);
+        bool ok = cacheDirectory == nullptr ? Compile(argv[1], argv[2], output, cout) :
+                  CompileCached(argv[1], argv[2], output);
+        if (!ok)
+            return 1;
+    }
+    else if (!strcmp(argv[1], "-jit")) {
         try {
-            Parser parser(argv[2], ParserConfig::ParseProgram);
-            parser.PrintTree();
+            CodeGenerator generator(Lower(argv[2]));
+            generator.RunJit();
         }
         catch (Error error) {
             cout << error.GetMessage();
         }
     }
+    else {
+        cerr << usage;
+        return 1;
+    }
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include <cctype>
+#include <set>
+#include "AnalysisCache.h"
+#include "CompileCache.h"
+
+using namespace std;
+
+CachedBody::CachedBody(std::string key, int line, PNode tree, int run) :
+        key(key), line(line), tree(tree), run(run) {}
+
+AnalysisCache::AnalysisCache() : run(0) {}
+
+void AnalysisCache::Start() {
+    lock_guard<std::mutex> lock(mutex);
+    run++;
+}
+
+void AnalysisCache::Finish() {
+    lock_guard<std::mutex> lock(mutex);
+    for (auto i = bodies.begin(); i != bodies.end();)
+        i = i->second.run == run ? next(i) : bodies.erase(i);
+}
+
+// Identical bodies share a key; each takes a body of its own, the one that was on its line if any.
+PNode AnalysisCache::Find(const std::string &key, int line, PSymbolTableStack scope) {
+    lock_guard<std::mutex> lock(mutex);
+    auto range = bodies.equal_range(CompileCache::Hash(key.data(), key.size()));
+    CachedBody *found = nullptr;
+    for (auto i = range.first; i != range.second; i++) {
+        CachedBody &body = i->second;
+        if (body.run == run || body.key != key)
+            continue;
+        if (found == nullptr || body.line == line)
+            found = &body;
+    }
+    if (found == nullptr)
+        return nullptr;
+    found->tree->Relocate(line - found->line, scope);
+    found->line = line;
+    found->run = run;
+    return found->tree;
+}
+
+void AnalysisCache::Store(const std::string &key, int line, PNode tree) {
+    lock_guard<std::mutex> lock(mutex);
+    bodies.emplace(CompileCache::Hash(key.data(), key.size()), CachedBody(key, line, tree, run));
+}
+
+// Every word of the body that could be an identifier, comments and strings included, is looked up;
+// so are the base types, which type checks look up by name. A word that is not declared counts too,
+// as declaring it later may change what the body means.
+std::string AnalysisCache::GetKey(const std::string &text, const ScannerPosition &position,
+                                  PSymbolTableStack scope) {
+    set<string> words;
+    for (const auto &type: baseType)
+        words.insert(type.second);
+    string word;
+    for (char symb: text + " ") {
+        if (isalnum(symb) || symb == '_') {
+            word += (char) tolower(symb);
+            continue;
+        }
+        if (!word.empty() && !isdigit(word[0]))
+            words.insert(word);
+        word.clear();
+    }
+    string key = to_string(position.GetColumn()) + " " + to_string(position.IsRangeChecking()) +
+                 to_string(position.IsPackingRecords()) + to_string(position.IsReorderingRecords()) + "\n" + text;
+    for (const auto &name: words) {
+        PSymbolComplex symbol = scope->FindSymbol(name);
+        key += "\n" + name;
+        if (symbol == nullptr)
+            continue;
+        key += " " + symTypeName.at(symbol->GetSymType()) + " " + symbol->GetTypeName();
+        PSymbolComplexWithValue value = dynamic_pointer_cast<SymbolComplexWithValue>(symbol);
+        if (value != nullptr && symbol->GetSymType() == SymType::Const)
+            key += " = " + value->GetValueText();
+    }
+    return key;
+}
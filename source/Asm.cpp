@@ -0,0 +1,292 @@
+#include "Asm.h"
+#include <iostream>
+
+using namespace std;
+
+Operand Operand::Reg(Register reg, int size) {
+    Operand operand;
+    operand.type = OperandType::Register;
+    operand.reg = reg;
+    operand.size = size;
+    return operand;
+}
+
+Operand Operand::Imm(long long value) {
+    Operand operand;
+    operand.type = OperandType::Immediate;
+    operand.value = value;
+    return operand;
+}
+
+Operand Operand::Mem(Register base, int disp) {
+    Operand operand;
+    operand.type = OperandType::Memory;
+    operand.reg = base;
+    operand.value = disp;
+    return operand;
+}
+
+Operand Operand::Mem(Register base, Register index, int scale, int disp) {
+    Operand operand = Mem(base, disp);
+    operand.index = index;
+    operand.scale = scale;
+    return operand;
+}
+
+Operand Operand::Rip(std::string label, int disp) {
+    Operand operand = Mem(Register::Rip, disp);
+    operand.label = label;
+    return operand;
+}
+
+Operand Operand::Label(std::string label) {
+    Operand operand;
+    operand.type = OperandType::Label;
+    operand.label = label;
+    return operand;
+}
+
+Operand Operand::External(std::string label) {
+    Operand operand = Label(label);
+    operand.external = true;
+    return operand;
+}
+
+OperandType Operand::GetType() const {
+    return type;
+}
+
+Register Operand::GetRegister() const {
+    return reg;
+}
+
+Register Operand::GetIndex() const {
+    return index;
+}
+
+int Operand::GetScale() const {
+    return scale;
+}
+
+int Operand::GetSize() const {
+    return size;
+}
+
+long long Operand::GetValue() const {
+    return value;
+}
+
+void Operand::SetValue(long long value) {
+    this->value = value;
+}
+
+const std::string &Operand::GetLabel() const {
+    return label;
+}
+
+bool Operand::IsExternal() const {
+    return external;
+}
+
+bool Operand::IsDouble() const {
+    return type == OperandType::Register && reg >= Register::Xmm0 && reg <= Register::Xmm15;
+}
+
+const std::string Operand::GetText() const {
+    switch (type) {
+        case OperandType::Register: {
+            if (IsDouble() || size == 8)
+                return "%" + registerName.at(reg);
+            if (size == 4)
+                return "%" + register32Name.at(reg);
+            return "%" + register8Name.at(reg);
+        }
+        case OperandType::Immediate: {
+            return "$" + to_string(value);
+        }
+        case OperandType::Label: {
+            return external ? label + "@PLT" : label;
+        }
+        case OperandType::Memory: {
+            string text = label;
+            if (!label.empty() && value > 0)
+                text += "+";
+            if (value != 0 || label.empty())
+                text += to_string(value);
+            text += "(%" + registerName.at(reg);
+            if (index != Register::None)
+                text += ", %" + registerName.at(index) + ", " + to_string(scale);
+            return text + ")";
+        }
+    }
+    return "";
+}
+
+AsmInstruction::AsmInstruction(OpCode op, int size, std::vector<Operand> operands, Condition condition) :
+        op(op), size(size), condition(condition), operands(operands) {}
+
+AsmInstruction::AsmInstruction(std::string label) : op(OpCode::Label), size(0),
+        condition(Condition::None), label(label) {}
+
+OpCode AsmInstruction::GetOpCode() const {
+    return op;
+}
+
+int AsmInstruction::GetSize() const {
+    return size;
+}
+
+Condition AsmInstruction::GetCondition() const {
+    return condition;
+}
+
+const std::vector<Operand> &AsmInstruction::GetOperands() const {
+    return operands;
+}
+
+std::vector<Operand> &AsmInstruction::GetOperands() {
+    return operands;
+}
+
+const std::string &AsmInstruction::GetLabel() const {
+    return label;
+}
+
+const std::string AsmInstruction::GetSuffix(int size) {
+    switch (size) {
+        case 1: return "b";
+        case 2: return "w";
+        case 4: return "l";
+        default: return "q";
+    }
+}
+
+const std::string AsmInstruction::GetText() const {
+    if (op == OpCode::Label)
+        return label + ":";
+    string text;
+    switch (op) {
+        case OpCode::Cdq: {
+            text = size == 8 ? "cqto" : "cltd";
+            break;
+        }
+        case OpCode::Movsx:
+        case OpCode::Movzx: {
+            text = opCodeName.at(op) + GetSuffix(size) + GetSuffix(operands[1].GetSize());
+            break;
+        }
+        case OpCode::Set:
+        case OpCode::J: {
+            text = opCodeName.at(op) + conditionName.at(condition);
+            break;
+        }
+        case OpCode::Cvtsi2sd: {
+            text = opCodeName.at(op) + GetSuffix(size);
+            break;
+        }
+        case OpCode::Jmp:
+        case OpCode::Call:
+        case OpCode::Ret:
+        case OpCode::Leave:
+        case OpCode::RepMovsb:
+        case OpCode::Movsd:
+        case OpCode::Movq:
+        case OpCode::Addsd:
+        case OpCode::Subsd:
+        case OpCode::Mulsd:
+        case OpCode::Divsd:
+        case OpCode::Ucomisd:
+        case OpCode::Cvttsd2si: {
+            text = opCodeName.at(op);
+            break;
+        }
+        default: {
+            text = opCodeName.at(op) + GetSuffix(size);
+        }
+    }
+    for (int i = 0; i < operands.size(); i++)
+        text += (i == 0 ? " " : ", ") + operands[i].GetText();
+    return text;
+}
+
+AsmData::AsmData(std::string label, std::vector<unsigned char> bytes, int align, bool readOnly) :
+        label(label), bytes(bytes), align(align), readOnly(readOnly) {}
+
+const std::string &AsmData::GetLabel() const {
+    return label;
+}
+
+const std::vector<unsigned char> &AsmData::GetBytes() const {
+    return bytes;
+}
+
+int AsmData::GetAlign() const {
+    return align;
+}
+
+bool AsmData::IsReadOnly() const {
+    return readOnly;
+}
+
+void AsmData::Print(std::ostream &out) const {
+    out << "    .balign " << align << endl;
+    out << label << ":" << endl;
+    bool zero = true;
+    for (auto byte: bytes)
+        zero = zero && byte == 0;
+    if (zero) {
+        out << "    .zero " << (bytes.empty() ? 1 : bytes.size()) << endl;
+        return;
+    }
+    for (int i = 0; i < bytes.size(); i += bytesPerLine) {
+        out << "    .byte ";
+        for (int j = i; j < bytes.size() && j < i + bytesPerLine; j++)
+            out << (j == i ? "" : ", ") << (int) bytes[j];
+        out << endl;
+    }
+}
+
+void AsmProgram::Emit(AsmInstruction instruction) {
+    code.push_back(instruction);
+}
+
+void AsmProgram::AddData(AsmData data) {
+    this->data.push_back(data);
+}
+
+void AsmProgram::AddGlobal(std::string label) {
+    globals.push_back(label);
+}
+
+std::vector<AsmInstruction> &AsmProgram::GetCode() {
+    return code;
+}
+
+const std::vector<AsmData> &AsmProgram::GetData() const {
+    return data;
+}
+
+const std::vector<std::string> &AsmProgram::GetGlobals() const {
+    return globals;
+}
+
+void AsmProgram::Print(std::ostream &out) const {
+    out << "    .text" << endl;
+    for (const auto &global: globals)
+        out << "    .globl " << global << endl;
+    for (const auto &instruction: code) {
+        if (instruction.GetOpCode() == OpCode::Label)
+            out << instruction.GetText() << endl;
+        else
+            out << "    " << instruction.GetText() << endl;
+    }
+    out << "    .section .rodata" << endl;
+    for (const auto &item: data)
+        if (item.IsReadOnly())
+            item.Print(out);
+    out << "    .data" << endl;
+    for (const auto &item: data)
+        if (!item.IsReadOnly())
+            item.Print(out);
+    out << "    .section .note.GNU-stack,\"\",@progbits" << endl;
+}
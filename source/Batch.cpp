@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "Batch.h"
+#include "Scanner.h"
+#include "PipelinedScanner.h"
+#include "Parser.h"
+#include "ThreadPool.h"
+#include "Error.h"
+
+using namespace std;
+
+BatchResult::BatchResult(std::string fileName) : fileName(fileName), ok(false), seconds(0) {}
+
+const std::string &BatchResult::GetFileName() const {
+    return fileName;
+}
+
+const std::string &BatchResult::GetOutput() const {
+    return output;
+}
+
+bool BatchResult::IsOk() const {
+    return ok;
+}
+
+double BatchResult::GetSeconds() const {
+    return seconds;
+}
+
+// Each file is parsed on a single thread; the pool is already kept busy with whole files.
+Batch::Batch(std::string mode, std::string path, int threads) : mode(mode), threads(max(threads, 1)), seconds(0) {
+    struct stat info;
+    if (stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+        root = path;
+        ReadDirectory(path);
+    } else {
+        root = path.rfind('/') == string::npos ? "." : path.substr(0, path.rfind('/'));
+        ReadManifest(path);
+    }
+    auto start = chrono::steady_clock::now();
+    {
+        ThreadPool pool(this->threads);
+        for (auto &result: results) {
+            pool.Submit([this, &result]() {
+                auto fileStart = chrono::steady_clock::now();
+                ostringstream out;
+                try {
+                    if (ifstream(result.fileName).is_open())
+                        result.ok = Run(this->mode, result.fileName.c_str(), out);
+                    else
+                        out << "Cannot open " << result.fileName;
+                }
+                catch (exception &exception) {
+                    out << "Internal error: " << exception.what();
+                }
+                result.output = out.str();
+                result.seconds = chrono::duration<double>(chrono::steady_clock::now() - fileStart).count();
+            });
+        }
+        pool.Wait();
+    }
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+bool Batch::IsMode(const std::string &mode) {
+    return mode == "-s" || mode == "-pe" || mode == "-pd" || mode == "-ps";
+}
+
+// Runs one front-end mode on one file exactly as the single-file command line does; returns
+// false when the file ended in a diagnostic, which is printed in place of the rest.
+bool Batch::Run(const std::string &mode, const char *fileName, std::ostream &out, int threads, bool pipelined) {
+    try {
+        if (mode == "-s") {
+            PScanner scanner(pipelined ? new PipelinedScanner(fileName) : new Scanner(fileName));
+            while (!scanner->IsEndOfFile()) {
+                scanner->NextToken();
+                scanner->PrintToken(out);
+            }
+        }
+        else if (mode == "-pe") {
+            Parser parser(fileName, ParserConfig::ParseExpression, 1, pipelined);
+            parser.PrintTree(out);
+        }
+        else if (mode == "-pd") {
+            Parser parser(fileName, ParserConfig::ParseProgram, threads, pipelined);
+            parser.PrintStack(out);
+        }
+        else if (mode == "-ps") {
+            Parser parser(fileName, ParserConfig::ParseProgram, threads, pipelined);
+            parser.PrintTree(out);
+        }
+    }
+    catch (Error error) {
+        out << error.GetMessage();
+        return false;
+    }
+    return true;
+}
+
+const std::vector<BatchResult> &Batch::GetResults() const {
+    return results;
+}
+
+// A manifest names one source file per line, relative to the manifest itself; blank lines and
+// lines starting with '#' are skipped.
+void Batch::ReadManifest(const std::string &path) {
+    ifstream manifest(path);
+    if (!manifest.is_open())
+        throw runtime_error("cannot open manifest " + path);
+    string line;
+    while (getline(manifest, line)) {
+        line.erase(0, line.find_first_not_of(" \t\r"));
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (line.empty() || line[0] == '#')
+            continue;
+        results.emplace_back(line[0] == '/' ? line : root + "/" + line);
+    }
+}
+
+// Collects the .pas, .pp and .in files under a directory, in name order.
+void Batch::ReadDirectory(const std::string &path) {
+    DIR *dir = opendir(path.c_str());
+    if (dir == nullptr)
+        throw runtime_error("cannot open directory " + path);
+    vector<string> names;
+    while (dirent *entry = readdir(dir))
+        if (entry->d_name[0] != '.')
+            names.push_back(entry->d_name);
+    closedir(dir);
+    sort(names.begin(), names.end());
+    for (const auto &name: names) {
+        string file = path + "/" + name;
+        struct stat info;
+        if (stat(file.c_str(), &info) != 0)
+            continue;
+        if (S_ISDIR(info.st_mode)) {
+            ReadDirectory(file);
+            continue;
+        }
+        string extension = name.rfind('.') == string::npos ? "" : name.substr(name.rfind('.'));
+        if (extension == ".pas" || extension == ".pp" || extension == ".in")
+            results.emplace_back(file);
+    }
+}
+
+// Writes each result to <outputDir>/<name>.out, the name taken relative to the directory or
+// manifest the batch was read from, so the files line up with the expected outputs of the tests.
+void Batch::Write(const std::string &outputDir) const {
+    for (const auto &result: results) {
+        string name = result.fileName;
+        if (name.compare(0, root.size() + 1, root + "/") == 0)
+            name = name.substr(root.size() + 1);
+        else if (name.rfind('/') != string::npos)
+            name = name.substr(name.rfind('/') + 1);
+        if (name.rfind('.') != string::npos && name.rfind('.') > (name.rfind('/') + 1))
+            name = name.substr(0, name.rfind('.'));
+        string file = outputDir + "/" + name + ".out";
+        for (size_t slash = file.find('/', 1); slash != string::npos; slash = file.find('/', slash + 1))
+            mkdir(file.substr(0, slash).c_str(), 0755);
+        ofstream out(file, ios::binary);
+        if (!out.is_open())
+            throw runtime_error("cannot write " + file);
+        out << result.output;
+    }
+}
+
+void Batch::Print(std::ostream &out) const {
+    for (const auto &result: results)
+        out << "==> " << result.fileName << " <==" << endl << result.output << endl;
+}
+
+void Batch::PrintSummary(std::ostream &out) const {
+    int ok = count_if(results.begin(), results.end(), [](const BatchResult &result) { return result.IsOk(); });
+    out << "batch: " << results.size() << " files, " << ok << " ok, " << results.size() - ok << " with errors, "
+        << fixed << setprecision(2) << seconds << "s on " << threads << " threads" << endl;
+}
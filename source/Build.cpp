@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <stdexcept>
+#include "Build.h"
+#include "Scanner.h"
+#include "Parser.h"
+#include "UnitInterface.h"
+#include "Error.h"
+
+using namespace std;
+
+static const map<BuildState, string> buildStateName = {
+        { BuildState::Pending,  "pending"    },
+        { BuildState::Compiled, "compiled"   },
+        { BuildState::UpToDate, "up to date" },
+        { BuildState::Failed,   "failed"     },
+        { BuildState::Skipped,  "skipped"    }
+};
+
+static std::string ToLower(std::string name) {
+    transform(name.begin(), name.end(), name.begin(), ::tolower);
+    return name;
+}
+
+static std::string GetBaseName(const std::string &fileName) {
+    return fileName.substr(fileName.rfind('/') + 1);
+}
+
+BuildUnit::BuildUnit(std::string name, std::string sourceFileName, std::string interfaceFileName) :
+        name(name), sourceFileName(sourceFileName), interfaceFileName(interfaceFileName), waiting(0),
+        state(BuildState::Pending), hash(0), seconds(0) {}
+
+const std::string &BuildUnit::GetName() const {
+    return name;
+}
+
+const std::string &BuildUnit::GetSourceFileName() const {
+    return sourceFileName;
+}
+
+BuildState BuildUnit::GetState() const {
+    return state;
+}
+
+const std::string &BuildUnit::GetOutput() const {
+    return output;
+}
+
+double BuildUnit::GetSeconds() const {
+    return seconds;
+}
+
+// The graph is read first and checked for cycles; then the units that use nothing start, and every
+// unit that finishes starts those of its users it was the last to hold up.
+Build::Build(std::string fileName, int threads) : threads(max(threads, 1)), seconds(0) {
+    auto start = chrono::steady_clock::now();
+    string base = GetBaseName(fileName);
+    AddUnit(ToLower(base.substr(0, base.rfind('.'))), fileName, "");
+    for (int i = 0; i < units.size(); i++)
+        ReadUses(units[i].get());
+    CheckCycles();
+    pool = PThreadPool(new ThreadPool(this->threads));
+    for (const auto &unit: units)
+        unit->waiting = unit->uses.size();
+    for (const auto &unit: units)
+        if (unit->uses.empty())
+            Start(unit.get());
+    pool->Wait();
+    pool = nullptr;
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+const std::vector<PBuildUnit> &Build::GetUnits() const {
+    return units;
+}
+
+bool Build::IsOk() const {
+    for (const auto &unit: units)
+        if (unit->state != BuildState::Compiled && unit->state != BuildState::UpToDate)
+            return false;
+    return true;
+}
+
+BuildUnit *Build::AddUnit(const std::string &name, const std::string &sourceFileName,
+                          const std::string &interfaceFileName) {
+    units.push_back(PBuildUnit(new BuildUnit(name, sourceFileName, interfaceFileName)));
+    unitNames[name] = units.back().get();
+    return units.back().get();
+}
+
+// Scans no further than the uses clause. A unit's source is looked for beside its interface file,
+// as <name>.pas or <name>.pp; a unit with neither is built already if its interface file is there.
+// Anything that cannot be read here is left for the compiler to report.
+void Build::ReadUses(BuildUnit *unit) {
+    if (!ifstream(unit->sourceFileName).is_open())
+        return;
+    vector<string> names;
+    try {
+        Scanner scanner(unit->sourceFileName.c_str());
+        PToken token = scanner.GetToken();
+        scanner.NextToken();
+        if (token->GetState() == Unit) {
+            if (unit->interfaceFileName.empty())
+                unit->interfaceFileName = unit->sourceFileName.substr(0, unit->sourceFileName.rfind('.')) + ".ppi";
+            while (!scanner.IsEndOfFile() && token->GetState() != Interface)
+                scanner.NextToken();
+            scanner.NextToken();
+        }
+        while (token->GetState() == Uses || (token->GetState() == Comma && !names.empty())) {
+            scanner.NextToken();
+            if (token->GetType() != TK::Identifier)
+                break;
+            names.push_back(ToLower(token->GetValue()));
+            scanner.NextToken();
+        }
+    }
+    catch (Error &error) {
+    }
+    for (const auto &name: names) {
+        BuildUnit *used = unitNames.count(name) > 0 ? unitNames[name] : nullptr;
+        if (used == nullptr) {
+            string interfaceFileName = UnitInterface::GetFileName(unit->sourceFileName, name);
+            string base = interfaceFileName.substr(0, interfaceFileName.rfind('.'));
+            string sourceFileName = ifstream(base + ".pp").is_open() ? base + ".pp" : base + ".pas";
+            used = AddUnit(name, sourceFileName, interfaceFileName);
+        }
+        unit->uses.push_back(used);
+        used->users.push_back(unit);
+    }
+}
+
+// A depth-first search from every unit; meeting a unit still on the search path closes a cycle.
+void Build::CheckCycles() {
+    map<BuildUnit*, int> marks;
+    vector<BuildUnit*> path;
+    function<void(BuildUnit*)> visit = [&](BuildUnit *unit) {
+        if (marks[unit] == 2)
+            return;
+        if (marks[unit] == 1) {
+            string cycle;
+            for (auto i = find(path.begin(), path.end(), unit); i != path.end(); i++)
+                cycle += (*i)->name + " -> ";
+            throw runtime_error("circular unit reference: " + cycle + unit->name);
+        }
+        marks[unit] = 1;
+        path.push_back(unit);
+        for (const auto &used: unit->uses)
+            visit(used);
+        path.pop_back();
+        marks[unit] = 2;
+    };
+    for (const auto &unit: units)
+        visit(unit.get());
+}
+
+void Build::Start(BuildUnit *unit) {
+    pool->Submit([this, unit]() {
+        auto start = chrono::steady_clock::now();
+        if (IsCurrent(unit))
+            unit->state = BuildState::UpToDate;
+        else
+            Compile(unit);
+        unit->seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        Finish(unit);
+    });
+}
+
+// A user whose units all succeeded starts; one that waited on a failure is skipped, and so are
+// its own users in turn.
+void Build::Finish(BuildUnit *unit) {
+    vector<BuildUnit*> ready;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        for (const auto &user: unit->users)
+            if (--user->waiting == 0)
+                ready.push_back(user);
+    }
+    for (const auto &user: ready) {
+        bool failed = any_of(user->uses.begin(), user->uses.end(), [](BuildUnit *used) {
+            return used->state == BuildState::Failed || used->state == BuildState::Skipped;
+        });
+        if (!failed) {
+            Start(user);
+            continue;
+        }
+        user->state = BuildState::Skipped;
+        Finish(user);
+    }
+}
+
+// Current when its interface file was compiled from the source as it is now, against the
+// interfaces the units it uses have now. A unit without a source is taken as it is.
+bool Build::IsCurrent(BuildUnit *unit) {
+    if (unit->interfaceFileName.empty() || !ifstream(unit->interfaceFileName).is_open())
+        return false;
+    try {
+        UnitInterface compiled(unit->interfaceFileName);
+        bool source = ifstream(unit->sourceFileName).is_open();
+        if (source && compiled.GetSourceHash() != UnitInterface::HashFile(unit->sourceFileName))
+            return false;
+        set<pair<string, unsigned long long>> recorded, current;
+        for (const auto &used: compiled.GetUses())
+            recorded.emplace(ToLower(used.first), used.second);
+        for (const auto &used: unit->uses)
+            current.emplace(used->name, used->hash);
+        if (source && recorded != current)
+            return false;
+        unit->hash = compiled.GetHash();
+        return true;
+    }
+    catch (Error &error) {
+        return false;
+    }
+}
+
+// The program at the root is parsed for its diagnostics; a unit also gets its interface file.
+void Build::Compile(BuildUnit *unit) {
+    if (!ifstream(unit->sourceFileName).is_open()) {
+        unit->state = BuildState::Failed;
+        unit->output = "Cannot open " + unit->sourceFileName;
+        return;
+    }
+    try {
+        if (unit->interfaceFileName.empty()) {
+            Parser parser(unit->sourceFileName.c_str(), ParserConfig::ParseProgram);
+        } else {
+            Parser parser(unit->sourceFileName.c_str(), ParserConfig::ParseUnit);
+            parser.GetUnit()->Save(unit->interfaceFileName);
+            unit->hash = parser.GetUnit()->GetHash();
+        }
+        unit->state = BuildState::Compiled;
+    }
+    catch (Error &error) {
+        unit->state = BuildState::Failed;
+        unit->output = error.GetMessage();
+    }
+    catch (exception &exception) {
+        unit->state = BuildState::Failed;
+        unit->output = string("Internal error: ") + exception.what();
+    }
+}
+
+// Units in the order they could have been built one at a time: each after the units it uses, in
+// the order its uses clause names them.
+void Build::Print(std::ostream &out) const {
+    set<BuildUnit*> printed;
+    function<void(BuildUnit*)> print = [&](BuildUnit *unit) {
+        if (!printed.insert(unit).second)
+            return;
+        for (const auto &used: unit->uses)
+            print(used);
+        out << buildStateName.at(unit->state) << " " << unit->name << endl;
+        if (!unit->output.empty() && unit->output[0] == '(')
+            out << GetBaseName(unit->sourceFileName);
+        if (!unit->output.empty())
+            out << unit->output << endl;
+    };
+    print(units.front().get());
+    map<BuildState, int> counts;
+    for (const auto &unit: units)
+        counts[unit->state]++;
+    out << "build: " << units.size() << " files, " << counts[BuildState::Compiled] << " compiled, "
+        << counts[BuildState::UpToDate] << " up to date, " << counts[BuildState::Failed] << " failed, "
+        << counts[BuildState::Skipped] << " skipped, " << fixed << setprecision(3) << seconds << "s on "
+        << threads << " threads" << endl;
+}
+
+// The chain of units, each using the next, whose times add up to the most: however many threads
+// there are, the build takes at least that long.
+void Build::PrintCriticalPath(std::ostream &out) const {
+    map<BuildUnit*, double> finish;
+    map<BuildUnit*, BuildUnit*> slowest;
+    function<double(BuildUnit*)> measure = [&](BuildUnit *unit) {
+        if (finish.count(unit) > 0)
+            return finish[unit];
+        double longest = 0;
+        for (const auto &used: unit->uses)
+            if (measure(used) > longest || slowest[unit] == nullptr) {
+                longest = measure(used);
+                slowest[unit] = used;
+            }
+        return finish[unit] = longest + unit->seconds;
+    };
+    BuildUnit *root = units.front().get();
+    double total = measure(root);
+    vector<BuildUnit*> path;
+    for (BuildUnit *unit = root; unit != nullptr; unit = slowest[unit])
+        path.insert(path.begin(), unit);
+    out << "critical path:";
+    for (const auto &unit: path)
+        out << (unit == path.front() ? " " : " -> ") << unit->name << " " << fixed << setprecision(3)
+            << unit->seconds << "s";
+    out << ", " << total << "s of " << seconds << "s" << endl;
+}
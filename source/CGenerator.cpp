@@ -0,0 +1,485 @@
+#include <fstream>
+#include <cstdlib>
+#include <climits>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include "CGenerator.h"
+#include "Error.h"
+
+using namespace std;
+
+static const map<IrOp, string> cBinaryOp = {
+        { IrOp::Div,  "/" },
+        { IrOp::Mod,  "%" },
+        { IrOp::And,  "&" },
+        { IrOp::Or,   "|" },
+        { IrOp::Xor,  "^" },
+        { IrOp::FAdd, "+" },
+        { IrOp::FSub, "-" },
+        { IrOp::FMul, "*" },
+        { IrOp::FDiv, "/" }
+};
+
+static const map<IrOp, string> cWrappingOp = {
+        { IrOp::Add, "+" },
+        { IrOp::Sub, "-" },
+        { IrOp::Mul, "*" }
+};
+
+static const map<IrCondition, string> cRelationalOp = {
+        { IrCondition::Eq, "==" },
+        { IrCondition::Ne, "!=" },
+        { IrCondition::Lt, "<"  },
+        { IrCondition::Le, "<=" },
+        { IrCondition::Gt, ">"  },
+        { IrCondition::Ge, ">=" }
+};
+
+static const map<IrWrite, string> cWriteFormat = {
+        { IrWrite::Int,    "%d" },
+        { IrWrite::Char,   "%c" },
+        { IrWrite::String, "%s" }
+};
+
+CGenerator::CGenerator(PIrModule module) : module(module), runtimeUsed(false), rangeChecked(false),
+        divideChecked(false) {
+    Run();
+}
+
+void CGenerator::Run() {
+    GenerateGlobals();
+    for (const auto &irFunction: module->GetFunctions())
+        GenerateFunction(irFunction);
+}
+
+void CGenerator::Print(std::ostream &out) {
+    if (divideChecked)
+        out << "#include <limits.h>" << endl;
+    out << "#include <stdio.h>" << endl;
+    if (rangeChecked || divideChecked)
+        out << "#include <stdlib.h>" << endl;
+    out << "#include <string.h>" << endl << endl;
+    out << prototypes.str();
+    if (!prototypes.str().empty())
+        out << endl;
+    out << globals.str();
+    if (!globals.str().empty())
+        out << endl;
+    if (runtimeUsed)
+        GenerateRuntime(out);
+    if (rangeChecked)
+        GenerateRangeError(out);
+    if (divideChecked)
+        GenerateDivideError(out);
+    out << functions.str();
+}
+
+// What cc prints goes to a file beside the source and is shown only if the build fails; warnings
+// about generated code mean nothing to the user, and would end up in the output -cache keeps.
+void CGenerator::Build(const std::string &output) {
+    string source = output + ".c", log = source + ".log";
+    ofstream fout(source);
+    Print(fout);
+    fout.close();
+    string command = "cc -std=c99 -O2 -o \"" + output + "\" \"" + source + "\"";
+    int status = system((command + " > \"" + log + "\" 2>&1").c_str());
+    ostringstream diagnostics;
+    diagnostics << ifstream(log).rdbuf();
+    remove(source.c_str());
+    remove(log.c_str());
+    if (status != 0)
+        throw BuildError(command, diagnostics.str());
+}
+
+void CGenerator::GenerateRuntime(std::ostream &out) {
+    // Formats a double the way Free Pascal does: " 1.50000000000000E+000".
+    out << "static void rt_write_double(double value) {" << endl;
+    out << "    char buffer[48];" << endl;
+    out << "    snprintf(buffer, sizeof(buffer), \"% .14E\", value);" << endl;
+    out << "    char *exponent = strchr(buffer, 'E');" << endl;
+    out << "    if (exponent != NULL && exponent[4] == '\\0') {" << endl;
+    out << "        memmove(exponent + 3, exponent + 2, 3);" << endl;
+    out << "        exponent[2] = '0';" << endl;
+    out << "    }" << endl;
+    out << "    printf(\"%s\", buffer);" << endl;
+    out << "}" << endl << endl;
+}
+
+void CGenerator::GenerateRangeError(std::ostream &out) {
+    out << "static void rt_range_error(void) {" << endl;
+    out << "    printf(\"Runtime error 201\\n\");" << endl;
+    out << "    exit(201);" << endl;
+    out << "}" << endl << endl;
+}
+
+void CGenerator::GenerateDivideError(std::ostream &out) {
+    out << "static void rt_divide_error(void) {" << endl;
+    out << "    printf(\"Runtime error 200\\n\");" << endl;
+    out << "    exit(200);" << endl;
+    out << "}" << endl << endl;
+}
+
+// Globals keep the byte image the IR gives them; the union only forces double alignment.
+void CGenerator::GenerateGlobals() {
+    for (const auto &global: module->GetGlobals()) {
+        const vector<unsigned char> &bytes = global.GetBytes();
+        globals << "static " << (global.IsReadOnly() ? "const " : "")
+                << GetStorage(bytes.size(), GetName(global.GetName())) << " = { .bytes = ";
+        if (global.IsReadOnly() && !bytes.empty() && bytes.back() == 0) {
+            globals << Quote(string(bytes.begin(), bytes.end() - 1));
+        } else {
+            globals << "{ ";
+            for (int i = 0; i < bytes.size(); i++)
+                globals << (i == 0 ? "" : ", ") << (int) bytes[i];
+            globals << " }";
+        }
+        globals << " };" << endl;
+    }
+}
+
+std::string CGenerator::GenerateHeader(PIrFunction irFunction) {
+    string text = irFunction->IsExported() ? "" : "static ";
+    text += GetTypeName(irFunction->GetReturnType()) + " " + irFunction->GetName() + "(";
+    const vector<IrType> &types = irFunction->GetParamTypes();
+    for (int i = 0; i < types.size(); i++) {
+        string type = GetTypeName(types[i]);
+        text += (i == 0 ? "" : ", ") + type + (type.back() == '*' ? "" : " ") + "p" + to_string(i);
+    }
+    if (types.empty())
+        text += "void";
+    return text + ")";
+}
+
+void CGenerator::GenerateFunction(PIrFunction irFunction) {
+    function = irFunction;
+    function->SplitCriticalEdges();
+    function->Renumber();
+    string header = GenerateHeader(function);
+    if (!function->IsExported())
+        prototypes << header << ";" << endl;
+    functions << header << " {" << endl;
+    const vector<IrSlot> &slots = function->GetSlots();
+    for (int i = 0; i < slots.size(); i++)
+        functions << "    " << GetStorage(slots[i].GetSize(), "s" + to_string(i)) << ";" << endl;
+    vector<IrBlock*> blocks = function->GetBlocks();
+    for (const auto &block: blocks)
+        for (const auto &instruction: block->GetInstructions())
+            if (instruction->GetType() != IrType::Void && !IsInlined(instruction)) {
+                string type = GetTypeName(instruction->GetType());
+                functions << "    " << type << (type.back() == '*' ? "" : " ") << GetValue(instruction) << ";"
+                          << endl;
+            }
+    for (int i = 0; i < blocks.size(); i++)
+        GenBlock(blocks[i], i + 1 < blocks.size() ? blocks[i + 1] : nullptr, functions);
+    functions << "}" << endl << endl;
+    function = nullptr;
+}
+
+void CGenerator::GenBlock(IrBlock *block, IrBlock *next, std::ostream &out) {
+    out << GetBlockName(block) << ":" << endl;
+    for (const auto &instruction: block->GetInstructions()) {
+        if (instruction->IsTerminator())
+            GenTerminator(instruction, next, out);
+        else
+            GenInstruction(instruction, out);
+    }
+}
+
+void CGenerator::GenInstruction(IrInstruction *instruction, std::ostream &out) {
+    const vector<IrInstruction*> &operands = instruction->GetOperands();
+    switch (instruction->GetOp()) {
+        case IrOp::Phi: {
+            break;
+        }
+        case IrOp::Load: {
+            string address = GetValue(operands[0]);
+            if (instruction->GetSize() == 1)
+                out << "    " << GetValue(instruction) << " = *" << address << ";" << endl;
+            else
+                out << "    memcpy(&" << GetValue(instruction) << ", " << address << ", "
+                    << instruction->GetSize() << ");" << endl;
+            break;
+        }
+        case IrOp::Store: {
+            string address = GetValue(operands[0]);
+            if (instruction->GetSize() == 1)
+                out << "    *" << address << " = (unsigned char) " << GetValue(operands[1]) << ";" << endl;
+            else
+                out << "    memcpy(" << address << ", &(" << GetTypeName(operands[1]->GetType()) << ") { "
+                    << GetValue(operands[1]) << " }, " << instruction->GetSize() << ");" << endl;
+            break;
+        }
+        case IrOp::Copy: {
+            out << "    memmove(" << GetValue(operands[0]) << ", " << GetValue(operands[1]) << ", "
+                << instruction->GetSize() << ");" << endl;
+            break;
+        }
+        case IrOp::Check: {
+            rangeChecked = true;
+            string value = GetValue(operands[0]);
+            out << "    if (" << value << " < " << GetValue(operands[1]) << " || " << value << " > "
+                << GetValue(operands[2]) << ")" << endl;
+            out << "        rt_range_error();" << endl;
+            break;
+        }
+        case IrOp::Div:
+        case IrOp::Mod: {
+            // Division by zero and INT_MIN / -1 are undefined in C, so the operands are tested first.
+            bool constant = operands[1]->GetOp() == IrOp::Const;
+            if (!constant || operands[1]->GetInt() == 0) {
+                divideChecked = true;
+                out << "    if (" << GetValue(operands[1]) << " == 0)" << endl;
+                out << "        rt_divide_error();" << endl;
+            }
+            bool lowest = operands[0]->GetOp() != IrOp::Const || operands[0]->GetInt() == INT_MIN;
+            if (lowest && (!constant || operands[1]->GetInt() == -1)) {
+                divideChecked = true;
+                out << "    if (" << GetValue(operands[0]) << " == INT_MIN && " << GetValue(operands[1])
+                    << " == -1)" << endl;
+                out << "        rt_divide_error();" << endl;
+            }
+            out << "    " << GetValue(instruction) << " = " << GenExpression(instruction) << ";" << endl;
+            break;
+        }
+        case IrOp::Write: {
+            if (instruction->GetWrite() == IrWrite::NewLine) {
+                out << "    printf(\"\\n\");" << endl;
+            } else if (instruction->GetWrite() == IrWrite::Double) {
+                runtimeUsed = true;
+                out << "    rt_write_double(" << GetValue(operands[0]) << ");" << endl;
+            } else {
+                out << "    printf(\"" << cWriteFormat.at(instruction->GetWrite()) << "\", "
+                    << GetValue(operands[0]) << ");" << endl;
+            }
+            break;
+        }
+        default: {
+            if (IsInlined(instruction))
+                break;
+            out << "    ";
+            if (instruction->GetType() != IrType::Void)
+                out << GetValue(instruction) << " = ";
+            out << GenExpression(instruction) << ";" << endl;
+        }
+    }
+}
+
+std::string CGenerator::GenExpression(IrInstruction *instruction) {
+    const vector<IrInstruction*> &operands = instruction->GetOperands();
+    vector<string> values;
+    for (const auto &operand: operands)
+        values.push_back(GetValue(operand));
+    IrOp op = instruction->GetOp();
+    if (cWrappingOp.find(op) != cWrappingOp.end())
+        return "(int) ((unsigned) " + values[0] + " " + cWrappingOp.at(op) + " (unsigned) " + values[1] + ")";
+    if (cBinaryOp.find(op) != cBinaryOp.end())
+        return values[0] + " " + cBinaryOp.at(op) + " " + values[1];
+    switch (op) {
+        case IrOp::Shl: {
+            return "(int) ((unsigned) " + values[0] + " << (" + values[1] + " & 31))";
+        }
+        case IrOp::Shr: {
+            return values[0] + " >> (" + values[1] + " & 31)";
+        }
+        case IrOp::Neg: {
+            return "(int) (0u - (unsigned) " + values[0] + ")";
+        }
+        case IrOp::Not: {
+            return "~" + values[0];
+        }
+        case IrOp::FNeg: {
+            return "-(" + values[0] + ")";
+        }
+        case IrOp::Cmp:
+        case IrOp::FCmp: {
+            return values[0] + " " + cRelationalOp.at(instruction->GetCondition()) + " " + values[1];
+        }
+        case IrOp::IntToDouble: {
+            return "(double) " + values[0];
+        }
+        case IrOp::DoubleToInt: {
+            return "(int) " + values[0];
+        }
+        case IrOp::Index: {
+            return GenIndex(instruction);
+        }
+        case IrOp::Call: {
+            string text = instruction->GetName() + "(";
+            for (int i = 0; i < values.size(); i++)
+                text += (i == 0 ? "" : ", ") + values[i];
+            return text + ")";
+        }
+        default: {
+            return GetValue(instruction);
+        }
+    }
+}
+
+std::string CGenerator::GenIndex(IrInstruction *instruction) {
+    const vector<IrInstruction*> &operands = instruction->GetOperands();
+    string text = GetValue(operands[0]);
+    long long disp = instruction->GetInt();
+    if (operands.size() > 1) {
+        text += " + (long) " + GetValue(operands[1]);
+        if (instruction->GetSize() != 1)
+            text += " * " + to_string(instruction->GetSize());
+    }
+    if (disp != 0)
+        text += (disp < 0 ? " - " : " + ") + to_string(disp < 0 ? -disp : disp);
+    return text;
+}
+
+// Phi operands are assigned on the edge. Copies that read another phi of the same block go
+// through temporaries so that all of them see the old values.
+void CGenerator::GenPhiCopies(IrBlock *from, IrBlock *to, std::ostream &out) {
+    vector<pair<IrInstruction*, IrInstruction*>> copies;
+    bool interfere = false;
+    for (const auto &phi: to->GetPhis())
+        for (int i = 0; i < phi->GetTargets().size(); i++)
+            if (phi->GetTargets()[i] == from) {
+                IrInstruction *source = phi->GetOperand(i);
+                if (source != phi)
+                    copies.push_back({ phi, source });
+                interfere = interfere || (source != phi && source->GetOp() == IrOp::Phi && source->GetBlock() == to);
+                break;
+            }
+    if (!interfere) {
+        for (const auto &copy: copies)
+            out << "    " << GetValue(copy.first) << " = " << GetValue(copy.second) << ";" << endl;
+        return;
+    }
+    out << "    {" << endl;
+    for (int i = 0; i < copies.size(); i++) {
+        string type = GetTypeName(copies[i].first->GetType());
+        out << "        " << type << (type.back() == '*' ? "" : " ") << "t" << i << " = "
+            << GetValue(copies[i].second) << ";" << endl;
+    }
+    for (int i = 0; i < copies.size(); i++)
+        out << "        " << GetValue(copies[i].first) << " = t" << i << ";" << endl;
+    out << "    }" << endl;
+}
+
+void CGenerator::GenTerminator(IrInstruction *instruction, IrBlock *next, std::ostream &out) {
+    switch (instruction->GetOp()) {
+        case IrOp::Jump: {
+            IrBlock *target = instruction->GetTargets()[0];
+            GenPhiCopies(instruction->GetBlock(), target, out);
+            if (target != next)
+                out << "    goto " << GetBlockName(target) << ";" << endl;
+            break;
+        }
+        case IrOp::Branch: {
+            IrBlock *trueTarget = instruction->GetTargets()[0], *falseTarget = instruction->GetTargets()[1];
+            string condition = GetValue(instruction->GetOperand(0));
+            if (trueTarget == next) {
+                out << "    if (!" << condition << ") goto " << GetBlockName(falseTarget) << ";" << endl;
+                break;
+            }
+            out << "    if (" << condition << ") goto " << GetBlockName(trueTarget) << ";" << endl;
+            if (falseTarget != next)
+                out << "    goto " << GetBlockName(falseTarget) << ";" << endl;
+            break;
+        }
+        default: {
+            if (instruction->GetOperands().empty())
+                out << "    return;" << endl;
+            else
+                out << "    return " << GetValue(instruction->GetOperand(0)) << ";" << endl;
+        }
+    }
+}
+
+std::string CGenerator::GetValue(IrInstruction *value) {
+    switch (value->GetOp()) {
+        case IrOp::Const: {
+            if (value->GetType() == IrType::Double)
+                return DoubleText(value->GetDouble());
+            if (value->GetType() == IrType::Pointer)
+                return "(unsigned char *) " + to_string(value->GetInt());
+            return IntText(value->GetInt());
+        }
+        case IrOp::Param: {
+            return "p" + to_string(value->GetInt());
+        }
+        case IrOp::SlotAddr: {
+            return "s" + to_string(value->GetInt()) + ".bytes";
+        }
+        case IrOp::GlobalAddr: {
+            return "(unsigned char *) " + GetName(value->GetName()) + ".bytes";
+        }
+        default: {
+            return "v" + to_string(value->GetId());
+        }
+    }
+}
+
+std::string CGenerator::GetName(const std::string &label) {
+    return label[0] == '.' ? label.substr(1) : label;
+}
+
+std::string CGenerator::GetBlockName(IrBlock *block) {
+    return "b" + to_string(block->GetId());
+}
+
+std::string CGenerator::GetTypeName(IrType type) {
+    switch (type) {
+        case IrType::Int: {
+            return "int";
+        }
+        case IrType::Double: {
+            return "double";
+        }
+        case IrType::Pointer: {
+            return "unsigned char *";
+        }
+        default: {
+            return "void";
+        }
+    }
+}
+
+std::string CGenerator::GetStorage(int size, const std::string &name) {
+    return "union { double align; unsigned char bytes[" + to_string(max(size, 1)) + "]; } " + name;
+}
+
+bool CGenerator::IsInlined(IrInstruction *value) {
+    IrOp op = value->GetOp();
+    return op == IrOp::Const || op == IrOp::Param || op == IrOp::SlotAddr || op == IrOp::GlobalAddr;
+}
+
+std::string CGenerator::IntText(long long value) {
+    if (value == INT_MIN)
+        return "(-2147483647 - 1)";
+    return value < 0 ? "(" + to_string(value) + ")" : to_string(value);
+}
+
+std::string CGenerator::Quote(const std::string &value) {
+    string text = "\"";
+    for (unsigned char c: value) {
+        if (c == '"' || c == '\\') {
+            text += '\\';
+            text += c;
+        } else if (c < 32 || c > 126) {
+            char buff[8];
+            sprintf(buff, "\\%03o", c);
+            text += buff;
+        } else {
+            text += c;
+        }
+    }
+    return text + "\"";
+}
+
+std::string CGenerator::DoubleText(double value) {
+    if (isnan(value))
+        return "(0.0 / 0.0)";
+    if (isinf(value))
+        return value < 0 ? "(-1.0 / 0.0)" : "(1.0 / 0.0)";
+    char buff[32];
+    sprintf(buff, "%.17g", value);
+    string text = buff;
+    if (text.find_first_of(".eni") == string::npos)
+        text += ".0";
+    return text;
+}
@@ -0,0 +1,134 @@
+#include "CallGraph.h"
+
+using namespace std;
+
+CallGraph::CallGraph(PNode tree, PSymbolTable globals) {
+    AddBody(nullptr, tree);
+    AddProcedures(globals);
+    FindReachable();
+}
+
+const std::set<Symbol*> &CallGraph::GetCallees(Symbol *procedure) const {
+    return callees.at(procedure);
+}
+
+bool CallGraph::IsReachable(Symbol *procedure) const {
+    return reachable.find(procedure) != reachable.end();
+}
+
+int CallGraph::GetProcedureCount() const {
+    return callees.size() - 1;
+}
+
+int CallGraph::GetRemovedCount() const {
+    return callees.size() - reachable.size();
+}
+
+// Size is counted in tree nodes, the closest measure of code there is before lowering.
+int CallGraph::GetRemovedSize() const {
+    int size = 0;
+    for (const auto &procedure: sizes)
+        if (!IsReachable(procedure.first))
+            size += procedure.second;
+    return size;
+}
+
+void CallGraph::AddProcedures(PSymbolTable table) {
+    for (const auto &symbol: table->GetSymbols()) {
+        SymType symType = symbol->GetSymType();
+        if (symType == SymType::Procedure || symType == SymType::Function) {
+            PSymbolProcedure proc = dynamic_pointer_cast<SymbolProcedure>(symbol);
+            AddBody(proc.get(), proc->GetBody());
+            AddProcedures(proc->GetLocals());
+        }
+    }
+}
+
+void CallGraph::AddBody(Symbol *procedure, PNode body) {
+    set<Symbol*> &calls = callees[procedure];
+    int &size = sizes[procedure];
+    Visit(body, calls, size);
+}
+
+// A procedure named anywhere in a body counts as called: a bare name is a call without
+// arguments, and the only other use, assigning a function its result, names the function itself.
+void CallGraph::Visit(PNode node, std::set<Symbol*> &calls, int &size) {
+    if (node == nullptr)
+        return;
+    size++;
+    switch (node->GetNodeType()) {
+        case NodeType::NodeValue: {
+            PSymbolComplex symbol = dynamic_pointer_cast<NodeValue>(node)->GetSymbol();
+            if (dynamic_pointer_cast<SymbolProcedure>(symbol) != nullptr)
+                calls.insert(symbol.get());
+            break;
+        }
+        case NodeType::NodeBinOp:
+        case NodeType::NodeAssignmentOp: {
+            PNodeBinOp binOp = dynamic_pointer_cast<NodeBinOp>(node);
+            Visit(binOp->GetLeft(), calls, size);
+            Visit(binOp->GetRight(), calls, size);
+            break;
+        }
+        case NodeType::NodeUnOp: {
+            Visit(dynamic_pointer_cast<NodeUnOp>(node)->GetNode(), calls, size);
+            break;
+        }
+        case NodeType::NodePeriod: {
+            Visit(dynamic_pointer_cast<NodePeriod>(node)->GetName(), calls, size);
+            break;
+        }
+        case NodeType::NodeBrackets:
+        case NodeType::NodeParentehsiss: {
+            PNodeStructed structured = dynamic_pointer_cast<NodeStructured>(node);
+            Visit(structured->GetName(), calls, size);
+            for (const auto &parameter: structured->GetParameters())
+                Visit(parameter, calls, size);
+            break;
+        }
+        case NodeType::NodeCompoundStatement: {
+            for (const auto &statement: dynamic_pointer_cast<NodeCompoundStatement>(node)->GetStatements())
+                Visit(statement, calls, size);
+            break;
+        }
+        case NodeType::NodeIfStatement: {
+            PNodeIfStatement ifStatement = dynamic_pointer_cast<NodeIfStatement>(node);
+            Visit(ifStatement->GetIfNode(), calls, size);
+            Visit(ifStatement->GetThenNode(), calls, size);
+            Visit(ifStatement->GetElseNode(), calls, size);
+            break;
+        }
+        case NodeType::NodeForStatement: {
+            PNodeForStatement forStatement = dynamic_pointer_cast<NodeForStatement>(node);
+            Visit(forStatement->GetControlVar(), calls, size);
+            Visit(forStatement->GetFinalVar(), calls, size);
+            Visit(forStatement->GetDoSt(), calls, size);
+            break;
+        }
+        case NodeType::NodeWhileStatement:
+        case NodeType::NodeRepeatStatement: {
+            PNodeWhileStatement whileStatement = dynamic_pointer_cast<NodeWhileStatement>(node);
+            Visit(whileStatement->GetCondition(), calls, size);
+            for (const auto &statement: whileStatement->GetStatements())
+                Visit(statement, calls, size);
+            break;
+        }
+        case NodeType::NodeWriteStatement: {
+            for (const auto &parameter: dynamic_pointer_cast<NodeWriteStatement>(node)->GetParameters())
+                Visit(parameter, calls, size);
+            break;
+        }
+    }
+}
+
+void CallGraph::FindReachable() {
+    vector<Symbol*> work = { nullptr };
+    reachable.insert(nullptr);
+    while (!work.empty()) {
+        Symbol *procedure = work.back();
+        work.pop_back();
+        for (const auto &callee: callees.at(procedure))
+            if (callees.find(callee) != callees.end() && reachable.insert(callee).second)
+                work.push_back(callee);
+    }
+}
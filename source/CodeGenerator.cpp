@@ -0,0 +1,765 @@
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <algorithm>
+#include "CodeGenerator.h"
+#include "Error.h"
+#include "ElfWriter.h"
+#include "Jit.h"
+#include "FrameLayout.h"
+
+using namespace std;
+
+CodeGenerator::CodeGenerator(PIrModule module) :
+        module(module), program(new AsmProgram()), frameSize(0), spillBase(0), labelCount(0), runtimeUsed(false),
+        rangeChecked(false), divideChecked(false) {
+    Run();
+}
+
+void CodeGenerator::Run() {
+    GenerateGlobals();
+    for (const auto &irFunction: module->GetFunctions())
+        GenerateFunction(irFunction);
+    if (runtimeUsed)
+        GenerateRuntime();
+    if (rangeChecked)
+        GenerateRangeError();
+    if (divideChecked)
+        GenerateDivideError();
+}
+
+const PAsmProgram CodeGenerator::GetProgram() const {
+    return program;
+}
+
+void CodeGenerator::Print(std::ostream &out) {
+    program->Print(out);
+}
+
+void CodeGenerator::Build(const std::string &output) {
+    string objFile = output + ".o";
+    BuildObject(objFile);
+    string command = "cc -o \"" + output + "\" \"" + objFile + "\"";
+    int status = system(command.c_str());
+    remove(objFile.c_str());
+    if (status != 0)
+        throw BuildError(command);
+}
+
+void CodeGenerator::BuildObject(const std::string &output) {
+    Encoder encoder(program);
+    ElfWriter(encoder).WriteObject(output);
+}
+
+void CodeGenerator::BuildStatic(const std::string &output) {
+    Encoder encoder(program);
+    ElfWriter(encoder).WriteExecutable(output);
+}
+
+int CodeGenerator::RunJit() {
+    Jit jit(program);
+    jit.WritePerfMap();
+    return jit.Run();
+}
+
+void CodeGenerator::GenerateGlobals() {
+    for (const auto &global: module->GetGlobals())
+        program->AddData(AsmData(global.GetName(), global.GetBytes(), global.GetAlign(), global.IsReadOnly()));
+}
+
+// SSA values live in the registers the allocator gives them and otherwise in their own frame
+// slot, reloaded at every use; constants and addresses of slots and globals are rematerialized
+// at each use instead. Operations work in rax, rcx, rdx and xmm0-1, which are never allocated.
+void CodeGenerator::GenerateFunction(PIrFunction irFunction) {
+    function = irFunction;
+    function->SplitCriticalEdges();
+    function->Renumber();
+    offsets.clear();
+    homes.clear();
+    savedRegisters.clear();
+    slotOffsets.clear();
+    blockLabels.clear();
+    if (function->IsExported())
+        program->AddGlobal(function->GetName());
+    GeneratePrologue(function->GetName());
+    int frameInstruction = program->GetCode().size() - 1;
+    RegisterAllocator allocator(function);
+    for (const auto &reg: allocator.GetSavedRegisters()) {
+        savedRegisters.push_back({ reg, Allocate(slotSize) });
+        Emit(OpCode::Mov, 8, { Operand::Reg(reg), Operand::Mem(Register::Rbp, savedRegisters.back().second) });
+    }
+    FrameLayout layout(function);
+    int slotBase = Allocate(layout.GetSize());
+    for (int i = 0; i < function->GetSlots().size(); i++)
+        slotOffsets.push_back(slotBase + layout.GetOffset(i));
+    spillBase = Allocate(slotSize * allocator.GetSpillSlotCount());
+    vector<IrBlock*> blocks = function->GetBlocks();
+    for (const auto &block: blocks) {
+        blockLabels[block] = NewLabel();
+        for (const auto &instruction: block->GetInstructions()) {
+            if (instruction->GetType() == IrType::Void || IsRematerialized(instruction))
+                continue;
+            if (allocator.GetRegister(instruction) != Register::None)
+                homes[instruction] = allocator.GetRegister(instruction);
+            else
+                offsets[instruction] = spillBase + slotSize * allocator.GetSpillSlot(instruction);
+        }
+    }
+    GenerateParams();
+    for (int i = 0; i < blocks.size(); i++)
+        GenBlock(blocks[i], i + 1 < blocks.size() ? blocks[i + 1] : nullptr);
+    GenerateEpilogue(frameInstruction);
+    function = nullptr;
+}
+
+void CodeGenerator::GeneratePrologue(std::string label) {
+    frameSize = 0;
+    exitLabel = NewLabel();
+    EmitLabel(label);
+    Emit(OpCode::Push, 8, { Operand::Reg(Register::Rbp) });
+    Emit(OpCode::Mov, 8, { Operand::Reg(Register::Rsp), Operand::Reg(Register::Rbp) });
+    Emit(OpCode::Sub, 8, { Operand::Imm(0), Operand::Reg(Register::Rsp) });
+}
+
+void CodeGenerator::GenerateEpilogue(int frameInstruction) {
+    int size = (frameSize + stackAlign - 1) / stackAlign * stackAlign;
+    program->GetCode()[frameInstruction].GetOperands()[0].SetValue(size);
+    EmitLabel(exitLabel);
+    RestoreRegisters();
+    Emit(OpCode::Leave);
+    Emit(OpCode::Ret);
+}
+
+void CodeGenerator::RestoreRegisters() {
+    for (const auto &saved: savedRegisters)
+        Emit(OpCode::Mov, 8, { Operand::Mem(Register::Rbp, saved.second), Operand::Reg(saved.first) });
+}
+
+// Register parameters are spilled to their slots; stack parameters are used where the caller put them.
+void CodeGenerator::GenerateParams() {
+    map<int, IrInstruction*> params;
+    for (const auto &instruction: function->GetEntry()->GetInstructions())
+        if (instruction->GetOp() == IrOp::Param)
+            params[instruction->GetInt()] = instruction;
+    const vector<IrType> &types = function->GetParamTypes();
+    int intCount = 0, doubleCount = 0, stackCount = 0;
+    for (int i = 0; i < types.size(); i++) {
+        bool isDouble = types[i] == IrType::Double;
+        Register reg = Register::None;
+        if (isDouble && doubleCount < maxDoubleArgs)
+            reg = doubleArgRegisters[doubleCount++];
+        else if (!isDouble && intCount < maxIntArgs)
+            reg = intArgRegisters[intCount++];
+        auto param = params.find(i);
+        if (reg == Register::None) {
+            int offset = 2 * slotSize + slotSize * stackCount++;
+            if (param != params.end() && HasHome(param->second))
+                Emit(isDouble ? OpCode::Movsd : OpCode::Mov, 8, { Operand::Mem(Register::Rbp, offset),
+                                                                   Operand::Reg(homes.at(param->second)) });
+            else if (param != params.end())
+                offsets[param->second] = offset;
+            continue;
+        }
+        if (param == params.end())
+            continue;
+        StoreValue(param->second, reg);
+    }
+}
+
+void CodeGenerator::GenerateRuntime() {
+    // Formats a double the way Free Pascal does: " 1.50000000000000E+000".
+    string format = AddFormat("% .14E");
+    string formatString = AddFormat("%s");
+    string scan = NewLabel(), exponent = NewLabel(), print = NewLabel();
+    EmitLabel("rt_write_double");
+    Emit(OpCode::Push, 8, { Operand::Reg(Register::Rbp) });
+    Emit(OpCode::Mov, 8, { Operand::Reg(Register::Rsp), Operand::Reg(Register::Rbp) });
+    Emit(OpCode::Sub, 8, { Operand::Imm(64), Operand::Reg(Register::Rsp) });
+    Emit(OpCode::Lea, 8, { Operand::Mem(Register::Rbp, -64), Operand::Reg(Register::Rdi) });
+    Emit(OpCode::Mov, 4, { Operand::Imm(48), Operand::Reg(Register::Rsi, 4) });
+    Emit(OpCode::Lea, 8, { Operand::Rip(format), Operand::Reg(Register::Rdx) });
+    Emit(OpCode::Mov, 4, { Operand::Imm(1), Operand::Reg(Register::Rax, 4) });
+    Emit(OpCode::Call, 8, { Operand::External("snprintf") });
+    Emit(OpCode::Lea, 8, { Operand::Mem(Register::Rbp, -64), Operand::Reg(Register::Rcx) });
+    EmitLabel(scan);
+    Emit(OpCode::Movzx, 1, { Operand::Mem(Register::Rcx), Operand::Reg(Register::Rax, 4) });
+    Emit(OpCode::Test, 4, { Operand::Reg(Register::Rax, 4), Operand::Reg(Register::Rax, 4) });
+    EmitJump(Condition::E, print);
+    Emit(OpCode::Cmp, 4, { Operand::Imm('E'), Operand::Reg(Register::Rax, 4) });
+    EmitJump(Condition::E, exponent);
+    Emit(OpCode::Add, 8, { Operand::Imm(1), Operand::Reg(Register::Rcx) });
+    EmitJump(Condition::None, scan);
+    EmitLabel(exponent);
+    Emit(OpCode::Cmp, 1, { Operand::Imm(0), Operand::Mem(Register::Rcx, 4) });
+    EmitJump(Condition::NE, print);
+    Emit(OpCode::Mov, 1, { Operand::Mem(Register::Rcx, 3), Operand::Reg(Register::Rax, 1) });
+    Emit(OpCode::Mov, 1, { Operand::Reg(Register::Rax, 1), Operand::Mem(Register::Rcx, 4) });
+    Emit(OpCode::Mov, 1, { Operand::Mem(Register::Rcx, 2), Operand::Reg(Register::Rax, 1) });
+    Emit(OpCode::Mov, 1, { Operand::Reg(Register::Rax, 1), Operand::Mem(Register::Rcx, 3) });
+    Emit(OpCode::Mov, 1, { Operand::Imm('0'), Operand::Mem(Register::Rcx, 2) });
+    Emit(OpCode::Mov, 1, { Operand::Imm(0), Operand::Mem(Register::Rcx, 5) });
+    EmitLabel(print);
+    Emit(OpCode::Lea, 8, { Operand::Mem(Register::Rbp, -64), Operand::Reg(Register::Rsi) });
+    Emit(OpCode::Lea, 8, { Operand::Rip(formatString), Operand::Reg(Register::Rdi) });
+    Emit(OpCode::Xor, 4, { Operand::Reg(Register::Rax, 4), Operand::Reg(Register::Rax, 4) });
+    Emit(OpCode::Call, 8, { Operand::External("printf") });
+    Emit(OpCode::Leave);
+    Emit(OpCode::Ret);
+}
+
+// Failed range checks jump here from an aligned frame, so there is no prologue; the program
+// stops with the status Free Pascal uses for range errors.
+void CodeGenerator::GenerateRangeError() {
+    EmitLabel("rt_range_error");
+    CallPrintf("Runtime error 201\n");
+    Emit(OpCode::Mov, 4, { Operand::Imm(201), Operand::Reg(Register::Rdi, 4) });
+    Emit(OpCode::Call, 8, { Operand::External("exit") });
+}
+
+// Division by zero, and the lowest integer divided by -1, are caught before idiv would raise SIGFPE,
+// so that the output written so far is flushed by exit as it is for range errors.
+void CodeGenerator::GenerateDivideError() {
+    EmitLabel("rt_divide_error");
+    CallPrintf("Runtime error 200\n");
+    Emit(OpCode::Mov, 4, { Operand::Imm(200), Operand::Reg(Register::Rdi, 4) });
+    Emit(OpCode::Call, 8, { Operand::External("exit") });
+}
+
+void CodeGenerator::GenBlock(IrBlock *block, IrBlock *next) {
+    EmitLabel(blockLabels.at(block));
+    for (const auto &instruction: block->GetInstructions()) {
+        if (instruction->IsTerminator()) {
+            GenTerminator(instruction, next);
+        } else if (IsSiblingCall(instruction)) {
+            GenSiblingCall(instruction);
+            return;
+        } else {
+            GenInstruction(instruction);
+        }
+    }
+}
+
+void CodeGenerator::GenInstruction(IrInstruction *instruction) {
+    switch (instruction->GetOp()) {
+        case IrOp::Const:
+        case IrOp::Param:
+        case IrOp::Phi:
+        case IrOp::SlotAddr:
+        case IrOp::GlobalAddr: {
+            break;
+        }
+        case IrOp::FAdd:
+        case IrOp::FSub:
+        case IrOp::FMul:
+        case IrOp::FDiv:
+        case IrOp::FNeg:
+        case IrOp::FCmp:
+        case IrOp::DoubleToInt: {
+            GenDoubleOp(instruction);
+            break;
+        }
+        case IrOp::IntToDouble: {
+            LoadValue(instruction->GetOperand(0), Register::Rax);
+            Emit(OpCode::Cvtsi2sd, 4, { Operand::Reg(Register::Rax, 4), Operand::Reg(Register::Xmm0) });
+            StoreValue(instruction, Register::Xmm0);
+            break;
+        }
+        case IrOp::Index: {
+            GenIndex(instruction);
+            break;
+        }
+        case IrOp::Load: {
+            GenLoad(instruction);
+            break;
+        }
+        case IrOp::Store: {
+            GenStore(instruction);
+            break;
+        }
+        case IrOp::Copy: {
+            GenCopy(instruction);
+            break;
+        }
+        case IrOp::Check: {
+            GenCheck(instruction);
+            break;
+        }
+        case IrOp::Call: {
+            GenCall(instruction);
+            break;
+        }
+        case IrOp::Write: {
+            GenWrite(instruction);
+            break;
+        }
+        default: {
+            GenIntOp(instruction);
+        }
+    }
+}
+
+void CodeGenerator::GenIntOp(IrInstruction *instruction) {
+    static const map<IrOp, OpCode> arithmetic = {
+            { IrOp::Add, OpCode::Add  },
+            { IrOp::Sub, OpCode::Sub  },
+            { IrOp::Mul, OpCode::Imul },
+            { IrOp::And, OpCode::And  },
+            { IrOp::Or,  OpCode::Or   },
+            { IrOp::Xor, OpCode::Xor  },
+            { IrOp::Shl, OpCode::Sal  },
+            { IrOp::Shr, OpCode::Sar  }
+    };
+    IrOp op = instruction->GetOp();
+    LoadValue(instruction->GetOperand(0), Register::Rax);
+    if (op == IrOp::Neg || op == IrOp::Not) {
+        Emit(op == IrOp::Neg ? OpCode::Neg : OpCode::Not, 4, { Operand::Reg(Register::Rax, 4) });
+        StoreValue(instruction, Register::Rax);
+        return;
+    }
+    IrInstruction *right = instruction->GetOperand(1);
+    bool immediate = right->GetOp() == IrOp::Const && op != IrOp::Div && op != IrOp::Mod;
+    Operand source = Operand::Reg(Register::Rcx, op == IrOp::Shl || op == IrOp::Shr ? 1 : 4);
+    if (immediate)
+        source = Operand::Imm(op == IrOp::Shl || op == IrOp::Shr ? right->GetInt() & 31 : right->GetInt());
+    else
+        LoadValue(right, Register::Rcx);
+    Operand result = Operand::Reg(Register::Rax, 4);
+    if (op == IrOp::Div || op == IrOp::Mod) {
+        bool constant = right->GetOp() == IrOp::Const;
+        if (!constant || right->GetInt() == 0) {
+            divideChecked = true;
+            Emit(OpCode::Test, 4, { source, source });
+            EmitJump(Condition::E, "rt_divide_error");
+        }
+        IrInstruction *left = instruction->GetOperand(0);
+        bool lowest = left->GetOp() != IrOp::Const || left->GetInt() == INT_MIN;
+        if (lowest && (!constant || right->GetInt() == -1)) {
+            divideChecked = true;
+            string divisible = NewLabel();
+            if (!constant) {
+                Emit(OpCode::Cmp, 4, { Operand::Imm(-1), source });
+                EmitJump(Condition::NE, divisible);
+            }
+            Emit(OpCode::Cmp, 4, { Operand::Imm(INT_MIN), result });
+            EmitJump(Condition::E, "rt_divide_error");
+            EmitLabel(divisible);
+        }
+        Emit(OpCode::Cdq, 4);
+        Emit(OpCode::Idiv, 4, { source });
+        StoreValue(instruction, op == IrOp::Div ? Register::Rax : Register::Rdx);
+        return;
+    }
+    if (op == IrOp::Cmp) {
+        Emit(OpCode::Cmp, 4, { source, result });
+        program->Emit(AsmInstruction(OpCode::Set, 1, { Operand::Reg(Register::Rax, 1) },
+                                     intCondition.at(instruction->GetCondition())));
+        Emit(OpCode::Movzx, 1, { Operand::Reg(Register::Rax, 1), result });
+    } else if (op == IrOp::Mul && immediate) {
+        Emit(OpCode::Imul, 4, { source, result, result });
+    } else {
+        Emit(arithmetic.at(op), 4, { source, result });
+    }
+    StoreValue(instruction, Register::Rax);
+}
+
+void CodeGenerator::GenDoubleOp(IrInstruction *instruction) {
+    static const map<IrOp, OpCode> arithmetic = {
+            { IrOp::FAdd, OpCode::Addsd },
+            { IrOp::FSub, OpCode::Subsd },
+            { IrOp::FMul, OpCode::Mulsd },
+            { IrOp::FDiv, OpCode::Divsd }
+    };
+    IrOp op = instruction->GetOp();
+    LoadValue(instruction->GetOperand(0), Register::Xmm0);
+    if (op == IrOp::DoubleToInt) {
+        Emit(OpCode::Cvttsd2si, 4, { Operand::Reg(Register::Xmm0), Operand::Reg(Register::Rax, 4) });
+        StoreValue(instruction, Register::Rax);
+        return;
+    }
+    if (op == IrOp::FNeg) {
+        Emit(OpCode::Movq, 8, { Operand::Reg(Register::Xmm0), Operand::Reg(Register::Rax) });
+        Emit(OpCode::Btc, 8, { Operand::Imm(63), Operand::Reg(Register::Rax) });
+        Emit(OpCode::Movq, 8, { Operand::Reg(Register::Rax), Operand::Reg(Register::Xmm0) });
+        StoreValue(instruction, Register::Xmm0);
+        return;
+    }
+    LoadValue(instruction->GetOperand(1), Register::Xmm1);
+    if (op == IrOp::FCmp) {
+        Emit(OpCode::Ucomisd, 8, { Operand::Reg(Register::Xmm1), Operand::Reg(Register::Xmm0) });
+        program->Emit(AsmInstruction(OpCode::Set, 1, { Operand::Reg(Register::Rax, 1) },
+                                     doubleCondition.at(instruction->GetCondition())));
+        Emit(OpCode::Movzx, 1, { Operand::Reg(Register::Rax, 1), Operand::Reg(Register::Rax, 4) });
+        StoreValue(instruction, Register::Rax);
+        return;
+    }
+    Emit(arithmetic.at(op), 8, { Operand::Reg(Register::Xmm1), Operand::Reg(Register::Xmm0) });
+    StoreValue(instruction, Register::Xmm0);
+}
+
+// base + sign-extended index * scale + disp, folded into a single lea where the scale allows it.
+void CodeGenerator::GenIndex(IrInstruction *instruction) {
+    long long disp = instruction->GetInt();
+    int scale = instruction->GetSize();
+    IrInstruction *index = instruction->GetOperands().size() > 1 ? instruction->GetOperand(1) : nullptr;
+    if (index != nullptr && index->GetOp() == IrOp::Const) {
+        disp += index->GetInt() * scale;
+        index = nullptr;
+    }
+    LoadValue(instruction->GetOperand(0), Register::Rax);
+    if (index == nullptr) {
+        if (disp != 0)
+            Emit(OpCode::Lea, 8, { Operand::Mem(Register::Rax, disp), Operand::Reg(Register::Rax) });
+        StoreValue(instruction, Register::Rax);
+        return;
+    }
+    LoadValue(index, Register::Rcx);
+    Emit(OpCode::Movsx, 4, { Operand::Reg(Register::Rcx, 4), Operand::Reg(Register::Rcx) });
+    if (scale != 1 && scale != 2 && scale != 4 && scale != 8) {
+        Emit(OpCode::Imul, 8, { Operand::Imm(scale), Operand::Reg(Register::Rcx), Operand::Reg(Register::Rcx) });
+        scale = 1;
+    }
+    Emit(OpCode::Lea, 8, { Operand::Mem(Register::Rax, Register::Rcx, scale, disp), Operand::Reg(Register::Rax) });
+    StoreValue(instruction, Register::Rax);
+}
+
+void CodeGenerator::GenLoad(IrInstruction *instruction) {
+    Operand source = GetAddress(instruction->GetOperand(0), Register::Rax);
+    if (instruction->GetType() == IrType::Double) {
+        Emit(OpCode::Movsd, 8, { source, Operand::Reg(Register::Xmm0) });
+        StoreValue(instruction, Register::Xmm0);
+        return;
+    }
+    int size = instruction->GetSize();
+    if (size == 1)
+        Emit(OpCode::Movzx, 1, { source, Operand::Reg(Register::Rax, 4) });
+    else
+        Emit(OpCode::Mov, size, { source, Operand::Reg(Register::Rax, size) });
+    StoreValue(instruction, Register::Rax);
+}
+
+void CodeGenerator::GenStore(IrInstruction *instruction) {
+    IrInstruction *value = instruction->GetOperand(1);
+    bool isDouble = value->GetType() == IrType::Double;
+    LoadValue(value, isDouble ? Register::Xmm0 : Register::Rax);
+    Operand dest = GetAddress(instruction->GetOperand(0), Register::Rcx);
+    if (isDouble)
+        Emit(OpCode::Movsd, 8, { Operand::Reg(Register::Xmm0), dest });
+    else
+        Emit(OpCode::Mov, instruction->GetSize(), { Operand::Reg(Register::Rax, instruction->GetSize()), dest });
+}
+
+void CodeGenerator::GenCopy(IrInstruction *instruction) {
+    LoadValue(instruction->GetOperand(1), Register::Rsi);
+    LoadValue(instruction->GetOperand(0), Register::Rdi);
+    Emit(OpCode::Mov, 8, { Operand::Imm(instruction->GetSize()), Operand::Reg(Register::Rcx) });
+    Emit(OpCode::RepMovsb);
+}
+
+// System V call: doubles in xmm0-7, everything else in the integer registers, the rest on a
+// 16-byte aligned outgoing area in argument order.
+void CodeGenerator::GenCall(IrInstruction *instruction) {
+    const vector<IrInstruction*> &arguments = instruction->GetOperands();
+    vector<pair<IrInstruction*, Register>> registers;
+    vector<IrInstruction*> stack;
+    int intCount = 0, doubleCount = 0;
+    for (const auto &argument: arguments) {
+        if (argument->GetType() == IrType::Double && doubleCount < maxDoubleArgs)
+            registers.push_back({ argument, doubleArgRegisters[doubleCount++] });
+        else if (argument->GetType() != IrType::Double && intCount < maxIntArgs)
+            registers.push_back({ argument, intArgRegisters[intCount++] });
+        else
+            stack.push_back(argument);
+    }
+    int reserve = (slotSize * stack.size() + stackAlign - 1) / stackAlign * stackAlign;
+    if (reserve != 0)
+        Emit(OpCode::Sub, 8, { Operand::Imm(reserve), Operand::Reg(Register::Rsp) });
+    for (int i = 0; i < stack.size(); i++) {
+        LoadWord(stack[i], Register::Rax);
+        Emit(OpCode::Mov, 8, { Operand::Reg(Register::Rax), Operand::Mem(Register::Rsp, slotSize * i) });
+    }
+    for (const auto &argument: registers)
+        LoadValue(argument.first, argument.second);
+    Emit(OpCode::Call, 8, { Operand::Label(instruction->GetName()) });
+    if (reserve != 0)
+        Emit(OpCode::Add, 8, { Operand::Imm(reserve), Operand::Reg(Register::Rsp) });
+    if (instruction->GetType() != IrType::Void)
+        StoreValue(instruction, instruction->GetType() == IrType::Double ? Register::Xmm0 : Register::Rax);
+}
+
+// A call in tail position can reuse the caller's return address when all of its arguments go in
+// registers and none of them points into the frame that is about to be released.
+bool CodeGenerator::IsSiblingCall(IrInstruction *instruction) {
+    if (instruction->GetOp() != IrOp::Call || !instruction->IsTailCall() || instruction->PassesFrameAddress())
+        return false;
+    int intCount = 0, doubleCount = 0;
+    for (const auto &argument: instruction->GetOperands())
+        (argument->GetType() == IrType::Double ? doubleCount : intCount)++;
+    return intCount <= maxIntArgs && doubleCount <= maxDoubleArgs;
+}
+
+void CodeGenerator::GenSiblingCall(IrInstruction *instruction) {
+    int intCount = 0, doubleCount = 0;
+    for (const auto &argument: instruction->GetOperands()) {
+        if (argument->GetType() == IrType::Double)
+            LoadValue(argument, doubleArgRegisters[doubleCount++]);
+        else
+            LoadValue(argument, intArgRegisters[intCount++]);
+    }
+    RestoreRegisters();
+    Emit(OpCode::Leave);
+    EmitJump(Condition::None, instruction->GetName());
+}
+
+void CodeGenerator::GenCheck(IrInstruction *instruction) {
+    rangeChecked = true;
+    LoadValue(instruction->GetOperand(0), Register::Rax);
+    Emit(OpCode::Cmp, 4, { Operand::Imm(instruction->GetOperand(1)->GetInt()), Operand::Reg(Register::Rax, 4) });
+    EmitJump(Condition::L, "rt_range_error");
+    Emit(OpCode::Cmp, 4, { Operand::Imm(instruction->GetOperand(2)->GetInt()), Operand::Reg(Register::Rax, 4) });
+    EmitJump(Condition::G, "rt_range_error");
+}
+
+void CodeGenerator::GenWrite(IrInstruction *instruction) {
+    switch (instruction->GetWrite()) {
+        case IrWrite::Double: {
+            LoadValue(instruction->GetOperand(0), Register::Xmm0);
+            Emit(OpCode::Mov, 4, { Operand::Imm(1), Operand::Reg(Register::Rax, 4) });
+            Emit(OpCode::Call, 8, { Operand::Label("rt_write_double") });
+            runtimeUsed = true;
+            return;
+        }
+        case IrWrite::NewLine: {
+            CallPrintf("\n");
+            return;
+        }
+        default: {
+            LoadValue(instruction->GetOperand(0), Register::Rsi);
+            map<IrWrite, string> format = {
+                    { IrWrite::Int,    "%d" },
+                    { IrWrite::Char,   "%c" },
+                    { IrWrite::String, "%s" }
+            };
+            CallPrintf(format.at(instruction->GetWrite()));
+        }
+    }
+}
+
+// Phi operands become copies at the end of the predecessor. When a copy would overwrite a phi
+// that a later copy still reads, the whole group goes through the stack instead.
+void CodeGenerator::GenPhiCopies(IrBlock *from, IrBlock *to) {
+    vector<pair<IrInstruction*, IrInstruction*>> copies;
+    for (const auto &phi: to->GetPhis())
+        for (int i = 0; i < phi->GetTargets().size(); i++)
+            if (phi->GetTargets()[i] == from && (offsets.find(phi) != offsets.end() || HasHome(phi))) {
+                copies.push_back({ phi, phi->GetOperand(i) });
+                break;
+            }
+    bool interfere = false;
+    for (const auto &copy: copies)
+        interfere = interfere || (copy.second->GetOp() == IrOp::Phi && copy.second->GetBlock() == to &&
+                                  copy.second != copy.first);
+    if (!interfere) {
+        for (const auto &copy: copies) {
+            if (copy.first == copy.second)
+                continue;
+            LoadWord(copy.second, Register::Rax);
+            StoreWord(copy.first, Register::Rax);
+        }
+        return;
+    }
+    for (const auto &copy: copies) {
+        LoadWord(copy.second, Register::Rax);
+        Emit(OpCode::Push, 8, { Operand::Reg(Register::Rax) });
+    }
+    for (auto copy = copies.rbegin(); copy != copies.rend(); copy++) {
+        Emit(OpCode::Pop, 8, { Operand::Reg(Register::Rax) });
+        StoreWord(copy->first, Register::Rax);
+    }
+}
+
+void CodeGenerator::GenTerminator(IrInstruction *instruction, IrBlock *next) {
+    IrBlock *block = instruction->GetBlock();
+    switch (instruction->GetOp()) {
+        case IrOp::Jump: {
+            IrBlock *target = instruction->GetTargets()[0];
+            GenPhiCopies(block, target);
+            if (target != next)
+                EmitJump(Condition::None, blockLabels.at(target));
+            break;
+        }
+        case IrOp::Branch: {
+            IrBlock *trueTarget = instruction->GetTargets()[0], *falseTarget = instruction->GetTargets()[1];
+            LoadValue(instruction->GetOperand(0), Register::Rax);
+            Emit(OpCode::Test, 4, { Operand::Reg(Register::Rax, 4), Operand::Reg(Register::Rax, 4) });
+            if (trueTarget == next) {
+                EmitJump(Condition::E, blockLabels.at(falseTarget));
+                break;
+            }
+            EmitJump(Condition::NE, blockLabels.at(trueTarget));
+            if (falseTarget != next)
+                EmitJump(Condition::None, blockLabels.at(falseTarget));
+            break;
+        }
+        default: {
+            if (!instruction->GetOperands().empty()) {
+                IrInstruction *value = instruction->GetOperand(0);
+                LoadValue(value, value->GetType() == IrType::Double ? Register::Xmm0 : Register::Rax);
+            }
+            if (next != nullptr)
+                EmitJump(Condition::None, exitLabel);
+        }
+    }
+}
+
+void CodeGenerator::LoadValue(IrInstruction *value, Register reg) {
+    bool isDouble = value->GetType() == IrType::Double;
+    switch (value->GetOp()) {
+        case IrOp::Const: {
+            if (isDouble)
+                LoadDouble(value->GetDouble(), reg);
+            else if (value->GetType() == IrType::Int)
+                Emit(OpCode::Mov, 4, { Operand::Imm((int) value->GetInt()), Operand::Reg(reg, 4) });
+            else
+                Emit(OpCode::Mov, 8, { Operand::Imm(value->GetInt()), Operand::Reg(reg) });
+            return;
+        }
+        case IrOp::SlotAddr:
+        case IrOp::GlobalAddr: {
+            Emit(OpCode::Lea, 8, { GetAddress(value, reg), Operand::Reg(reg) });
+            return;
+        }
+        default: {
+            if (HasHome(value) && homes.at(value) == reg)
+                return;
+            Operand source = Operand::Mem(Register::Rbp, HasHome(value) ? 0 : offsets.at(value));
+            if (HasHome(value))
+                source = Operand::Reg(homes.at(value), value->GetType() == IrType::Int ? 4 : 8);
+            if (isDouble)
+                Emit(OpCode::Movsd, 8, { source, Operand::Reg(reg) });
+            else if (value->GetType() == IrType::Int)
+                Emit(OpCode::Mov, 4, { source, Operand::Reg(reg, 4) });
+            else
+                Emit(OpCode::Mov, 8, { source, Operand::Reg(reg) });
+        }
+    }
+}
+
+// Loads the raw bits of a value into a general purpose register, whatever its type.
+void CodeGenerator::LoadWord(IrInstruction *value, Register reg) {
+    if (value->GetOp() == IrOp::Const && value->GetType() == IrType::Double) {
+        double number = value->GetDouble();
+        long long bits;
+        memcpy(&bits, &number, sizeof(bits));
+        Emit(OpCode::Mov, 8, { Operand::Imm(bits), Operand::Reg(reg) });
+        return;
+    }
+    if (IsRematerialized(value)) {
+        LoadValue(value, reg);
+        return;
+    }
+    if (HasHome(value)) {
+        Register home = homes.at(value);
+        Emit(value->GetType() == IrType::Double ? OpCode::Movq : OpCode::Mov, 8, { Operand::Reg(home), Operand::Reg(reg) });
+        return;
+    }
+    Emit(OpCode::Mov, 8, { Operand::Mem(Register::Rbp, offsets.at(value)), Operand::Reg(reg) });
+}
+
+void CodeGenerator::StoreValue(IrInstruction *value, Register reg) {
+    if (HasHome(value) && homes.at(value) == reg)
+        return;
+    Operand dest = Operand::Mem(Register::Rbp, HasHome(value) ? 0 : offsets.at(value));
+    if (HasHome(value))
+        dest = Operand::Reg(homes.at(value), value->GetType() == IrType::Int ? 4 : 8);
+    if (value->GetType() == IrType::Double)
+        Emit(OpCode::Movsd, 8, { Operand::Reg(reg), dest });
+    else if (value->GetType() == IrType::Int)
+        Emit(OpCode::Mov, 4, { Operand::Reg(reg, 4), dest });
+    else
+        Emit(OpCode::Mov, 8, { Operand::Reg(reg), dest });
+}
+
+// Stores the raw bits of a general purpose register, whatever the type of the value.
+void CodeGenerator::StoreWord(IrInstruction *value, Register reg) {
+    if (!HasHome(value))
+        Emit(OpCode::Mov, 8, { Operand::Reg(reg), Operand::Mem(Register::Rbp, offsets.at(value)) });
+    else if (value->GetType() == IrType::Double)
+        Emit(OpCode::Movq, 8, { Operand::Reg(reg), Operand::Reg(homes.at(value)) });
+    else
+        Emit(OpCode::Mov, 8, { Operand::Reg(reg), Operand::Reg(homes.at(value)) });
+}
+
+bool CodeGenerator::HasHome(IrInstruction *value) const {
+    return homes.find(value) != homes.end();
+}
+
+Operand CodeGenerator::GetAddress(IrInstruction *address, Register reg) {
+    if (address->GetOp() == IrOp::SlotAddr)
+        return Operand::Mem(Register::Rbp, slotOffsets.at(address->GetInt()));
+    if (address->GetOp() == IrOp::GlobalAddr)
+        return Operand::Rip(address->GetName());
+    LoadValue(address, reg);
+    return Operand::Mem(reg);
+}
+
+void CodeGenerator::CallPrintf(std::string format, int doubleCount) {
+    Emit(OpCode::Lea, 8, { Operand::Rip(AddFormat(format)), Operand::Reg(Register::Rdi) });
+    Emit(OpCode::Mov, 4, { Operand::Imm(doubleCount), Operand::Reg(Register::Rax, 4) });
+    Emit(OpCode::Call, 8, { Operand::External("printf") });
+}
+
+void CodeGenerator::LoadDouble(double value, Register reg) {
+    long long bits;
+    memcpy(&bits, &value, sizeof(bits));
+    auto label = doubles.find(bits);
+    if (label == doubles.end()) {
+        vector<unsigned char> bytes(sizeof(value));
+        memcpy(bytes.data(), &value, sizeof(value));
+        label = doubles.insert({ bits, ".LC" + to_string(labelCount++) }).first;
+        program->AddData(AsmData(label->second, bytes, slotSize, true));
+    }
+    Emit(OpCode::Movsd, 8, { Operand::Rip(label->second), Operand::Reg(reg) });
+}
+
+std::string CodeGenerator::AddFormat(std::string value) {
+    auto label = formats.find(value);
+    if (label != formats.end())
+        return label->second;
+    string name = ".LF" + to_string(labelCount++);
+    vector<unsigned char> bytes(value.begin(), value.end());
+    bytes.push_back(0);
+    program->AddData(AsmData(name, bytes, 1, true));
+    formats[value] = name;
+    return name;
+}
+
+int CodeGenerator::Allocate(int size) {
+    frameSize += (size + slotSize - 1) / slotSize * slotSize;
+    return -frameSize;
+}
+
+std::string CodeGenerator::NewLabel() {
+    return ".L" + to_string(labelCount++);
+}
+
+bool CodeGenerator::IsRematerialized(IrInstruction *value) {
+    IrOp op = value->GetOp();
+    return op == IrOp::Const || op == IrOp::SlotAddr || op == IrOp::GlobalAddr;
+}
+
+void CodeGenerator::Emit(OpCode op, int size, std::vector<Operand> operands) {
+    program->Emit(AsmInstruction(op, size, operands));
+}
+
+void CodeGenerator::EmitJump(Condition condition, std::string label) {
+    if (condition == Condition::None)
+        program->Emit(AsmInstruction(OpCode::Jmp, 8, { Operand::Label(label) }));
+    else
+        program->Emit(AsmInstruction(OpCode::J, 8, { Operand::Label(label) }, condition));
+}
+
+void CodeGenerator::EmitLabel(std::string label) {
+    program->Emit(AsmInstruction(label));
+}
@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <tuple>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "CompileCache.h"
+
+using namespace std;
+
+// Bumped whenever the entry layout changes; entries of another layout are misses.
+static const char entryMagic[] = "PCC2";
+
+// Used in place of the binary's own hash where it cannot be read.
+static const char compilerVersion[] = "Compiler 1.0";
+
+CachedRun::CachedRun(std::string output, bool ok, bool built, std::string artifact, int fileMode) :
+        output(output), ok(ok), built(built), artifact(artifact), fileMode(fileMode) {}
+
+const std::string &CachedRun::GetOutput() const {
+    return output;
+}
+
+bool CachedRun::IsOk() const {
+    return ok;
+}
+
+bool CachedRun::IsBuilt() const {
+    return built;
+}
+
+const std::string &CachedRun::GetArtifact() const {
+    return artifact;
+}
+
+int CachedRun::GetFileMode() const {
+    return fileMode;
+}
+
+CompileCache::CompileCache(std::string directory, long long limit) : directory(directory), limit(limit) {
+    mkdir(directory.c_str(), 0755);
+}
+
+static unsigned long long Rotate(unsigned long long value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static unsigned long long Mix(unsigned long long value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    return value ^ (value >> 33);
+}
+
+// A 64-bit hash taking the input eight bytes at a time, after MurmurHash3's mixing steps. It only
+// has to tell sources apart, not resist anyone crafting collisions.
+unsigned long long CompileCache::Hash(const char *data, size_t size, unsigned long long seed) {
+    const unsigned long long first = 0x87c37b91114253d5ULL, second = 0x4cf5ad432745937fULL;
+    unsigned long long hash = seed ^ (size * first);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        unsigned long long word;
+        memcpy(&word, data + i, 8);
+        hash ^= Rotate(word * first, 31) * second;
+        hash = Rotate(hash, 27) * 5 + 0x52dce729;
+    }
+    unsigned long long tail = 0;
+    for (size_t j = size; j > i; j--)
+        tail = (tail << 8) | (unsigned char) data[j - 1];
+    hash ^= Rotate(tail * first, 31) * second;
+    return Mix(hash);
+}
+
+// The compiler's own binary stands for its version, so a rebuilt compiler never reads entries
+// written by an older one. Its inode, size and modification time identify it without reading it.
+unsigned long long CompileCache::GetVersion() {
+    unsigned long long version = Hash(compilerVersion, sizeof(compilerVersion));
+    struct stat info;
+    if (stat("/proc/self/exe", &info) == 0) {
+        long long identity[] = { (long long) info.st_ino, (long long) info.st_size, (long long) info.st_mtim.tv_sec,
+                                 (long long) info.st_mtim.tv_nsec };
+        version = Hash((const char*) identity, sizeof(identity), version);
+    }
+    return version;
+}
+
+// An empty key means the source cannot be read, and the run is not cached.
+std::string CompileCache::GetKey(const std::string &fileName, const std::vector<std::string> &flags) const {
+    ifstream source(fileName, ios::binary | ios::ate);
+    if (!source.is_open())
+        return "";
+    string bytes(source.tellg(), '\0');
+    source.seekg(0);
+    source.read(&bytes[0], bytes.size());
+    unsigned long long key = Hash(bytes.data(), bytes.size(), GetVersion());
+    for (const auto &flag: flags)
+        key = Hash(flag.data(), flag.size(), key);
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", key);
+    return name;
+}
+
+static bool ReadSized(std::istream &in, std::string &value) {
+    uint64_t size;
+    if (!in.read((char*) &size, sizeof(size)) || size > (1ULL << 32))
+        return false;
+    value.resize(size);
+    return (bool) in.read(&value[0], size);
+}
+
+static void WriteSized(std::ostream &out, const std::string &value) {
+    uint64_t size = value.size();
+    out.write((const char*) &size, sizeof(size));
+    out.write(value.data(), value.size());
+}
+
+bool CompileCache::Load(const std::string &key, CachedRun &run) const {
+    string path = directory + "/" + key;
+    ifstream entry(path, ios::binary);
+    char magic[sizeof(entryMagic)];
+    int32_t flags[3];
+    if (!entry.is_open() || !entry.read(magic, sizeof(magic)) || memcmp(magic, entryMagic, sizeof(magic)) != 0 ||
+        !entry.read((char*) flags, sizeof(flags)) || !ReadSized(entry, run.output) || !ReadSized(entry, run.artifact))
+        return false;
+    run.ok = flags[0] != 0;
+    run.built = flags[1] != 0;
+    run.fileMode = flags[2];
+    utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+    return true;
+}
+
+// Entries are written aside and renamed into place, so a concurrent reader sees a whole entry or
+// none.
+void CompileCache::Store(const std::string &key, const CachedRun &run) const {
+    string path = directory + "/" + key;
+    string temporary = path + ".tmp" + to_string(getpid());
+    {
+        ofstream entry(temporary, ios::binary);
+        int32_t flags[3] = { run.ok, run.built, run.fileMode };
+        entry.write(entryMagic, sizeof(entryMagic));
+        entry.write((const char*) flags, sizeof(flags));
+        WriteSized(entry, run.output);
+        WriteSized(entry, run.artifact);
+        if (!entry) {
+            unlink(temporary.c_str());
+            return;
+        }
+    }
+    rename(temporary.c_str(), path.c_str());
+    Evict();
+}
+
+void CompileCache::Evict() const {
+    DIR *dir = opendir(directory.c_str());
+    if (dir == nullptr)
+        return;
+    vector<tuple<long long, string, long long>> entries;
+    long long total = 0;
+    while (dirent *entry = readdir(dir)) {
+        string name = entry->d_name;
+        struct stat info;
+        if (name.size() != 16 || stat((directory + "/" + name).c_str(), &info) != 0)
+            continue;
+        entries.emplace_back(info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec, name, info.st_size);
+        total += info.st_size;
+    }
+    closedir(dir);
+    sort(entries.begin(), entries.end());
+    for (const auto &entry: entries) {
+        if (total <= limit)
+            break;
+        unlink((directory + "/" + get<1>(entry)).c_str());
+        total -= get<2>(entry);
+    }
+}
@@ -0,0 +1,110 @@
+#include <cstdint>
+#include <cstdlib>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "CompileProtocol.h"
+
+using namespace std;
+
+static bool WriteAll(int socket, const void *data, size_t size) {
+    const char *bytes = (const char*) data;
+    while (size > 0) {
+        ssize_t written = send(socket, bytes, size, MSG_NOSIGNAL);
+        if (written <= 0)
+            return false;
+        bytes += written;
+        size -= written;
+    }
+    return true;
+}
+
+static bool ReadAll(int socket, void *data, size_t size) {
+    char *bytes = (char*) data;
+    while (size > 0) {
+        ssize_t got = recv(socket, bytes, size, 0);
+        if (got <= 0)
+            return false;
+        bytes += got;
+        size -= got;
+    }
+    return true;
+}
+
+static bool WriteInt(int socket, uint32_t value) {
+    return WriteAll(socket, &value, sizeof(value));
+}
+
+static bool ReadInt(int socket, uint32_t &value) {
+    return ReadAll(socket, &value, sizeof(value));
+}
+
+static bool WriteString(int socket, const std::string &value) {
+    return WriteInt(socket, value.size()) && WriteAll(socket, value.data(), value.size());
+}
+
+// Nothing the compiler prints comes near 64 MB, so a longer string means a broken stream.
+static bool ReadString(int socket, std::string &value) {
+    uint32_t size;
+    if (!ReadInt(socket, size) || size > (1u << 26))
+        return false;
+    value.resize(size);
+    return ReadAll(socket, &value[0], size);
+}
+
+CompileRequest::CompileRequest(std::string directory, std::vector<std::string> args) :
+        directory(directory), args(args) {}
+
+const std::string &CompileRequest::GetDirectory() const {
+    return directory;
+}
+
+const std::vector<std::string> &CompileRequest::GetArgs() const {
+    return args;
+}
+
+bool CompileRequest::Send(int socket) const {
+    if (!WriteString(socket, directory) || !WriteInt(socket, args.size()))
+        return false;
+    for (const auto &arg: args)
+        if (!WriteString(socket, arg))
+            return false;
+    return true;
+}
+
+// A request has at most a handful of arguments; anything claiming more is not one.
+bool CompileRequest::Receive(int socket, CompileRequest &request) {
+    uint32_t count;
+    if (!ReadString(socket, request.directory) || !ReadInt(socket, count) || count > 64)
+        return false;
+    request.args.resize(count);
+    for (auto &arg: request.args)
+        if (!ReadString(socket, arg))
+            return false;
+    return true;
+}
+
+CompileResponse::CompileResponse(int status, std::string output) : status(status), output(output) {}
+
+int CompileResponse::GetStatus() const {
+    return status;
+}
+
+const std::string &CompileResponse::GetOutput() const {
+    return output;
+}
+
+bool CompileResponse::Send(int socket) const {
+    return WriteInt(socket, status) && WriteString(socket, output);
+}
+
+bool CompileResponse::Receive(int socket, CompileResponse &response) {
+    uint32_t status;
+    if (!ReadInt(socket, status) || !ReadString(socket, response.output))
+        return false;
+    response.status = status;
+    return true;
+}
+
+std::string DefaultSocketPath() {
+    return "/tmp/compiler-" + to_string(getuid()) + ".sock";
+}
@@ -0,0 +1,144 @@
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "CompileServer.h"
+#include "Batch.h"
+#include "UnitInterface.h"
+
+using namespace std;
+
+CachedOutput::CachedOutput(long long modified, long long size, unsigned long long units, std::string output) :
+        modified(modified), size(size), units(units), output(output), lastUse(0) {}
+
+bool CachedOutput::IsCurrent(long long modified, long long size, unsigned long long units) const {
+    return this->modified == modified && this->size == size && this->units == units;
+}
+
+const std::string &CachedOutput::GetOutput() const {
+    return output;
+}
+
+unsigned long long CachedOutput::GetLastUse() const {
+    return lastUse;
+}
+
+void CachedOutput::SetLastUse(unsigned long long lastUse) {
+    CachedOutput::lastUse = lastUse;
+}
+
+// A socket left behind by a server that died is replaced. Only the owner may connect, since the
+// server reads files on behalf of whoever does.
+CompileServer::CompileServer(std::string socketPath, int threads) : socketPath(socketPath), listener(-1),
+        pool(new ThreadPool(max(threads, 1))), requests(0), hits(0), stopping(false) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path))
+        throw runtime_error("socket path too long: " + socketPath);
+    strcpy(address.sun_path, socketPath.c_str());
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socketPath.c_str());
+    mode_t mask = umask(0077);
+    bool bound = listener >= 0 && ::bind(listener, (sockaddr*) &address, sizeof(address)) == 0;
+    umask(mask);
+    if (!bound || listen(listener, 64) != 0)
+        throw runtime_error("cannot listen on " + socketPath + ": " + strerror(errno));
+}
+
+CompileServer::~CompileServer() {
+    pool = nullptr;
+    if (listener >= 0)
+        close(listener);
+    unlink(socketPath.c_str());
+}
+
+void CompileServer::Run() {
+    while (!stopping) {
+        int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0 && errno == EINTR)
+            continue;
+        if (connection < 0)
+            break;
+        pool->Submit([this, connection]() { Serve(connection); });
+    }
+    pool->Wait();
+}
+
+void CompileServer::Serve(int connection) {
+    CompileRequest request;
+    if (CompileRequest::Receive(connection, request))
+        Handle(request).Send(connection);
+    close(connection);
+}
+
+// Reads the command line the way main does. -j and -pipe are accepted and ignored: each request
+// is parsed on the one pool worker serving it, which keeps the pool's threads busy without more
+// threads of its own. Relative file names are taken from the client's directory, since the
+// server's own may be anywhere.
+CompileResponse CompileServer::Handle(const CompileRequest &request) {
+    const vector<string> &args = request.GetArgs();
+    int next = 0;
+    while (next + 1 < args.size() && (args[next] == "-unroll" || args[next] == "-j" || args[next] == "-pipe")) {
+        next += args[next] == "-pipe" ? 1 : 2;
+    }
+    if (next < args.size() && args[next] == "-stop") {
+        stopping = true;
+        shutdown(listener, SHUT_RDWR);
+        return CompileResponse(0, "");
+    }
+    if (next < args.size() && args[next] == "-status") {
+        lock_guard<std::mutex> lock(mutex);
+        return CompileResponse(0, "requests: " + to_string(requests) + ", cache hits: " + to_string(hits) +
+                                  ", cached files: " + to_string(cache.size()) + "\n");
+    }
+    if (next + 1 >= args.size() || !Batch::IsMode(args[next]))
+        return CompileResponse(1, "The compile server runs -s, -pe, -pd and -ps only\n");
+    string fileName = args[next + 1];
+    if (fileName[0] != '/')
+        fileName = request.GetDirectory() + "/" + fileName;
+    return Compile(args[next], fileName);
+}
+
+// Output depends on nothing but the mode and the file; an entry is used only while the file keeps
+// its size and modification time and no unit interface beside it is rebuilt.
+CompileResponse CompileServer::Compile(const std::string &mode, const std::string &fileName) {
+    struct stat info;
+    if (stat(fileName.c_str(), &info) != 0 || !ifstream(fileName).is_open())
+        return CompileResponse(1, "Cannot open " + fileName + "\n");
+    long long modified = info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+    unsigned long long units = UnitInterface::GetStamp(fileName);
+    string key = mode + " " + fileName;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        requests++;
+        auto found = cache.find(key);
+        if (found != cache.end() && found->second.IsCurrent(modified, info.st_size, units)) {
+            hits++;
+            found->second.SetLastUse(requests);
+            return CompileResponse(0, found->second.GetOutput());
+        }
+    }
+    ostringstream out;
+    try {
+        Batch::Run(mode, fileName.c_str(), out);
+    }
+    catch (exception &exception) {
+        return CompileResponse(1, out.str() + "Internal error: " + exception.what() + "\n");
+    }
+    lock_guard<std::mutex> lock(mutex);
+    if (cache.size() >= maxCached && cache.find(key) == cache.end()) {
+        auto oldest = cache.begin();
+        for (auto entry = cache.begin(); entry != cache.end(); entry++)
+            if (entry->second.GetLastUse() < oldest->second.GetLastUse())
+                oldest = entry;
+        cache.erase(oldest);
+    }
+    CachedOutput &entry = cache[key] = CachedOutput(modified, info.st_size, units, out.str());
+    entry.SetLastUse(requests);
+    return CompileResponse(0, entry.GetOutput());
+}
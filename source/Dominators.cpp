@@ -0,0 +1,155 @@
+#include <algorithm>
+#include "Dominators.h"
+
+using namespace std;
+
+IrLoop::IrLoop(IrBlock *header) : header(header) {
+    blocks.insert(header);
+}
+
+IrBlock *IrLoop::GetHeader() const {
+    return header;
+}
+
+const std::set<IrBlock*> &IrLoop::GetBlocks() const {
+    return blocks;
+}
+
+const std::vector<IrBlock*> &IrLoop::GetLatches() const {
+    return latches;
+}
+
+bool IrLoop::Contains(IrBlock *block) const {
+    return blocks.find(block) != blocks.end();
+}
+
+bool IrLoop::Contains(IrInstruction *instruction) const {
+    return Contains(instruction->GetBlock());
+}
+
+void IrLoop::AddBlock(IrBlock *block) {
+    blocks.insert(block);
+}
+
+void IrLoop::AddLatch(IrBlock *latch) {
+    latches.push_back(latch);
+}
+
+// Iterative dominator computation over the reverse postorder (Cooper, Harvey and Kennedy,
+// "A Simple, Fast Dominance Algorithm").
+DominatorTree::DominatorTree(PIrFunction function) : function(function) {
+    function->ComputePredecessors();
+    IrBlock *entry = function->GetEntry();
+    set<IrBlock*> visited = { entry };
+    vector<pair<IrBlock*, int>> stack = { { entry, 0 } };
+    while (!stack.empty()) {
+        IrBlock *block = stack.back().first;
+        vector<IrBlock*> successors = block->GetSuccessors();
+        if (stack.back().second < successors.size()) {
+            IrBlock *successor = successors[stack.back().second++];
+            if (visited.insert(successor).second)
+                stack.push_back({ successor, 0 });
+            continue;
+        }
+        order.push_back(block);
+        stack.pop_back();
+    }
+    reverse(order.begin(), order.end());
+    for (int i = 0; i < order.size(); i++)
+        index[order[i]] = i;
+    idoms[entry] = entry;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 1; i < order.size(); i++) {
+            IrBlock *block = order[i];
+            IrBlock *idom = nullptr;
+            for (const auto &predecessor: block->GetPredecessors()) {
+                if (idoms.find(predecessor) == idoms.end())
+                    continue;
+                idom = idom == nullptr ? predecessor : Intersect(predecessor, idom);
+            }
+            if (idoms[block] != idom) {
+                idoms[block] = idom;
+                changed = true;
+            }
+        }
+    }
+    for (int i = 1; i < order.size(); i++)
+        children[idoms.at(order[i])].push_back(order[i]);
+}
+
+IrBlock *DominatorTree::Intersect(IrBlock *first, IrBlock *second) const {
+    while (first != second) {
+        while (index.at(first) > index.at(second))
+            first = idoms.at(first);
+        while (index.at(second) > index.at(first))
+            second = idoms.at(second);
+    }
+    return first;
+}
+
+IrBlock *DominatorTree::GetIdom(IrBlock *block) const {
+    return idoms.at(block);
+}
+
+const std::vector<IrBlock*> &DominatorTree::GetChildren(IrBlock *block) const {
+    static const vector<IrBlock*> none;
+    auto found = children.find(block);
+    return found != children.end() ? found->second : none;
+}
+
+const std::vector<IrBlock*> &DominatorTree::GetOrder() const {
+    return order;
+}
+
+bool DominatorTree::Dominates(IrBlock *dominator, IrBlock *block) const {
+    if (idoms.find(block) == idoms.end())
+        return false;
+    while (block != dominator) {
+        IrBlock *idom = idoms.at(block);
+        if (idom == block)
+            return false;
+        block = idom;
+    }
+    return true;
+}
+
+bool DominatorTree::Dominates(IrInstruction *definition, IrInstruction *use) const {
+    if (definition->GetBlock() != use->GetBlock())
+        return Dominates(definition->GetBlock(), use->GetBlock());
+    vector<IrInstruction*> &instructions = definition->GetBlock()->GetInstructions();
+    return find(instructions.begin(), instructions.end(), definition) <
+           find(instructions.begin(), instructions.end(), use);
+}
+
+std::vector<IrLoop> DominatorTree::FindLoops() const {
+    vector<IrLoop> loops;
+    map<IrBlock*, int> headers;
+    for (const auto &block: order) {
+        for (const auto &successor: block->GetSuccessors()) {
+            if (!Dominates(successor, block))
+                continue;
+            if (headers.find(successor) == headers.end()) {
+                headers[successor] = loops.size();
+                loops.push_back(IrLoop(successor));
+            }
+            IrLoop &loop = loops[headers.at(successor)];
+            loop.AddLatch(block);
+            vector<IrBlock*> work = { block };
+            while (!work.empty()) {
+                IrBlock *current = work.back();
+                work.pop_back();
+                if (loop.Contains(current))
+                    continue;
+                loop.AddBlock(current);
+                for (const auto &predecessor: current->GetPredecessors())
+                    work.push_back(predecessor);
+            }
+        }
+    }
+    stable_sort(loops.begin(), loops.end(), [](const IrLoop &first, const IrLoop &second) {
+        return first.GetBlocks().size() < second.GetBlocks().size();
+    });
+    return loops;
+}
@@ -0,0 +1,246 @@
+#include "ElfWriter.h"
+#include "Error.h"
+#include <elf.h>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+
+using namespace std;
+
+// _start: xor %ebp, %ebp; call main; mov %eax, %edi; mov $60, %eax; syscall
+static const vector<unsigned char> startStub = {
+        0x31, 0xED,
+        0xE8, 0x00, 0x00, 0x00, 0x00,
+        0x89, 0xC7,
+        0xB8, 0x3C, 0x00, 0x00, 0x00,
+        0x0F, 0x05
+};
+static const int startCallOffset = 3;
+
+ElfWriter::ElfWriter(const Encoder &encoder) : encoder(encoder) {}
+
+void ElfWriter::Append(const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char*) data;
+    file.insert(file.end(), bytes, bytes + size);
+}
+
+void ElfWriter::Align(size_t align) {
+    while (file.size() % align != 0)
+        file.push_back(0);
+}
+
+int ElfWriter::AddString(std::vector<unsigned char> &table, const std::string &value) {
+    int offset = table.size();
+    table.insert(table.end(), value.begin(), value.end());
+    table.push_back(0);
+    return offset;
+}
+
+void ElfWriter::Write(const std::string &fileName, bool executable) {
+    ofstream out(fileName, ios::binary);
+    if (!out)
+        throw FileNotWritten(fileName);
+    out.write((const char*) file.data(), file.size());
+    out.close();
+    if (!out)
+        throw FileNotWritten(fileName);
+    if (executable)
+        chmod(fileName.c_str(), 0755);
+}
+
+void ElfWriter::WriteObject(const std::string &fileName) {
+    enum { Null, Text, RoData, Data, RelaText, SymTab, StrTab, ShStrTab, NoteStack, SectionCount };
+    map<SectionType, int> sectionIndex = {
+            { SectionType::Text,         Text   },
+            { SectionType::ReadOnlyData, RoData },
+            { SectionType::Data,         Data   }
+    };
+    vector<unsigned char> strTab(1, 0), shStrTab(1, 0);
+    vector<Elf64_Sym> symbols(1);
+    map<SectionType, int> sectionSymbols;
+    for (const auto &section: sectionIndex) {
+        Elf64_Sym symbol = {};
+        symbol.st_info = ELF64_ST_INFO(STB_LOCAL, STT_SECTION);
+        symbol.st_shndx = section.second;
+        sectionSymbols[section.first] = symbols.size();
+        symbols.push_back(symbol);
+    }
+    map<string, int> symbolIndex;
+    for (int pass = 0; pass < 2; pass++) {
+        for (const auto &item: encoder.GetSymbols()) {
+            if (item.IsGlobal() != (pass == 1) || item.GetName().compare(0, 2, ".L") == 0)
+                continue;
+            Elf64_Sym symbol = {};
+            symbol.st_name = AddString(strTab, item.GetName());
+            symbol.st_info = ELF64_ST_INFO(item.IsGlobal() ? STB_GLOBAL : STB_LOCAL,
+                                           item.IsFunction() ? STT_FUNC : STT_OBJECT);
+            symbol.st_shndx = sectionIndex.at(item.GetSection());
+            symbol.st_value = item.GetOffset();
+            symbol.st_size = item.GetSize();
+            symbolIndex[item.GetName()] = symbols.size();
+            symbols.push_back(symbol);
+        }
+    }
+    int firstGlobal = symbols.size();
+    for (const auto &item: encoder.GetSymbols())
+        if (item.IsGlobal())
+            firstGlobal = min(firstGlobal, symbolIndex.at(item.GetName()));
+    vector<Elf64_Rela> relocations;
+    for (const auto &relocation: encoder.GetRelocations()) {
+        Elf64_Rela rela = {};
+        rela.r_offset = relocation.GetOffset();
+        rela.r_addend = relocation.GetAddend();
+        int type = relocation.GetType() == RelocationType::PLT32 ? R_X86_64_PLT32 : R_X86_64_PC32;
+        const ObjectSymbol *target = encoder.FindSymbol(relocation.GetSymbol());
+        int index;
+        if (target != nullptr && !target->IsGlobal()) {
+            index = sectionSymbols.at(target->GetSection());
+            rela.r_addend += target->GetOffset();
+        } else if (symbolIndex.find(relocation.GetSymbol()) != symbolIndex.end()) {
+            index = symbolIndex.at(relocation.GetSymbol());
+        } else {
+            Elf64_Sym symbol = {};
+            symbol.st_name = AddString(strTab, relocation.GetSymbol());
+            symbol.st_info = ELF64_ST_INFO(STB_GLOBAL, STT_NOTYPE);
+            symbol.st_shndx = SHN_UNDEF;
+            index = symbolIndex[relocation.GetSymbol()] = symbols.size();
+            symbols.push_back(symbol);
+        }
+        rela.r_info = ELF64_R_INFO(index, type);
+        relocations.push_back(rela);
+    }
+
+    vector<Elf64_Shdr> headers(SectionCount);
+    auto addSection = [&](int index, const string &name, Elf64_Word type, Elf64_Xword flags,
+                          const void *data, size_t size, size_t align) {
+        Elf64_Shdr &header = headers[index];
+        header.sh_name = AddString(shStrTab, name);
+        header.sh_type = type;
+        header.sh_flags = flags;
+        header.sh_addralign = align;
+        Align(align);
+        header.sh_offset = file.size();
+        header.sh_size = size;
+        if (type != SHT_NOBITS)
+            Append(data, size);
+    };
+    file.assign(sizeof(Elf64_Ehdr), 0);
+    const vector<unsigned char> &text = encoder.GetSection(SectionType::Text);
+    const vector<unsigned char> &roData = encoder.GetSection(SectionType::ReadOnlyData);
+    const vector<unsigned char> &data = encoder.GetSection(SectionType::Data);
+    addSection(Text, ".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, text.data(), text.size(),
+               encoder.GetAlign(SectionType::Text));
+    addSection(RoData, ".rodata", SHT_PROGBITS, SHF_ALLOC, roData.data(), roData.size(),
+               encoder.GetAlign(SectionType::ReadOnlyData));
+    addSection(Data, ".data", SHT_PROGBITS, SHF_ALLOC | SHF_WRITE, data.data(), data.size(),
+               encoder.GetAlign(SectionType::Data));
+    addSection(RelaText, ".rela.text", SHT_RELA, SHF_INFO_LINK, relocations.data(),
+               relocations.size() * sizeof(Elf64_Rela), 8);
+    headers[RelaText].sh_link = SymTab;
+    headers[RelaText].sh_info = Text;
+    headers[RelaText].sh_entsize = sizeof(Elf64_Rela);
+    addSection(SymTab, ".symtab", SHT_SYMTAB, 0, symbols.data(), symbols.size() * sizeof(Elf64_Sym), 8);
+    headers[SymTab].sh_link = StrTab;
+    headers[SymTab].sh_info = firstGlobal;
+    headers[SymTab].sh_entsize = sizeof(Elf64_Sym);
+    addSection(StrTab, ".strtab", SHT_STRTAB, 0, strTab.data(), strTab.size(), 1);
+    addSection(NoteStack, ".note.GNU-stack", SHT_PROGBITS, 0, nullptr, 0, 1);
+    headers[ShStrTab].sh_name = AddString(shStrTab, ".shstrtab");
+    headers[ShStrTab].sh_type = SHT_STRTAB;
+    headers[ShStrTab].sh_addralign = 1;
+    headers[ShStrTab].sh_offset = file.size();
+    headers[ShStrTab].sh_size = shStrTab.size();
+    Append(shStrTab.data(), shStrTab.size());
+    Align(8);
+
+    Elf64_Ehdr header = {};
+    memcpy(header.e_ident, ELFMAG, SELFMAG);
+    header.e_ident[EI_CLASS] = ELFCLASS64;
+    header.e_ident[EI_DATA] = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    header.e_type = ET_REL;
+    header.e_machine = EM_X86_64;
+    header.e_version = EV_CURRENT;
+    header.e_ehsize = sizeof(Elf64_Ehdr);
+    header.e_shentsize = sizeof(Elf64_Shdr);
+    header.e_shnum = SectionCount;
+    header.e_shstrndx = ShStrTab;
+    header.e_shoff = file.size();
+    Append(headers.data(), headers.size() * sizeof(Elf64_Shdr));
+    memcpy(file.data(), &header, sizeof(header));
+    Write(fileName, false);
+}
+
+void ElfWriter::WriteExecutable(const std::string &fileName) {
+    for (const auto &relocation: encoder.GetRelocations())
+        if (encoder.FindSymbol(relocation.GetSymbol()) == nullptr)
+            throw UndefinedSymbol(relocation.GetSymbol());
+    const ObjectSymbol *entry = encoder.FindSymbol("main");
+    if (entry == nullptr)
+        throw UndefinedSymbol("main");
+
+    const vector<unsigned char> &text = encoder.GetSection(SectionType::Text);
+    const vector<unsigned char> &roData = encoder.GetSection(SectionType::ReadOnlyData);
+    const vector<unsigned char> &data = encoder.GetSection(SectionType::Data);
+    file.assign(sizeof(Elf64_Ehdr) + 2 * sizeof(Elf64_Phdr), 0);
+    Align(16);
+    size_t startOffset = file.size();
+    Append(startStub.data(), startStub.size());
+    Align(encoder.GetAlign(SectionType::Text));
+    map<SectionType, size_t> offsets;
+    offsets[SectionType::Text] = file.size();
+    Append(text.data(), text.size());
+    Align(encoder.GetAlign(SectionType::ReadOnlyData));
+    offsets[SectionType::ReadOnlyData] = file.size();
+    Append(roData.data(), roData.size());
+    size_t codeEnd = file.size();
+    Align(pageSize);
+    offsets[SectionType::Data] = file.size();
+    Append(data.data(), data.size());
+
+    auto patch = [&](size_t offset, long long value) {
+        for (int i = 0; i < 4; i++)
+            file[offset + i] = (value >> (8 * i)) & 0xFF;
+    };
+    long long mainAddress = offsets[SectionType::Text] + entry->GetOffset();
+    patch(startOffset + startCallOffset, mainAddress - (long long) (startOffset + startCallOffset + 4));
+    for (const auto &relocation: encoder.GetRelocations()) {
+        const ObjectSymbol *target = encoder.FindSymbol(relocation.GetSymbol());
+        long long place = offsets[SectionType::Text] + relocation.GetOffset();
+        long long symbol = offsets[target->GetSection()] + target->GetOffset();
+        patch(place, symbol + relocation.GetAddend() - place);
+    }
+
+    Elf64_Phdr segments[2] = {};
+    segments[0].p_type = PT_LOAD;
+    segments[0].p_flags = PF_R | PF_X;
+    segments[0].p_offset = 0;
+    segments[0].p_vaddr = segments[0].p_paddr = baseAddress;
+    segments[0].p_filesz = segments[0].p_memsz = codeEnd;
+    segments[0].p_align = pageSize;
+    segments[1].p_type = PT_LOAD;
+    segments[1].p_flags = PF_R | PF_W;
+    segments[1].p_offset = offsets[SectionType::Data];
+    segments[1].p_vaddr = segments[1].p_paddr = baseAddress + offsets[SectionType::Data];
+    segments[1].p_filesz = segments[1].p_memsz = data.size();
+    segments[1].p_align = pageSize;
+
+    Elf64_Ehdr header = {};
+    memcpy(header.e_ident, ELFMAG, SELFMAG);
+    header.e_ident[EI_CLASS] = ELFCLASS64;
+    header.e_ident[EI_DATA] = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    header.e_type = ET_EXEC;
+    header.e_machine = EM_X86_64;
+    header.e_version = EV_CURRENT;
+    header.e_entry = baseAddress + startOffset;
+    header.e_phoff = sizeof(Elf64_Ehdr);
+    header.e_ehsize = sizeof(Elf64_Ehdr);
+    header.e_phentsize = sizeof(Elf64_Phdr);
+    header.e_phnum = 2;
+    memcpy(file.data(), &header, sizeof(header));
+    memcpy(file.data() + sizeof(Elf64_Ehdr), segments, sizeof(segments));
+    Write(fileName, true);
+}
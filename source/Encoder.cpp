@@ -0,0 +1,580 @@
+#include "Encoder.h"
+#include <algorithm>
+
+using namespace std;
+
+ObjectSymbol::ObjectSymbol(std::string name, SectionType section, long long offset, bool global, bool function) :
+        name(name), section(section), offset(offset), global(global), function(function) {}
+
+const std::string &ObjectSymbol::GetName() const {
+    return name;
+}
+
+SectionType ObjectSymbol::GetSection() const {
+    return section;
+}
+
+long long ObjectSymbol::GetOffset() const {
+    return offset;
+}
+
+long long ObjectSymbol::GetSize() const {
+    return size;
+}
+
+void ObjectSymbol::SetSize(long long size) {
+    this->size = size;
+}
+
+bool ObjectSymbol::IsGlobal() const {
+    return global;
+}
+
+bool ObjectSymbol::IsFunction() const {
+    return function;
+}
+
+Relocation::Relocation(long long offset, std::string symbol, RelocationType type, long long addend) :
+        offset(offset), symbol(symbol), type(type), addend(addend) {}
+
+long long Relocation::GetOffset() const {
+    return offset;
+}
+
+const std::string &Relocation::GetSymbol() const {
+    return symbol;
+}
+
+RelocationType Relocation::GetType() const {
+    return type;
+}
+
+long long Relocation::GetAddend() const {
+    return addend;
+}
+
+Encoder::Encoder(PAsmProgram program) : program(program) {
+    for (auto section: { SectionType::Text, SectionType::ReadOnlyData, SectionType::Data }) {
+        sections[section] = {};
+        aligns[section] = 1;
+    }
+    aligns[SectionType::Text] = 16;
+    EncodeData();
+    int dataSymbols = symbols.size();
+    EncodeCode();
+    while (!ResolveFixups()) {
+        ClearCode(dataSymbols);
+        EncodeCode();
+    }
+}
+
+const std::vector<unsigned char> &Encoder::GetSection(SectionType section) const {
+    return sections.at(section);
+}
+
+int Encoder::GetAlign(SectionType section) const {
+    return aligns.at(section);
+}
+
+const std::vector<ObjectSymbol> &Encoder::GetSymbols() const {
+    return symbols;
+}
+
+const std::vector<Relocation> &Encoder::GetRelocations() const {
+    return relocations;
+}
+
+const ObjectSymbol *Encoder::FindSymbol(const std::string &name) const {
+    auto symbol = symbolNames.find(name);
+    return symbol == symbolNames.end() ? nullptr : &symbols[symbol->second];
+}
+
+void Encoder::AddSymbol(ObjectSymbol symbol) {
+    symbolNames[symbol.GetName()] = symbols.size();
+    symbols.push_back(symbol);
+}
+
+void Encoder::EncodeData() {
+    for (const auto &data: program->GetData()) {
+        SectionType section = data.IsReadOnly() ? SectionType::ReadOnlyData : SectionType::Data;
+        vector<unsigned char> &bytes = sections[section];
+        while (bytes.size() % data.GetAlign() != 0)
+            bytes.push_back(0);
+        aligns[section] = max(aligns[section], data.GetAlign());
+        ObjectSymbol symbol(data.GetLabel(), section, bytes.size(), false, false);
+        symbol.SetSize(data.GetBytes().size());
+        AddSymbol(symbol);
+        bytes.insert(bytes.end(), data.GetBytes().begin(), data.GetBytes().end());
+    }
+}
+
+// Jumps to labels of this object that are not global start out short, as GNU as has them; one that
+// turns out not to reach its target is made long, and the code is encoded again. Branches only ever
+// grow, so this ends with the layout GNU as picks.
+void Encoder::EncodeCode() {
+    const vector<string> &globals = program->GetGlobals();
+    const vector<AsmInstruction> &code = program->GetCode();
+    for (const auto &instruction: code)
+        if (instruction.GetOpCode() == OpCode::Label &&
+                find(globals.begin(), globals.end(), instruction.GetLabel()) == globals.end())
+            localLabels.insert(instruction.GetLabel());
+    int function = -1;
+    vector<unsigned char> &text = sections[SectionType::Text];
+    for (current = 0; current < code.size(); current++) {
+        const AsmInstruction &instruction = code[current];
+        if (instruction.GetOpCode() != OpCode::Label) {
+            Encode(instruction);
+            continue;
+        }
+        const string &label = instruction.GetLabel();
+        bool local = label[0] == '.';
+        if (!local) {
+            if (function >= 0)
+                symbols[function].SetSize(text.size() - symbols[function].GetOffset());
+            function = symbols.size();
+        }
+        bool global = find(globals.begin(), globals.end(), label) != globals.end();
+        AddSymbol(ObjectSymbol(label, SectionType::Text, text.size(), global, !local));
+    }
+    if (function >= 0)
+        symbols[function].SetSize(text.size() - symbols[function].GetOffset());
+}
+
+void Encoder::ClearCode(int dataSymbols) {
+    sections[SectionType::Text].clear();
+    for (int i = dataSymbols; i < symbols.size(); i++)
+        symbolNames.erase(symbols[i].GetName());
+    symbols.erase(symbols.begin() + dataSymbols, symbols.end());
+    fixups.clear();
+    shortFixups.clear();
+}
+
+// False if a short branch did not reach; it is then marked long for the next encoding.
+bool Encoder::ResolveFixups() {
+    vector<unsigned char> &text = sections[SectionType::Text];
+    bool reached = true;
+    for (const auto &branch: shortFixups) {
+        const Relocation &fixup = branch.second;
+        long long value = FindSymbol(fixup.GetSymbol())->GetOffset() + fixup.GetAddend() - fixup.GetOffset();
+        if (!IsByte(value)) {
+            longBranches.insert(branch.first);
+            reached = false;
+        }
+        text[fixup.GetOffset()] = value & 0xFF;
+    }
+    if (!reached)
+        return false;
+    for (const auto &fixup: fixups) {
+        const ObjectSymbol *symbol = FindSymbol(fixup.GetSymbol());
+        if (symbol == nullptr || symbol->GetSection() != SectionType::Text) {
+            relocations.push_back(fixup);
+            continue;
+        }
+        long long value = symbol->GetOffset() + fixup.GetAddend() - fixup.GetOffset();
+        for (int i = 0; i < 4; i++)
+            text[fixup.GetOffset() + i] = (value >> (8 * i)) & 0xFF;
+    }
+    return true;
+}
+
+int Encoder::GetCode(Register reg) {
+    if (reg >= Register::Xmm0 && reg <= Register::Xmm15)
+        return (int) reg - (int) Register::Xmm0;
+    return (int) reg;
+}
+
+bool Encoder::IsByte(long long value) {
+    return value >= -128 && value <= 127;
+}
+
+void Encoder::EmitByte(unsigned char byte) {
+    sections[SectionType::Text].push_back(byte);
+}
+
+void Encoder::EmitImm(long long value, int size) {
+    for (int i = 0; i < size; i++)
+        EmitByte((value >> (8 * i)) & 0xFF);
+}
+
+void Encoder::EmitFixup(const std::string &label, RelocationType type, long long addend) {
+    fixups.push_back(Relocation(sections[SectionType::Text].size(), label, type, addend));
+    EmitImm(0, 4);
+}
+
+void Encoder::EmitRex(bool wide, int reg, const Operand &rm, bool byteRm, bool byteReg) {
+    int rex = (wide ? 8 : 0) | (reg >= 8 ? 4 : 0);
+    bool force = byteReg && reg >= 4 && reg < 8;
+    if (rm.GetType() == OperandType::Register) {
+        int code = GetCode(rm.GetRegister());
+        rex |= code >= 8 ? 1 : 0;
+        force = force || (byteRm && code >= 4 && code < 8);
+    } else if (rm.GetType() == OperandType::Memory && rm.GetRegister() != Register::Rip) {
+        rex |= GetCode(rm.GetRegister()) >= 8 ? 1 : 0;
+        if (rm.GetIndex() != Register::None)
+            rex |= GetCode(rm.GetIndex()) >= 8 ? 2 : 0;
+    }
+    if (rex != 0 || force)
+        EmitByte(0x40 | rex);
+}
+
+void Encoder::EmitModRm(int reg, const Operand &rm, int immSize) {
+    reg &= 7;
+    if (rm.GetType() == OperandType::Register) {
+        EmitByte(0xC0 | reg << 3 | (GetCode(rm.GetRegister()) & 7));
+        return;
+    }
+    if (rm.GetRegister() == Register::Rip) {
+        EmitByte(reg << 3 | 5);
+        if (rm.GetLabel().empty())
+            EmitImm(rm.GetValue(), 4);
+        else
+            EmitFixup(rm.GetLabel(), RelocationType::PC32, rm.GetValue() - 4 - immSize);
+        return;
+    }
+    int base = GetCode(rm.GetRegister()) & 7;
+    long long disp = rm.GetValue();
+    int mod = disp == 0 && base != 5 ? 0 : IsByte(disp) ? 1 : 2;
+    if (rm.GetIndex() == Register::None && base != 4) {
+        EmitByte(mod << 6 | reg << 3 | base);
+    } else {
+        map<int, int> scales = { { 1, 0 }, { 2, 1 }, { 4, 2 }, { 8, 3 } };
+        int index = rm.GetIndex() == Register::None ? 4 : GetCode(rm.GetIndex()) & 7;
+        EmitByte(mod << 6 | reg << 3 | 4);
+        EmitByte(scales.at(rm.GetScale()) << 6 | index << 3 | base);
+    }
+    if (mod == 1)
+        EmitImm(disp, 1);
+    else if (mod == 2)
+        EmitImm(disp, 4);
+}
+
+void Encoder::EncodeAlu(const AsmInstruction &instruction, int extension, unsigned char opCode) {
+    const Operand &source = instruction.GetOperands()[0];
+    const Operand &dest = instruction.GetOperands()[1];
+    int size = instruction.GetSize();
+    bool wide = size == 8, byte = size == 1;
+    if (source.GetType() == OperandType::Immediate) {
+        int immSize = byte || IsByte(source.GetValue()) ? 1 : 4;
+        // The accumulator has a form without ModRM, which as picks wherever it is not longer.
+        if (dest.GetType() == OperandType::Register && dest.GetRegister() == Register::Rax && (byte || immSize == 4)) {
+            EmitRex(wide, 0, dest, byte);
+            EmitByte(opCode + (byte ? 4 : 5));
+            EmitImm(source.GetValue(), immSize);
+            return;
+        }
+        EmitRex(wide, extension, dest, byte);
+        EmitByte(byte ? 0x80 : immSize == 1 ? 0x83 : 0x81);
+        EmitModRm(extension, dest, immSize);
+        EmitImm(source.GetValue(), immSize);
+    } else if (source.GetType() == OperandType::Register) {
+        int reg = GetCode(source.GetRegister());
+        EmitRex(wide, reg, dest, byte, byte);
+        EmitByte(opCode + (byte ? 0 : 1));
+        EmitModRm(reg, dest);
+    } else {
+        int reg = GetCode(dest.GetRegister());
+        EmitRex(wide, reg, source, byte, byte);
+        EmitByte(opCode + (byte ? 2 : 3));
+        EmitModRm(reg, source);
+    }
+}
+
+void Encoder::EncodeShift(const AsmInstruction &instruction, int extension) {
+    const Operand &count = instruction.GetOperands()[0];
+    const Operand &dest = instruction.GetOperands()[1];
+    EmitRex(instruction.GetSize() == 8, extension, dest);
+    if (count.GetType() == OperandType::Immediate) {
+        EmitByte(0xC1);
+        EmitModRm(extension, dest, 1);
+        EmitImm(count.GetValue(), 1);
+    } else {
+        EmitByte(0xD3);
+        EmitModRm(extension, dest);
+    }
+}
+
+void Encoder::EncodeUnary(const AsmInstruction &instruction, int extension) {
+    const Operand &operand = instruction.GetOperands()[0];
+    bool byte = instruction.GetSize() == 1;
+    EmitRex(instruction.GetSize() == 8, extension, operand, byte);
+    EmitByte(byte ? 0xF6 : 0xF7);
+    EmitModRm(extension, operand);
+}
+
+void Encoder::EncodeSse(unsigned char prefix, unsigned char opCode, const Operand &reg, const Operand &rm,
+                        bool wide) {
+    int code = GetCode(reg.GetRegister());
+    if (prefix != 0)
+        EmitByte(prefix);
+    EmitRex(wide, code, rm);
+    EmitByte(0x0F);
+    EmitByte(opCode);
+    EmitModRm(code, rm);
+}
+
+void Encoder::EncodeBranch(std::vector<unsigned char> opCode, const Operand &target) {
+    for (auto byte: opCode)
+        EmitByte(byte);
+    EmitFixup(target.GetLabel(), target.IsExternal() ? RelocationType::PLT32 : RelocationType::PC32, -4);
+}
+
+bool Encoder::IsShort(const Operand &target) const {
+    return !target.IsExternal() && localLabels.count(target.GetLabel()) != 0 && longBranches.count(current) == 0;
+}
+
+void Encoder::EncodeShortBranch(unsigned char opCode, const Operand &target) {
+    EmitByte(opCode);
+    shortFixups.push_back({ current, Relocation(sections[SectionType::Text].size(), target.GetLabel(),
+                                                RelocationType::PC32, -1) });
+    EmitByte(0);
+}
+
+void Encoder::Encode(const AsmInstruction &instruction) {
+    const vector<Operand> &operands = instruction.GetOperands();
+    int size = instruction.GetSize();
+    bool wide = size == 8;
+    switch (instruction.GetOpCode()) {
+        case OpCode::Mov: {
+            const Operand &source = operands[0];
+            const Operand &dest = operands[1];
+            if (source.GetType() == OperandType::Immediate && dest.GetType() == OperandType::Register) {
+                int reg = GetCode(dest.GetRegister());
+                long long value = source.GetValue();
+                if (wide && value >= INT32_MIN && value <= INT32_MAX) {
+                    EmitRex(true, 0, dest);
+                    EmitByte(0xC7);
+                    EmitModRm(0, dest, 4);
+                    EmitImm(value, 4);
+                    break;
+                }
+                EmitRex(wide, 0, dest, size == 1);
+                EmitByte((size == 1 ? 0xB0 : 0xB8) + (reg & 7));
+                EmitImm(value, size);
+            } else if (source.GetType() == OperandType::Immediate) {
+                int immSize = min(size, 4);
+                EmitRex(wide, 0, dest);
+                EmitByte(size == 1 ? 0xC6 : 0xC7);
+                EmitModRm(0, dest, immSize);
+                EmitImm(source.GetValue(), immSize);
+            } else if (source.GetType() == OperandType::Register) {
+                int reg = GetCode(source.GetRegister());
+                EmitRex(wide, reg, dest, size == 1, size == 1);
+                EmitByte(size == 1 ? 0x88 : 0x89);
+                EmitModRm(reg, dest);
+            } else {
+                int reg = GetCode(dest.GetRegister());
+                EmitRex(wide, reg, source, size == 1, size == 1);
+                EmitByte(size == 1 ? 0x8A : 0x8B);
+                EmitModRm(reg, source);
+            }
+            break;
+        }
+        case OpCode::Movsx:
+        case OpCode::Movzx: {
+            int reg = GetCode(operands[1].GetRegister());
+            EmitRex(operands[1].GetSize() == 8, reg, operands[0], size == 1);
+            if (size == 4) {
+                EmitByte(0x63);
+            } else {
+                EmitByte(0x0F);
+                bool sign = instruction.GetOpCode() == OpCode::Movsx;
+                EmitByte((sign ? 0xBE : 0xB6) + (size == 2 ? 1 : 0));
+            }
+            EmitModRm(reg, operands[0]);
+            break;
+        }
+        case OpCode::Lea: {
+            int reg = GetCode(operands[1].GetRegister());
+            EmitRex(true, reg, operands[0]);
+            EmitByte(0x8D);
+            EmitModRm(reg, operands[0]);
+            break;
+        }
+        case OpCode::Add: {
+            EncodeAlu(instruction, 0, 0x00);
+            break;
+        }
+        case OpCode::Or: {
+            EncodeAlu(instruction, 1, 0x08);
+            break;
+        }
+        case OpCode::And: {
+            EncodeAlu(instruction, 4, 0x20);
+            break;
+        }
+        case OpCode::Sub: {
+            EncodeAlu(instruction, 5, 0x28);
+            break;
+        }
+        case OpCode::Xor: {
+            EncodeAlu(instruction, 6, 0x30);
+            break;
+        }
+        case OpCode::Cmp: {
+            EncodeAlu(instruction, 7, 0x38);
+            break;
+        }
+        case OpCode::Test: {
+            int reg = GetCode(operands[0].GetRegister());
+            EmitRex(wide, reg, operands[1], size == 1, size == 1);
+            EmitByte(size == 1 ? 0x84 : 0x85);
+            EmitModRm(reg, operands[1]);
+            break;
+        }
+        case OpCode::Imul: {
+            if (operands.size() == 3) {
+                int reg = GetCode(operands[2].GetRegister());
+                int immSize = IsByte(operands[0].GetValue()) ? 1 : 4;
+                EmitRex(wide, reg, operands[1]);
+                EmitByte(immSize == 1 ? 0x6B : 0x69);
+                EmitModRm(reg, operands[1], immSize);
+                EmitImm(operands[0].GetValue(), immSize);
+                break;
+            }
+            int reg = GetCode(operands[1].GetRegister());
+            EmitRex(wide, reg, operands[0]);
+            EmitByte(0x0F);
+            EmitByte(0xAF);
+            EmitModRm(reg, operands[0]);
+            break;
+        }
+        case OpCode::Idiv: {
+            EncodeUnary(instruction, 7);
+            break;
+        }
+        case OpCode::Neg: {
+            EncodeUnary(instruction, 3);
+            break;
+        }
+        case OpCode::Not: {
+            EncodeUnary(instruction, 2);
+            break;
+        }
+        case OpCode::Cdq: {
+            if (wide)
+                EmitByte(0x48);
+            EmitByte(0x99);
+            break;
+        }
+        case OpCode::Sal: {
+            EncodeShift(instruction, 4);
+            break;
+        }
+        case OpCode::Sar: {
+            EncodeShift(instruction, 7);
+            break;
+        }
+        case OpCode::Btc: {
+            EmitRex(wide, 7, operands[1]);
+            EmitByte(0x0F);
+            EmitByte(0xBA);
+            EmitModRm(7, operands[1], 1);
+            EmitImm(operands[0].GetValue(), 1);
+            break;
+        }
+        case OpCode::Set: {
+            EmitRex(false, 0, operands[0], true);
+            EmitByte(0x0F);
+            EmitByte(0x90 + conditionCode.at(instruction.GetCondition()));
+            EmitModRm(0, operands[0]);
+            break;
+        }
+        case OpCode::Jmp: {
+            if (IsShort(operands[0]))
+                EncodeShortBranch(0xEB, operands[0]);
+            else
+                EncodeBranch({ 0xE9 }, operands[0]);
+            break;
+        }
+        case OpCode::J: {
+            int code = conditionCode.at(instruction.GetCondition());
+            if (IsShort(operands[0]))
+                EncodeShortBranch(0x70 + code, operands[0]);
+            else
+                EncodeBranch({ 0x0F, (unsigned char) (0x80 + code) }, operands[0]);
+            break;
+        }
+        case OpCode::Call: {
+            EncodeBranch({ 0xE8 }, operands[0]);
+            break;
+        }
+        case OpCode::Ret: {
+            EmitByte(0xC3);
+            break;
+        }
+        case OpCode::Leave: {
+            EmitByte(0xC9);
+            break;
+        }
+        case OpCode::RepMovsb: {
+            EmitByte(0xF3);
+            EmitByte(0xA4);
+            break;
+        }
+        case OpCode::Push: {
+            const Operand &operand = operands[0];
+            if (operand.GetType() == OperandType::Register) {
+                EmitRex(false, 0, operand);
+                EmitByte(0x50 + (GetCode(operand.GetRegister()) & 7));
+            } else if (operand.GetType() == OperandType::Immediate) {
+                EmitByte(0x68);
+                EmitImm(operand.GetValue(), 4);
+            } else {
+                EmitRex(false, 6, operand);
+                EmitByte(0xFF);
+                EmitModRm(6, operand);
+            }
+            break;
+        }
+        case OpCode::Pop: {
+            EmitRex(false, 0, operands[0]);
+            EmitByte(0x58 + (GetCode(operands[0].GetRegister()) & 7));
+            break;
+        }
+        case OpCode::Movsd: {
+            if (operands[1].IsDouble())
+                EncodeSse(0xF2, 0x10, operands[1], operands[0]);
+            else
+                EncodeSse(0xF2, 0x11, operands[0], operands[1]);
+            break;
+        }
+        case OpCode::Movq: {
+            if (operands[1].IsDouble())
+                EncodeSse(0x66, 0x6E, operands[1], operands[0], true);
+            else
+                EncodeSse(0x66, 0x7E, operands[0], operands[1], true);
+            break;
+        }
+        case OpCode::Addsd: {
+            EncodeSse(0xF2, 0x58, operands[1], operands[0]);
+            break;
+        }
+        case OpCode::Subsd: {
+            EncodeSse(0xF2, 0x5C, operands[1], operands[0]);
+            break;
+        }
+        case OpCode::Mulsd: {
+            EncodeSse(0xF2, 0x59, operands[1], operands[0]);
+            break;
+        }
+        case OpCode::Divsd: {
+            EncodeSse(0xF2, 0x5E, operands[1], operands[0]);
+            break;
+        }
+        case OpCode::Ucomisd: {
+            EncodeSse(0x66, 0x2E, operands[1], operands[0]);
+            break;
+        }
+        case OpCode::Cvtsi2sd: {
+            EncodeSse(0xF2, 0x2A, operands[1], operands[0], wide);
+            break;
+        }
+        case OpCode::Cvttsd2si: {
+            EncodeSse(0xF2, 0x2C, operands[1], operands[0], operands[1].GetSize() == 8);
+            break;
+        }
+        case OpCode::Label: {
+            break;
+        }
+    }
+}
@@ -87,3 +87,48 @@ IncompatibleTypesForArg::IncompatibleTypesForArg(Token &token, int num,
             token.GetLine(), token.GetColumn(), num, type1.c_str(), type2.c_str());
     message = buff;
 }
+
+UnitNotFound::UnitNotFound(Token &token, std::string unit) {
+    char buff[minBuffSize + unit.size()];
+    sprintf(buff, "(%d,%d) Error: Can't find unit \"%s\"",
+            token.GetLine(), token.GetColumn(), unit.c_str());
+    message = buff;
+}
+
+ForwardNotSolved::ForwardNotSolved(Token &token, std::string ident) {
+    char buff[minBuffSize + ident.size()];
+    sprintf(buff, "(%d,%d) Error: Forward declaration not solved \"%s\"",
+            token.GetLine(), token.GetColumn(), ident.c_str());
+    message = buff;
+}
+
+NotSupported::NotSupported(Token &token, std::string construct) {
+    char buff[minBuffSize + construct.size()];
+    sprintf(buff, "(%d,%d) Error: Not supported by code generator: %s",
+            token.GetLine(), token.GetColumn(), construct.c_str());
+    message = buff;
+}
+
+BuildError::BuildError(std::string command, std::string diagnostics) {
+    message = "Error: Command failed: " + command;
+    while (!diagnostics.empty() && diagnostics.back() == '\n')
+        diagnostics.pop_back();
+    if (!diagnostics.empty())
+        message += "\n" + diagnostics;
+}
+
+FileNotWritten::FileNotWritten(std::string fileName) {
+    message = "Error: Can not write file: " + fileName;
+}
+
+UndefinedSymbol::UndefinedSymbol(std::string symbol) {
+    message = "Error: Undefined symbol: " + symbol;
+}
+
+InvalidInterface::InvalidInterface(std::string fileName) {
+    message = "Error: Invalid interface file: " + fileName;
+}
+
+JitError::JitError(std::string reason) {
+    message = "Error: JIT failed: " + reason;
+}
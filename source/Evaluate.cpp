@@ -77,8 +77,12 @@ any Evaluate::Calc(State state, any first, any second, string firstType,
             return DoubleArgs(first, second, firstType, secondType, exprType, minus<double>());
         case Asterisk:
             return DoubleArgs(first, second, firstType, secondType, exprType, multiplies<double>());
-        case Slash:
-            return DoubleArgs(first, second, firstType, secondType, exprType, divides<double>());
+        case Slash: {
+            string doubleType = baseType.at(BaseType::Double);
+            double dividend = any_cast<double>(Cast(first, firstType, doubleType));
+            double divisor = any_cast<double>(Cast(second, secondType, doubleType));
+            return Cast(dividend / divisor, doubleType, exprType);
+        }
         case Mod:
             return Cast(any_cast<int>(first) % any_cast<int>(second), firstType, exprType);
         case Div:
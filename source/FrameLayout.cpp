@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <climits>
+#include "FrameLayout.h"
+
+using namespace std;
+
+FrameLayout::FrameLayout(PIrFunction function) : function(function), size(0) {
+    FindLifetimes();
+    Place();
+}
+
+int FrameLayout::GetOffset(int slot) const {
+    return offsets[slot];
+}
+
+int FrameLayout::GetSize() const {
+    return size;
+}
+
+// A slot whose address is stored to memory may be reached from anywhere, so it stays live over
+// the whole function. Lifetimes are widened across every backward edge they overlap, since the
+// contents of a slot used inside a loop survive from one iteration to the next.
+void FrameLayout::FindLifetimes() {
+    int count = function->GetSlots().size();
+    starts.assign(count, INT_MAX);
+    ends.assign(count, INT_MIN);
+    map<IrInstruction*, int> positions, derived;
+    map<IrBlock*, pair<int, int>> spans;
+    vector<IrInstruction*> work;
+    int position = 0;
+    for (const auto &block: function->GetBlocks()) {
+        int start = position;
+        for (const auto &instruction: block->GetInstructions()) {
+            positions[instruction] = position++;
+            if (instruction->GetOp() == IrOp::SlotAddr) {
+                derived[instruction] = instruction->GetInt();
+                work.push_back(instruction);
+            }
+        }
+        spans[block] = { start, position - 1 };
+    }
+    auto cover = [&](int slot, int from, int to) {
+        starts[slot] = min(starts[slot], from);
+        ends[slot] = max(ends[slot], to);
+    };
+    while (!work.empty()) {
+        IrInstruction *pointer = work.back();
+        work.pop_back();
+        int slot = derived.at(pointer);
+        for (const auto &user: function->GetUsers(pointer)) {
+            cover(slot, positions.at(user), positions.at(user));
+            if (user->GetOp() == IrOp::Store && user->GetOperand(1) == pointer)
+                cover(slot, 0, position);
+            if (user->GetType() == IrType::Pointer && derived.find(user) == derived.end()) {
+                derived[user] = slot;
+                work.push_back(user);
+            } else if (user->GetType() == IrType::Pointer && derived.at(user) != slot) {
+                cover(slot, 0, position);
+                cover(derived.at(user), 0, position);
+            }
+        }
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const auto &block: function->GetBlocks()) {
+            for (const auto &successor: block->GetSuccessors()) {
+                int from = spans.at(successor).first, to = spans.at(block).second;
+                if (from > to)
+                    continue;
+                for (int slot = 0; slot < count; slot++) {
+                    if (starts[slot] > to || ends[slot] < from || (starts[slot] <= from && ends[slot] >= to))
+                        continue;
+                    cover(slot, from, to);
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+// Slots are placed largest first; each goes to the lowest offset whose occupants are all dead
+// while it is live.
+void FrameLayout::Place() {
+    const vector<IrSlot> &slots = function->GetSlots();
+    vector<int> order;
+    for (int slot = 0; slot < slots.size(); slot++)
+        order.push_back(slot);
+    stable_sort(order.begin(), order.end(), [&](int first, int second) {
+        return slots[first].GetSize() > slots[second].GetSize();
+    });
+    offsets.assign(slots.size(), 0);
+    vector<int> placed;
+    for (const auto &slot: order) {
+        int align = max(slots[slot].GetAlign(), (int) minAlign);
+        int offset = 0;
+        bool moved = true;
+        while (moved) {
+            moved = false;
+            for (const auto &other: placed) {
+                bool overlapping = starts[slot] <= ends[other] && starts[other] <= ends[slot];
+                bool sharing = offset < offsets[other] + slots[other].GetSize() &&
+                               offsets[other] < offset + slots[slot].GetSize();
+                if (overlapping && sharing) {
+                    offset = AlignUp(offsets[other] + slots[other].GetSize(), align);
+                    moved = true;
+                }
+            }
+        }
+        offsets[slot] = offset;
+        placed.push_back(slot);
+        size = max(size, offset + slots[slot].GetSize());
+    }
+}
+
+int FrameLayout::AlignUp(int value, int align) {
+    return (value + align - 1) / align * align;
+}
@@ -0,0 +1,744 @@
+#include <algorithm>
+#include <set>
+#include <cstdio>
+#include "Ir.h"
+
+using namespace std;
+
+IrInstruction::IrInstruction(IrOp op, IrType type, std::vector<IrInstruction*> operands) :
+        op(op), type(type), operands(operands) {}
+
+IrOp IrInstruction::GetOp() const {
+    return op;
+}
+
+void IrInstruction::SetOp(IrOp op) {
+    this->op = op;
+}
+
+IrType IrInstruction::GetType() const {
+    return type;
+}
+
+int IrInstruction::GetId() const {
+    return id;
+}
+
+void IrInstruction::SetId(int id) {
+    this->id = id;
+}
+
+const std::vector<IrInstruction*> &IrInstruction::GetOperands() const {
+    return operands;
+}
+
+IrInstruction *IrInstruction::GetOperand(int index) const {
+    return operands[index];
+}
+
+void IrInstruction::SetOperand(int index, IrInstruction *operand) {
+    operands[index] = operand;
+}
+
+void IrInstruction::AddOperand(IrInstruction *operand) {
+    operands.push_back(operand);
+}
+
+void IrInstruction::RemoveOperand(int index) {
+    operands.erase(operands.begin() + index);
+}
+
+void IrInstruction::ClearOperands() {
+    operands.clear();
+}
+
+const std::vector<IrBlock*> &IrInstruction::GetTargets() const {
+    return targets;
+}
+
+void IrInstruction::SetTarget(int index, IrBlock *target) {
+    targets[index] = target;
+}
+
+void IrInstruction::AddTarget(IrBlock *target) {
+    targets.push_back(target);
+}
+
+void IrInstruction::RemoveTarget(int index) {
+    targets.erase(targets.begin() + index);
+}
+
+void IrInstruction::ClearTargets() {
+    targets.clear();
+}
+
+IrBlock *IrInstruction::GetBlock() const {
+    return block;
+}
+
+void IrInstruction::SetBlock(IrBlock *block) {
+    this->block = block;
+}
+
+long long IrInstruction::GetInt() const {
+    return intValue;
+}
+
+void IrInstruction::SetInt(long long value) {
+    intValue = value;
+}
+
+double IrInstruction::GetDouble() const {
+    return doubleValue;
+}
+
+void IrInstruction::SetDouble(double value) {
+    doubleValue = value;
+}
+
+IrCondition IrInstruction::GetCondition() const {
+    return condition;
+}
+
+void IrInstruction::SetCondition(IrCondition condition) {
+    this->condition = condition;
+}
+
+const std::string &IrInstruction::GetName() const {
+    return name;
+}
+
+void IrInstruction::SetName(const std::string &name) {
+    this->name = name;
+}
+
+int IrInstruction::GetSize() const {
+    return size;
+}
+
+void IrInstruction::SetSize(int size) {
+    this->size = size;
+}
+
+IrWrite IrInstruction::GetWrite() const {
+    return write;
+}
+
+void IrInstruction::SetWrite(IrWrite write) {
+    this->write = write;
+}
+
+bool IrInstruction::IsTerminator() const {
+    return op == IrOp::Jump || op == IrOp::Branch || op == IrOp::Return;
+}
+
+bool IrInstruction::HasSideEffects() const {
+    switch (op) {
+        case IrOp::Store:
+        case IrOp::Copy:
+        case IrOp::Check:
+        case IrOp::Call:
+        case IrOp::Write:
+        case IrOp::Jump:
+        case IrOp::Branch:
+        case IrOp::Return: {
+            return true;
+        }
+        default: {
+            return false;
+        }
+    }
+}
+
+bool IrInstruction::IsPure() const {
+    return !HasSideEffects() && op != IrOp::Phi && op != IrOp::Param && op != IrOp::Load;
+}
+
+bool IrInstruction::IsCommutative() const {
+    switch (op) {
+        case IrOp::Add:
+        case IrOp::Mul:
+        case IrOp::And:
+        case IrOp::Or:
+        case IrOp::Xor:
+        case IrOp::FAdd:
+        case IrOp::FMul: {
+            return true;
+        }
+        case IrOp::Cmp:
+        case IrOp::FCmp: {
+            return condition == IrCondition::Eq || condition == IrCondition::Ne;
+        }
+        default: {
+            return false;
+        }
+    }
+}
+
+// A call is in tail position when nothing but jumps lies between it and a return of its result;
+// the result may travel to the return through phis along the way.
+bool IrInstruction::IsTailCall() const {
+    if (op != IrOp::Call)
+        return false;
+    const vector<IrInstruction*> &instructions = block->GetInstructions();
+    auto position = find(instructions.begin(), instructions.end(), this);
+    if (position + 2 != instructions.end())
+        return false;
+    const IrInstruction *value = type != IrType::Void ? this : nullptr;
+    IrBlock *current = block;
+    set<IrBlock*> visited;
+    while (visited.insert(current).second) {
+        IrInstruction *terminator = current->GetTerminator();
+        if (terminator->GetOp() == IrOp::Return)
+            return terminator->GetOperands().empty() ? value == nullptr : terminator->GetOperand(0) == value;
+        if (terminator->GetOp() != IrOp::Jump)
+            return false;
+        IrBlock *next = terminator->GetTargets()[0];
+        if (next->GetPhis().size() + 1 != next->GetInstructions().size())
+            return false;
+        for (const auto &phi: next->GetPhis())
+            for (int i = 0; i < phi->GetTargets().size(); i++)
+                if (phi->GetTargets()[i] == current && phi->GetOperand(i) == value && value != nullptr)
+                    value = phi;
+        current = next;
+    }
+    return false;
+}
+
+// Pointers that may lead into the caller's frame keep the frame alive until the call returns.
+bool IrInstruction::PassesFrameAddress() const {
+    for (const auto &operand: operands) {
+        const IrInstruction *pointer = operand;
+        while (pointer->GetOp() == IrOp::Index)
+            pointer = pointer->GetOperand(0);
+        if (operand->GetType() == IrType::Pointer && pointer->GetOp() != IrOp::Param &&
+                pointer->GetOp() != IrOp::GlobalAddr)
+            return true;
+    }
+    return false;
+}
+
+void IrInstruction::Print(std::ostream &out) const {
+    out << "    ";
+    if (type != IrType::Void)
+        out << "%" << id << " = ";
+    out << irOpName.at(op);
+    if (op == IrOp::Cmp || op == IrOp::FCmp)
+        out << " " << irConditionName.at(condition);
+    if (op == IrOp::Write)
+        out << " " << irWriteName.at(write);
+    if (type != IrType::Void)
+        out << " " << irTypeName.at(type);
+    if (op == IrOp::Load || op == IrOp::Store || op == IrOp::Copy)
+        out << " " << size;
+    switch (op) {
+        case IrOp::Const: {
+            if (type == IrType::Double) {
+                char text[32];
+                sprintf(text, "%.17g", doubleValue);
+                out << " " << text;
+            } else {
+                out << " " << intValue;
+            }
+            return;
+        }
+        case IrOp::Param: {
+            out << " " << intValue;
+            return;
+        }
+        case IrOp::SlotAddr: {
+            out << " s" << intValue;
+            return;
+        }
+        case IrOp::GlobalAddr: {
+            out << " " << name;
+            return;
+        }
+        case IrOp::Call: {
+            out << " " << name << "(";
+            for (int i = 0; i < operands.size(); i++)
+                out << (i == 0 ? "" : ", ") << "%" << operands[i]->GetId();
+            out << ")";
+            return;
+        }
+        case IrOp::Phi: {
+            for (int i = 0; i < operands.size(); i++)
+                out << (i == 0 ? " " : ", ") << "[%" << operands[i]->GetId() << ", b" << targets[i]->GetId() << "]";
+            return;
+        }
+        default: {
+            break;
+        }
+    }
+    for (int i = 0; i < operands.size(); i++)
+        out << (i == 0 ? " " : ", ") << "%" << operands[i]->GetId();
+    for (int i = 0; i < targets.size(); i++)
+        out << (i == 0 && operands.empty() ? " " : ", ") << "b" << targets[i]->GetId();
+    if (op == IrOp::Index)
+        out << ", " << size << ", " << intValue;
+}
+
+IrBlock::IrBlock(int id) : id(id) {}
+
+int IrBlock::GetId() const {
+    return id;
+}
+
+void IrBlock::SetId(int id) {
+    this->id = id;
+}
+
+std::vector<IrInstruction*> &IrBlock::GetInstructions() {
+    return instructions;
+}
+
+IrInstruction *IrBlock::GetTerminator() const {
+    if (instructions.empty() || !instructions.back()->IsTerminator())
+        return nullptr;
+    return instructions.back();
+}
+
+std::vector<IrBlock*> IrBlock::GetSuccessors() const {
+    IrInstruction *terminator = GetTerminator();
+    if (terminator == nullptr)
+        return {};
+    return terminator->GetTargets();
+}
+
+std::vector<IrBlock*> &IrBlock::GetPredecessors() {
+    return predecessors;
+}
+
+std::vector<IrInstruction*> IrBlock::GetPhis() const {
+    vector<IrInstruction*> phis;
+    for (const auto &instruction: instructions) {
+        if (instruction->GetOp() != IrOp::Phi)
+            break;
+        phis.push_back(instruction);
+    }
+    return phis;
+}
+
+void IrBlock::Append(IrInstruction *instruction) {
+    instruction->SetBlock(this);
+    instructions.push_back(instruction);
+}
+
+void IrBlock::Insert(int index, IrInstruction *instruction) {
+    instruction->SetBlock(this);
+    instructions.insert(instructions.begin() + index, instruction);
+}
+
+void IrBlock::InsertBeforeTerminator(IrInstruction *instruction) {
+    Insert(instructions.size() - (GetTerminator() != nullptr ? 1 : 0), instruction);
+}
+
+void IrBlock::InsertAfterPhis(IrInstruction *instruction) {
+    Insert(GetPhis().size(), instruction);
+}
+
+void IrBlock::Remove(IrInstruction *instruction) {
+    instructions.erase(find(instructions.begin(), instructions.end(), instruction));
+}
+
+void IrBlock::RemovePhiIncoming(IrBlock *predecessor) {
+    for (const auto &phi: GetPhis()) {
+        for (int i = phi->GetTargets().size() - 1; i >= 0; i--) {
+            if (phi->GetTargets()[i] == predecessor) {
+                phi->RemoveOperand(i);
+                phi->RemoveTarget(i);
+            }
+        }
+    }
+}
+
+void IrBlock::ReplaceSuccessor(IrBlock *from, IrBlock *to) {
+    IrInstruction *terminator = GetTerminator();
+    for (int i = 0; i < terminator->GetTargets().size(); i++)
+        if (terminator->GetTargets()[i] == from)
+            terminator->SetTarget(i, to);
+}
+
+void IrBlock::Print(std::ostream &out) const {
+    out << "b" << id << ":";
+    if (!predecessors.empty()) {
+        out << "    ; preds";
+        for (const auto &block: predecessors)
+            out << " b" << block->GetId();
+    }
+    out << endl;
+    for (const auto &instruction: instructions) {
+        instruction->Print(out);
+        out << endl;
+    }
+}
+
+IrSlot::IrSlot(int size, int align, std::string name) : size(size), align(align), name(name) {}
+
+int IrSlot::GetSize() const {
+    return size;
+}
+
+int IrSlot::GetAlign() const {
+    return align;
+}
+
+const std::string &IrSlot::GetName() const {
+    return name;
+}
+
+IrFunction::IrFunction(std::string name, IrType returnType, bool exported) :
+        name(name), returnType(returnType), exported(exported) {}
+
+const std::string &IrFunction::GetName() const {
+    return name;
+}
+
+IrType IrFunction::GetReturnType() const {
+    return returnType;
+}
+
+bool IrFunction::IsExported() const {
+    return exported;
+}
+
+const std::vector<IrType> &IrFunction::GetParamTypes() const {
+    return paramTypes;
+}
+
+void IrFunction::AddParamType(IrType type) {
+    paramTypes.push_back(type);
+}
+
+const std::vector<IrSlot> &IrFunction::GetSlots() const {
+    return slots;
+}
+
+int IrFunction::AddSlot(int size, int align, std::string name) {
+    slots.push_back(IrSlot(size, align, name));
+    return slots.size() - 1;
+}
+
+std::vector<IrBlock*> IrFunction::GetBlocks() const {
+    vector<IrBlock*> result;
+    for (const auto &block: blocks)
+        result.push_back(block.get());
+    return result;
+}
+
+IrBlock *IrFunction::GetEntry() const {
+    return blocks.front().get();
+}
+
+IrBlock *IrFunction::NewBlock() {
+    blocks.push_back(unique_ptr<IrBlock>(new IrBlock(blockCount++)));
+    return blocks.back().get();
+}
+
+void IrFunction::MoveBlockToEnd(IrBlock *block) {
+    for (auto it = blocks.begin(); it != blocks.end(); it++) {
+        if (it->get() == block) {
+            unique_ptr<IrBlock> moved = move(*it);
+            blocks.erase(it);
+            blocks.push_back(move(moved));
+            return;
+        }
+    }
+}
+
+void IrFunction::MoveBlockAfter(IrBlock *block, IrBlock *after) {
+    auto it = find_if(blocks.begin(), blocks.end(), [&](const unique_ptr<IrBlock> &current) {
+        return current.get() == block;
+    });
+    unique_ptr<IrBlock> moved = move(*it);
+    blocks.erase(it);
+    it = find_if(blocks.begin(), blocks.end(), [&](const unique_ptr<IrBlock> &current) {
+        return current.get() == after;
+    });
+    blocks.insert(it + 1, move(moved));
+}
+
+IrInstruction *IrFunction::NewInstruction(IrOp op, IrType type, std::vector<IrInstruction*> operands) {
+    pool.push_back(unique_ptr<IrInstruction>(new IrInstruction(op, type, operands)));
+    return pool.back().get();
+}
+
+void IrFunction::RemoveBlock(IrBlock *block) {
+    RemoveBlocks({ block });
+}
+
+// Phi incoming values are only dropped in surviving successors, so removing several blocks
+// that branch to each other never touches one that is already gone.
+void IrFunction::RemoveBlocks(const std::set<IrBlock*> &removed) {
+    for (const auto &block: removed)
+        for (const auto &successor: block->GetSuccessors())
+            if (removed.find(successor) == removed.end())
+                successor->RemovePhiIncoming(block);
+    blocks.erase(remove_if(blocks.begin(), blocks.end(), [&](const unique_ptr<IrBlock> &block) {
+        return removed.find(block.get()) != removed.end();
+    }), blocks.end());
+}
+
+void IrFunction::RemoveUnreachableBlocks() {
+    set<IrBlock*> reachable;
+    vector<IrBlock*> work = { GetEntry() };
+    while (!work.empty()) {
+        IrBlock *block = work.back();
+        work.pop_back();
+        if (!reachable.insert(block).second)
+            continue;
+        for (const auto &successor: block->GetSuccessors())
+            work.push_back(successor);
+    }
+    set<IrBlock*> removed;
+    for (const auto &block: GetBlocks())
+        if (reachable.find(block) == reachable.end())
+            removed.insert(block);
+    RemoveBlocks(removed);
+    ComputePredecessors();
+}
+
+void IrFunction::ReplaceAllUses(IrInstruction *from, IrInstruction *to) {
+    for (const auto &block: blocks)
+        for (const auto &instruction: block->GetInstructions())
+            for (int i = 0; i < instruction->GetOperands().size(); i++)
+                if (instruction->GetOperand(i) == from)
+                    instruction->SetOperand(i, to);
+}
+
+bool IrFunction::RemoveTrivialPhis() {
+    bool changed = false, removed = true;
+    while (removed) {
+        removed = false;
+        for (const auto &block: blocks) {
+            for (const auto &phi: block->GetPhis()) {
+                IrInstruction *same = nullptr;
+                bool trivial = true;
+                for (const auto &operand: phi->GetOperands()) {
+                    if (operand == phi || operand == same)
+                        continue;
+                    if (same != nullptr)
+                        trivial = false;
+                    same = operand;
+                }
+                if (!trivial || same == nullptr)
+                    continue;
+                ReplaceAllUses(phi, same);
+                block->Remove(phi);
+                removed = changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+// A block that only jumps to a block with no other predecessor is joined with it.
+bool IrFunction::MergeBlocks() {
+    ComputePredecessors();
+    set<IrBlock*> removed;
+    for (const auto &block: GetBlocks()) {
+        if (removed.find(block) != removed.end())
+            continue;
+        IrInstruction *terminator = block->GetTerminator();
+        while (terminator != nullptr && terminator->GetOp() == IrOp::Jump) {
+            IrBlock *next = terminator->GetTargets()[0];
+            if (next == block || next == GetEntry() || next->GetPredecessors().size() != 1 || !next->GetPhis().empty())
+                break;
+            block->Remove(terminator);
+            for (const auto &instruction: next->GetInstructions())
+                block->Append(instruction);
+            next->GetInstructions().clear();
+            for (const auto &successor: block->GetSuccessors()) {
+                for (const auto &phi: successor->GetPhis())
+                    for (int i = 0; i < phi->GetTargets().size(); i++)
+                        if (phi->GetTargets()[i] == next)
+                            phi->SetTarget(i, block);
+                replace(successor->GetPredecessors().begin(), successor->GetPredecessors().end(), next, block);
+            }
+            removed.insert(next);
+            terminator = block->GetTerminator();
+        }
+    }
+    blocks.erase(remove_if(blocks.begin(), blocks.end(), [&](const unique_ptr<IrBlock> &block) {
+        return removed.find(block.get()) != removed.end();
+    }), blocks.end());
+    ComputePredecessors();
+    return !removed.empty();
+}
+
+std::vector<IrInstruction*> IrFunction::GetUsers(IrInstruction *value) const {
+    vector<IrInstruction*> users;
+    for (const auto &block: blocks)
+        for (const auto &instruction: block->GetInstructions())
+            if (find(instruction->GetOperands().begin(), instruction->GetOperands().end(), value) !=
+                    instruction->GetOperands().end())
+                users.push_back(instruction);
+    return users;
+}
+
+void IrFunction::ComputePredecessors() {
+    for (const auto &block: blocks)
+        block->GetPredecessors().clear();
+    for (const auto &block: blocks) {
+        for (const auto &successor: block->GetSuccessors()) {
+            vector<IrBlock*> &predecessors = successor->GetPredecessors();
+            if (find(predecessors.begin(), predecessors.end(), block.get()) == predecessors.end())
+                predecessors.push_back(block.get());
+        }
+    }
+}
+
+IrBlock *IrFunction::SplitEdge(IrBlock *from, IrBlock *to) {
+    blocks.push_back(unique_ptr<IrBlock>(new IrBlock(blockCount++)));
+    unique_ptr<IrBlock> split = move(blocks.back());
+    blocks.pop_back();
+    IrBlock *block = split.get();
+    for (auto it = blocks.begin(); it != blocks.end(); it++) {
+        if (it->get() == to) {
+            blocks.insert(it, move(split));
+            break;
+        }
+    }
+    IrInstruction *jump = NewInstruction(IrOp::Jump, IrType::Void);
+    jump->AddTarget(to);
+    block->Append(jump);
+    from->ReplaceSuccessor(to, block);
+    for (const auto &phi: to->GetPhis())
+        for (int i = 0; i < phi->GetTargets().size(); i++)
+            if (phi->GetTargets()[i] == from)
+                phi->SetTarget(i, block);
+    ComputePredecessors();
+    return block;
+}
+
+IrBlock *IrFunction::InsertPreheader(IrBlock *header, const std::set<IrBlock*> &loop) {
+    vector<IrBlock*> outside;
+    for (const auto &predecessor: header->GetPredecessors())
+        if (loop.find(predecessor) == loop.end())
+            outside.push_back(predecessor);
+    if (outside.empty())
+        return nullptr;
+    if (outside.size() == 1 && outside[0]->GetSuccessors().size() == 1)
+        return outside[0];
+    if (outside.size() == 1)
+        return SplitEdge(outside[0], header);
+    IrBlock *preheader = SplitEdge(outside[0], header);
+    for (const auto &phi: header->GetPhis()) {
+        IrInstruction *merge = NewInstruction(IrOp::Phi, phi->GetType());
+        for (int i = phi->GetTargets().size() - 1; i >= 0; i--) {
+            IrBlock *target = phi->GetTargets()[i];
+            if (target != preheader && find(outside.begin(), outside.end(), target) == outside.end())
+                continue;
+            merge->AddOperand(phi->GetOperand(i));
+            merge->AddTarget(target == preheader ? outside[0] : target);
+            phi->RemoveOperand(i);
+            phi->RemoveTarget(i);
+        }
+        preheader->Insert(0, merge);
+        phi->AddOperand(merge);
+        phi->AddTarget(preheader);
+    }
+    for (int i = 1; i < outside.size(); i++)
+        outside[i]->ReplaceSuccessor(header, preheader);
+    ComputePredecessors();
+    return preheader;
+}
+
+void IrFunction::SplitCriticalEdges() {
+    ComputePredecessors();
+    for (const auto &block: GetBlocks()) {
+        vector<IrBlock*> successors = block->GetSuccessors();
+        if (successors.size() < 2)
+            continue;
+        for (const auto &successor: successors)
+            if (successor->GetPredecessors().size() > 1)
+                SplitEdge(block, successor);
+    }
+}
+
+void IrFunction::Renumber() {
+    int id = 0, blockId = 0;
+    for (const auto &block: blocks)
+        block->SetId(blockId++);
+    for (const auto &block: blocks)
+        for (const auto &instruction: block->GetInstructions())
+            instruction->SetId(id++);
+}
+
+void IrFunction::Print(std::ostream &out) {
+    Renumber();
+    out << "function " << name << "(";
+    for (int i = 0; i < paramTypes.size(); i++)
+        out << (i == 0 ? "" : ", ") << irTypeName.at(paramTypes[i]);
+    out << "): " << irTypeName.at(returnType) << endl;
+    for (int i = 0; i < slots.size(); i++)
+        out << "    s" << i << ": " << slots[i].GetSize() << " align " << slots[i].GetAlign() << " ; "
+            << slots[i].GetName() << endl;
+    for (const auto &block: blocks)
+        block->Print(out);
+    out << endl;
+}
+
+IrGlobal::IrGlobal(std::string name, std::vector<unsigned char> bytes, int align, bool readOnly) :
+        name(name), bytes(bytes), align(align), readOnly(readOnly) {}
+
+const std::string &IrGlobal::GetName() const {
+    return name;
+}
+
+const std::vector<unsigned char> &IrGlobal::GetBytes() const {
+    return bytes;
+}
+
+int IrGlobal::GetAlign() const {
+    return align;
+}
+
+bool IrGlobal::IsReadOnly() const {
+    return readOnly;
+}
+
+const std::vector<IrGlobal> &IrModule::GetGlobals() const {
+    return globals;
+}
+
+void IrModule::AddGlobal(IrGlobal global) {
+    globals.push_back(global);
+}
+
+std::string IrModule::AddString(const std::string &value) {
+    auto string = strings.find(value);
+    if (string != strings.end())
+        return string->second;
+    std::string label = ".LS" + to_string(strings.size());
+    vector<unsigned char> bytes(value.begin(), value.end());
+    bytes.push_back(0);
+    globals.push_back(IrGlobal(label, bytes, 1, true));
+    strings[value] = label;
+    return label;
+}
+
+const std::vector<PIrFunction> &IrModule::GetFunctions() const {
+    return functions;
+}
+
+void IrModule::AddFunction(PIrFunction function) {
+    functions.push_back(function);
+}
+
+PIrFunction IrModule::FindFunction(const std::string &name) const {
+    for (const auto &function: functions)
+        if (function->GetName() == name)
+            return function;
+    return nullptr;
+}
+
+void IrModule::Print(std::ostream &out) {
+    for (const auto &global: globals)
+        out << "global " << global.GetName() << ": " << global.GetBytes().size() << " align " << global.GetAlign()
+            << (global.IsReadOnly() ? " readonly" : "") << endl;
+    if (!globals.empty())
+        out << endl;
+    for (const auto &function: functions)
+        function->Print(out);
+}
@@ -0,0 +1,1003 @@
+#include <cstring>
+#include <algorithm>
+#include "IrBuilder.h"
+#include "Evaluate.h"
+#include "Error.h"
+
+using namespace std;
+
+static const map<State, IrOp> irIntOp = {
+        { Plus,                   IrOp::Add },
+        { Minus,                  IrOp::Sub },
+        { Asterisk,               IrOp::Mul },
+        { Div,                    IrOp::Div },
+        { Mod,                    IrOp::Mod },
+        { And,                    IrOp::And },
+        { Or,                     IrOp::Or  },
+        { Xor,                    IrOp::Xor },
+        { Shl,                    IrOp::Shl },
+        { LessThanLessThan,       IrOp::Shl },
+        { Shr,                    IrOp::Shr },
+        { GreaterThanGreaterThan, IrOp::Shr }
+};
+
+static const map<State, IrOp> irDoubleOp = {
+        { Plus,     IrOp::FAdd },
+        { Minus,    IrOp::FSub },
+        { Asterisk, IrOp::FMul },
+        { Slash,    IrOp::FDiv }
+};
+
+static const map<State, IrCondition> irRelationalOp = {
+        { Equal,               IrCondition::Eq },
+        { LessThanGreaterThan, IrCondition::Ne },
+        { LessThan,            IrCondition::Lt },
+        { GreaterThan,         IrCondition::Gt },
+        { LessThanEqual,       IrCondition::Le },
+        { GreaterThanEqual,    IrCondition::Ge }
+};
+
+static const map<State, State> irAssignmentOp = {
+        { PlusEqual,     Plus     },
+        { MinusEqual,    Minus    },
+        { AsteriskEqual, Asterisk },
+        { SlashEqual,    Slash    }
+};
+
+IrBuilder::IrBuilder(PNode tree, PSymbolTableStack tableStack, int unrollFactor) :
+        tree(tree), tableStack(tableStack), module(new IrModule()), block(nullptr), labelCount(0),
+        unrollFactor(unrollFactor) {
+    Run();
+}
+
+void IrBuilder::Run() {
+    PSymbolTable globals = tableStack->Top();
+    callGraph = PCallGraph(new CallGraph(tree, globals));
+    if (callGraph->GetRemovedCount() > 0)
+        log.push_back("callgraph: " + to_string(callGraph->GetRemovedCount()) + " of " +
+                      to_string(callGraph->GetProcedureCount()) + " procedures unreachable, " +
+                      to_string(callGraph->GetRemovedSize()) + " nodes removed");
+    CollectLabels(globals);
+    LowerGlobals(globals);
+    LowerProcedures(globals);
+    LowerMain();
+}
+
+const PIrModule IrBuilder::GetModule() const {
+    return module;
+}
+
+const std::vector<std::string> &IrBuilder::GetLog() const {
+    return log;
+}
+
+void IrBuilder::CollectLabels(PSymbolTable table) {
+    for (const auto &symbol: table->GetSymbols()) {
+        SymType symType = symbol->GetSymType();
+        if (symType == SymType::Procedure || symType == SymType::Function) {
+            labels[symbol.get()] = "P_" + symbol->GetName() + "_" + to_string(labelCount++);
+            CollectLabels(dynamic_pointer_cast<SymbolProcedure>(symbol)->GetLocals());
+        }
+    }
+}
+
+void IrBuilder::LowerGlobals(PSymbolTable table) {
+    for (const auto &symbol: table->GetSymbols()) {
+        if (symbol->GetSymType() != SymType::Var)
+            continue;
+        string label = "G_" + symbol->GetName();
+        labels[symbol.get()] = label;
+        any value = dynamic_pointer_cast<SymbolVar>(symbol)->GetValue();
+        module->AddGlobal(IrGlobal(label, GetInitBytes(symbol->GetType(), value), slotSize, false));
+    }
+}
+
+void IrBuilder::LowerProcedures(PSymbolTable table) {
+    for (const auto &symbol: table->GetSymbols()) {
+        SymType symType = symbol->GetSymType();
+        if (symType == SymType::Procedure || symType == SymType::Function) {
+            PSymbolProcedure proc = dynamic_pointer_cast<SymbolProcedure>(symbol);
+            LowerProcedures(proc->GetLocals());
+            if (callGraph->IsReachable(proc.get()))
+                LowerProcedure(proc);
+        }
+    }
+}
+
+void IrBuilder::BeginFunction(std::string name, IrType returnType, bool exported) {
+    function = PIrFunction(new IrFunction(name, returnType, exported));
+    slots.clear();
+    openArrays.clear();
+    variables.clear();
+    definitions.clear();
+    incompletePhis.clear();
+    sealedBlocks.clear();
+    block = NewBlock();
+    SealBlock(block);
+}
+
+void IrBuilder::EndFunction() {
+    function->ComputePredecessors();
+    function->RemoveTrivialPhis();
+    module->AddFunction(function);
+    function = nullptr;
+    block = nullptr;
+}
+
+void IrBuilder::LowerProcedure(PSymbolProcedure symbol) {
+    procedure = symbol;
+    PSymbolProcHeader header = dynamic_pointer_cast<SymbolProcHeader>(symbol->GetType());
+    IrType returnType = IrType::Void;
+    if (symbol->GetSymType() == SymType::Function) {
+        returnType = GetIrType(header->GetReturnType());
+        if (returnType == IrType::Void)
+            throw NotSupported(*symbol->GetBody()->GetToken(), "function result of type " +
+                               header->GetReturnType()->GetTypeName());
+    }
+    BeginFunction(labels.at(symbol.get()), returnType);
+    LowerArguments(header);
+    LowerLocals(symbol->GetLocals());
+    if (returnType != IrType::Void) {
+        variables[symbol.get()] = returnType;
+        WriteVariable(symbol.get(), block, returnType == IrType::Double ? EmitConst(0.0) : EmitConst(returnType, 0));
+    }
+    LowerStatement(symbol->GetBody());
+    if (returnType != IrType::Void)
+        Emit(IrOp::Return, IrType::Void, { ReadVariable(symbol.get(), block) });
+    else
+        Emit(IrOp::Return, IrType::Void);
+    EndFunction();
+    procedure = nullptr;
+}
+
+void IrBuilder::LowerArguments(PSymbolProcHeader header) {
+    vector<pair<IrInstruction*, Symbol*>> copies;
+    auto param = [&](IrType type) {
+        IrInstruction *value = Emit(IrOp::Param, type);
+        value->SetInt(function->GetParamTypes().size());
+        function->AddParamType(type);
+        return value;
+    };
+    for (const auto &arg: header->GetArgs()->GetSymbols()) {
+        PSymbolBase type = arg->GetType();
+        if (type->GetSymType() == SymType::OpenArray) {
+            IrInstruction *pointer = param(IrType::Pointer);
+            openArrays[arg.get()] = { pointer, param(IrType::Int) };
+        } else if (IsAggregate(type)) {
+            slots[arg.get()] = function->AddSlot(GetSize(type), slotSize, arg->GetName());
+            copies.push_back({ param(IrType::Pointer), arg.get() });
+        } else if (GetIrType(type) != IrType::Void) {
+            variables[arg.get()] = GetIrType(type);
+            WriteVariable(arg.get(), block, param(GetIrType(type)));
+        }
+    }
+    for (const auto &copy: copies) {
+        IrInstruction *slot = Emit(IrOp::SlotAddr, IrType::Pointer);
+        slot->SetInt(slots.at(copy.second));
+        Emit(IrOp::Copy, IrType::Void, { slot, copy.first })->SetSize(function->GetSlots()[slot->GetInt()].GetSize());
+    }
+}
+
+void IrBuilder::LowerLocals(PSymbolTable locals) {
+    for (const auto &symbol: locals->GetSymbols()) {
+        if (symbol->GetSymType() != SymType::Var)
+            continue;
+        PSymbolBase type = symbol->GetType();
+        if (IsAggregate(type)) {
+            slots[symbol.get()] = function->AddSlot(GetSize(type), slotSize, symbol->GetName());
+            continue;
+        }
+        PromoteVariable(symbol);
+    }
+}
+
+void IrBuilder::PromoteVariable(PSymbolComplex symbol) {
+    PSymbolBase type = symbol->GetType();
+    IrType irType = GetIrType(type);
+    if (irType == IrType::Void)
+        return;
+    vector<unsigned char> bytes = GetInitBytes(type, dynamic_pointer_cast<SymbolVar>(symbol)->GetValue());
+    IrInstruction *value;
+    if (irType == IrType::Double) {
+        double number;
+        memcpy(&number, bytes.data(), sizeof(number));
+        value = EmitConst(number);
+    } else {
+        int number = 0;
+        memcpy(&number, bytes.data(), min(bytes.size(), sizeof(number)));
+        value = EmitConst(irType, irType == IrType::Int ? number : 0);
+    }
+    variables[symbol.get()] = irType;
+    WriteVariable(symbol.get(), block, value);
+}
+
+// Scalar globals that no procedure touches can only be seen by the main program, so it keeps
+// them in SSA values like locals; their storage is still emitted but never read.
+void IrBuilder::LowerMain() {
+    BeginFunction("main", IrType::Int, true);
+    for (const auto &symbol: tableStack->Top()->GetSymbols())
+        if (symbol->GetSymType() == SymType::Var && !IsAggregate(symbol->GetType()) &&
+                sharedGlobals.find(symbol.get()) == sharedGlobals.end())
+            PromoteVariable(symbol);
+    LowerStatement(tree);
+    Emit(IrOp::Return, IrType::Void, { EmitConst(IrType::Int, 0) });
+    EndFunction();
+}
+
+void IrBuilder::LowerStatement(PNode node) {
+    switch (node->GetNodeType()) {
+        case NodeType::NodeCompoundStatement: {
+            LowerCompoundStatement(dynamic_pointer_cast<NodeCompoundStatement>(node));
+            break;
+        }
+        case NodeType::NodeAssignmentOp: {
+            LowerAssignment(dynamic_pointer_cast<NodeAssignmentOp>(node));
+            break;
+        }
+        case NodeType::NodeIfStatement: {
+            LowerIfStatement(dynamic_pointer_cast<NodeIfStatement>(node));
+            break;
+        }
+        case NodeType::NodeForStatement: {
+            LowerForStatement(dynamic_pointer_cast<NodeForStatement>(node));
+            break;
+        }
+        case NodeType::NodeWhileStatement: {
+            LowerWhileStatement(dynamic_pointer_cast<NodeWhileStatement>(node));
+            break;
+        }
+        case NodeType::NodeRepeatStatement: {
+            LowerRepeatStatement(dynamic_pointer_cast<NodeRepeatStatement>(node));
+            break;
+        }
+        case NodeType::NodeWriteStatement: {
+            LowerWriteStatement(dynamic_pointer_cast<NodeWriteStatement>(node));
+            break;
+        }
+        case NodeType::NodeParentehsiss: {
+            PNodeParenthesiss call = dynamic_pointer_cast<NodeParenthesiss>(node);
+            LowerCall(call->GetName(), call->GetParameters());
+            break;
+        }
+        case NodeType::NodeValue: {
+            LowerCall(dynamic_pointer_cast<NodeOp>(node), {});
+            break;
+        }
+        default: {
+            throw NotSupported(*node->GetToken(), "statement");
+        }
+    }
+}
+
+void IrBuilder::LowerCompoundStatement(PNodeCompoundStatement node) {
+    for (const auto &statement: node->GetStatements())
+        LowerStatement(statement);
+}
+
+void IrBuilder::LowerAssignment(PNodeAssignmentOp node) {
+    PNodeOp left = node->GetLeft();
+    PNodeOp right = node->GetRight();
+    PSymbolBase type = left->GetType();
+    State op = node->GetToken()->GetState();
+    Symbol *variable = GetVariable(left);
+    if (IsAggregate(type)) {
+        IrInstruction *dest = LowerAddress(left);
+        Emit(IrOp::Copy, IrType::Void, { dest, LowerExpression(right) })->SetSize(GetSize(type));
+        return;
+    }
+    IrType irType = GetIrType(type);
+    IrInstruction *address = variable == nullptr ? LowerAddress(left) : nullptr;
+    IrInstruction *value = LowerExpression(right);
+    if (op != ColonEqual) {
+        IrInstruction *current = variable != nullptr ? ReadVariable(variable, block) :
+                                 EmitLoad(irType, GetMemorySize(type), address);
+        State binOp = irAssignmentOp.at(op);
+        if (irType == IrType::Double) {
+            value = Emit(irDoubleOp.at(binOp), IrType::Double, { current, Convert(value, IrType::Double) });
+        } else {
+            value = Emit(irIntOp.at(binOp), IrType::Int, { current, value });
+        }
+    } else {
+        value = Convert(value, irType);
+    }
+    if (variable != nullptr)
+        WriteVariable(variable, block, value);
+    else
+        EmitStore(GetMemorySize(type), address, value);
+}
+
+void IrBuilder::LowerIfStatement(PNodeIfStatement node) {
+    IrInstruction *condition = LowerExpression(node->GetIfNode());
+    IrBlock *thenBlock = NewBlock();
+    IrBlock *elseBlock = node->GetElseNode() != nullptr ? NewBlock() : nullptr;
+    IrBlock *endBlock = NewBlock();
+    EmitBranch(condition, thenBlock, elseBlock != nullptr ? elseBlock : endBlock);
+    SealBlock(thenBlock);
+    StartBlock(thenBlock);
+    LowerStatement(node->GetThenNode());
+    EmitJump(endBlock);
+    if (elseBlock != nullptr) {
+        SealBlock(elseBlock);
+        StartBlock(elseBlock);
+        LowerStatement(node->GetElseNode());
+        EmitJump(endBlock);
+    }
+    SealBlock(endBlock);
+    StartBlock(endBlock);
+}
+
+// A loop over constant bounds whose body neither loops nor assigns the control variable is
+// unrolled: up to unrollFactor iterations are copied out completely, longer loops run
+// unrollFactor copies of the body per iteration and leave the rest to an ordinary loop.
+void IrBuilder::LowerForStatement(PNodeForStatement node) {
+    PNodeAssignmentOp controlVar = node->GetControlVar();
+    Symbol *variable = GetVariable(controlVar->GetLeft());
+    bool downto = node->GetToType().GetState() == Downto;
+    LowerAssignment(controlVar);
+    IrInstruction *finalValue = LowerExpression(node->GetFinalVar());
+    long long first, last;
+    if (unrollFactor < 2 || variable == nullptr || !GetConstant(ReadVariable(variable, block), first) ||
+            !GetConstant(finalValue, last) || !IsUnrollable(node->GetDoSt(), variable)) {
+        LowerCountedLoop(node, finalValue);
+        return;
+    }
+    long long count = (downto ? first - last : last - first) + 1;
+    string position = "(" + to_string(node->GetToken()->GetLine()) + "," + to_string(node->GetToken()->GetColumn()) + ")";
+    if (count <= 0) {
+        LowerCountedLoop(node, finalValue);
+    } else if (count <= unrollFactor) {
+        for (long long i = 0; i < count; i++) {
+            WriteVariable(variable, block, EmitConst(IrType::Int, downto ? first - i : first + i));
+            LowerStatement(node->GetDoSt());
+        }
+        log.push_back(position + " for loop: " + to_string(count) + " iterations fully unrolled");
+    } else {
+        long long remainder = count % unrollFactor;
+        LowerUnrolledLoop(node, variable, first, count - remainder);
+        if (remainder != 0) {
+            long long next = downto ? first - (count - remainder) : first + (count - remainder);
+            WriteVariable(variable, block, EmitConst(IrType::Int, next));
+            LowerCountedLoop(node, finalValue);
+        }
+        log.push_back(position + " for loop: " + to_string(count) + " iterations unrolled by " +
+                      to_string(unrollFactor) + ", " + to_string(remainder) + " in remainder loop");
+    }
+}
+
+void IrBuilder::LowerCountedLoop(PNodeForStatement node, IrInstruction *finalValue) {
+    PNodeOp left = node->GetControlVar()->GetLeft();
+    bool downto = node->GetToType().GetState() == Downto;
+    IrBlock *bodyBlock = NewBlock();
+    IrBlock *stepBlock = NewBlock();
+    IrBlock *endBlock = NewBlock();
+    IrInstruction *enter = Emit(IrOp::Cmp, IrType::Int, { LowerExpression(left), finalValue });
+    enter->SetCondition(downto ? IrCondition::Ge : IrCondition::Le);
+    EmitBranch(enter, bodyBlock, endBlock);
+    StartBlock(bodyBlock);
+    LowerStatement(node->GetDoSt());
+    IrInstruction *done = Emit(IrOp::Cmp, IrType::Int, { LowerExpression(left), finalValue });
+    done->SetCondition(IrCondition::Eq);
+    EmitBranch(done, endBlock, stepBlock);
+    SealBlock(stepBlock);
+    StartBlock(stepBlock);
+    Symbol *variable = GetVariable(left);
+    IrInstruction *address = variable == nullptr ? LowerAddress(left) : nullptr;
+    IrInstruction *current = variable != nullptr ? ReadVariable(variable, block) :
+                             EmitLoad(IrType::Int, GetMemorySize(left->GetType()), address);
+    IrInstruction *next = Emit(downto ? IrOp::Sub : IrOp::Add, IrType::Int, { current, EmitConst(IrType::Int, 1) });
+    if (variable != nullptr)
+        WriteVariable(variable, block, next);
+    else
+        EmitStore(GetMemorySize(left->GetType()), address, next);
+    EmitJump(bodyBlock);
+    SealBlock(bodyBlock);
+    SealBlock(endBlock);
+    StartBlock(endBlock);
+}
+
+// Runs count iterations, a multiple of unrollFactor, as count / unrollFactor iterations of a
+// loop holding unrollFactor copies of the body.
+void IrBuilder::LowerUnrolledLoop(PNodeForStatement node, Symbol *variable, long long first, long long count) {
+    long long step = node->GetToType().GetState() == Downto ? -1 : 1;
+    IrBlock *bodyBlock = NewBlock();
+    IrBlock *stepBlock = NewBlock();
+    IrBlock *endBlock = NewBlock();
+    EmitJump(bodyBlock);
+    StartBlock(bodyBlock);
+    IrInstruction *base = ReadVariable(variable, block);
+    for (int i = 0; i < unrollFactor; i++) {
+        if (i != 0)
+            WriteVariable(variable, block, Emit(IrOp::Add, IrType::Int, { base, EmitConst(IrType::Int, i * step) }));
+        LowerStatement(node->GetDoSt());
+    }
+    IrInstruction *done = Emit(IrOp::Cmp, IrType::Int, {
+            base, EmitConst(IrType::Int, first + (count - unrollFactor) * step) });
+    done->SetCondition(IrCondition::Eq);
+    EmitBranch(done, endBlock, stepBlock);
+    SealBlock(stepBlock);
+    StartBlock(stepBlock);
+    WriteVariable(variable, block, Emit(IrOp::Add, IrType::Int, { base, EmitConst(IrType::Int, unrollFactor * step) }));
+    EmitJump(bodyBlock);
+    SealBlock(bodyBlock);
+    SealBlock(endBlock);
+    StartBlock(endBlock);
+}
+
+bool IrBuilder::IsUnrollable(PNode node, Symbol *variable) {
+    switch (node->GetNodeType()) {
+        case NodeType::NodeCompoundStatement: {
+            for (const auto &statement: dynamic_pointer_cast<NodeCompoundStatement>(node)->GetStatements())
+                if (!IsUnrollable(statement, variable))
+                    return false;
+            return true;
+        }
+        case NodeType::NodeIfStatement: {
+            PNodeIfStatement statement = dynamic_pointer_cast<NodeIfStatement>(node);
+            return IsUnrollable(statement->GetThenNode(), variable) &&
+                   (statement->GetElseNode() == nullptr || IsUnrollable(statement->GetElseNode(), variable));
+        }
+        case NodeType::NodeAssignmentOp: {
+            return GetVariable(dynamic_pointer_cast<NodeAssignmentOp>(node)->GetLeft()) != variable;
+        }
+        case NodeType::NodeWriteStatement:
+        case NodeType::NodeParentehsiss:
+        case NodeType::NodeValue: {
+            return true;
+        }
+        default: {
+            return false;
+        }
+    }
+}
+
+void IrBuilder::LowerWhileStatement(PNodeWhileStatement node) {
+    IrBlock *headerBlock = NewBlock();
+    IrBlock *bodyBlock = NewBlock();
+    IrBlock *endBlock = NewBlock();
+    EmitJump(headerBlock);
+    StartBlock(headerBlock);
+    EmitBranch(LowerExpression(node->GetCondition()), bodyBlock, endBlock);
+    SealBlock(bodyBlock);
+    StartBlock(bodyBlock);
+    for (const auto &statement: node->GetStatements())
+        LowerStatement(statement);
+    EmitJump(headerBlock);
+    SealBlock(headerBlock);
+    SealBlock(endBlock);
+    StartBlock(endBlock);
+}
+
+void IrBuilder::LowerRepeatStatement(PNodeRepeatStatement node) {
+    IrBlock *bodyBlock = NewBlock();
+    IrBlock *endBlock = NewBlock();
+    EmitJump(bodyBlock);
+    StartBlock(bodyBlock);
+    for (const auto &statement: node->GetStatements())
+        LowerStatement(statement);
+    EmitBranch(LowerExpression(node->GetCondition()), endBlock, bodyBlock);
+    SealBlock(bodyBlock);
+    SealBlock(endBlock);
+    StartBlock(endBlock);
+}
+
+void IrBuilder::LowerWriteStatement(PNodeWriteStatement node) {
+    for (const auto &param: node->GetParameters()) {
+        PSymbolBase type = param->GetType();
+        if (IsType(type, BaseType::Char)) {
+            PNodeValue value = dynamic_pointer_cast<NodeValue>(param);
+            if (value != nullptr && (value->GetToken()->GetType() == TK::String ||
+                    (value->GetSymbol() != nullptr && value->GetSymbol()->GetSymType() == SymType::Const))) {
+                any text = value->GetSymbol() != nullptr ?
+                           dynamic_pointer_cast<SymbolConst>(value->GetSymbol())->GetValue() :
+                           any(value->GetToken()->GetValue());
+                IrInstruction *address = Emit(IrOp::GlobalAddr, IrType::Pointer);
+                address->SetName(module->AddString(any_cast<string>(text)));
+                EmitWrite(IrWrite::String, address);
+            } else {
+                EmitWrite(IrWrite::Char, LowerExpression(param));
+            }
+        } else if (GetIrType(type) == IrType::Double) {
+            EmitWrite(IrWrite::Double, LowerExpression(param));
+        } else if (GetIrType(type) == IrType::Int) {
+            EmitWrite(IrWrite::Int, LowerExpression(param));
+        } else {
+            throw NotSupported(*param->GetToken(), "write of " + param->GetTypeName());
+        }
+    }
+    if (node->IsNewLine())
+        EmitWrite(IrWrite::NewLine);
+}
+
+IrInstruction *IrBuilder::LowerExpression(PNodeOp node) {
+    switch (node->GetNodeType()) {
+        case NodeType::NodeBinOp: {
+            return LowerBinOp(dynamic_pointer_cast<NodeBinOp>(node));
+        }
+        case NodeType::NodeUnOp: {
+            return LowerUnOp(dynamic_pointer_cast<NodeUnOp>(node));
+        }
+        case NodeType::NodeValue: {
+            return LowerValue(dynamic_pointer_cast<NodeValue>(node));
+        }
+        case NodeType::NodeParentehsiss: {
+            PNodeParenthesiss call = dynamic_pointer_cast<NodeParenthesiss>(node);
+            return LowerCall(call->GetName(), call->GetParameters());
+        }
+        case NodeType::NodeBrackets:
+        case NodeType::NodePeriod: {
+            IrInstruction *address = LowerAddress(node);
+            if (IsAggregate(node->GetType()))
+                return address;
+            return EmitLoad(GetIrType(node->GetType()), GetMemorySize(node->GetType()), address);
+        }
+        default: {
+            throw NotSupported(*node->GetToken(), "expression");
+        }
+    }
+}
+
+IrInstruction *IrBuilder::LowerBinOp(PNodeBinOp node) {
+    if (IsType(node->GetLeft()->GetType(), BaseType::Char) || IsType(node->GetRight()->GetType(), BaseType::Char))
+        throw NotSupported(*node->GetToken(), "string concatenation");
+    if (GetIrType(node->GetLeft()->GetType()) == IrType::Double ||
+            GetIrType(node->GetRight()->GetType()) == IrType::Double || node->GetToken()->GetState() == Slash)
+        return LowerDoubleBinOp(node);
+    return LowerIntBinOp(node);
+}
+
+IrInstruction *IrBuilder::LowerDoubleBinOp(PNodeBinOp node) {
+    State op = node->GetToken()->GetState();
+    IrInstruction *left = Convert(LowerExpression(node->GetLeft()), IrType::Double);
+    IrInstruction *right = Convert(LowerExpression(node->GetRight()), IrType::Double);
+    auto arithmetic = irDoubleOp.find(op);
+    if (arithmetic != irDoubleOp.end()) {
+        return Emit(arithmetic->second, IrType::Double, { left, right });
+    }
+    auto relational = irRelationalOp.find(op);
+    if (relational == irRelationalOp.end())
+        throw NotSupported(*node->GetToken(), "operator " + node->GetToken()->GetValue());
+    IrInstruction *value = Emit(IrOp::FCmp, IrType::Int, { left, right });
+    value->SetCondition(relational->second);
+    return value;
+}
+
+IrInstruction *IrBuilder::LowerIntBinOp(PNodeBinOp node) {
+    State op = node->GetToken()->GetState();
+    IrInstruction *left = LowerExpression(node->GetLeft());
+    IrInstruction *right = LowerExpression(node->GetRight());
+    auto arithmetic = irIntOp.find(op);
+    if (arithmetic != irIntOp.end())
+        return Emit(arithmetic->second, IrType::Int, { left, right });
+    auto relational = irRelationalOp.find(op);
+    if (relational == irRelationalOp.end())
+        throw NotSupported(*node->GetToken(), "operator " + node->GetToken()->GetValue());
+    IrInstruction *value = Emit(IrOp::Cmp, IrType::Int, { left, right });
+    value->SetCondition(relational->second);
+    return value;
+}
+
+IrInstruction *IrBuilder::LowerUnOp(PNodeUnOp node) {
+    IrInstruction *value = LowerExpression(node->GetNode());
+    switch (node->GetToken()->GetState()) {
+        case Minus: {
+            if (value->GetType() == IrType::Double)
+                return Emit(IrOp::FNeg, IrType::Double, { value });
+            return Emit(IrOp::Neg, IrType::Int, { value });
+        }
+        case Not: {
+            return Emit(IrOp::Not, IrType::Int, { value });
+        }
+        default: {
+            return value;
+        }
+    }
+}
+
+IrInstruction *IrBuilder::LowerValue(PNodeValue node) {
+    PToken token = node->GetToken();
+    IrType type = GetIrType(node->GetType());
+    any value;
+    if (token->GetType() != TK::Identifier) {
+        value = Evaluate::Calc(token->GetValue(), node->GetTypeName());
+    } else if (node->GetSymbol()->GetSymType() == SymType::Const) {
+        PSymbolConst symbol = dynamic_pointer_cast<SymbolConst>(node->GetSymbol());
+        value = Evaluate::Calc(symbol->GetValue(), symbol->GetTypeName(), node->GetTypeName());
+    } else {
+        Symbol *variable = GetVariable(node);
+        if (variable != nullptr)
+            return ReadVariable(variable, block);
+        if (IsAggregate(node->GetType()))
+            return LowerAddress(node);
+        return EmitLoad(type, GetMemorySize(node->GetType()), LowerAddress(node));
+    }
+    if (IsType(node->GetType(), BaseType::Char)) {
+        string text = any_cast<string>(value);
+        if (text.size() != 1)
+            throw NotSupported(*token, "string value");
+        return EmitConst(IrType::Int, (unsigned char) text[0]);
+    }
+    if (type == IrType::Int)
+        return EmitConst(IrType::Int, any_cast<int>(value));
+    if (type == IrType::Double)
+        return EmitConst(any_cast<double>(value));
+    throw NotSupported(*token, "value of type " + node->GetTypeName());
+}
+
+IrInstruction *IrBuilder::LowerAddress(PNodeOp node) {
+    switch (node->GetNodeType()) {
+        case NodeType::NodeBrackets: {
+            return LowerBrackets(dynamic_pointer_cast<NodeBrackets>(node));
+        }
+        case NodeType::NodePeriod: {
+            return LowerPeriod(dynamic_pointer_cast<NodePeriod>(node));
+        }
+        case NodeType::NodeValue: {
+            PSymbolComplex symbol = dynamic_pointer_cast<NodeValue>(node)->GetSymbol();
+            if (symbol == nullptr)
+                break;
+            auto slot = slots.find(symbol.get());
+            if (slot != slots.end()) {
+                IrInstruction *address = Emit(IrOp::SlotAddr, IrType::Pointer);
+                address->SetInt(slot->second);
+                return address;
+            }
+            auto label = labels.find(symbol.get());
+            if (label != labels.end() && symbol->GetSymType() == SymType::Var) {
+                if (procedure != nullptr)
+                    sharedGlobals.insert(symbol.get());
+                IrInstruction *address = Emit(IrOp::GlobalAddr, IrType::Pointer);
+                address->SetName(label->second);
+                return address;
+            }
+            // Every global of the program has a label; one the stack finds without a label is declared
+            // by a unit.
+            if (symbol->GetSymType() == SymType::Var && tableStack->FindSymbol(symbol->GetName()) == symbol)
+                throw NotSupported(*node->GetToken(), "access to variable of unit");
+            if (symbol->GetSymType() == SymType::Var || symbol->GetSymType() == SymType::ValueParameter)
+                throw NotSupported(*node->GetToken(), "access to variable of enclosing procedure");
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+    throw NotSupported(*node->GetToken(), "address of expression");
+}
+
+// Dimensions of a static array are indexed together: the indices are combined in Horner form
+// into one element number and a single index instruction applies the stride and base offset.
+// Dynamic and open arrays hold a pointer per dimension, which is loaded before indexing further.
+IrInstruction *IrBuilder::LowerBrackets(PNodeBrackets node) {
+    PSymbolBase type = node->GetName()->GetType();
+    IrInstruction *address = IsAggregate(type) ? LowerAddress(node->GetName()) : LowerExpression(node->GetName());
+    const vector<PNodeOp> &parameters = node->GetParameters();
+    for (int i = 0; i < parameters.size();) {
+        PSymbolStaticArray array = dynamic_pointer_cast<SymbolStaticArray>(type);
+        if (array != nullptr) {
+            const ArrayLayout &arrayLayout = layout.GetArrayLayout(array);
+            int rank = min<int>(arrayLayout.GetRank(), parameters.size() - i);
+            address = LowerStaticIndex(node, i, rank, address, arrayLayout);
+            type = arrayLayout.GetType(rank - 1);
+            i += rank;
+            continue;
+        }
+        if (i > 0)
+            address = EmitLoad(IrType::Pointer, slotSize, address);
+        type = dynamic_pointer_cast<SymbolArray>(type)->GetType();
+        address = EmitIndex(address, LowerExpression(parameters[i]), GetSize(type), 0);
+        i++;
+    }
+    return address;
+}
+
+IrInstruction *IrBuilder::LowerStaticIndex(PNodeBrackets node, int first, int rank, IrInstruction *address,
+                                           const ArrayLayout &array) {
+    IrInstruction *element = nullptr;
+    for (int i = 0; i < rank; i++) {
+        IrInstruction *index = LowerExpression(node->GetParameters()[first + i]);
+        if (node->IsRangeChecked())
+            Emit(IrOp::Check, IrType::Void, { index, EmitConst(IrType::Int, array.GetLow(i)),
+                                              EmitConst(IrType::Int, array.GetHigh(i)) });
+        if (element == nullptr)
+            element = index;
+        else if (array.GetExtent(i) == 1)
+            element = Emit(IrOp::Add, IrType::Int, { element, index });
+        else
+            element = Emit(IrOp::Add, IrType::Int, { Emit(IrOp::Mul, IrType::Int, {
+                    element, EmitConst(IrType::Int, array.GetExtent(i)) }), index });
+    }
+    return EmitIndex(address, element, array.GetStride(rank - 1), array.GetBaseOffset(rank));
+}
+
+IrInstruction *IrBuilder::LowerPeriod(PNodePeriod node) {
+    PSymbolRecord record = dynamic_pointer_cast<SymbolRecord>(node->GetName()->GetType());
+    PSymbolBase type;
+    int offset = GetFieldOffset(record, node->GetField().GetValue(), type);
+    IrInstruction *address = LowerAddress(node->GetName());
+    if (offset == 0)
+        return address;
+    return EmitIndex(address, nullptr, 1, offset);
+}
+
+IrInstruction *IrBuilder::LowerCall(PNodeOp name, const std::vector<PNodeOp> &parameters) {
+    PNodeValue value = dynamic_pointer_cast<NodeValue>(name);
+    if (value == nullptr || value->GetSymbol() == nullptr ||
+            dynamic_pointer_cast<SymbolProcedure>(value->GetSymbol()) == nullptr)
+        throw NotSupported(*name->GetToken(), "call");
+    // Every procedure of the program has a label; one without is declared by a unit.
+    if (labels.find(value->GetSymbol().get()) == labels.end())
+        throw NotSupported(*name->GetToken(), "call to procedure of unit");
+    PSymbolProcedure callee = dynamic_pointer_cast<SymbolProcedure>(value->GetSymbol());
+    PSymbolProcHeader header = dynamic_pointer_cast<SymbolProcHeader>(callee->GetType());
+    const vector<PSymbolComplex> &args = header->GetArgs()->GetSymbols();
+    vector<IrInstruction*> operands;
+    for (int i = 0; i < parameters.size(); i++) {
+        PNodeOp param = parameters[i];
+        PSymbolBase argType = args[i]->GetType();
+        if (argType->GetSymType() == SymType::OpenArray) {
+            PSymbolBase paramType = param->GetType();
+            if (IsAggregate(paramType)) {
+                operands.push_back(LowerAddress(param));
+                const ArrayLayout &array = layout.GetArrayLayout(dynamic_pointer_cast<SymbolStaticArray>(paramType));
+                operands.push_back(EmitConst(IrType::Int, array.GetExtent(0) - 1));
+            } else if (paramType->GetSymType() == SymType::OpenArray) {
+                PNodeValue array = dynamic_pointer_cast<NodeValue>(param);
+                auto words = array != nullptr ? openArrays.find(array->GetSymbol().get()) : openArrays.end();
+                if (words == openArrays.end())
+                    throw NotSupported(*param->GetToken(), "access to variable of enclosing procedure");
+                operands.insert(operands.end(), words->second.begin(), words->second.end());
+            } else {
+                operands.push_back(LowerExpression(param));
+                operands.push_back(EmitConst(IrType::Int, -1));
+            }
+        } else if (IsAggregate(argType)) {
+            operands.push_back(LowerAddress(param));
+        } else {
+            operands.push_back(Convert(LowerExpression(param), GetIrType(argType)));
+        }
+    }
+    IrType returnType = IrType::Void;
+    if (callee->GetSymType() == SymType::Function)
+        returnType = GetIrType(header->GetReturnType());
+    IrInstruction *call = Emit(IrOp::Call, returnType, operands);
+    call->SetName(labels.at(callee.get()));
+    return call;
+}
+
+IrInstruction *IrBuilder::Convert(IrInstruction *value, IrType type) {
+    if (value->GetType() == IrType::Int && type == IrType::Double)
+        return Emit(IrOp::IntToDouble, IrType::Double, { value });
+    return value;
+}
+
+Symbol *IrBuilder::GetVariable(PNodeOp node) {
+    PNodeValue value = dynamic_pointer_cast<NodeValue>(node);
+    if (value == nullptr || value->GetSymbol() == nullptr)
+        return nullptr;
+    auto variable = variables.find(value->GetSymbol().get());
+    return variable != variables.end() ? variable->first : nullptr;
+}
+
+// Scalar locals, value parameters and the function result live in SSA values. Definitions are
+// tracked per block and phis are placed on demand while lowering (Braun et al., "Simple and
+// Efficient Construction of Static Single Assignment Form"); a block is sealed once all of its
+// predecessors are known.
+void IrBuilder::WriteVariable(Symbol *variable, IrBlock *target, IrInstruction *value) {
+    definitions[variable][target] = value;
+}
+
+IrInstruction *IrBuilder::ReadVariable(Symbol *variable, IrBlock *target) {
+    auto &blocks = definitions[variable];
+    auto definition = blocks.find(target);
+    if (definition != blocks.end())
+        return definition->second;
+    return ReadVariableRecursive(variable, target);
+}
+
+IrInstruction *IrBuilder::ReadVariableRecursive(Symbol *variable, IrBlock *target) {
+    IrInstruction *value;
+    if (sealedBlocks.find(target) == sealedBlocks.end()) {
+        value = NewPhi(variable, target);
+        incompletePhis[target][variable] = value;
+    } else if (target->GetPredecessors().size() == 1) {
+        value = ReadVariable(variable, target->GetPredecessors()[0]);
+    } else {
+        value = NewPhi(variable, target);
+        WriteVariable(variable, target, value);
+        AddPhiOperands(variable, value);
+    }
+    WriteVariable(variable, target, value);
+    return value;
+}
+
+void IrBuilder::AddPhiOperands(Symbol *variable, IrInstruction *phi) {
+    for (const auto &predecessor: phi->GetBlock()->GetPredecessors()) {
+        phi->AddOperand(ReadVariable(variable, predecessor));
+        phi->AddTarget(predecessor);
+    }
+}
+
+void IrBuilder::SealBlock(IrBlock *target) {
+    for (const auto &phi: incompletePhis[target])
+        AddPhiOperands(phi.first, phi.second);
+    incompletePhis.erase(target);
+    sealedBlocks.insert(target);
+}
+
+IrInstruction *IrBuilder::NewPhi(Symbol *variable, IrBlock *target) {
+    IrInstruction *phi = function->NewInstruction(IrOp::Phi, variables.at(variable));
+    target->Insert(0, phi);
+    return phi;
+}
+
+IrInstruction *IrBuilder::Emit(IrOp op, IrType type, std::vector<IrInstruction*> operands) {
+    IrInstruction *instruction = function->NewInstruction(op, type, operands);
+    block->Append(instruction);
+    return instruction;
+}
+
+IrInstruction *IrBuilder::EmitConst(IrType type, long long value) {
+    IrInstruction *instruction = Emit(IrOp::Const, type);
+    instruction->SetInt(value);
+    return instruction;
+}
+
+IrInstruction *IrBuilder::EmitConst(double value) {
+    IrInstruction *instruction = Emit(IrOp::Const, IrType::Double);
+    instruction->SetDouble(value);
+    return instruction;
+}
+
+IrInstruction *IrBuilder::EmitIndex(IrInstruction *base, IrInstruction *index, int scale, long long disp) {
+    IrInstruction *instruction = Emit(IrOp::Index, IrType::Pointer, { base });
+    if (index != nullptr)
+        instruction->AddOperand(index);
+    instruction->SetSize(scale);
+    instruction->SetInt(disp);
+    return instruction;
+}
+
+IrInstruction *IrBuilder::EmitLoad(IrType type, int size, IrInstruction *address) {
+    IrInstruction *instruction = Emit(IrOp::Load, type, { address });
+    instruction->SetSize(size);
+    return instruction;
+}
+
+void IrBuilder::EmitStore(int size, IrInstruction *address, IrInstruction *value) {
+    Emit(IrOp::Store, IrType::Void, { address, value })->SetSize(size);
+}
+
+void IrBuilder::EmitJump(IrBlock *target) {
+    Emit(IrOp::Jump, IrType::Void)->AddTarget(target);
+    target->GetPredecessors().push_back(block);
+}
+
+void IrBuilder::EmitBranch(IrInstruction *condition, IrBlock *trueTarget, IrBlock *falseTarget) {
+    IrInstruction *branch = Emit(IrOp::Branch, IrType::Void, { condition });
+    branch->AddTarget(trueTarget);
+    branch->AddTarget(falseTarget);
+    trueTarget->GetPredecessors().push_back(block);
+    falseTarget->GetPredecessors().push_back(block);
+}
+
+void IrBuilder::EmitWrite(IrWrite write, IrInstruction *value) {
+    IrInstruction *instruction = Emit(IrOp::Write, IrType::Void);
+    if (value != nullptr)
+        instruction->AddOperand(value);
+    instruction->SetWrite(write);
+}
+
+IrBlock *IrBuilder::NewBlock() {
+    return function->NewBlock();
+}
+
+void IrBuilder::StartBlock(IrBlock *target) {
+    function->MoveBlockToEnd(target);
+    block = target;
+}
+
+IrType IrBuilder::GetIrType(PSymbolBase type) {
+    switch (type->GetSymType()) {
+        case SymType::BaseType: {
+            if (IsType(type, BaseType::Integer) || IsType(type, BaseType::Char))
+                return IrType::Int;
+            if (IsType(type, BaseType::Double))
+                return IrType::Double;
+            return IrType::Void;
+        }
+        case SymType::SubRange: {
+            return IrType::Int;
+        }
+        case SymType::Array: {
+            if (IsAggregate(type))
+                return IrType::Void;
+            return IrType::Pointer;
+        }
+        default: {
+            return IrType::Void;
+        }
+    }
+}
+
+int IrBuilder::GetMemorySize(PSymbolBase type) {
+    if (IsType(type, BaseType::Char))
+        return 1;
+    switch (GetIrType(type)) {
+        case IrType::Int: {
+            return 4;
+        }
+        case IrType::Double:
+        case IrType::Pointer: {
+            return slotSize;
+        }
+        default: {
+            return GetSize(type);
+        }
+    }
+}
+
+int IrBuilder::GetSize(PSymbolBase type) {
+    return layout.GetSize(type);
+}
+
+int IrBuilder::GetFieldOffset(PSymbolRecord record, std::string field, PSymbolBase &type) {
+    transform(field.begin(), field.end(), field.begin(), ::tolower);
+    const RecordLayout &recordLayout = layout.GetRecordLayout(record);
+    type = recordLayout.GetType(field);
+    return recordLayout.GetOffset(field);
+}
+
+std::vector<unsigned char> IrBuilder::GetInitBytes(PSymbolBase type, std::any value) {
+    vector<unsigned char> bytes(GetSize(type), 0);
+    if (!value.has_value())
+        return bytes;
+    if (IsType(type, BaseType::Char)) {
+        string text = any_cast<string>(value);
+        bytes[0] = text.empty() ? 0 : text[0];
+    } else if (GetIrType(type) == IrType::Int) {
+        int number = any_cast<int>(value);
+        memcpy(bytes.data(), &number, sizeof(number));
+    } else if (GetIrType(type) == IrType::Double) {
+        double number = any_cast<double>(value);
+        memcpy(bytes.data(), &number, sizeof(number));
+    }
+    return bytes;
+}
+
+// Folds integer arithmetic on constants, so that bounds written as const expressions are known.
+bool IrBuilder::GetConstant(IrInstruction *value, long long &result) {
+    long long left, right;
+    switch (value->GetOp()) {
+        case IrOp::Const: {
+            result = value->GetInt();
+            return value->GetType() == IrType::Int;
+        }
+        case IrOp::Neg: {
+            if (!GetConstant(value->GetOperand(0), left))
+                return false;
+            result = (int) (unsigned) -left;
+            return true;
+        }
+        case IrOp::Add:
+        case IrOp::Sub:
+        case IrOp::Mul: {
+            if (!GetConstant(value->GetOperand(0), left) || !GetConstant(value->GetOperand(1), right))
+                return false;
+            long long folded = value->GetOp() == IrOp::Add ? left + right :
+                               value->GetOp() == IrOp::Sub ? left - right : left * right;
+            result = (int) (unsigned) folded;
+            return true;
+        }
+        default: {
+            return false;
+        }
+    }
+}
+
+bool IrBuilder::IsAggregate(PSymbolBase type) {
+    return type->GetSymType() == SymType::Record || dynamic_pointer_cast<SymbolStaticArray>(type) != nullptr;
+}
+
+bool IrBuilder::IsType(PSymbolBase type, BaseType base) {
+    return type != nullptr && type->GetSymType() == SymType::BaseType && type->GetTypeName() == baseType.at(base);
+}
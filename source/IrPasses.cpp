@@ -0,0 +1,1484 @@
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include "IrPasses.h"
+
+using namespace std;
+
+PassManager::PassManager(std::ostream *dump) : dump(dump) {}
+
+void PassManager::AddPass(PIrPass pass) {
+    passes.push_back(pass);
+}
+
+void PassManager::AddStandardPasses() {
+    AddPass(PIrPass(new InlinePass()));
+    AddPass(PIrPass(new TailRecursionPass()));
+    AddPass(PIrPass(new SccpPass()));
+    AddPass(PIrPass(new GvnPass()));
+    AddPass(PIrPass(new LicmPass()));
+    AddPass(PIrPass(new BcePass()));
+    AddPass(PIrPass(new IvPass()));
+    AddPass(PIrPass(new DcePass()));
+}
+
+void PassManager::Run(PIrModule module) {
+    for (const auto &pass: passes) {
+        if (dump != nullptr) {
+            *dump << "; before " << pass->GetName() << endl;
+            module->Print(*dump);
+        }
+        pass->Prepare(module);
+        for (const auto &function: module->GetFunctions())
+            pass->Run(function);
+        if (dump != nullptr) {
+            *dump << "; after " << pass->GetName() << endl;
+            module->Print(*dump);
+        }
+    }
+}
+
+void PassManager::PrintStatistics(std::ostream &out) const {
+    for (const auto &pass: passes)
+        pass->PrintStatistics(out);
+}
+
+// A function is recursive when it can reach itself through calls; inlining never changes that,
+// so it is decided once for the whole module.
+void InlinePass::Prepare(PIrModule module) {
+    this->module = module;
+    map<string, set<string>> callees;
+    for (const auto &function: module->GetFunctions())
+        for (const auto &block: function->GetBlocks())
+            for (const auto &instruction: block->GetInstructions())
+                if (instruction->GetOp() == IrOp::Call)
+                    callees[function->GetName()].insert(instruction->GetName());
+    for (const auto &function: module->GetFunctions()) {
+        set<string> visited;
+        vector<string> work(callees[function->GetName()].begin(), callees[function->GetName()].end());
+        while (!work.empty()) {
+            string name = work.back();
+            work.pop_back();
+            if (name == function->GetName()) {
+                recursive.insert(name);
+                break;
+            }
+            if (visited.insert(name).second)
+                work.insert(work.end(), callees[name].begin(), callees[name].end());
+        }
+    }
+}
+
+// Functions come bottom-up from the builder, so a callee has already had its own small calls
+// inlined by the time its body is copied; calls copied in with a body are not revisited.
+bool InlinePass::Run(PIrFunction function) {
+    vector<IrInstruction*> sites;
+    for (const auto &block: function->GetBlocks())
+        for (const auto &instruction: block->GetInstructions())
+            if (instruction->GetOp() == IrOp::Call)
+                sites.push_back(instruction);
+    bool changed = false;
+    for (const auto &call: sites) {
+        calls++;
+        PIrFunction callee = module->FindFunction(call->GetName());
+        if (callee == nullptr || callee == function || recursive.count(callee->GetName()) != 0 ||
+                GetCost(call, callee) > maxCost)
+            continue;
+        Inline(function, call, callee);
+        inlined++;
+        changed = true;
+    }
+    if (changed) {
+        function->ComputePredecessors();
+        function->RemoveTrivialPhis();
+        function->MergeBlocks();
+    }
+    return changed;
+}
+
+void InlinePass::PrintStatistics(std::ostream &out) const {
+    out << "inline: " << calls << " calls, " << inlined << " inlined" << endl;
+}
+
+// The cost is the size of the callee's body less what the call itself costs; every constant
+// argument is expected to fold away at least one more instruction once it is propagated.
+int InlinePass::GetCost(IrInstruction *call, PIrFunction callee) const {
+    int cost = 0;
+    for (const auto &block: callee->GetBlocks())
+        for (const auto &instruction: block->GetInstructions())
+            if (instruction->GetOp() != IrOp::Const && instruction->GetOp() != IrOp::Param &&
+                    instruction->GetOp() != IrOp::Phi && instruction->GetOp() != IrOp::Jump)
+                cost++;
+    cost -= call->GetOperands().size() + 1;
+    for (const auto &operand: call->GetOperands())
+        if (operand->GetOp() == IrOp::Const)
+            cost--;
+    return cost;
+}
+
+// Splits the calling block after the call, copies the callee's blocks in between with its
+// parameters replaced by the arguments and its slots appended to the caller's frame, and turns
+// every return into a jump to the rest of the caller.
+void InlinePass::Inline(PIrFunction function, IrInstruction *call, PIrFunction callee) {
+    IrBlock *block = call->GetBlock();
+    IrBlock *rest = function->NewBlock();
+    function->MoveBlockAfter(rest, block);
+    vector<IrInstruction*> &instructions = block->GetInstructions();
+    auto position = find(instructions.begin(), instructions.end(), call);
+    for (auto it = position + 1; it != instructions.end(); it++)
+        rest->Append(*it);
+    instructions.erase(position, instructions.end());
+    for (const auto &successor: rest->GetSuccessors())
+        for (const auto &phi: successor->GetPhis())
+            for (int i = 0; i < phi->GetTargets().size(); i++)
+                if (phi->GetTargets()[i] == block)
+                    phi->SetTarget(i, rest);
+    int slotBase = function->GetSlots().size();
+    for (const auto &slot: callee->GetSlots())
+        function->AddSlot(slot.GetSize(), slot.GetAlign(), slot.GetName());
+    map<IrBlock*, IrBlock*> blocks;
+    map<IrInstruction*, IrInstruction*> values;
+    IrBlock *after = block;
+    for (const auto &original: callee->GetBlocks()) {
+        blocks[original] = function->NewBlock();
+        function->MoveBlockAfter(blocks[original], after);
+        after = blocks[original];
+    }
+    IrInstruction *result = call->GetType() != IrType::Void ? function->NewInstruction(IrOp::Phi, call->GetType()) : nullptr;
+    for (const auto &original: callee->GetBlocks()) {
+        IrBlock *copy = blocks.at(original);
+        for (const auto &instruction: original->GetInstructions()) {
+            if (instruction->GetOp() == IrOp::Param) {
+                values[instruction] = call->GetOperand(instruction->GetInt());
+                continue;
+            }
+            if (instruction->GetOp() == IrOp::Return) {
+                IrInstruction *jump = function->NewInstruction(IrOp::Jump, IrType::Void);
+                jump->AddTarget(rest);
+                copy->Append(jump);
+                if (result != nullptr) {
+                    result->AddOperand(instruction->GetOperand(0));
+                    result->AddTarget(copy);
+                }
+                continue;
+            }
+            IrInstruction *clone = function->NewInstruction(instruction->GetOp(), instruction->GetType(),
+                                                            instruction->GetOperands());
+            for (const auto &target: instruction->GetTargets())
+                clone->AddTarget(blocks.at(target));
+            clone->SetInt(instruction->GetOp() == IrOp::SlotAddr ? instruction->GetInt() + slotBase : instruction->GetInt());
+            clone->SetDouble(instruction->GetDouble());
+            clone->SetCondition(instruction->GetCondition());
+            clone->SetName(instruction->GetName());
+            clone->SetSize(instruction->GetSize());
+            clone->SetWrite(instruction->GetWrite());
+            values[instruction] = clone;
+            copy->Append(clone);
+        }
+    }
+    for (const auto &original: callee->GetBlocks())
+        for (const auto &instruction: blocks.at(original)->GetInstructions())
+            for (int i = 0; i < instruction->GetOperands().size(); i++)
+                instruction->SetOperand(i, values.at(instruction->GetOperand(i)));
+    if (result != nullptr) {
+        for (int i = 0; i < result->GetOperands().size(); i++)
+            result->SetOperand(i, values.at(result->GetOperand(i)));
+        rest->Insert(0, result);
+        function->ReplaceAllUses(call, result);
+    }
+    IrInstruction *jump = function->NewInstruction(IrOp::Jump, IrType::Void);
+    jump->AddTarget(blocks.at(callee->GetEntry()));
+    block->Append(jump);
+}
+
+// Self-recursive tail calls become jumps back to the start of the body. The entry block keeps
+// only the parameters; the body gets a phi per parameter that takes the arguments of each call.
+bool TailRecursionPass::Run(PIrFunction function) {
+    vector<IrInstruction*> sites;
+    for (const auto &block: function->GetBlocks())
+        for (const auto &instruction: block->GetInstructions())
+            if (instruction->GetOp() == IrOp::Call && instruction->GetName() == function->GetName() &&
+                    instruction->IsTailCall() && !instruction->PassesFrameAddress())
+                sites.push_back(instruction);
+    if (sites.empty())
+        return false;
+    IrBlock *entry = function->GetEntry();
+    IrBlock *body = function->NewBlock();
+    function->MoveBlockAfter(body, entry);
+    vector<IrInstruction*> params;
+    for (const auto &instruction: entry->GetInstructions()) {
+        if (instruction->GetOp() == IrOp::Param)
+            params.push_back(instruction);
+        else
+            body->Append(instruction);
+    }
+    entry->GetInstructions() = params;
+    for (const auto &successor: body->GetSuccessors())
+        for (const auto &phi: successor->GetPhis())
+            for (int i = 0; i < phi->GetTargets().size(); i++)
+                if (phi->GetTargets()[i] == entry)
+                    phi->SetTarget(i, body);
+    IrInstruction *jump = function->NewInstruction(IrOp::Jump, IrType::Void);
+    jump->AddTarget(body);
+    entry->Append(jump);
+    vector<IrInstruction*> phis(function->GetParamTypes().size(), nullptr);
+    for (const auto &param: params) {
+        IrInstruction *phi = function->NewInstruction(IrOp::Phi, param->GetType());
+        function->ReplaceAllUses(param, phi);
+        phi->AddOperand(param);
+        phi->AddTarget(entry);
+        body->Insert(0, phi);
+        phis[param->GetInt()] = phi;
+    }
+    for (const auto &call: sites) {
+        IrBlock *block = call->GetBlock();
+        for (const auto &successor: block->GetSuccessors())
+            successor->RemovePhiIncoming(block);
+        block->GetInstructions().resize(block->GetInstructions().size() - 2);
+        for (int i = 0; i < phis.size(); i++) {
+            if (phis[i] == nullptr)
+                continue;
+            phis[i]->AddOperand(call->GetOperand(i));
+            phis[i]->AddTarget(block);
+        }
+        IrInstruction *back = function->NewInstruction(IrOp::Jump, IrType::Void);
+        back->AddTarget(body);
+        block->Append(back);
+        eliminated++;
+    }
+    function->RemoveUnreachableBlocks();
+    function->RemoveTrivialPhis();
+    return true;
+}
+
+void TailRecursionPass::PrintStatistics(std::ostream &out) const {
+    out << "tailrec: " << eliminated << " calls eliminated" << endl;
+}
+
+LatticeValue::LatticeValue() : state(LatticeState::Top), intValue(0), doubleValue(0.0) {}
+
+LatticeValue LatticeValue::Int(long long value) {
+    LatticeValue result;
+    result.state = LatticeState::Constant;
+    result.intValue = value;
+    return result;
+}
+
+LatticeValue LatticeValue::Double(double value) {
+    LatticeValue result;
+    result.state = LatticeState::Constant;
+    result.doubleValue = value;
+    return result;
+}
+
+LatticeValue LatticeValue::Bottom() {
+    LatticeValue result;
+    result.state = LatticeState::Bottom;
+    return result;
+}
+
+LatticeState LatticeValue::GetState() const {
+    return state;
+}
+
+long long LatticeValue::GetInt() const {
+    return intValue;
+}
+
+double LatticeValue::GetDouble() const {
+    return doubleValue;
+}
+
+bool LatticeValue::Meet(const LatticeValue &other) {
+    if (other.state == LatticeState::Top || state == LatticeState::Bottom)
+        return false;
+    if (state == LatticeState::Top || (other.state == LatticeState::Constant && !(*this == other))) {
+        *this = state == LatticeState::Top ? other : Bottom();
+        return true;
+    }
+    if (other.state == LatticeState::Bottom) {
+        *this = Bottom();
+        return true;
+    }
+    return false;
+}
+
+bool LatticeValue::operator==(const LatticeValue &other) const {
+    return state == other.state && intValue == other.intValue &&
+           memcmp(&doubleValue, &other.doubleValue, sizeof(doubleValue)) == 0;
+}
+
+// Sparse conditional constant propagation (Wegman and Zadeck): values start at top and only move
+// down the lattice, and blocks are only evaluated once an edge into them is known to be taken.
+bool SccpPass::Run(PIrFunction function) {
+    values.clear();
+    users.clear();
+    executableEdges.clear();
+    executableBlocks.clear();
+    function->ComputePredecessors();
+    for (const auto &block: function->GetBlocks())
+        for (const auto &instruction: block->GetInstructions())
+            for (const auto &operand: instruction->GetOperands())
+                users[operand].push_back(instruction);
+    MarkEdge(nullptr, function->GetEntry());
+    while (!flowWork.empty() || !valueWork.empty()) {
+        while (!flowWork.empty()) {
+            pair<IrBlock*, IrBlock*> edge = flowWork.back();
+            flowWork.pop_back();
+            IrBlock *block = edge.second;
+            if (executableBlocks.insert(block).second) {
+                for (const auto &instruction: block->GetInstructions())
+                    Visit(instruction);
+            } else {
+                for (const auto &phi: block->GetPhis())
+                    Visit(phi);
+            }
+        }
+        while (!valueWork.empty()) {
+            IrInstruction *instruction = valueWork.back();
+            valueWork.pop_back();
+            if (executableBlocks.find(instruction->GetBlock()) != executableBlocks.end())
+                Visit(instruction);
+        }
+    }
+    return Rewrite(function);
+}
+
+void SccpPass::MarkEdge(IrBlock *from, IrBlock *to) {
+    if (executableEdges.insert({ from, to }).second)
+        flowWork.push_back({ from, to });
+}
+
+void SccpPass::Update(IrInstruction *instruction, const LatticeValue &value) {
+    if (!values[instruction].Meet(value))
+        return;
+    for (const auto &user: users[instruction])
+        valueWork.push_back(user);
+}
+
+void SccpPass::Visit(IrInstruction *instruction) {
+    switch (instruction->GetOp()) {
+        case IrOp::Jump: {
+            MarkEdge(instruction->GetBlock(), instruction->GetTargets()[0]);
+            return;
+        }
+        case IrOp::Branch: {
+            LatticeValue condition = values[instruction->GetOperand(0)];
+            if (condition.GetState() == LatticeState::Top)
+                return;
+            if (condition.GetState() == LatticeState::Bottom || condition.GetInt() != 0)
+                MarkEdge(instruction->GetBlock(), instruction->GetTargets()[0]);
+            if (condition.GetState() == LatticeState::Bottom || condition.GetInt() == 0)
+                MarkEdge(instruction->GetBlock(), instruction->GetTargets()[1]);
+            return;
+        }
+        case IrOp::Phi: {
+            LatticeValue value;
+            for (int i = 0; i < instruction->GetOperands().size(); i++)
+                if (executableEdges.find({ instruction->GetTargets()[i], instruction->GetBlock() }) !=
+                        executableEdges.end())
+                    value.Meet(values[instruction->GetOperand(i)]);
+            Update(instruction, value);
+            return;
+        }
+        default: {
+            if (instruction->GetType() != IrType::Void)
+                Update(instruction, Evaluate(instruction));
+        }
+    }
+}
+
+LatticeValue SccpPass::Evaluate(IrInstruction *instruction) {
+    if (instruction->GetOp() == IrOp::Const) {
+        if (instruction->GetType() == IrType::Double)
+            return LatticeValue::Double(instruction->GetDouble());
+        return LatticeValue::Int(instruction->GetInt());
+    }
+    if (!instruction->IsPure() || instruction->GetType() == IrType::Pointer)
+        return LatticeValue::Bottom();
+    vector<LatticeValue> operands;
+    for (const auto &operand: instruction->GetOperands()) {
+        LatticeValue value = values[operand];
+        if (value.GetState() == LatticeState::Bottom)
+            return LatticeValue::Bottom();
+        operands.push_back(value);
+    }
+    for (const auto &operand: operands)
+        if (operand.GetState() == LatticeState::Top)
+            return LatticeValue();
+    LatticeValue result;
+    if (!Fold(instruction, operands, result))
+        return LatticeValue::Bottom();
+    return result;
+}
+
+// Folds with the target semantics: 32-bit wrapping integers, shift counts masked to five bits,
+// and no folding of anything that traps or is undefined at run time.
+bool SccpPass::Fold(IrInstruction *instruction, const std::vector<LatticeValue> &operands, LatticeValue &result) {
+    int a = operands.size() > 0 ? operands[0].GetInt() : 0;
+    int b = operands.size() > 1 ? operands[1].GetInt() : 0;
+    double x = operands.size() > 0 ? operands[0].GetDouble() : 0.0;
+    double y = operands.size() > 1 ? operands[1].GetDouble() : 0.0;
+    auto compare = [&](auto first, auto second) {
+        switch (instruction->GetCondition()) {
+            case IrCondition::Eq: return first == second;
+            case IrCondition::Ne: return first != second;
+            case IrCondition::Lt: return first < second;
+            case IrCondition::Le: return first <= second;
+            case IrCondition::Gt: return first > second;
+            default: return first >= second;
+        }
+    };
+    switch (instruction->GetOp()) {
+        case IrOp::Add: result = LatticeValue::Int((int) ((unsigned) a + (unsigned) b)); return true;
+        case IrOp::Sub: result = LatticeValue::Int((int) ((unsigned) a - (unsigned) b)); return true;
+        case IrOp::Mul: result = LatticeValue::Int((int) ((unsigned) a * (unsigned) b)); return true;
+        case IrOp::And: result = LatticeValue::Int(a & b); return true;
+        case IrOp::Or: result = LatticeValue::Int(a | b); return true;
+        case IrOp::Xor: result = LatticeValue::Int(a ^ b); return true;
+        case IrOp::Shl: result = LatticeValue::Int((int) ((unsigned) a << (b & 31))); return true;
+        case IrOp::Shr: result = LatticeValue::Int(a >> (b & 31)); return true;
+        case IrOp::Neg: result = LatticeValue::Int((int) (0u - (unsigned) a)); return true;
+        case IrOp::Not: result = LatticeValue::Int(~a); return true;
+        case IrOp::Div:
+        case IrOp::Mod: {
+            if (b == 0 || (a == INT_MIN && b == -1))
+                return false;
+            result = LatticeValue::Int(instruction->GetOp() == IrOp::Div ? a / b : a % b);
+            return true;
+        }
+        case IrOp::FAdd: result = LatticeValue::Double(x + y); return true;
+        case IrOp::FSub: result = LatticeValue::Double(x - y); return true;
+        case IrOp::FMul: result = LatticeValue::Double(x * y); return true;
+        case IrOp::FDiv: result = LatticeValue::Double(x / y); return true;
+        case IrOp::FNeg: result = LatticeValue::Double(-x); return true;
+        case IrOp::Cmp: result = LatticeValue::Int(compare(a, b) ? 1 : 0); return true;
+        case IrOp::FCmp: {
+            if (isnan(x) || isnan(y))
+                return false;
+            result = LatticeValue::Int(compare(x, y) ? 1 : 0);
+            return true;
+        }
+        case IrOp::IntToDouble: result = LatticeValue::Double(a); return true;
+        case IrOp::DoubleToInt: {
+            if (isnan(x) || x <= (double) INT_MIN - 1.0 || x >= (double) INT_MAX + 1.0)
+                return false;
+            result = LatticeValue::Int((int) x);
+            return true;
+        }
+        default: {
+            return false;
+        }
+    }
+}
+
+bool SccpPass::Rewrite(PIrFunction function) {
+    bool changed = false;
+    for (const auto &block: function->GetBlocks()) {
+        if (executableBlocks.find(block) == executableBlocks.end())
+            continue;
+        for (const auto &instruction: vector<IrInstruction*>(block->GetInstructions())) {
+            LatticeValue value = values[instruction];
+            if (instruction->GetOp() == IrOp::Const || instruction->GetType() == IrType::Void ||
+                    value.GetState() != LatticeState::Constant)
+                continue;
+            bool phi = instruction->GetOp() == IrOp::Phi;
+            instruction->SetOp(IrOp::Const);
+            instruction->ClearOperands();
+            instruction->ClearTargets();
+            instruction->SetInt(value.GetInt());
+            instruction->SetDouble(value.GetDouble());
+            if (phi) {
+                block->Remove(instruction);
+                block->InsertAfterPhis(instruction);
+            }
+            changed = true;
+        }
+        IrInstruction *terminator = block->GetTerminator();
+        if (terminator->GetOp() != IrOp::Branch)
+            continue;
+        vector<IrBlock*> live;
+        for (const auto &target: terminator->GetTargets())
+            if (executableEdges.find({ block, target }) != executableEdges.end())
+                live.push_back(target);
+        if (live.size() != 1 || terminator->GetTargets()[0] == terminator->GetTargets()[1])
+            continue;
+        IrBlock *dead = terminator->GetTargets()[0] == live[0] ? terminator->GetTargets()[1] :
+                        terminator->GetTargets()[0];
+        dead->RemovePhiIncoming(block);
+        terminator->SetOp(IrOp::Jump);
+        terminator->ClearOperands();
+        terminator->ClearTargets();
+        terminator->AddTarget(live[0]);
+        changed = true;
+    }
+    set<IrBlock*> removed;
+    for (const auto &block: function->GetBlocks())
+        if (executableBlocks.find(block) == executableBlocks.end())
+            removed.insert(block);
+    function->RemoveBlocks(removed);
+    changed = changed || !removed.empty();
+    function->ComputePredecessors();
+    return function->RemoveTrivialPhis() || changed;
+}
+
+// Dominator-scoped value numbering: a pure instruction is replaced by an identical one that
+// dominates it, and phis that merge the same values in the same block are merged.
+bool GvnPass::Run(PIrFunction function) {
+    table.clear();
+    replacements.clear();
+    bool changed = function->RemoveTrivialPhis();
+    DominatorTree tree(function);
+    Number(tree, function->GetEntry());
+    if (replacements.empty())
+        return changed;
+    for (const auto &block: function->GetBlocks())
+        for (const auto &instruction: block->GetInstructions())
+            for (int i = 0; i < instruction->GetOperands().size(); i++) {
+                auto replacement = replacements.find(instruction->GetOperand(i));
+                if (replacement != replacements.end())
+                    instruction->SetOperand(i, replacement->second);
+            }
+    function->RemoveTrivialPhis();
+    return true;
+}
+
+void GvnPass::Number(const DominatorTree &tree, IrBlock *block) {
+    vector<ValueKey> added;
+    for (const auto &instruction: vector<IrInstruction*>(block->GetInstructions())) {
+        for (int i = 0; i < instruction->GetOperands().size(); i++) {
+            auto replacement = replacements.find(instruction->GetOperand(i));
+            if (replacement != replacements.end())
+                instruction->SetOperand(i, replacement->second);
+        }
+        if (instruction->GetType() == IrType::Void || (!instruction->IsPure() && instruction->GetOp() != IrOp::Phi))
+            continue;
+        ValueKey key = GetKey(instruction);
+        auto found = table.find(key);
+        if (found != table.end()) {
+            replacements[instruction] = found->second;
+            block->Remove(instruction);
+            continue;
+        }
+        table[key] = instruction;
+        added.push_back(key);
+    }
+    for (const auto &child: tree.GetChildren(block))
+        Number(tree, child);
+    for (const auto &key: added)
+        table.erase(key);
+}
+
+GvnPass::ValueKey GvnPass::GetKey(IrInstruction *instruction) {
+    long long bits;
+    double value = instruction->GetDouble();
+    memcpy(&bits, &value, sizeof(bits));
+    vector<long long> key = {
+            (long long) instruction->GetOp(), (long long) instruction->GetType(), instruction->GetInt(), bits,
+            (long long) instruction->GetCondition(), instruction->GetSize()
+    };
+    vector<long long> operands;
+    for (const auto &operand: instruction->GetOperands())
+        operands.push_back((long long) operand);
+    if (instruction->IsCommutative())
+        sort(operands.begin(), operands.end());
+    key.insert(key.end(), operands.begin(), operands.end());
+    if (instruction->GetOp() == IrOp::Phi) {
+        key.push_back((long long) instruction->GetBlock());
+        for (const auto &target: instruction->GetTargets())
+            key.push_back((long long) target);
+    }
+    return { key, instruction->GetName() };
+}
+
+// Mark and sweep from the instructions with side effects; anything they do not reach is dead.
+bool DcePass::Run(PIrFunction function) {
+    int blockCount = function->GetBlocks().size();
+    function->RemoveUnreachableBlocks();
+    bool changed = blockCount != function->GetBlocks().size();
+    set<IrInstruction*> live;
+    vector<IrInstruction*> work;
+    for (const auto &block: function->GetBlocks())
+        for (const auto &instruction: block->GetInstructions())
+            if (instruction->HasSideEffects())
+                work.push_back(instruction);
+    while (!work.empty()) {
+        IrInstruction *instruction = work.back();
+        work.pop_back();
+        if (!live.insert(instruction).second)
+            continue;
+        for (const auto &operand: instruction->GetOperands())
+            work.push_back(operand);
+    }
+    for (const auto &block: function->GetBlocks()) {
+        vector<IrInstruction*> &instructions = block->GetInstructions();
+        int size = instructions.size();
+        instructions.erase(remove_if(instructions.begin(), instructions.end(), [&](IrInstruction *instruction) {
+            return live.find(instruction) == live.end();
+        }), instructions.end());
+        changed = changed || size != instructions.size();
+    }
+    return changed;
+}
+
+// Every loop first gets a preheader; pure instructions whose operands are all defined outside
+// the loop then move there, innermost loops first so invariants can keep bubbling outwards.
+bool LicmPass::Run(PIrFunction function) {
+    {
+        DominatorTree tree(function);
+        for (const auto &loop: tree.FindLoops())
+            function->InsertPreheader(loop.GetHeader(), loop.GetBlocks());
+    }
+    DominatorTree tree(function);
+    bool changed = false;
+    for (const auto &loop: tree.FindLoops())
+        changed = Hoist(tree, loop) || changed;
+    return changed;
+}
+
+bool LicmPass::Hoist(const DominatorTree &tree, const IrLoop &loop) {
+    IrBlock *preheader = nullptr;
+    for (const auto &predecessor: loop.GetHeader()->GetPredecessors())
+        if (!loop.Contains(predecessor))
+            preheader = predecessor;
+    if (preheader == nullptr)
+        return false;
+    bool changed = false;
+    for (const auto &block: tree.GetOrder()) {
+        if (!loop.Contains(block))
+            continue;
+        for (const auto &instruction: vector<IrInstruction*>(block->GetInstructions())) {
+            if (!instruction->IsPure() || instruction->GetType() == IrType::Void || MayTrap(instruction))
+                continue;
+            bool invariant = true;
+            for (const auto &operand: instruction->GetOperands())
+                invariant = invariant && !loop.Contains(operand);
+            if (!invariant)
+                continue;
+            block->Remove(instruction);
+            preheader->InsertBeforeTerminator(instruction);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool LicmPass::MayTrap(IrInstruction *instruction) {
+    if (instruction->GetOp() != IrOp::Div && instruction->GetOp() != IrOp::Mod)
+        return false;
+    IrInstruction *divisor = instruction->GetOperand(1);
+    return divisor->GetOp() != IrOp::Const || divisor->GetInt() == 0 || divisor->GetInt() == -1;
+}
+
+InductionForm::InductionForm(IrInstruction *phi, long long factor, long long offset, IrInstruction *addend) :
+        phi(phi), factor(factor), offset(offset), addend(addend) {}
+
+IrInstruction *InductionForm::GetPhi() const {
+    return phi;
+}
+
+long long InductionForm::GetFactor() const {
+    return factor;
+}
+
+long long InductionForm::GetOffset() const {
+    return offset;
+}
+
+IrInstruction *InductionForm::GetAddend() const {
+    return addend;
+}
+
+// Strength reduction of induction variables. A basic induction variable is a header phi that
+// the latch advances by a constant; values of the form factor * iv + offset derived from it
+// through multiplies and shifts, and array addresses indexed by them (possibly plus a loop
+// invariant, as in the row offset of a multi-dimensional array), get their own phi that is
+// advanced by an add instead. Integer forms are exact modulo 2^32; address forms only
+// diverge from the original once the index itself overflows, which is out of bounds anyway.
+bool IvPass::Run(PIrFunction irFunction) {
+    function = irFunction;
+    DominatorTree tree(function);
+    bool changed = false;
+    for (const auto &loop: tree.FindLoops())
+        changed = Reduce(tree, loop) || changed;
+    function = nullptr;
+    return changed;
+}
+
+bool IvPass::Reduce(const DominatorTree &tree, const IrLoop &loop) {
+    IrBlock *header = loop.GetHeader();
+    vector<IrBlock*> outside;
+    for (const auto &predecessor: header->GetPredecessors())
+        if (!loop.Contains(predecessor))
+            outside.push_back(predecessor);
+    if (loop.GetLatches().size() != 1 || outside.size() != 1 || outside[0]->GetSuccessors().size() != 1)
+        return false;
+    IrBlock *preheader = outside[0], *latch = loop.GetLatches()[0];
+    forms.clear();
+    steps.clear();
+    FindBasic(loop, preheader, latch);
+    if (forms.empty())
+        return false;
+    vector<pair<IrInstruction*, InductionForm>> candidates;
+    for (const auto &block: tree.GetOrder()) {
+        if (!loop.Contains(block))
+            continue;
+        for (const auto &instruction: block->GetInstructions()) {
+            if (instruction->GetOp() == IrOp::Index && instruction->GetOperands().size() == 2 &&
+                    forms.find(instruction->GetOperand(1)) != forms.end() &&
+                    !loop.Contains(instruction->GetOperand(0)))
+                candidates.push_back({ instruction, forms.at(instruction->GetOperand(1)) });
+            else if (FindDerived(loop, instruction) && instruction->GetOp() != IrOp::Add &&
+                     instruction->GetOp() != IrOp::Sub)
+                candidates.push_back({ instruction, forms.at(instruction) });
+        }
+    }
+    for (const auto &entry: candidates) {
+        IrInstruction *candidate = entry.first;
+        const InductionForm &form = entry.second;
+        bool isIndex = candidate->GetOp() == IrOp::Index;
+        IrInstruction *iv = form.GetPhi();
+        int incoming = iv->GetTargets()[0] == preheader ? 0 : 1;
+        long long step = Wrap(form.GetFactor() * steps.at(iv));
+        IrInstruction *start = EmitStart(preheader, form, incoming);
+        IrInstruction *phi = function->NewInstruction(IrOp::Phi, candidate->GetType());
+        IrInstruction *next;
+        if (isIndex) {
+            IrInstruction *address = function->NewInstruction(IrOp::Index, IrType::Pointer,
+                                                              { candidate->GetOperand(0), start });
+            address->SetSize(candidate->GetSize());
+            address->SetInt(candidate->GetInt());
+            preheader->InsertBeforeTerminator(address);
+            start = address;
+            next = function->NewInstruction(IrOp::Index, IrType::Pointer, { phi });
+            next->SetSize(1);
+            next->SetInt(step * candidate->GetSize());
+        } else {
+            next = function->NewInstruction(IrOp::Add, IrType::Int, { phi, EmitConst(preheader, step) });
+        }
+        latch->InsertBeforeTerminator(next);
+        phi->AddOperand(start);
+        phi->AddTarget(preheader);
+        phi->AddOperand(next);
+        phi->AddTarget(latch);
+        header->InsertAfterPhis(phi);
+        function->ReplaceAllUses(candidate, phi);
+    }
+    return !candidates.empty();
+}
+
+void IvPass::FindBasic(const IrLoop &loop, IrBlock *preheader, IrBlock *latch) {
+    for (const auto &phi: loop.GetHeader()->GetPhis()) {
+        if (phi->GetType() != IrType::Int || phi->GetOperands().size() != 2)
+            continue;
+        int back = phi->GetTargets()[0] == latch ? 0 : 1;
+        if (phi->GetTargets()[back] != latch || phi->GetTargets()[1 - back] != preheader)
+            continue;
+        IrInstruction *next = phi->GetOperand(back);
+        if (next->GetOperands().size() != 2)
+            continue;
+        IrInstruction *left = next->GetOperand(0), *right = next->GetOperand(1);
+        if (next->GetOp() == IrOp::Add && left == phi && right->GetOp() == IrOp::Const)
+            steps[phi] = right->GetInt();
+        else if (next->GetOp() == IrOp::Add && right == phi && left->GetOp() == IrOp::Const)
+            steps[phi] = left->GetInt();
+        else if (next->GetOp() == IrOp::Sub && left == phi && right->GetOp() == IrOp::Const)
+            steps[phi] = Wrap(-right->GetInt());
+        else
+            continue;
+        forms[phi] = InductionForm(phi);
+    }
+}
+
+bool IvPass::FindDerived(const IrLoop &loop, IrInstruction *instruction) {
+    if (instruction->GetType() != IrType::Int || instruction->GetOperands().size() != 2)
+        return false;
+    IrInstruction *left = instruction->GetOperand(0), *right = instruction->GetOperand(1);
+    IrOp op = instruction->GetOp();
+    if (forms.find(left) == forms.end() && instruction->IsCommutative())
+        swap(left, right);
+    auto source = forms.find(left);
+    if (source == forms.end())
+        return false;
+    const InductionForm &form = source->second;
+    if (right->GetOp() != IrOp::Const) {
+        if (op != IrOp::Add || form.GetAddend() != nullptr || loop.Contains(right))
+            return false;
+        forms[instruction] = InductionForm(form.GetPhi(), form.GetFactor(), form.GetOffset(), right);
+        return true;
+    }
+    long long value = right->GetInt();
+    switch (op) {
+        case IrOp::Add: {
+            forms[instruction] = InductionForm(form.GetPhi(), form.GetFactor(), Wrap(form.GetOffset() + value),
+                                               form.GetAddend());
+            return true;
+        }
+        case IrOp::Sub: {
+            forms[instruction] = InductionForm(form.GetPhi(), form.GetFactor(), Wrap(form.GetOffset() - value),
+                                               form.GetAddend());
+            return true;
+        }
+        case IrOp::Mul:
+        case IrOp::Shl: {
+            if (form.GetAddend() != nullptr)
+                return false;
+            long long factor = op == IrOp::Mul ? value : 1LL << (value & 31);
+            forms[instruction] = InductionForm(form.GetPhi(), Wrap(form.GetFactor() * factor),
+                                               Wrap(form.GetOffset() * factor));
+            return true;
+        }
+        default: {
+            return false;
+        }
+    }
+}
+
+IrInstruction *IvPass::EmitStart(IrBlock *preheader, const InductionForm &form, int incoming) {
+    IrInstruction *value = form.GetPhi()->GetOperand(incoming);
+    if (form.GetAddend() != nullptr) {
+        value = EmitStart(preheader, InductionForm(form.GetPhi(), form.GetFactor(), form.GetOffset()), incoming);
+        if (value->GetOp() == IrOp::Const && value->GetInt() == 0)
+            return form.GetAddend();
+        value = function->NewInstruction(IrOp::Add, IrType::Int, { value, form.GetAddend() });
+        preheader->InsertBeforeTerminator(value);
+        return value;
+    }
+    if (value->GetOp() == IrOp::Const)
+        return EmitConst(preheader, Wrap(value->GetInt() * form.GetFactor() + form.GetOffset()));
+    if (form.GetFactor() != 1) {
+        value = function->NewInstruction(IrOp::Mul, IrType::Int, { value, EmitConst(preheader, form.GetFactor()) });
+        preheader->InsertBeforeTerminator(value);
+    }
+    if (form.GetOffset() != 0) {
+        value = function->NewInstruction(IrOp::Add, IrType::Int, { value, EmitConst(preheader, form.GetOffset()) });
+        preheader->InsertBeforeTerminator(value);
+    }
+    return value;
+}
+
+IrInstruction *IvPass::EmitConst(IrBlock *target, long long value) {
+    IrInstruction *instruction = function->NewInstruction(IrOp::Const, IrType::Int);
+    instruction->SetInt(value);
+    target->InsertBeforeTerminator(instruction);
+    return instruction;
+}
+
+long long IvPass::Wrap(long long value) {
+    return (int) (unsigned) value;
+}
+
+ValueRange::ValueRange(long long low, long long high) : low(low), high(high) {}
+
+long long ValueRange::GetLow() const {
+    return low;
+}
+
+long long ValueRange::GetHigh() const {
+    return high;
+}
+
+bool ValueRange::Contains(const ValueRange &other) const {
+    return other.low > other.high || (low <= other.low && other.high <= high);
+}
+
+ValueRange ValueRange::Intersect(const ValueRange &other) const {
+    return ValueRange(max(low, other.low), min(high, other.high));
+}
+
+ValueRange ValueRange::Union(const ValueRange &other) const {
+    return ValueRange(min(low, other.low), max(high, other.high));
+}
+
+ValueRange ValueRange::Add(const ValueRange &other) const {
+    return ValueRange(low + other.low, high + other.high);
+}
+
+ValueRange ValueRange::Sub(const ValueRange &other) const {
+    return ValueRange(low - other.high, high - other.low);
+}
+
+ValueRange ValueRange::Scale(long long factor) const {
+    return factor < 0 ? ValueRange(high * factor, low * factor) : ValueRange(low * factor, high * factor);
+}
+
+// Arithmetic on ranges is done in 64 bits; a result outside the int range means the 32-bit
+// operation may wrap, so nothing is known about it.
+bool ValueRange::IsWrapping() const {
+    return low < INT_MIN || high > INT_MAX;
+}
+
+InductionBound::InductionBound(const IrLoop *loop, IrBlock *preheader, IrBlock *test,
+                               IrInstruction *start, IrInstruction *end) :
+        loop(loop), preheader(preheader), test(test), start(start), end(end) {}
+
+const IrLoop *InductionBound::GetLoop() const {
+    return loop;
+}
+
+IrBlock *InductionBound::GetPreheader() const {
+    return preheader;
+}
+
+IrBlock *InductionBound::GetTest() const {
+    return test;
+}
+
+IrInstruction *InductionBound::GetStart() const {
+    return start;
+}
+
+IrInstruction *InductionBound::GetEnd() const {
+    return end;
+}
+
+LoopVersion::LoopVersion(const IrLoop *loop, IrBlock *preheader, IrBlock *test) :
+        loop(loop), preheader(preheader), test(test), guard(nullptr) {}
+
+const IrLoop *LoopVersion::GetLoop() const {
+    return loop;
+}
+
+IrBlock *LoopVersion::GetPreheader() const {
+    return preheader;
+}
+
+IrBlock *LoopVersion::GetTest() const {
+    return test;
+}
+
+IrInstruction *LoopVersion::GetGuard() const {
+    return guard;
+}
+
+void LoopVersion::SetGuard(IrInstruction *guard) {
+    LoopVersion::guard = guard;
+}
+
+const std::vector<IrInstruction*> &LoopVersion::GetChecks() const {
+    return checks;
+}
+
+void LoopVersion::AddCheck(IrInstruction *check) {
+    checks.push_back(check);
+}
+
+// Bounds check elimination. Walking the dominator tree, every integer value gets an interval
+// from its definition, from the branch conditions on the edges that dominate the current block
+// and from the checks already passed; induction variables get theirs from the loop exit test.
+// A check whose value is proven in range is removed. A check that runs on every iteration of a
+// counted loop and indexes by iv + c is hoisted: the loop is versioned on a test of the first and
+// last values in the preheader, and only the copy run when they are in range loses the check.
+// The original loop keeps it, so an access out of range still fails in its own iteration, after
+// whatever the iterations before it wrote.
+bool BcePass::Run(PIrFunction irFunction) {
+    function = irFunction;
+    {
+        DominatorTree tree(function);
+        for (const auto &loop: tree.FindLoops())
+            function->InsertPreheader(loop.GetHeader(), loop.GetBlocks());
+    }
+    DominatorTree tree(function);
+    loops = tree.FindLoops();
+    facts.clear();
+    inductions.clear();
+    bounds.clear();
+    conditions.clear();
+    versions.clear();
+    bool changed = Visit(tree, function->GetEntry());
+    vector<const LoopVersion*> order;
+    for (const auto &version: versions)
+        order.push_back(&version.second);
+    sort(order.begin(), order.end(), [](const LoopVersion *left, const LoopVersion *right) {
+        return left->GetLoop()->GetBlocks().size() < right->GetLoop()->GetBlocks().size();
+    });
+    for (const auto &version: order)
+        Version(*version);
+    versions.clear();
+    bounds.clear();
+    loops.clear();
+    function = nullptr;
+    return changed;
+}
+
+void BcePass::PrintStatistics(std::ostream &out) const {
+    out << GetName() << ": " << checks << " checks, " << removed << " removed, " << hoisted << " hoisted, "
+        << kept << " kept" << endl;
+}
+
+bool BcePass::Visit(const DominatorTree &tree, IrBlock *block) {
+    vector<pair<IrInstruction*, ValueRange>> saved;
+    int conditionCount = conditions.size();
+    AddEdgeFacts(block, saved);
+    for (const auto &loop: loops)
+        if (loop.GetHeader() == block)
+            FindInductions(tree, loop);
+    bool changed = false;
+    for (const auto &instruction: vector<IrInstruction*>(block->GetInstructions())) {
+        if (instruction->GetOp() != IrOp::Check)
+            continue;
+        checks++;
+        IrInstruction *value = instruction->GetOperand(0);
+        ValueRange allowed(instruction->GetOperand(1)->GetInt(), instruction->GetOperand(2)->GetInt());
+        if (allowed.Contains(GetRange(value))) {
+            block->Remove(instruction);
+            removed++;
+            changed = true;
+        } else if (Hoist(tree, instruction)) {
+            hoisted++;
+            changed = true;
+        } else {
+            kept++;
+        }
+        Restrict(value, allowed, saved);
+    }
+    for (const auto &child: tree.GetChildren(block))
+        changed = Visit(tree, child) || changed;
+    for (auto fact = saved.rbegin(); fact != saved.rend(); fact++)
+        facts[fact->first] = fact->second;
+    conditions.resize(conditionCount);
+    return changed;
+}
+
+// A block with a single predecessor that ends in a branch on an integer comparison learns the
+// outcome of the comparison.
+void BcePass::AddEdgeFacts(IrBlock *block, std::vector<std::pair<IrInstruction*, ValueRange>> &saved) {
+    if (block->GetPredecessors().size() != 1)
+        return;
+    IrInstruction *terminator = block->GetPredecessors()[0]->GetTerminator();
+    if (terminator == nullptr || terminator->GetOp() != IrOp::Branch ||
+            terminator->GetTargets()[0] == terminator->GetTargets()[1])
+        return;
+    IrInstruction *compare = terminator->GetOperand(0);
+    if (compare->GetOp() != IrOp::Cmp || compare->GetOperand(0)->GetType() != IrType::Int)
+        return;
+    IrCondition condition = compare->GetCondition();
+    if (terminator->GetTargets()[0] != block)
+        condition = Negate(condition);
+    conditions.push_back({ compare, condition });
+    IrInstruction *left = compare->GetOperand(0), *right = compare->GetOperand(1);
+    ValueRange leftRange = GetRange(left), rightRange = GetRange(right);
+    switch (condition) {
+        case IrCondition::Eq: {
+            Restrict(left, rightRange, saved);
+            Restrict(right, leftRange, saved);
+            break;
+        }
+        case IrCondition::Lt: {
+            Restrict(left, ValueRange(INT_MIN, rightRange.GetHigh() - 1), saved);
+            Restrict(right, ValueRange(leftRange.GetLow() + 1, INT_MAX), saved);
+            break;
+        }
+        case IrCondition::Le: {
+            Restrict(left, ValueRange(INT_MIN, rightRange.GetHigh()), saved);
+            Restrict(right, ValueRange(leftRange.GetLow(), INT_MAX), saved);
+            break;
+        }
+        case IrCondition::Gt: {
+            Restrict(left, ValueRange(rightRange.GetLow() + 1, INT_MAX), saved);
+            Restrict(right, ValueRange(INT_MIN, leftRange.GetHigh() - 1), saved);
+            break;
+        }
+        case IrCondition::Ge: {
+            Restrict(left, ValueRange(rightRange.GetLow(), INT_MAX), saved);
+            Restrict(right, ValueRange(INT_MIN, leftRange.GetHigh()), saved);
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+}
+
+// A header phi advanced by a constant step is bounded by its start value and by an exit test
+// that runs on every iteration and compares it against a loop invariant. The equality test of
+// a counted loop also needs the entry guard, since the variable must meet the final value.
+void BcePass::FindInductions(const DominatorTree &tree, const IrLoop &loop) {
+    IrBlock *header = loop.GetHeader(), *preheader = nullptr;
+    for (const auto &predecessor: header->GetPredecessors())
+        if (!loop.Contains(predecessor))
+            preheader = predecessor;
+    if (preheader == nullptr || loop.GetLatches().size() != 1)
+        return;
+    IrBlock *latch = loop.GetLatches()[0];
+    for (const auto &phi: header->GetPhis()) {
+        if (phi->GetType() != IrType::Int || phi->GetOperands().size() != 2)
+            continue;
+        int back = phi->GetTargets()[0] == latch ? 0 : 1;
+        if (phi->GetTargets()[back] != latch || phi->GetTargets()[1 - back] != preheader)
+            continue;
+        IrInstruction *start = phi->GetOperand(1 - back), *next = phi->GetOperand(back);
+        if ((next->GetOp() != IrOp::Add && next->GetOp() != IrOp::Sub) || next->GetOperands().size() != 2)
+            continue;
+        IrInstruction *left = next->GetOperand(0), *right = next->GetOperand(1);
+        if (next->GetOp() == IrOp::Add && right == phi)
+            swap(left, right);
+        if (left != phi || right->GetOp() != IrOp::Const || right->GetInt() == 0)
+            continue;
+        long long step = next->GetOp() == IrOp::Add ? right->GetInt() : -right->GetInt();
+        for (const auto &block: tree.GetOrder()) {
+            IrInstruction *terminator = block->GetTerminator();
+            if (!loop.Contains(block) || terminator == nullptr || terminator->GetOp() != IrOp::Branch ||
+                    !tree.Dominates(block, latch))
+                continue;
+            bool stays = loop.Contains(terminator->GetTargets()[0]);
+            IrInstruction *compare = terminator->GetOperand(0);
+            if (stays == loop.Contains(terminator->GetTargets()[1]) || compare->GetOp() != IrOp::Cmp)
+                continue;
+            IrCondition condition = stays ? compare->GetCondition() : Negate(compare->GetCondition());
+            IrInstruction *limit = compare->GetOperand(1);
+            if (compare->GetOperand(1) == phi) {
+                limit = compare->GetOperand(0);
+                condition = Swap(condition);
+            } else if (compare->GetOperand(0) != phi) {
+                continue;
+            }
+            if (loop.Contains(limit))
+                continue;
+            ValueRange startRange = GetRange(start), limitRange = GetRange(limit), range;
+            if (condition == IrCondition::Ne && step == 1 && Implies(start, IrCondition::Le, limit)) {
+                range = ValueRange(startRange.GetLow(), limitRange.GetHigh());
+                bounds[phi] = InductionBound(&loop, preheader, block, start, limit);
+            } else if (condition == IrCondition::Ne && step == -1 && Implies(start, IrCondition::Ge, limit)) {
+                range = ValueRange(limitRange.GetLow(), startRange.GetHigh());
+                bounds[phi] = InductionBound(&loop, preheader, block, start, limit);
+            } else if (condition == IrCondition::Ne && start->GetOp() == IrOp::Const && limit->GetOp() == IrOp::Const &&
+                       (limit->GetInt() - start->GetInt()) % step == 0 && (limit->GetInt() - start->GetInt()) / step >= 0) {
+                // Unrolled loops step by the unroll factor and stop on an exact constant.
+                range = ValueRange(min(start->GetInt(), limit->GetInt()), max(start->GetInt(), limit->GetInt()));
+            } else if ((condition == IrCondition::Lt || condition == IrCondition::Le) && step > 0) {
+                long long last = limitRange.GetHigh() - (condition == IrCondition::Lt ? 1 : 0) + step;
+                range = ValueRange(startRange.GetLow(), max(startRange.GetHigh(), last));
+            } else if ((condition == IrCondition::Gt || condition == IrCondition::Ge) && step < 0) {
+                long long last = limitRange.GetLow() + (condition == IrCondition::Gt ? 1 : 0) + step;
+                range = ValueRange(min(startRange.GetLow(), last), startRange.GetHigh());
+            } else {
+                continue;
+            }
+            if (!range.IsWrapping()) {
+                inductions[phi] = range;
+                break;
+            }
+            bounds.erase(phi);
+        }
+    }
+}
+
+void BcePass::Restrict(IrInstruction *value, const ValueRange &range,
+                       std::vector<std::pair<IrInstruction*, ValueRange>> &saved) {
+    auto fact = facts.find(value);
+    ValueRange current = fact != facts.end() ? fact->second : ValueRange();
+    saved.push_back({ value, current });
+    facts[value] = current.Intersect(range);
+}
+
+// Facts hold for the current instance of a value, so they are not applied to the incoming
+// values of a phi, which may come from an earlier iteration.
+ValueRange BcePass::GetRange(IrInstruction *value, int depth, bool useFacts) {
+    ValueRange result;
+    if (value->GetType() != IrType::Int)
+        return result;
+    IrInstruction *left = value->GetOperands().empty() ? nullptr : value->GetOperand(0);
+    IrInstruction *right = value->GetOperands().size() < 2 ? nullptr : value->GetOperand(1);
+    switch (depth > maxDepth ? IrOp::Load : value->GetOp()) {
+        case IrOp::Const: {
+            result = ValueRange(value->GetInt(), value->GetInt());
+            break;
+        }
+        case IrOp::Cmp:
+        case IrOp::FCmp: {
+            result = ValueRange(0, 1);
+            break;
+        }
+        case IrOp::Add:
+        case IrOp::Sub: {
+            ValueRange leftRange = GetRange(left, depth + 1, useFacts);
+            ValueRange rightRange = GetRange(right, depth + 1, useFacts);
+            ValueRange sum = value->GetOp() == IrOp::Add ? leftRange.Add(rightRange) : leftRange.Sub(rightRange);
+            if (!sum.IsWrapping())
+                result = sum;
+            break;
+        }
+        case IrOp::Mul: {
+            if (left->GetOp() == IrOp::Const)
+                swap(left, right);
+            if (right->GetOp() != IrOp::Const)
+                break;
+            ValueRange product = GetRange(left, depth + 1, useFacts).Scale(right->GetInt());
+            if (!product.IsWrapping())
+                result = product;
+            break;
+        }
+        case IrOp::And: {
+            if (left->GetOp() == IrOp::Const)
+                swap(left, right);
+            if (right->GetOp() == IrOp::Const && right->GetInt() >= 0)
+                result = ValueRange(0, right->GetInt());
+            break;
+        }
+        case IrOp::Mod: {
+            if (right->GetOp() != IrOp::Const || right->GetInt() == 0)
+                break;
+            long long divisor = llabs(right->GetInt()) - 1;
+            result = ValueRange(GetRange(left, depth + 1, useFacts).GetLow() >= 0 ? 0 : -divisor, divisor);
+            break;
+        }
+        case IrOp::Phi: {
+            auto induction = inductions.find(value);
+            if (induction != inductions.end()) {
+                result = induction->second;
+                break;
+            }
+            if (value->GetOperands().empty())
+                break;
+            result = ValueRange(LLONG_MAX, LLONG_MIN);
+            for (const auto &operand: value->GetOperands())
+                result = result.Union(GetRange(operand, depth + 1, false));
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+    auto fact = facts.find(value);
+    if (useFacts && fact != facts.end())
+        result = result.Intersect(fact->second);
+    return result;
+}
+
+bool BcePass::Implies(IrInstruction *left, IrCondition condition, IrInstruction *right) {
+    for (const auto &known: conditions) {
+        IrInstruction *compare = known.first;
+        IrCondition implied = known.second;
+        if (compare->GetOperand(0) == right && compare->GetOperand(1) == left)
+            implied = Swap(implied);
+        else if (compare->GetOperand(0) != left || compare->GetOperand(1) != right)
+            continue;
+        if (implied == condition || implied == IrCondition::Eq ||
+                (condition == IrCondition::Le && implied == IrCondition::Lt) ||
+                (condition == IrCondition::Ge && implied == IrCondition::Gt))
+            return true;
+    }
+    ValueRange leftRange = GetRange(left), rightRange = GetRange(right);
+    if (condition == IrCondition::Le)
+        return leftRange.GetHigh() <= rightRange.GetLow();
+    return leftRange.GetLow() >= rightRange.GetHigh();
+}
+
+// The check sees exactly the values start + c .. end + c when it runs on every iteration and the
+// loop can only be left through the exit test, so testing both ends before the loop tells whether
+// it can fail. Checks in loops nested inside this one are left to the versions of those loops.
+bool BcePass::Hoist(const DominatorTree &tree, IrInstruction *check) {
+    IrInstruction *value = check->GetOperand(0), *phi = value;
+    long long offset = 0;
+    if ((value->GetOp() == IrOp::Add || value->GetOp() == IrOp::Sub) && value->GetOperand(1)->GetOp() == IrOp::Const) {
+        phi = value->GetOperand(0);
+        offset = value->GetOp() == IrOp::Add ? value->GetOperand(1)->GetInt() : -value->GetOperand(1)->GetInt();
+    } else if (value->GetOp() == IrOp::Add && value->GetOperand(0)->GetOp() == IrOp::Const) {
+        phi = value->GetOperand(1);
+        offset = value->GetOperand(0)->GetInt();
+    }
+    auto bound = bounds.find(phi);
+    if (bound == bounds.end())
+        return false;
+    const IrLoop *loop = bound->second.GetLoop();
+    IrBlock *test = bound->second.GetTest(), *preheader = bound->second.GetPreheader(), *exit = nullptr;
+    if (!loop->Contains(check) || !tree.Dominates(check->GetBlock(), test) ||
+            GetInnermost(check->GetBlock()) != loop || GetInnermost(test) != loop)
+        return false;
+    for (const auto &block: loop->GetBlocks()) {
+        for (const auto &successor: block->GetSuccessors()) {
+            if (!loop->Contains(successor) && block != test)
+                return false;
+            if (!loop->Contains(successor))
+                exit = successor;
+        }
+    }
+    if (exit == nullptr || preheader->GetSuccessors().size() != 1)
+        return false;
+    vector<IrInstruction*> ends = { bound->second.GetStart(), bound->second.GetEnd() };
+    if (ends[0] == ends[1])
+        ends.pop_back();
+    for (const auto &end: ends)
+        if (GetRange(end).Add(ValueRange(offset, offset)).IsWrapping())
+            return false;
+    LoopVersion &version = versions.emplace(loop->GetHeader(), LoopVersion(loop, preheader, test)).first->second;
+    ValueRange allowed(check->GetOperand(1)->GetInt(), check->GetOperand(2)->GetInt());
+    for (const auto &end: ends) {
+        if (allowed.Contains(GetRange(end).Add(ValueRange(offset, offset))))
+            continue;
+        IrInstruction *first = end;
+        if (offset != 0 && end->GetOp() == IrOp::Const) {
+            first = EmitConst(preheader, end->GetInt() + offset);
+        } else if (offset != 0) {
+            first = function->NewInstruction(IrOp::Add, IrType::Int, { end, EmitConst(preheader, offset) });
+            preheader->InsertBeforeTerminator(first);
+        }
+        for (const auto &passes: { EmitCompare(preheader, first, IrCondition::Ge, allowed.GetLow()),
+                                   EmitCompare(preheader, first, IrCondition::Le, allowed.GetHigh()) }) {
+            IrInstruction *guard = passes;
+            if (version.GetGuard() != nullptr) {
+                guard = function->NewInstruction(IrOp::And, IrType::Int, { version.GetGuard(), passes });
+                preheader->InsertBeforeTerminator(guard);
+            }
+            version.SetGuard(guard);
+        }
+    }
+    version.AddCheck(check);
+    return true;
+}
+
+const IrLoop *BcePass::GetInnermost(IrBlock *block) const {
+    const IrLoop *innermost = nullptr;
+    for (const auto &loop: loops)
+        if (loop.Contains(block) && (innermost == nullptr || loop.GetBlocks().size() < innermost->GetBlocks().size()))
+            innermost = &loop;
+    return innermost;
+}
+
+IrInstruction *BcePass::EmitCompare(IrBlock *target, IrInstruction *left, IrCondition condition, long long right) {
+    IrInstruction *compare = function->NewInstruction(IrOp::Cmp, IrType::Int, { left, EmitConst(target, right) });
+    compare->SetCondition(condition);
+    target->InsertBeforeTerminator(compare);
+    return compare;
+}
+
+// Copies the loop without its hoisted checks and has the preheader branch to the copy when the
+// guard holds. Either copy leaves through its exit test into an exit block of their own, where the
+// values of the loop used later meet in phis. Loops nested inside are versioned first; their new
+// blocks join every loop around them, so copying an outer loop copies both versions of an inner one.
+void BcePass::Version(const LoopVersion &version) {
+    if (version.GetGuard() == nullptr) {
+        for (const auto &check: version.GetChecks())
+            check->GetBlock()->Remove(check);
+        return;
+    }
+    const IrLoop *loop = version.GetLoop();
+    IrBlock *header = loop->GetHeader(), *preheader = version.GetPreheader(), *test = version.GetTest(), *exit = nullptr;
+    for (const auto &successor: test->GetSuccessors())
+        if (!loop->Contains(successor))
+            exit = successor;
+    if (exit->GetPredecessors().size() > 1) {
+        IrBlock *target = exit;
+        exit = function->SplitEdge(test, target);
+        for (auto &other: loops)
+            if (&other != loop && other.Contains(header) && other.Contains(target))
+                other.AddBlock(exit);
+    }
+    vector<IrBlock*> originals;
+    for (const auto &block: function->GetBlocks())
+        if (loop->Contains(block))
+            originals.push_back(block);
+    map<IrBlock*, IrBlock*> blocks;
+    map<IrInstruction*, IrInstruction*> values;
+    IrBlock *after = originals.back();
+    for (const auto &original: originals) {
+        blocks[original] = function->NewBlock();
+        function->MoveBlockAfter(blocks[original], after);
+        after = blocks[original];
+    }
+    for (const auto &original: originals) {
+        for (const auto &instruction: original->GetInstructions()) {
+            IrInstruction *clone = function->NewInstruction(instruction->GetOp(), instruction->GetType(),
+                                                            instruction->GetOperands());
+            for (const auto &target: instruction->GetTargets())
+                clone->AddTarget(loop->Contains(target) ? blocks.at(target) : target);
+            clone->SetInt(instruction->GetInt());
+            clone->SetDouble(instruction->GetDouble());
+            clone->SetCondition(instruction->GetCondition());
+            clone->SetName(instruction->GetName());
+            clone->SetSize(instruction->GetSize());
+            clone->SetWrite(instruction->GetWrite());
+            values[instruction] = clone;
+            blocks.at(original)->Append(clone);
+        }
+    }
+    for (const auto &original: originals)
+        for (const auto &instruction: blocks.at(original)->GetInstructions())
+            for (int i = 0; i < instruction->GetOperands().size(); i++)
+                if (values.count(instruction->GetOperand(i)) > 0)
+                    instruction->SetOperand(i, values.at(instruction->GetOperand(i)));
+    for (const auto &check: version.GetChecks())
+        values.at(check)->GetBlock()->Remove(values.at(check));
+    for (const auto &phi: exit->GetPhis()) {
+        for (int i = phi->GetTargets().size() - 1; i >= 0; i--) {
+            if (phi->GetTargets()[i] != test)
+                continue;
+            IrInstruction *incoming = phi->GetOperand(i);
+            phi->AddOperand(values.count(incoming) > 0 ? values.at(incoming) : incoming);
+            phi->AddTarget(blocks.at(test));
+        }
+    }
+    vector<pair<IrInstruction*, int>> uses;
+    for (const auto &block: function->GetBlocks()) {
+        if (loop->Contains(block) || blocks.count(block) > 0)
+            continue;
+        for (const auto &instruction: block->GetInstructions())
+            for (int i = 0; i < instruction->GetOperands().size(); i++)
+                if (loop->Contains(instruction->GetOperand(i)))
+                    uses.push_back({ instruction, i });
+    }
+    map<IrInstruction*, IrInstruction*> merged;
+    for (const auto &use: uses) {
+        IrInstruction *user = use.first, *value = user->GetOperand(use.second);
+        if (user->GetBlock() == exit && user->GetOp() == IrOp::Phi)
+            continue;
+        IrInstruction *&phi = merged[value];
+        if (phi == nullptr) {
+            phi = function->NewInstruction(IrOp::Phi, value->GetType(), { value, values.at(value) });
+            phi->AddTarget(test);
+            phi->AddTarget(blocks.at(test));
+            exit->Insert(0, phi);
+        }
+        user->SetOperand(use.second, phi);
+    }
+    IrInstruction *branch = function->NewInstruction(IrOp::Branch, IrType::Void, { version.GetGuard() });
+    branch->AddTarget(blocks.at(header));
+    branch->AddTarget(header);
+    preheader->Remove(preheader->GetTerminator());
+    preheader->Append(branch);
+    function->ComputePredecessors();
+    IrBlock *fast = function->SplitEdge(preheader, blocks.at(header));
+    IrBlock *slow = function->SplitEdge(preheader, header);
+    for (auto &other: loops) {
+        if (&other == loop || !other.Contains(header))
+            continue;
+        for (const auto &original: originals)
+            other.AddBlock(blocks.at(original));
+        other.AddBlock(fast);
+        other.AddBlock(slow);
+    }
+}
+
+IrInstruction *BcePass::EmitConst(IrBlock *target, long long value) {
+    IrInstruction *instruction = function->NewInstruction(IrOp::Const, IrType::Int);
+    instruction->SetInt(value);
+    target->InsertBeforeTerminator(instruction);
+    return instruction;
+}
+
+IrCondition BcePass::Negate(IrCondition condition) {
+    static const map<IrCondition, IrCondition> negated = {
+            { IrCondition::Eq, IrCondition::Ne },
+            { IrCondition::Ne, IrCondition::Eq },
+            { IrCondition::Lt, IrCondition::Ge },
+            { IrCondition::Le, IrCondition::Gt },
+            { IrCondition::Gt, IrCondition::Le },
+            { IrCondition::Ge, IrCondition::Lt }
+    };
+    return negated.at(condition);
+}
+
+IrCondition BcePass::Swap(IrCondition condition) {
+    static const map<IrCondition, IrCondition> swapped = {
+            { IrCondition::Eq, IrCondition::Eq },
+            { IrCondition::Ne, IrCondition::Ne },
+            { IrCondition::Lt, IrCondition::Gt },
+            { IrCondition::Le, IrCondition::Ge },
+            { IrCondition::Gt, IrCondition::Lt },
+            { IrCondition::Ge, IrCondition::Le }
+    };
+    return swapped.at(condition);
+}
@@ -0,0 +1,120 @@
+#include "Jit.h"
+#include "Error.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const map<string, void*> externalSymbols = {
+        { "printf",   (void*) printf   },
+        { "snprintf", (void*) snprintf },
+        { "exit",     (void*) exit     }
+};
+
+Jit::Jit(PAsmProgram program) : encoder(program), memory(nullptr), memorySize(0) {
+    Load();
+    Link();
+    Protect();
+}
+
+Jit::~Jit() {
+    if (memory != nullptr)
+        munmap(memory, memorySize);
+}
+
+size_t Jit::PageAlign(size_t size) {
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    return (size + pageSize - 1) / pageSize * pageSize;
+}
+
+void Jit::Load() {
+    vector<string> externals;
+    for (const auto &relocation: encoder.GetRelocations()) {
+        const string &symbol = relocation.GetSymbol();
+        if (encoder.FindSymbol(symbol) == nullptr &&
+                find(externals.begin(), externals.end(), symbol) == externals.end())
+            externals.push_back(symbol);
+    }
+    const vector<unsigned char> &text = encoder.GetSection(SectionType::Text);
+    const vector<unsigned char> &roData = encoder.GetSection(SectionType::ReadOnlyData);
+    const vector<unsigned char> &data = encoder.GetSection(SectionType::Data);
+    size_t codeSize = PageAlign(text.size() + externals.size() * stubSize);
+    size_t roDataSize = PageAlign(roData.size());
+    memorySize = codeSize + roDataSize + PageAlign(data.size());
+    void *region = mmap(nullptr, memorySize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED)
+        throw JitError("can not map memory");
+    memory = (unsigned char*) region;
+    sections[SectionType::Text] = memory;
+    sections[SectionType::ReadOnlyData] = memory + codeSize;
+    sections[SectionType::Data] = memory + codeSize + roDataSize;
+    memcpy(sections[SectionType::Text], text.data(), text.size());
+    memcpy(sections[SectionType::ReadOnlyData], roData.data(), roData.size());
+    memcpy(sections[SectionType::Data], data.data(), data.size());
+
+    // Externals are reached through "jmp *0(%rip)" stubs followed by the absolute address,
+    // so rel32 calls from the JIT code never have to span the distance to the host binary.
+    unsigned char *stub = memory + text.size();
+    for (const auto &symbol: externals) {
+        auto external = externalSymbols.find(symbol);
+        if (external == externalSymbols.end())
+            throw UndefinedSymbol(symbol);
+        static const unsigned char jump[] = { 0xFF, 0x25, 0x00, 0x00, 0x00, 0x00 };
+        memcpy(stub, jump, sizeof(jump));
+        memcpy(stub + sizeof(jump), &external->second, sizeof(void*));
+        stubs[symbol] = stub;
+        stub += stubSize;
+    }
+}
+
+unsigned char *Jit::GetAddress(const std::string &symbol) {
+    const ObjectSymbol *target = encoder.FindSymbol(symbol);
+    if (target != nullptr)
+        return sections.at(target->GetSection()) + target->GetOffset();
+    return stubs.at(symbol);
+}
+
+void Jit::Link() {
+    for (const auto &relocation: encoder.GetRelocations()) {
+        unsigned char *place = sections[SectionType::Text] + relocation.GetOffset();
+        int value = GetAddress(relocation.GetSymbol()) + relocation.GetAddend() - place;
+        memcpy(place, &value, sizeof(value));
+    }
+}
+
+void Jit::Protect() {
+    size_t codeSize = sections[SectionType::ReadOnlyData] - memory;
+    size_t roDataSize = sections[SectionType::Data] - sections[SectionType::ReadOnlyData];
+    if (mprotect(memory, codeSize, PROT_READ | PROT_EXEC) != 0 ||
+            (roDataSize != 0 && mprotect(sections[SectionType::ReadOnlyData], roDataSize, PROT_READ) != 0))
+        throw JitError("can not protect memory");
+}
+
+void Jit::WritePerfMap() {
+    string fileName = "/tmp/perf-" + to_string(getpid()) + ".map";
+    ofstream out(fileName, ios::app);
+    if (!out)
+        throw FileNotWritten(fileName);
+    out << hex;
+    for (const auto &symbol: encoder.GetSymbols())
+        if (symbol.IsFunction())
+            out << (unsigned long long) GetAddress(symbol.GetName()) << " " << symbol.GetSize() << " "
+                << symbol.GetName() << endl;
+    for (const auto &stub: stubs)
+        out << (unsigned long long) stub.second << " " << stubSize << " " << stub.first << "@plt" << endl;
+}
+
+int Jit::Run() {
+    const ObjectSymbol *entry = encoder.FindSymbol("main");
+    if (entry == nullptr)
+        throw UndefinedSymbol("main");
+    int (*main)() = (int (*)()) GetAddress("main");
+    int result = main();
+    fflush(stdout);
+    return result;
+}
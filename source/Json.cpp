@@ -0,0 +1,355 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include "Json.h"
+
+using namespace std;
+
+// Reads one value from the text and what follows it; anything malformed is a runtime_error naming
+// the offset it was found at.
+class JsonReader {
+public:
+    JsonReader(const std::string &text) : text(text), offset(0) {}
+
+    Json ReadValue() {
+        SkipSpaces();
+        switch (Peek()) {
+            case '{': {
+                return ReadObject();
+            }
+            case '[': {
+                return ReadArray();
+            }
+            case '"': {
+                return Json(ReadString());
+            }
+            case 't': {
+                Expect("true");
+                return Json(true);
+            }
+            case 'f': {
+                Expect("false");
+                return Json(false);
+            }
+            case 'n': {
+                Expect("null");
+                return Json();
+            }
+            default: {
+                return ReadNumber();
+            }
+        }
+    }
+
+    void ReadEnd() {
+        SkipSpaces();
+        if (offset != text.size())
+            Fail();
+    }
+private:
+    const std::string &text;
+    size_t offset;
+
+    char Peek() const {
+        return offset < text.size() ? text[offset] : '\0';
+    }
+
+    char Get() {
+        if (offset >= text.size())
+            Fail();
+        return text[offset++];
+    }
+
+    void SkipSpaces() {
+        while (offset < text.size() && isspace((unsigned char) text[offset]))
+            offset++;
+    }
+
+    void Expect(const char *word) {
+        for (const char *c = word; *c != '\0'; c++)
+            if (Get() != *c)
+                Fail();
+    }
+
+    [[noreturn]] void Fail() const {
+        throw runtime_error("invalid JSON at offset " + to_string(offset));
+    }
+
+    Json ReadObject() {
+        Json object = Json::Object();
+        Get();
+        SkipSpaces();
+        if (Peek() == '}') {
+            Get();
+            return object;
+        }
+        while (true) {
+            SkipSpaces();
+            if (Peek() != '"')
+                Fail();
+            string key = ReadString();
+            SkipSpaces();
+            if (Get() != ':')
+                Fail();
+            object.Set(key, ReadValue());
+            SkipSpaces();
+            char next = Get();
+            if (next == '}')
+                return object;
+            if (next != ',')
+                Fail();
+        }
+    }
+
+    Json ReadArray() {
+        Json array = Json::Array();
+        Get();
+        SkipSpaces();
+        if (Peek() == ']') {
+            Get();
+            return array;
+        }
+        while (true) {
+            array.Add(ReadValue());
+            SkipSpaces();
+            char next = Get();
+            if (next == ']')
+                return array;
+            if (next != ',')
+                Fail();
+        }
+    }
+
+    unsigned ReadHex() {
+        unsigned code = 0;
+        for (int i = 0; i < 4; i++) {
+            char digit = Get();
+            if (!isxdigit((unsigned char) digit))
+                Fail();
+            code = code * 16 + (isdigit((unsigned char) digit) ? digit - '0' : tolower(digit) - 'a' + 10);
+        }
+        return code;
+    }
+
+    static void PutUtf8(std::string &out, unsigned code) {
+        if (code < 0x80) {
+            out += (char) code;
+        } else if (code < 0x800) {
+            out += (char) (0xc0 | code >> 6);
+            out += (char) (0x80 | (code & 0x3f));
+        } else if (code < 0x10000) {
+            out += (char) (0xe0 | code >> 12);
+            out += (char) (0x80 | (code >> 6 & 0x3f));
+            out += (char) (0x80 | (code & 0x3f));
+        } else {
+            out += (char) (0xf0 | code >> 18);
+            out += (char) (0x80 | (code >> 12 & 0x3f));
+            out += (char) (0x80 | (code >> 6 & 0x3f));
+            out += (char) (0x80 | (code & 0x3f));
+        }
+    }
+
+    std::string ReadString() {
+        string value;
+        Get();
+        while (true) {
+            char symb = Get();
+            if (symb == '"')
+                return value;
+            if (symb != '\\') {
+                value += symb;
+                continue;
+            }
+            switch (Get()) {
+                case '"': { value += '"'; break; }
+                case '\\': { value += '\\'; break; }
+                case '/': { value += '/'; break; }
+                case 'b': { value += '\b'; break; }
+                case 'f': { value += '\f'; break; }
+                case 'n': { value += '\n'; break; }
+                case 'r': { value += '\r'; break; }
+                case 't': { value += '\t'; break; }
+                case 'u': {
+                    unsigned code = ReadHex();
+                    if (code >= 0xd800 && code < 0xdc00 && Peek() == '\\') {
+                        Expect("\\u");
+                        code = 0x10000 + ((code - 0xd800) << 10) + (ReadHex() - 0xdc00);
+                    }
+                    PutUtf8(value, code);
+                    break;
+                }
+                default: {
+                    Fail();
+                }
+            }
+        }
+    }
+
+    Json ReadNumber() {
+        const char *start = text.c_str() + offset;
+        char *end;
+        double value = strtod(start, &end);
+        if (end == start)
+            Fail();
+        offset += end - start;
+        return Json(value);
+    }
+};
+
+static const Json null;
+
+Json::Json() : type(JsonType::Null), boolean(false), number(0) {}
+
+Json::Json(bool value) : type(JsonType::Bool), boolean(value), number(0) {}
+
+Json::Json(int value) : type(JsonType::Number), boolean(false), number(value) {}
+
+Json::Json(double value) : type(JsonType::Number), boolean(false), number(value) {}
+
+Json::Json(const char *value) : type(JsonType::String), boolean(false), number(0), text(value) {}
+
+Json::Json(std::string value) : type(JsonType::String), boolean(false), number(0), text(value) {}
+
+Json Json::Array() {
+    Json array;
+    array.type = JsonType::Array;
+    return array;
+}
+
+Json Json::Object() {
+    Json object;
+    object.type = JsonType::Object;
+    return object;
+}
+
+Json Json::Parse(const std::string &text) {
+    JsonReader reader(text);
+    Json value = reader.ReadValue();
+    reader.ReadEnd();
+    return value;
+}
+
+JsonType Json::GetType() const {
+    return type;
+}
+
+bool Json::IsNull() const {
+    return type == JsonType::Null;
+}
+
+bool Json::GetBool() const {
+    return boolean;
+}
+
+double Json::GetNumber() const {
+    return number;
+}
+
+const std::string &Json::GetString() const {
+    return text;
+}
+
+size_t Json::Size() const {
+    return type == JsonType::Array ? elements.size() : members.size();
+}
+
+bool Json::Has(const std::string &key) const {
+    return members.find(key) != members.end();
+}
+
+const Json &Json::operator[](const std::string &key) const {
+    auto member = members.find(key);
+    return member != members.end() ? member->second : null;
+}
+
+const Json &Json::operator[](size_t index) const {
+    return index < elements.size() ? elements[index] : null;
+}
+
+Json &Json::Set(const std::string &key, Json value) {
+    type = JsonType::Object;
+    members[key] = move(value);
+    return *this;
+}
+
+Json &Json::Add(Json value) {
+    type = JsonType::Array;
+    elements.push_back(move(value));
+    return *this;
+}
+
+std::string Json::Write() const {
+    string out;
+    Write(out);
+    return out;
+}
+
+void Json::Write(std::string &out) const {
+    switch (type) {
+        case JsonType::Null: {
+            out += "null";
+            break;
+        }
+        case JsonType::Bool: {
+            out += boolean ? "true" : "false";
+            break;
+        }
+        case JsonType::Number: {
+            char buff[32];
+            if (number == floor(number) && fabs(number) < 1e15)
+                snprintf(buff, sizeof(buff), "%lld", (long long) number);
+            else
+                snprintf(buff, sizeof(buff), "%.17g", number);
+            out += buff;
+            break;
+        }
+        case JsonType::String: {
+            out += '"';
+            for (char symb: text) {
+                if (symb == '"' || symb == '\\') {
+                    out += '\\';
+                    out += symb;
+                } else if (symb == '\n') {
+                    out += "\\n";
+                } else if (symb == '\r') {
+                    out += "\\r";
+                } else if (symb == '\t') {
+                    out += "\\t";
+                } else if ((unsigned char) symb < 0x20) {
+                    char buff[8];
+                    snprintf(buff, sizeof(buff), "\\u%04x", symb);
+                    out += buff;
+                } else {
+                    out += symb;
+                }
+            }
+            out += '"';
+            break;
+        }
+        case JsonType::Array: {
+            out += '[';
+            for (size_t i = 0; i < elements.size(); i++) {
+                if (i > 0)
+                    out += ',';
+                elements[i].Write(out);
+            }
+            out += ']';
+            break;
+        }
+        case JsonType::Object: {
+            out += '{';
+            bool first = true;
+            for (const auto &member: members) {
+                if (!first)
+                    out += ',';
+                first = false;
+                Json(member.first).Write(out);
+                out += ':';
+                member.second.Write(out);
+            }
+            out += '}';
+            break;
+        }
+    }
+}
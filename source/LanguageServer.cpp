@@ -0,0 +1,494 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "LanguageServer.h"
+#include "Error.h"
+
+using namespace std;
+
+// JSON-RPC error codes.
+static const int parseError = -32700;
+static const int invalidRequest = -32600;
+static const int methodNotFound = -32601;
+static const int internalError = -32603;
+
+// What a completion item is, for the client's icons; anything not listed is a variable.
+static const map<SymType, int> completionKind = {
+        { SymType::Procedure,   3  },
+        { SymType::Function,    3  },
+        { SymType::RecordField, 5  },
+        { SymType::Type,        7  },
+        { SymType::TypeAlias,   7  },
+        { SymType::Const,       21 }
+};
+
+static std::string ToLower(std::string name) {
+    transform(name.begin(), name.end(), name.begin(), ::tolower);
+    return name;
+}
+
+static bool IsIdentifierChar(char symb) {
+    return isalnum((unsigned char) symb) || symb == '_';
+}
+
+// A file URI's path, percent escapes decoded; any other URI has none.
+static std::string GetPath(const std::string &uri) {
+    if (uri.compare(0, 7, "file://") != 0)
+        return "";
+    string path;
+    for (size_t i = 7; i < uri.size(); i++) {
+        if (uri[i] == '%' && i + 2 < uri.size()) {
+            path += (char) strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16);
+            i += 2;
+        } else {
+            path += uri[i];
+        }
+    }
+    return path;
+}
+
+static std::string GetLineText(const std::string &text, int line) {
+    size_t start = 0;
+    for (int i = 0; i < line && start != string::npos; i++) {
+        start = text.find('\n', start);
+        if (start != string::npos)
+            start++;
+    }
+    if (start == string::npos)
+        return "";
+    size_t end = text.find('\n', start);
+    string result = text.substr(start, end == string::npos ? string::npos : end - start);
+    if (!result.empty() && result.back() == '\r')
+        result.pop_back();
+    return result;
+}
+
+static Json MakePosition(int line, int character) {
+    return Json::Object().Set("line", line).Set("character", character);
+}
+
+static Json MakeRange(int line, int start, int end) {
+    return Json::Object().Set("start", MakePosition(line, start)).Set("end", MakePosition(line, end));
+}
+
+// A symbol as hover and completion describe it: what it is and its type, and a constant's value.
+static std::string Describe(PSymbolComplex symbol) {
+    string type = symbol->GetTypeName();
+    while (!type.empty() && type.back() == ' ')
+        type.pop_back();
+    for (size_t space = type.find("  "); space != string::npos; space = type.find("  "))
+        type.erase(space, 1);
+    string text = symTypeName.at(symbol->GetSymType()) + " " + symbol->GetName() + ": " + type;
+    PSymbolComplexWithValue value = dynamic_pointer_cast<SymbolComplexWithValue>(symbol);
+    if (value != nullptr && symbol->GetSymType() == SymType::Const)
+        text += " = " + value->GetValueText();
+    return text;
+}
+
+static void RemoveTree(const std::string &path) {
+    DIR *dir = opendir(path.c_str());
+    if (dir != nullptr) {
+        while (dirent *entry = readdir(dir)) {
+            string name = entry->d_name;
+            if (name != "." && name != "..")
+                RemoveTree(path + "/" + name);
+        }
+        closedir(dir);
+        rmdir(path.c_str());
+        return;
+    }
+    unlink(path.c_str());
+}
+
+Document::Document(std::string uri, std::string directory, std::string scratchFileName) :
+        uri(uri), directory(directory), scratchFileName(scratchFileName), cache(new AnalysisCache()) {}
+
+const std::string &Document::GetText() const {
+    return text;
+}
+
+const std::shared_ptr<Parser> Document::GetAnalysis() const {
+    return analysis;
+}
+
+const std::string &Document::GetError() const {
+    return error;
+}
+
+LanguageServer::LanguageServer(std::istream &in, std::ostream &out, int threads) :
+        in(in), out(out), threads(max(threads, 1)), scratchCount(0), shutdown(false) {
+    char directory[] = "/tmp/lsp-XXXXXX";
+    if (mkdtemp(directory) == nullptr)
+        throw runtime_error("cannot create a scratch directory");
+    scratchDirectory = directory;
+}
+
+LanguageServer::~LanguageServer() {
+    RemoveTree(scratchDirectory);
+}
+
+// Messages are read until the client sends exit or closes the stream; true if it asked for a
+// shutdown first, as the protocol wants.
+bool LanguageServer::Run() {
+    string body;
+    while (Read(body)) {
+        Json message;
+        try {
+            message = Json::Parse(body);
+        }
+        catch (runtime_error &error) {
+            ReplyError(Json(), parseError, error.what());
+            continue;
+        }
+        if (!Handle(message))
+            break;
+    }
+    PrintLatencies();
+    return shutdown;
+}
+
+bool LanguageServer::Read(std::string &body) {
+    long length = -1;
+    string header;
+    while (getline(in, header)) {
+        if (!header.empty() && header.back() == '\r')
+            header.pop_back();
+        if (header.empty() && length >= 0)
+            break;
+        if (ToLower(header.substr(0, 15)) == "content-length:")
+            length = atol(header.c_str() + 15);
+    }
+    if (!in || length < 0)
+        return false;
+    body.assign(length, '\0');
+    in.read(&body[0], length);
+    return in.gcount() == length;
+}
+
+void LanguageServer::Send(const Json &message) {
+    string body = message.Write();
+    out << "Content-Length: " << body.size() << "\r\n\r\n" << body;
+    out.flush();
+}
+
+void LanguageServer::Reply(const Json &id, const Json &result) {
+    Send(Json::Object().Set("jsonrpc", "2.0").Set("id", id).Set("result", result));
+}
+
+void LanguageServer::ReplyError(const Json &id, int code, const std::string &message) {
+    Json error = Json::Object().Set("code", code).Set("message", message);
+    Send(Json::Object().Set("jsonrpc", "2.0").Set("id", id).Set("error", error));
+}
+
+// Requests are answered and timed; notifications change the documents. False on exit.
+bool LanguageServer::Handle(const Json &message) {
+    const string &method = message["method"].GetString();
+    const Json &params = message["params"];
+    if (method == "exit")
+        return false;
+    if (!message.Has("id")) {
+        if (method == "textDocument/didOpen") {
+            Open(params["textDocument"]["uri"].GetString(), params["textDocument"]["text"].GetString());
+        } else if (method == "textDocument/didChange") {
+            PDocument document = GetDocument(params);
+            const Json &changes = params["contentChanges"];
+            if (document != nullptr && changes.Size() > 0) {
+                document->text = changes[changes.Size() - 1]["text"].GetString();
+                Analyze(*document);
+                PublishDiagnostics(*document);
+            }
+        } else if (method == "textDocument/didClose") {
+            PDocument document = GetDocument(params);
+            if (document != nullptr) {
+                document->text.clear();
+                document->error.clear();
+                PublishDiagnostics(*document);
+                RemoveTree(document->scratchFileName.substr(0, document->scratchFileName.rfind('/')));
+                documents.erase(document->uri);
+            }
+        }
+        return true;
+    }
+    if (!message.Has("method"))
+        return true;
+    const Json &id = message["id"];
+    auto start = chrono::steady_clock::now();
+    if (shutdown) {
+        ReplyError(id, invalidRequest, "the server is shutting down");
+        return true;
+    }
+    try {
+        Json result;
+        if (Call(method, params, result))
+            Reply(id, result);
+        else
+            ReplyError(id, methodNotFound, "method not found: " + method);
+    }
+    catch (exception &exception) {
+        ReplyError(id, internalError, exception.what());
+    }
+    latencies.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+    return true;
+}
+
+bool LanguageServer::Call(const std::string &method, const Json &params, Json &result) {
+    if (method == "initialize") {
+        Json sync = Json::Object().Set("openClose", true).Set("change", 1);
+        Json completion = Json::Object().Set("triggerCharacters", Json::Array().Add("."));
+        Json capabilities = Json::Object().Set("textDocumentSync", sync).Set("definitionProvider", true)
+                .Set("hoverProvider", true).Set("completionProvider", completion);
+        result = Json::Object().Set("capabilities", capabilities)
+                .Set("serverInfo", Json::Object().Set("name", "Compiler"));
+    } else if (method == "shutdown") {
+        shutdown = true;
+        result = Json();
+    } else if (method == "textDocument/definition") {
+        result = FindDefinition(params);
+    } else if (method == "textDocument/hover") {
+        result = Hover(params);
+    } else if (method == "textDocument/completion") {
+        result = Complete(params);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void LanguageServer::Open(const std::string &uri, const std::string &text) {
+    PDocument document = documents[uri];
+    if (document == nullptr) {
+        string path = GetPath(uri);
+        size_t slash = path.rfind('/');
+        string directory = scratchDirectory + "/" + to_string(++scratchCount);
+        mkdir(directory.c_str(), 0700);
+        string base = path.empty() ? "document.pas" : path.substr(slash + 1);
+        document = documents[uri] = PDocument(new Document(uri, slash == string::npos ? "" : path.substr(0, slash),
+                                                           directory + "/" + base));
+    }
+    document->text = text;
+    Analyze(*document);
+    PublishDiagnostics(*document);
+}
+
+// The unit interfaces beside the document are linked beside its scratch file first, so that its
+// uses clause finds them as it would on disk. A version that does not parse keeps the analysis of
+// the last one that did.
+void LanguageServer::Analyze(Document &document) {
+    string scratch = document.scratchFileName.substr(0, document.scratchFileName.rfind('/'));
+    DIR *dir = document.directory.empty() ? nullptr : opendir(document.directory.c_str());
+    if (dir != nullptr) {
+        while (dirent *entry = readdir(dir)) {
+            string name = entry->d_name;
+            struct stat info;
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".ppi") == 0 &&
+                    lstat((scratch + "/" + name).c_str(), &info) != 0)
+                symlink((document.directory + "/" + name).c_str(), (scratch + "/" + name).c_str());
+        }
+        closedir(dir);
+    }
+    ofstream(document.scratchFileName, ios::binary | ios::trunc) << document.text;
+    try {
+        document.analysis = shared_ptr<Parser>(new Parser(document.scratchFileName.c_str(),
+                                                          ParserConfig::ParseProgram, threads, false,
+                                                          document.cache));
+        document.error.clear();
+        document.declarations.clear();
+        for (const auto &declaration: document.analysis->GetDeclarations()) {
+            PSymbolComplex symbol = declaration.FindSymbol();
+            if (symbol != nullptr)
+                document.declarations.emplace(symbol.get(), declaration.GetToken());
+        }
+    }
+    catch (Error &error) {
+        document.error = error.GetMessage();
+    }
+    catch (exception &exception) {
+        document.error = string("(1,1) Error: ") + exception.what();
+    }
+}
+
+// A diagnostic covers the word its message points at, or a single character.
+void LanguageServer::PublishDiagnostics(const Document &document) {
+    Json diagnostics = Json::Array();
+    int line, column;
+    if (sscanf(document.error.c_str(), "(%d,%d)", &line, &column) == 2) {
+        string text = GetLineText(document.text, line - 1);
+        int start = max(column - 1, 0), end = start;
+        while (end < text.size() && IsIdentifierChar(text[end]))
+            end++;
+        size_t error = document.error.find("Error: ");
+        string message = error == string::npos ? document.error : document.error.substr(error + 7);
+        diagnostics.Add(Json::Object().Set("range", MakeRange(line - 1, start, max(end, start + 1)))
+                                .Set("severity", 1).Set("source", "Compiler").Set("message", message));
+    }
+    Json params = Json::Object().Set("uri", document.uri).Set("diagnostics", diagnostics);
+    Send(Json::Object().Set("jsonrpc", "2.0").Set("method", "textDocument/publishDiagnostics").Set("params", params));
+}
+
+Json LanguageServer::FindDefinition(const Json &params) {
+    PDocument document = GetDocument(params);
+    Json range;
+    PSymbolComplex symbol = document != nullptr ? FindSymbol(*document, params["position"], range) : nullptr;
+    if (symbol == nullptr || document->declarations.count(symbol.get()) == 0)
+        return Json();
+    const Token &token = document->declarations.at(symbol.get());
+    int column = token.GetColumn() - 1;
+    return Json::Object().Set("uri", document->uri)
+            .Set("range", MakeRange(token.GetLine() - 1, column, column + (int) token.GetValue().size()));
+}
+
+Json LanguageServer::Hover(const Json &params) {
+    PDocument document = GetDocument(params);
+    Json range;
+    PSymbolComplex symbol = document != nullptr ? FindSymbol(*document, params["position"], range) : nullptr;
+    if (symbol == nullptr)
+        return Json();
+    Json contents = Json::Object().Set("kind", "plaintext").Set("value", Describe(symbol));
+    return Json::Object().Set("contents", contents).Set("range", range);
+}
+
+// After a period, the fields of the record before it; elsewhere, every name in scope. Either way
+// only those starting with what was typed of the word so far, and no more than maxCompletions of
+// them: the client asks again as the word grows.
+Json LanguageServer::Complete(const Json &params) {
+    Json items = Json::Array();
+    PDocument document = GetDocument(params);
+    if (document == nullptr || document->analysis == nullptr)
+        return Json::Object().Set("isIncomplete", false).Set("items", items);
+    int line = (int) params["position"]["line"].GetNumber();
+    string text = GetLineText(document->text, line);
+    size_t end = min((size_t) params["position"]["character"].GetNumber(), text.size()), start = end;
+    while (start > 0 && IsIdentifierChar(text[start - 1]))
+        start--;
+    string prefix = ToLower(text.substr(start, end - start));
+    size_t before = start;
+    while (before > 0 && text[before - 1] == ' ')
+        before--;
+    PSymbolTableStack scope = GetScope(*document, line + 1);
+    vector<PSymbolComplex> symbols;
+    if (before > 0 && text[before - 1] == '.') {
+        PSymbolRecord record = dynamic_pointer_cast<SymbolRecord>(FindQualifier(scope, text, before - 1));
+        if (record != nullptr)
+            symbols = record->GetFields()->GetSymbols();
+    } else {
+        symbols = scope->GetSymbols();
+    }
+    bool complete = true;
+    for (const auto &symbol: symbols) {
+        if (ToLower(symbol->GetName()).compare(0, prefix.size(), prefix) != 0)
+            continue;
+        if (items.Size() == maxCompletions) {
+            complete = false;
+            break;
+        }
+        auto kind = completionKind.find(symbol->GetSymType());
+        items.Add(Json::Object().Set("label", symbol->GetName()).Set("detail", Describe(symbol))
+                          .Set("kind", kind != completionKind.end() ? kind->second : 6));
+    }
+    return Json::Object().Set("isIncomplete", !complete).Set("items", items);
+}
+
+PDocument LanguageServer::GetDocument(const Json &params) const {
+    auto document = documents.find(params["textDocument"]["uri"].GetString());
+    return document != documents.end() ? document->second : nullptr;
+}
+
+// The symbols seen on a line, counted from 1: those of the innermost procedure holding it, or the
+// program's own.
+PSymbolTableStack LanguageServer::GetScope(const Document &document, int line) const {
+    for (const auto &scope: document.analysis->GetScopes())
+        if (scope.GetFirstLine() <= line && line < scope.GetEndLine())
+            return scope.GetSymbols();
+    return document.analysis->GetTableStack();
+}
+
+// The symbol named by the word at the position, a field if a period comes before it; range is set
+// to the word's.
+PSymbolComplex LanguageServer::FindSymbol(const Document &document, const Json &position, Json &range) const {
+    if (document.analysis == nullptr)
+        return nullptr;
+    int line = (int) position["line"].GetNumber();
+    string text = GetLineText(document.text, line);
+    size_t start = min((size_t) position["character"].GetNumber(), text.size()), end = start;
+    while (start > 0 && IsIdentifierChar(text[start - 1]))
+        start--;
+    while (end < text.size() && IsIdentifierChar(text[end]))
+        end++;
+    if (start == end || isdigit((unsigned char) text[start]))
+        return nullptr;
+    range = MakeRange(line, start, end);
+    string name = ToLower(text.substr(start, end - start));
+    size_t before = start;
+    while (before > 0 && text[before - 1] == ' ')
+        before--;
+    PSymbolTableStack scope = GetScope(document, line + 1);
+    if (before == 0 || text[before - 1] != '.')
+        return scope->FindSymbol(name);
+    PSymbolRecord record = dynamic_pointer_cast<SymbolRecord>(FindQualifier(scope, text, before - 1));
+    return record != nullptr ? record->GetFields()->FindSymbol(name) : nullptr;
+}
+
+// The type of what comes before end on the line: a name, a field of one, or an element of an array,
+// as in a[i, j].b. Calls and anything longer than a line are not followed.
+PSymbolBase LanguageServer::FindQualifier(PSymbolTableStack scope, const std::string &line, size_t end) const {
+    while (end > 0 && line[end - 1] == ' ')
+        end--;
+    if (end == 0)
+        return nullptr;
+    if (line[end - 1] == ']') {
+        int depth = 0, dimensions = 1;
+        size_t open = end;
+        while (open > 0) {
+            char symb = line[--open];
+            if (symb == ']')
+                depth++;
+            else if (symb == '[' && --depth == 0)
+                break;
+            else if (symb == ',' && depth == 1)
+                dimensions++;
+        }
+        PSymbolBase type = depth == 0 ? FindQualifier(scope, line, open) : nullptr;
+        for (int i = 0; i < dimensions && type != nullptr; i++) {
+            PSymbolArray array = dynamic_pointer_cast<SymbolArray>(type);
+            type = array != nullptr ? array->GetType() : nullptr;
+        }
+        return type;
+    }
+    size_t start = end;
+    while (start > 0 && IsIdentifierChar(line[start - 1]))
+        start--;
+    if (start == end)
+        return nullptr;
+    string name = ToLower(line.substr(start, end - start));
+    size_t before = start;
+    while (before > 0 && line[before - 1] == ' ')
+        before--;
+    PSymbolComplex symbol;
+    if (before > 0 && line[before - 1] == '.') {
+        PSymbolRecord record = dynamic_pointer_cast<SymbolRecord>(FindQualifier(scope, line, before - 1));
+        symbol = record != nullptr ? record->GetFields()->FindSymbol(name) : nullptr;
+    } else {
+        symbol = scope->FindSymbol(name);
+    }
+    return symbol != nullptr ? symbol->GetType() : nullptr;
+}
+
+void LanguageServer::PrintLatencies() const {
+    if (latencies.empty())
+        return;
+    vector<double> sorted = latencies;
+    sort(sorted.begin(), sorted.end());
+    auto percentile = [&](double p) {
+        return sorted[min(sorted.size() - 1, (size_t) (p * sorted.size()))];
+    };
+    cerr << "lsp: " << sorted.size() << " requests, p50 " << fixed << setprecision(3) << percentile(0.5)
+         << " ms, p99 " << percentile(0.99) << " ms, max " << sorted.back() << " ms" << endl;
+}
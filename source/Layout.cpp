@@ -0,0 +1,184 @@
+#include <algorithm>
+#include "Layout.h"
+
+using namespace std;
+
+ArrayLayout::ArrayLayout() : size(0) {}
+
+int ArrayLayout::GetRank() const {
+    return lows.size();
+}
+
+int ArrayLayout::GetSize() const {
+    return size;
+}
+
+long long ArrayLayout::GetLow(int dimension) const {
+    return lows[dimension];
+}
+
+long long ArrayLayout::GetHigh(int dimension) const {
+    return highs[dimension];
+}
+
+long long ArrayLayout::GetExtent(int dimension) const {
+    return highs[dimension] - lows[dimension] + 1;
+}
+
+long long ArrayLayout::GetStride(int dimension) const {
+    return strides[dimension];
+}
+
+// Byte offset of element [0, 0, ...] relative to the first element when only the first rank
+// dimensions are indexed.
+long long ArrayLayout::GetBaseOffset(int rank) const {
+    long long offset = 0;
+    for (int i = 0; i < rank; i++)
+        offset -= lows[i] * strides[i];
+    return offset;
+}
+
+// Type of an element once the dimensions up to and including this one are indexed.
+PSymbolBase ArrayLayout::GetType(int dimension) const {
+    return types[dimension];
+}
+
+void ArrayLayout::AddDimension(PSymbolSubRange range, PSymbolBase type) {
+    lows.push_back(range->GetLeft());
+    highs.push_back(range->GetRight());
+    types.push_back(type);
+}
+
+void ArrayLayout::SetElementSize(int elementSize) {
+    strides.assign(lows.size(), 0);
+    long long stride = elementSize;
+    for (int i = lows.size() - 1; i >= 0; i--) {
+        strides[i] = stride;
+        stride *= GetExtent(i);
+    }
+    size = stride;
+}
+
+RecordLayout::RecordLayout() : size(0), align(1) {}
+
+int RecordLayout::GetSize() const {
+    return size;
+}
+
+int RecordLayout::GetAlign() const {
+    return align;
+}
+
+int RecordLayout::GetOffset(const std::string &field) const {
+    return fields.at(field).first;
+}
+
+PSymbolBase RecordLayout::GetType(const std::string &field) const {
+    return fields.at(field).second;
+}
+
+void RecordLayout::AddField(const std::string &field, PSymbolBase type, int offset) {
+    fields[field] = { offset, type };
+}
+
+void RecordLayout::SetSize(int size, int align) {
+    this->size = size;
+    this->align = align;
+}
+
+// Scalars take their natural size: one byte for char, four for integer and eight for doubles
+// and pointers; dynamic arrays are a pointer and open arrays a pointer and a high bound.
+int TypeLayout::GetSize(PSymbolBase type) {
+    switch (type->GetSymType()) {
+        case SymType::Array: {
+            PSymbolStaticArray array = dynamic_pointer_cast<SymbolStaticArray>(type);
+            return array != nullptr ? GetArrayLayout(array).GetSize() : slotSize;
+        }
+        case SymType::Record: {
+            return GetRecordLayout(dynamic_pointer_cast<SymbolRecord>(type)).GetSize();
+        }
+        case SymType::OpenArray: {
+            return 2 * slotSize;
+        }
+        case SymType::BaseType: {
+            if (type->GetTypeName() == baseType.at(BaseType::Char))
+                return 1;
+            if (type->GetTypeName() == baseType.at(BaseType::Integer))
+                return 4;
+            return slotSize;
+        }
+        default: {
+            return slotSize;
+        }
+    }
+}
+
+int TypeLayout::GetAlign(PSymbolBase type) {
+    switch (type->GetSymType()) {
+        case SymType::Array: {
+            PSymbolStaticArray array = dynamic_pointer_cast<SymbolStaticArray>(type);
+            if (array == nullptr)
+                return slotSize;
+            const ArrayLayout &arrayLayout = GetArrayLayout(array);
+            return GetAlign(arrayLayout.GetType(arrayLayout.GetRank() - 1));
+        }
+        case SymType::Record: {
+            return GetRecordLayout(dynamic_pointer_cast<SymbolRecord>(type)).GetAlign();
+        }
+        case SymType::BaseType: {
+            return GetSize(type);
+        }
+        default: {
+            return slotSize;
+        }
+    }
+}
+
+// Computed once per array type: the chain of nested static arrays is walked to its element type,
+// whose size gives the innermost stride.
+const ArrayLayout &TypeLayout::GetArrayLayout(PSymbolStaticArray array) {
+    auto found = arrays.find(array.get());
+    if (found != arrays.end())
+        return found->second;
+    ArrayLayout layout;
+    PSymbolBase type = array;
+    for (PSymbolStaticArray dimension = array; dimension != nullptr;
+            dimension = dynamic_pointer_cast<SymbolStaticArray>(type)) {
+        type = dimension->GetType();
+        layout.AddDimension(dimension->GetSubRange(), type);
+    }
+    layout.SetElementSize(GetSize(type));
+    return arrays[array.get()] = layout;
+}
+
+// Aligned records pad each field to its natural alignment. Packed records have no padding and
+// byte alignment. Reordered records place fields by decreasing alignment, stable within equal
+// alignments, which leaves padding only at the end.
+const RecordLayout &TypeLayout::GetRecordLayout(PSymbolRecord record) {
+    auto found = records.find(record.get());
+    if (found != records.end())
+        return found->second;
+    vector<PSymbolComplex> fields = record->GetFields()->GetSymbols();
+    RecordPacking packing = record->GetPacking();
+    if (packing == RecordPacking::Reordered)
+        stable_sort(fields.begin(), fields.end(), [this](const PSymbolComplex &first, const PSymbolComplex &second) {
+            return GetAlign(first->GetType()) > GetAlign(second->GetType());
+        });
+    RecordLayout layout;
+    int offset = 0, align = 1;
+    for (const auto &field: fields) {
+        int fieldAlign = packing == RecordPacking::Packed ? 1 : GetAlign(field->GetType());
+        offset = AlignUp(offset, fieldAlign);
+        string name = field->GetName();
+        transform(name.begin(), name.end(), name.begin(), ::tolower);
+        layout.AddField(name, field->GetType(), offset);
+        offset += GetSize(field->GetType());
+        align = max(align, fieldAlign);
+    }
+    layout.SetSize(AlignUp(offset, align), align);
+    return records[record.get()] = layout;
+}
+
+int TypeLayout::AlignUp(int offset, int align) {
+    return (offset + align - 1) / align * align;
+}
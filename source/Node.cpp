@@ -13,6 +13,11 @@ const PToken Node::GetToken() const {
     return PToken(new Token(token));
 }
 
+// Moves the node down by lines, as when the body it is in moved; see AnalysisCache.
+void Node::Relocate(int lines, PSymbolTableStack tableStack) {
+    token.SetLine(token.GetLine() + lines);
+}
+
 void NodeOp::SetType(PSymbolBase type) {
     this->type = type;
 }
@@ -37,11 +42,19 @@ void NodeBinOp::SetRight(PNodeOp right) {
     this->right = right;
 }
 
-void NodeBinOp::Print(int depth) {
-    cout << string(depth * spacesCount, ' ');
-    cout << token.GetValue() << endl;
-    left->Print(depth + 1);
-    right->Print(depth + 1);
+void NodeBinOp::Print(std::ostream &out, int depth) {
+    out << string(depth * spacesCount, ' ');
+    out << token.GetValue() << endl;
+    left->Print(out, depth + 1);
+    right->Print(out, depth + 1);
+}
+
+// Operators take their type again from their operands, whose types are this run's.
+void NodeBinOp::Relocate(int lines, PSymbolTableStack tableStack) {
+    Node::Relocate(lines, tableStack);
+    left->Relocate(lines, tableStack);
+    right->Relocate(lines, tableStack);
+    CalcType();
 }
 
 bool NodeBinOp::CheckTypes(std::string type1, std::string type2) {
@@ -73,6 +86,8 @@ void NodeBinOp::CalcType() {
     State op = token.GetState();
     if (relationalOp.find(op) != relationalOp.end())
         type = basicSymbol.at(BaseType::Integer);
+    else if (op == Slash)
+        type = basicSymbol.at(BaseType::Double);
 }
 
 const PNodeOp NodeBinOp::GetLeft() const {
@@ -156,6 +171,9 @@ bool NodeAssignmentOp::CheckAssignmentOp() {
 bool NodeAssignmentOp::CheckOp() {
     string intType = baseType.at(BaseType::Integer);
     string doubleType = baseType.at(BaseType::Double);
+    // a /= b is a := a / b, and / gives a double that an integer cannot hold.
+    if (GetTypeName() == intType && token.GetState() == SlashEqual)
+        throw IncompatibleTypes(token, doubleType, intType);
     if (GetTypeName() == intType || GetTypeName() == doubleType)
         return CheckAssignmentOp();
     if (token.GetState() != ColonEqual)
@@ -178,12 +196,27 @@ void NodePeriod::SetField(PToken field) {
     this->field = *field;
 }
 
-void NodePeriod::Print(int depth) {
-    cout << string(depth * spacesCount, ' ');
-    cout << token.GetValue() << endl;
-    name->Print(depth + 1);
-    cout << string((depth + 1) * spacesCount, ' ');
-    cout << field.GetValue() << endl;
+const PNodeOp NodePeriod::GetName() const {
+    return name;
+}
+
+const Token &NodePeriod::GetField() const {
+    return field;
+}
+
+void NodePeriod::Print(std::ostream &out, int depth) {
+    out << string(depth * spacesCount, ' ');
+    out << token.GetValue() << endl;
+    name->Print(out, depth + 1);
+    out << string((depth + 1) * spacesCount, ' ');
+    out << field.GetValue() << endl;
+}
+
+void NodePeriod::Relocate(int lines, PSymbolTableStack tableStack) {
+    Node::Relocate(lines, tableStack);
+    field.SetLine(field.GetLine() + lines);
+    name->Relocate(lines, tableStack);
+    CalcType();
 }
 
 void NodePeriod::CalcType() {
@@ -202,10 +235,16 @@ void NodeUnOp::SetNode(PNodeOp node) {
     this->node = node;
 }
 
-void NodeUnOp::Print(int depth) {
-    cout << string(depth * spacesCount, ' ');
-    cout << token.GetValue() << endl;
-    node->Print(depth + 1);
+void NodeUnOp::Print(std::ostream &out, int depth) {
+    out << string(depth * spacesCount, ' ');
+    out << token.GetValue() << endl;
+    node->Print(out, depth + 1);
+}
+
+void NodeUnOp::Relocate(int lines, PSymbolTableStack tableStack) {
+    Node::Relocate(lines, tableStack);
+    node->Relocate(lines, tableStack);
+    CalcType();
 }
 
 bool NodeUnOp::CheckOp() {
@@ -246,9 +285,31 @@ NodeValue::NodeValue(PToken token, PSymbolBase type) : NodeOp(token) {
 
 NodeValue::NodeValue(PToken token) : NodeOp(token) {}
 
-void NodeValue::Print(int depth) {
-    cout << string(depth * spacesCount, ' ');
-    cout << token.GetValue() << endl;
+void NodeValue::SetSymbol(PSymbolComplex symbol) {
+    this->symbol = symbol;
+}
+
+const PSymbolComplex NodeValue::GetSymbol() const {
+    return symbol;
+}
+
+void NodeValue::Print(std::ostream &out, int depth) {
+    out << string(depth * spacesCount, ' ');
+    out << token.GetValue() << endl;
+}
+
+// An identifier is bound again to the symbol of that name in tableStack, the scope it was parsed in
+// as declared on this run, and takes that symbol's type, so that no type of an earlier run's tables
+// is left in the tree. A function's name assigned its result has the result type instead.
+void NodeValue::Relocate(int lines, PSymbolTableStack tableStack) {
+    Node::Relocate(lines, tableStack);
+    if (symbol == nullptr)
+        return;
+    bool result = type->GetSymType() != symbol->GetType()->GetSymType();
+    symbol = tableStack->FindSymbol(token.GetText());
+    type = symbol->GetType();
+    if (result)
+        type = dynamic_pointer_cast<SymbolFuncHeader>(type)->GetReturnType();
 }
 
 any NodeValue::CalcValue(PSymbolTableStack stack) {
@@ -269,18 +330,34 @@ void NodeStructured::AddParameter(PNodeOp node) {
     parameters.push_back(node);
 }
 
-void NodeStructured::Print(string value, int depth) {
-    cout << string(depth * spacesCount, ' ');
-    cout << value << endl;
-    name->Print(depth + 1);
+const PNodeOp NodeStructured::GetName() const {
+    return name;
+}
+
+const std::vector<PNodeOp> &NodeStructured::GetParameters() const {
+    return parameters;
+}
+
+void NodeStructured::Print(std::ostream &out, string value, int depth) {
+    out << string(depth * spacesCount, ' ');
+    out << value << endl;
+    name->Print(out, depth + 1);
     for (const auto& param: parameters)
-        param->Print(depth + 1);
+        param->Print(out, depth + 1);
+}
+
+void NodeStructured::Relocate(int lines, PSymbolTableStack tableStack) {
+    Node::Relocate(lines, tableStack);
+    name->Relocate(lines, tableStack);
+    for (const auto &param: parameters)
+        param->Relocate(lines, tableStack);
+    CalcType();
 }
 
 NodeBrackets::NodeBrackets(PToken token, PNodeOp name) : NodeStructured(token, name) {}
 
-void NodeBrackets::Print(int depth) {
-    NodeStructured::Print("[]", depth);
+void NodeBrackets::Print(std::ostream &out, int depth) {
+    NodeStructured::Print(out, "[]", depth);
 }
 
 void NodeBrackets::CalcType() {
@@ -296,10 +373,18 @@ void NodeBrackets::CalcType() {
     this->type = type;
 }
 
+void NodeBrackets::SetRangeChecked(bool checked) {
+    rangeChecked = checked;
+}
+
+bool NodeBrackets::IsRangeChecked() const {
+    return rangeChecked;
+}
+
 NodeParenthesiss::NodeParenthesiss(PToken token, PNodeOp name) : NodeStructured(token, name) {}
 
-void NodeParenthesiss::Print(int depth) {
-    NodeStructured::Print("()", depth);
+void NodeParenthesiss::Print(std::ostream &out, int depth) {
+    NodeStructured::Print(out, "()", depth);
 }
 
 void NodeParenthesiss::CalcType() {
@@ -331,28 +416,46 @@ void NodeParenthesiss::CalcType() {
 
 NodeCompoundStatement::NodeCompoundStatement(PToken token) : Node(token) {}
 
-void NodeCompoundStatement::Print(int depth) {
-    cout << string(depth * spacesCount, ' ');
-    cout << token.GetValue() << endl;
+void NodeCompoundStatement::Print(std::ostream &out, int depth) {
+    out << string(depth * spacesCount, ' ');
+    out << token.GetValue() << endl;
     for (const auto& statement: statements)
-        statement->Print(depth + 1);
-    cout << string(depth * spacesCount, ' ');
-    cout << "end" << endl;
+        statement->Print(out, depth + 1);
+    out << string(depth * spacesCount, ' ');
+    out << "end" << endl;
+}
+
+void NodeCompoundStatement::Relocate(int lines, PSymbolTableStack tableStack) {
+    Node::Relocate(lines, tableStack);
+    for (const auto &statement: statements)
+        statement->Relocate(lines, tableStack);
 }
 
 void NodeCompoundStatement::AddStatement(PNode node) {
     statements.push_back(node);
 }
 
+const std::vector<PNode> &NodeCompoundStatement::GetStatements() const {
+    return statements;
+}
+
 NodeIfStatement::NodeIfStatement(PToken token) : Node(token) {}
 
-void NodeIfStatement::Print(int depth) {
-    cout << string(depth * spacesCount, ' ');
-    cout << token.GetValue() << endl;
-    ifNode->Print(depth + 1);
-    thenNode->Print(depth + 1);
+void NodeIfStatement::Print(std::ostream &out, int depth) {
+    out << string(depth * spacesCount, ' ');
+    out << token.GetValue() << endl;
+    ifNode->Print(out, depth + 1);
+    thenNode->Print(out, depth + 1);
+    if (elseNode != nullptr)
+        elseNode->Print(out, depth + 1);
+}
+
+void NodeIfStatement::Relocate(int lines, PSymbolTableStack tableStack) {
+    Node::Relocate(lines, tableStack);
+    ifNode->Relocate(lines, tableStack);
+    thenNode->Relocate(lines, tableStack);
     if (elseNode != nullptr)
-        elseNode->Print(depth + 1);
+        elseNode->Relocate(lines, tableStack);
 }
 
 void NodeIfStatement::SetIfNode(PNodeOp node) {
@@ -367,16 +470,36 @@ void NodeIfStatement::SetElseNode(PNode node) {
     elseNode = node;
 }
 
+const PNodeOp NodeIfStatement::GetIfNode() const {
+    return ifNode;
+}
+
+const PNode NodeIfStatement::GetThenNode() const {
+    return thenNode;
+}
+
+const PNode NodeIfStatement::GetElseNode() const {
+    return elseNode;
+}
+
 NodeForStatement::NodeForStatement(PToken token) : Node(token) {}
 
-void NodeForStatement::Print(int depth) {
-    cout << string(depth * spacesCount, ' ');
-    cout << token.GetValue() << endl;
-    cout << string(depth * spacesCount, ' ');
-    cout << toType.GetValue() << endl;
-    controlVar->Print(depth + 1);
-    finalVar->Print(depth + 1);
-    doSt->Print(depth + 1);
+void NodeForStatement::Print(std::ostream &out, int depth) {
+    out << string(depth * spacesCount, ' ');
+    out << token.GetValue() << endl;
+    out << string(depth * spacesCount, ' ');
+    out << toType.GetValue() << endl;
+    controlVar->Print(out, depth + 1);
+    finalVar->Print(out, depth + 1);
+    doSt->Print(out, depth + 1);
+}
+
+void NodeForStatement::Relocate(int lines, PSymbolTableStack tableStack) {
+    Node::Relocate(lines, tableStack);
+    toType.SetLine(toType.GetLine() + lines);
+    controlVar->Relocate(lines, tableStack);
+    finalVar->Relocate(lines, tableStack);
+    doSt->Relocate(lines, tableStack);
 }
 
 void NodeForStatement::SetToType(PToken toType) {
@@ -395,6 +518,22 @@ void NodeForStatement::SetDoSt(PNode doSt) {
     this->doSt = doSt;
 }
 
+const Token &NodeForStatement::GetToType() const {
+    return toType;
+}
+
+const PNodeAssignmentOp NodeForStatement::GetControlVar() const {
+    return controlVar;
+}
+
+const PNodeOp NodeForStatement::GetFinalVar() const {
+    return finalVar;
+}
+
+const PNode NodeForStatement::GetDoSt() const {
+    return doSt;
+}
+
 NodeWhileStatement::NodeWhileStatement(PToken token) : Node(token) {}
 
 void NodeWhileStatement::SetCondition(PNodeOp condition) {
@@ -405,12 +544,54 @@ void NodeWhileStatement::AddStatement(PNode statement) {
     statements.push_back(statement);
 }
 
-void NodeWhileStatement::Print(int depth) {
-    cout << string(depth * spacesCount, ' ');
-    cout << token.GetValue() << endl;
-    condition->Print(depth + 1);
+const std::vector<PNode> &NodeWhileStatement::GetStatements() const {
+    return statements;
+}
+
+const PNodeOp NodeWhileStatement::GetCondition() const {
+    return condition;
+}
+
+void NodeWhileStatement::Print(std::ostream &out, int depth) {
+    out << string(depth * spacesCount, ' ');
+    out << token.GetValue() << endl;
+    condition->Print(out, depth + 1);
     for (auto& st: statements)
-        st->Print(depth + 1);
+        st->Print(out, depth + 1);
+}
+
+void NodeWhileStatement::Relocate(int lines, PSymbolTableStack tableStack) {
+    Node::Relocate(lines, tableStack);
+    condition->Relocate(lines, tableStack);
+    for (const auto &statement: statements)
+        statement->Relocate(lines, tableStack);
+}
+
+NodeRepeatStatement::NodeRepeatStatement(PToken token) : NodeWhileStatement(token) {}
+
+NodeWriteStatement::NodeWriteStatement(PToken token, bool newLine) : Node(token), newLine(newLine) {}
+
+void NodeWriteStatement::AddParameter(PNodeOp node) {
+    parameters.push_back(node);
+}
+
+const std::vector<PNodeOp> &NodeWriteStatement::GetParameters() const {
+    return parameters;
+}
+
+bool NodeWriteStatement::IsNewLine() const {
+    return newLine;
 }
 
-NodeRepeatStatement::NodeRepeatStatement(PToken token) : NodeWhileStatement(token) {}
\ No newline at end of file
+void NodeWriteStatement::Print(std::ostream &out, int depth) {
+    out << string(depth * spacesCount, ' ');
+    out << token.GetValue() << endl;
+    for (const auto& param: parameters)
+        param->Print(out, depth + 1);
+}
+
+void NodeWriteStatement::Relocate(int lines, PSymbolTableStack tableStack) {
+    Node::Relocate(lines, tableStack);
+    for (const auto &param: parameters)
+        param->Relocate(lines, tableStack);
+}
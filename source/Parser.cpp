@@ -2,66 +2,206 @@
 #include <vector>
 #include <map>
 #include <algorithm>
+#include <fstream>
+#include <iterator>
 #include "Parser.h"
 #include "Error.h"
 
 using namespace std;
 
-void Parser::PrintTree() {
-    PrintTree(tree);
-}
-
-void Parser::PrintTree(PNode node) {
-    node->Print();
-}
-
-Parser::Parser(const char* fileName, ParserConfig parserConfig) :
-        scanner(new Scanner(fileName)), parserConfig(parserConfig),
-        tableStack(new SymbolTableStack()) {
-    priorityTable = {
-            {
-                    Not,
-                    Plus,
-                    Minus
-            },
-            {
-                    Asterisk,
-                    Slash,
-                    Div,
-                    Mod,
-                    And,
-                    Shr,
-                    GreaterThanGreaterThan,
-                    Shl,
-                    LessThanLessThan
-            },
-            {
-                    Plus,
-                    Minus,
-                    Or,
-                    Xor
-            },
-            {
-                    Equal,
-                    LessThanGreaterThan,
-                    LessThan,
-                    GreaterThan,
-                    LessThanEqual,
-                    GreaterThanEqual
-            }
-    };
+ProcedureScope::ProcedureScope(int firstLine, int endLine, PSymbolTableStack symbols) :
+        firstLine(firstLine), endLine(endLine), symbols(symbols) {}
+
+int ProcedureScope::GetFirstLine() const {
+    return firstLine;
+}
+
+int ProcedureScope::GetEndLine() const {
+    return endLine;
+}
+
+const PSymbolTableStack ProcedureScope::GetSymbols() const {
+    return symbols;
+}
+
+Declaration::Declaration(PSymbolTable table, PSymbolTable top, const Token &token) :
+        table(table), top(top), token(token) {}
+
+const Token &Declaration::GetToken() const {
+    return token;
+}
+
+// A name is checked against one table, but some, such as a procedure's locals, go into the innermost
+// table instead.
+PSymbolComplex Declaration::FindSymbol() const {
+    string name = token.GetValue();
+    transform(name.begin(), name.end(), name.begin(), ::tolower);
+    PSymbolComplex symbol = table->FindSymbol(name);
+    return symbol != nullptr ? symbol : top->FindSymbol(name);
+}
+
+void Parser::PrintTree(std::ostream &out) {
+    PrintTree(out, tree);
+}
+
+void Parser::PrintTree(std::ostream &out, PNode node) {
+    node->Print(out);
+}
 
+static const vector<set<State>> priorityTable = {
+        {
+                Not,
+                Plus,
+                Minus
+        },
+        {
+                Asterisk,
+                Slash,
+                Div,
+                Mod,
+                And,
+                Shr,
+                GreaterThanGreaterThan,
+                Shl,
+                LessThanLessThan
+        },
+        {
+                Plus,
+                Minus,
+                Or,
+                Xor
+        },
+        {
+                Equal,
+                LessThanGreaterThan,
+                LessThan,
+                GreaterThan,
+                LessThanEqual,
+                GreaterThanEqual
+        }
+};
+
+// A pipelined parser scans on a second thread; see PipelinedScanner. A parser with a cache takes the
+// bodies it can from there; see AnalysisCache.
+Parser::Parser(const char* fileName, ParserConfig parserConfig, int threads, bool pipelined, PAnalysisCache cache) :
+        scanner(pipelined ? new PipelinedScanner(fileName) : new Scanner(fileName)), parserConfig(parserConfig),
+        tableStack(new SymbolTableStack()), fileName(fileName), threads(threads), bodyFailed(false),
+        interfaceSection(false), cache(cache) {
     CreateGlobalTable();
     Run();
 }
 
+// Parses a single procedure body from a scanner resumed at its begin; see ParseBody.
+Parser::Parser(PScanner scanner, PSymbolTableStack tableStack, PSymbolFunction currentFunction) :
+        scanner(scanner), parserConfig(ParserConfig::ParseProgram), tableStack(tableStack),
+        currentFunction(currentFunction), threads(1), bodyFailed(false), interfaceSection(false) {}
+
 void Parser::Run() {
     if (parserConfig == ParserConfig::ParseExpression)
         tree = ParseExpression(ExprType::Var);
-    else if (parserConfig == ParserConfig::ParseProgram)
+    else if (threads > 1 || cache != nullptr)
+        ParseProgramInParallel();
+    else
         ParseProgram();
 }
 
+// Procedure bodies are set aside while the declarations around them are parsed, then go to the pool
+// while the main block is parsed here. If anything fails, the program is parsed again on this thread
+// alone, so that diagnostics are exactly those of a sequential parse; every body counts as recomputed
+// then, and the cache keeps what it had.
+void Parser::ParseProgramInParallel() {
+    pool = PThreadPool(new ThreadPool(max(threads, 1)));
+    if (cache != nullptr) {
+        ifstream file(fileName);
+        source.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        cache->Start();
+    }
+    bool parsed = true;
+    try {
+        ParseProgram();
+    }
+    catch (...) {
+        parsed = false;
+    }
+    pool->Wait();
+    pool = nullptr;
+    bodies.clear();
+    if (parsed && !bodyFailed) {
+        if (cache != nullptr)
+            cache->Finish();
+        return;
+    }
+    recomputed.clear();
+    scanner = PScanner(new Scanner(fileName.c_str()));
+    tableStack = PSymbolTableStack(new SymbolTableStack());
+    currentFunction = nullptr;
+    units.clear();
+    unit = nullptr;
+    forwards.clear();
+    scopes.clear();
+    declarations.clear();
+    interfaceSection = false;
+    CreateGlobalTable();
+    ParseProgram();
+}
+
+// A body only reads the scopes around it, so it can be parsed on its own against a snapshot of them
+// once the skip below has found where it ends. The body parser must stop at the same token. With a
+// cache, the text the skip went over and the snapshot give the key the body is found by.
+void Parser::ParseBody(PSymbolProcedure procedure) {
+    PToken token = scanner->GetToken();
+    if (pool == nullptr || token->GetState() != Begin || scanner->IsGettedToken()) {
+        if (cache != nullptr)
+            recomputed.push_back(procedure->GetName());
+        procedure->SetBody(ParseLocalCompoundStatement());
+        return;
+    }
+    ScannerPosition position = scanner->GetPosition();
+    PSymbolTableStack snapshot = tableStack->Snapshot();
+    PSymbolFunction function = currentFunction;
+    SkipCompoundStatement();
+    int line = token->GetLine(), column = token->GetColumn();
+    string key;
+    if (cache != nullptr) {
+        long end = scanner->GetPosition().GetOffset();
+        key = AnalysisCache::GetKey(source.substr(position.GetOffset(), end - position.GetOffset()), position,
+                                    snapshot);
+        PNode tree = cache->Find(key, position.GetLine(), snapshot);
+        if (tree != nullptr) {
+            procedure->SetBody(tree);
+            ParseSemiColons();
+            return;
+        }
+        recomputed.push_back(procedure->GetName());
+    }
+    bodies.push_back([this, procedure, position, snapshot, function, line, column, key]() {
+        try {
+            PScanner bodyScanner(new Scanner(fileName.c_str(), position));
+            Parser body(bodyScanner, snapshot, function);
+            bodyScanner->NextToken();
+            PNode tree = body.ParseCompoundStatement();
+            if (bodyScanner->GetToken()->GetLine() != line || bodyScanner->GetToken()->GetColumn() != column) {
+                bodyFailed = true;
+                return;
+            }
+            procedure->SetBody(tree);
+            if (cache != nullptr)
+                cache->Store(key, position.GetLine(), tree);
+        }
+        catch (...) {
+            bodyFailed = true;
+        }
+    });
+    ParseSemiColons();
+}
+
+// Statements nest only in begin ... end, so balancing the two finds the end of a body.
+void Parser::SkipCompoundStatement() {
+    if (!scanner->SkipBlock())
+        throw Error(ErrorType::UnexpectedEOF, *scanner->GetToken());
+    scanner->NextToken();
+}
+
 bool Parser::CheckCorrectToken(int priority) {
     return priorityTable[priority].find(scanner->GetToken()->GetState()) != priorityTable[priority].end();
 }
@@ -109,6 +249,7 @@ PNodeOp Parser::ParseExprIdentifier(PNodeOp left, ExprType exprType) {
         }
         case LeftBracket: {
             PNodeBrackets node(new NodeBrackets(token, left));
+            node->SetRangeChecked(scanner->IsRangeChecking());
             return ParseExprParameters(node, RightBracket, exprType);
         }
         case LeftParenthesis: {
@@ -185,7 +326,7 @@ PNodeOp Parser::ParseFactor(ExprType exprType) {
         }
         case TK::Identifier: {
             PNodeValue node(new NodeValue(token));
-            if (parserConfig == ParserConfig::ParseProgram) {
+            if (parserConfig != ParserConfig::ParseExpression) {
                 PSymbolComplex symbol = tableStack->FindSymbol(token->GetText());
                 if (symbol == nullptr)
                     throw IdentifierNotFound(*token, token->GetText());
@@ -194,6 +335,7 @@ PNodeOp Parser::ParseFactor(ExprType exprType) {
                 if (symbol->GetSymType() == SymType::Type)
                     throw Error(ErrorType::IllegalExpression, *token);
                 node->SetType(symbol->GetType());
+                node->SetSymbol(symbol);
             }
             return ParseExprIdentifier(node, exprType);
         }
@@ -216,7 +358,7 @@ PNodeOp Parser::ParseFactor(ExprType exprType) {
 }
 
 void Parser::CalcNodeType(PNodeOp node) {
-    if (parserConfig == ParserConfig::ParseProgram)
+    if (parserConfig != ParserConfig::ParseExpression)
         node->CalcType();
 }
 
@@ -224,6 +366,35 @@ const PNode Parser::GetTree() const {
     return tree;
 }
 
+const PSymbolTableStack Parser::GetTableStack() const {
+    return tableStack;
+}
+
+// Set once a unit has been parsed; a program has none.
+const PUnitInterface Parser::GetUnit() const {
+    return unit;
+}
+
+const std::vector<PUnitInterface> &Parser::GetUnits() const {
+    return units;
+}
+
+// The procedures whose bodies this run parsed rather than took from its cache, in the order their
+// bodies end.
+const std::vector<std::string> &Parser::GetRecomputed() const {
+    return recomputed;
+}
+
+// A procedure is listed once its body ends, after those nested in it, so the innermost scope of a line
+// is the first one listed that holds it.
+const std::vector<ProcedureScope> &Parser::GetScopes() const {
+    return scopes;
+}
+
+const std::vector<Declaration> &Parser::GetDeclarations() const {
+    return declarations;
+}
+
 void Parser::ParseTypeDeclaration(PSymbolTable table) {
     PToken token = scanner->GetToken();
     CheckTokenState(token, Type);
@@ -280,7 +451,7 @@ void Parser::ParseVarDeclaration(PSymbolTable table) {
     CheckTokenState(token, Var);
     scanner->NextToken();
     do {
-        set<string> identifiers = ParseIdentifiers(table);
+        vector<string> identifiers = ParseIdentifiers(table);
         CheckTokenState(token, Colon);
         scanner->NextToken();
         PSymbolBase type = ParseType();
@@ -326,10 +497,89 @@ void Parser::ParseDeclaration(PSymbolTable table) {
 
 void Parser::ParseProgram() {
     scanner->NextToken();
+    if (scanner->GetToken()->GetState() == Unit || parserConfig == ParserConfig::ParseUnit) {
+        ParseUnit();
+        return;
+    }
+    ParseUses();
     ParseDeclaration(tableStack->Top());
+    for (const auto &body: bodies)
+        pool->Submit(body);
     tree = ParseGlobalCompoundStatement();
 }
 
+// The interface section declares what other files may use: types, constants, variables and the
+// headings of procedures and functions, whose bodies follow in the implementation section. Only the
+// interface's symbols are exported; a unit ends with "end." or with a main block run at startup.
+void Parser::ParseUnit() {
+    PToken token = scanner->GetToken();
+    CheckTokenState(token, Unit);
+    scanner->NextToken();
+    CheckTokenType(token, TK::Identifier);
+    string name = token->GetValue();
+    scanner->NextToken();
+    ParseSemiColon();
+    CheckTokenState(token, Interface);
+    scanner->NextToken();
+    ParseUses();
+    PSymbolTable globals = tableStack->Top();
+    int first = globals->Size();
+    interfaceSection = true;
+    ParseDeclaration(globals);
+    interfaceSection = false;
+    int last = globals->Size();
+    CheckTokenState(token, Implementation);
+    scanner->NextToken();
+    ParseDeclaration(globals);
+    if (!forwards.empty())
+        throw ForwardNotSolved(*token, forwards.front()->GetName());
+    for (const auto &body: bodies)
+        pool->Submit(body);
+    if (token->GetState() == Begin) {
+        tree = ParseGlobalCompoundStatement();
+    } else {
+        CheckTokenState(token, End, Begin);
+        tree = PNode(new NodeCompoundStatement(token));
+        scanner->NextToken();
+        CheckTokenState(token, Period);
+    }
+    PSymbolTable exported(new SymbolTable());
+    for (int i = first; i < last; i++)
+        exported->AddSymbol(globals->GetSymbols()[i]);
+    unit = PUnitInterface(new UnitInterface(name, fileName, exported, units));
+}
+
+// Every unit named is read from its interface file beside this one. The units' symbols go below the
+// globals, so that the file's own declarations hide them, and a later unit hides an earlier one.
+void Parser::ParseUses() {
+    PToken token = scanner->GetToken();
+    if (token->GetState() != Uses)
+        return;
+    do {
+        scanner->NextToken();
+        CheckTokenType(token, TK::Identifier);
+        string name = token->GetValue();
+        transform(name.begin(), name.end(), name.begin(), ::tolower);
+        for (const auto &used: units) {
+            string usedName = used->GetName();
+            transform(usedName.begin(), usedName.end(), usedName.begin(), ::tolower);
+            if (usedName == name)
+                throw DuplicateIdentifier(*token, token->GetValue());
+        }
+        string interfaceName = UnitInterface::GetFileName(fileName, name);
+        if (!ifstream(interfaceName).is_open())
+            throw UnitNotFound(*token, token->GetValue());
+        units.push_back(PUnitInterface(new UnitInterface(interfaceName)));
+        scanner->NextToken();
+    } while (token->GetState() == Comma);
+    ParseSemiColon();
+    PSymbolTable globals = tableStack->Top();
+    tableStack->Pop();
+    for (const auto &used: units)
+        tableStack->AddTable(used->GetSymbols());
+    tableStack->AddTable(globals);
+}
+
 PNodeAssignmentOp Parser::ParseAssignmentOperator() {
     PToken token = scanner->GetToken();
     if (assignmentOperators.find(token->GetState()) == assignmentOperators.end())
@@ -370,6 +620,8 @@ PNode Parser::ParseStatement() {
     PToken token = scanner->GetToken();
     switch (token->GetType()) {
         case TK::Identifier: {
+            if (IsWriteStatement())
+                return ParseWriteStatement();
             PSymbolComplex ident = ParseExistingIdentifier();
             SymType symType = ident->GetSymType();
             scanner->PrevToken();
@@ -379,6 +631,8 @@ PNode Parser::ParseStatement() {
                 ParseSemiColons();
                 return node;
             }
+            if (ident == currentFunction && node->GetNodeType() == NodeType::NodeValue)
+                node->SetType(dynamic_pointer_cast<SymbolFuncHeader>(currentFunction->GetType())->GetReturnType());
             if (node->GetNodeType() == NodeType::NodePeriod ||
                     node->GetNodeType() == NodeType::NodeBrackets ||
                     node->GetNodeType() == NodeType::NodeValue)
@@ -407,6 +661,38 @@ PNodeAssignmentOp Parser::ParseAssignmentStatement(PNodeOp left) {
     return op;
 }
 
+bool Parser::IsWriteStatement() {
+    PToken token = scanner->GetToken();
+    string text = token->GetText();
+    transform(text.begin(), text.end(), text.begin(), ::tolower);
+    return (text == "write" || text == "writeln") && !tableStack->HaveSymbol(text);
+}
+
+PNode Parser::ParseWriteStatement() {
+    PToken token = scanner->GetToken();
+    string text = token->GetText();
+    transform(text.begin(), text.end(), text.begin(), ::tolower);
+    PNodeWriteStatement node(new NodeWriteStatement(token, text == "writeln"));
+    scanner->NextToken();
+    if (token->GetState() == LeftParenthesis) {
+        scanner->NextToken();
+        if (token->GetState() != RightParenthesis) {
+            scanner->PrevToken();
+            do {
+                PNodeOp param = ParseExpression();
+                if (param->GetType()->GetSymType() != SymType::BaseType &&
+                        param->GetType()->GetSymType() != SymType::SubRange)
+                    throw Error(ErrorType::IllegalExpression, *param->GetToken());
+                node->AddParameter(param);
+            } while (token->GetState() == Comma);
+        }
+        CheckTokenState(token, RightParenthesis);
+        scanner->NextToken();
+    }
+    ParseSemiColons();
+    return node;
+}
+
 PNode Parser::ParseProcedureStatement() {
     scanner->PrevToken();
     PNodeOp node = ParseExpression();
@@ -469,6 +755,7 @@ PNode Parser::ParseForStatement() {
     if (ident->GetSymType() != SymType::Var)
         throw Error(ErrorType::IllegalExpression, *token);
     variable->SetType(ident->GetType());
+    variable->SetSymbol(ident);
     scanner->NextToken();
     CheckTokenState(token, ColonEqual);
     PNodeAssignmentOp assignmentOp(new NodeAssignmentOp(token));
@@ -552,7 +839,9 @@ void Parser::ParseFunctionDeclaration(PSymbolTable table) {
     PToken token = scanner->GetToken();
     CheckTokenState(token, Function);
     scanner->NextToken();
-    string ident = ParseIdentifier(table);
+    Token name = *token;
+    PSymbolProcedure forward = FindForward(table);
+    string ident = forward != nullptr ? forward->GetName() : ParseIdentifier(table);
     scanner->NextToken();
     PSymbolFuncHeader header(new SymbolFuncHeader());
     PSymbolTable args = header->GetArgs();
@@ -563,35 +852,81 @@ void Parser::ParseFunctionDeclaration(PSymbolTable table) {
     header->SetReturnType(type);
     ParseSemiColon();
     PSymbolTable locals(new SymbolTable());
+    PSymbolProcedure declared(new SymbolFunction(ident, header, locals));
+    PSymbolFunction function = dynamic_pointer_cast<SymbolFunction>(DeclareProcedure(declared, forward, name));
+    if (interfaceSection)
+        return;
+    args = dynamic_pointer_cast<SymbolProcHeader>(function->GetType())->GetArgs();
+    PSymbolFunction outerFunction = currentFunction;
+    currentFunction = function;
     tableStack->AddTable(args);
-    tableStack->AddTable(locals);
+    tableStack->AddTable(function->GetLocals());
     ParseDeclaration(args);
-    ParseLocalCompoundStatement();
+    PSymbolTableStack scope = tableStack->Snapshot();
+    ParseBody(function);
+    scopes.emplace_back(name.GetLine(), scanner->GetToken()->GetLine(), scope);
     tableStack->Pop();
     tableStack->Pop();
-    PSymbolFunction function(new SymbolFunction(ident, header, locals));
-    tableStack->Top()->AddSymbol(function);
+    currentFunction = outerFunction;
 }
 
 void Parser::ParseProcedureDeclaration(PSymbolTable table) {
     PToken token = scanner->GetToken();
     CheckTokenState(token, Procedure);
     scanner->NextToken();
-    string ident = ParseIdentifier(table);
+    Token name = *token;
+    PSymbolProcedure forward = FindForward(table);
+    string ident = forward != nullptr ? forward->GetName() : ParseIdentifier(table);
     scanner->NextToken();
     PSymbolProcHeader header(new SymbolProcHeader());
     PSymbolTable args = header->GetArgs();
     ParseExpParameterList(args);
     ParseSemiColon();
     PSymbolTable locals(new SymbolTable());
+    PSymbolProcedure procedure = DeclareProcedure(PSymbolProcedure(new SymbolProcedure(ident, header, locals)),
+                                                  forward, name);
+    if (interfaceSection)
+        return;
+    args = dynamic_pointer_cast<SymbolProcHeader>(procedure->GetType())->GetArgs();
+    PSymbolFunction outerFunction = currentFunction;
+    currentFunction = nullptr;
     tableStack->AddTable(args);
-    tableStack->AddTable(locals);
+    tableStack->AddTable(procedure->GetLocals());
     ParseDeclaration(args);
-    ParseLocalCompoundStatement();
+    PSymbolTableStack scope = tableStack->Snapshot();
+    ParseBody(procedure);
+    scopes.emplace_back(name.GetLine(), scanner->GetToken()->GetLine(), scope);
     tableStack->Pop();
     tableStack->Pop();
-    PSymbolProcedure procedure(new SymbolProcedure(ident, header, locals));
+    currentFunction = outerFunction;
+}
+
+// The interface heading a declaration in a unit's implementation completes, if it completes one.
+PSymbolProcedure Parser::FindForward(PSymbolTable table) {
+    PToken token = scanner->GetToken();
+    if (forwards.empty() || token->GetType() != TK::Identifier)
+        return nullptr;
+    string name = token->GetValue();
+    transform(name.begin(), name.end(), name.begin(), ::tolower);
+    PSymbolProcedure procedure = dynamic_pointer_cast<SymbolProcedure>(table->FindSymbol(name));
+    if (find(forwards.begin(), forwards.end(), procedure) == forwards.end())
+        return nullptr;
+    return procedure;
+}
+
+// A declaration completing an interface heading has to repeat it exactly; the heading's symbol is
+// the one that gets the body.
+PSymbolProcedure Parser::DeclareProcedure(PSymbolProcedure procedure, PSymbolProcedure forward, Token &name) {
+    if (forward != nullptr) {
+        if (forward->GetSymType() != procedure->GetSymType() || forward->GetTypeName() != procedure->GetTypeName())
+            throw DuplicateIdentifier(name, name.GetValue());
+        forwards.erase(find(forwards.begin(), forwards.end(), forward));
+        return forward;
+    }
     tableStack->Top()->AddSymbol(procedure);
+    if (interfaceSection)
+        forwards.push_back(procedure);
+    return procedure;
 }
 
 void Parser::ParseExpParameterList(PSymbolTable table) {
@@ -617,7 +952,7 @@ void Parser::ParseParameterList(PSymbolTable table) {
 }
 
 void Parser::ParseValueParameters(PSymbolTable table) {
-    set<string> identifiers = ParseIdentifiers(table);
+    vector<string> identifiers = ParseIdentifiers(table);
     PToken token = scanner->GetToken();
     CheckTokenState(token, Colon);
     scanner->NextToken();
@@ -737,9 +1072,13 @@ PSymbolRecord Parser::ParseRecord() {
     PToken token = scanner->GetToken();
     CheckTokenState(token, Record);
     PSymbolRecord record(new SymbolRecord());
+    if (scanner->IsPackingRecords())
+        record->SetPacking(RecordPacking::Packed);
+    else if (scanner->IsReorderingRecords())
+        record->SetPacking(RecordPacking::Reordered);
     scanner->NextToken();
     while (token->GetState() != End) {
-        set<string> identifiers = ParseIdentifiers(record->GetFields());
+        vector<string> identifiers = ParseIdentifiers(record->GetFields());
         CheckTokenState(token, Colon);
         scanner->NextToken();
         PSymbolBase type = ParseType();
@@ -767,6 +1106,14 @@ PSymbolBase Parser::ParseType() {
     if (token->GetState() == Record) {
         return ParseRecord();
     }
+    if (token->GetState() == Packed) {
+        scanner->NextToken();
+        if (token->GetState() == Array)
+            return ParseArray();
+        PSymbolRecord record = ParseRecord();
+        record->SetPacking(RecordPacking::Packed);
+        return record;
+    }
     return ParseSubRange();
 }
 
@@ -780,15 +1127,17 @@ PSymbolBase Parser::ParseSimpleType() {
     return type;
 }
 
-set<string> Parser::ParseIdentifiers(PSymbolTable table) {
+// The identifiers in the order they are declared, which parameter lists bind arguments by.
+vector<string> Parser::ParseIdentifiers(PSymbolTable table) {
     PToken token = scanner->GetToken();
-    set<string> identifiers;
+    vector<string> identifiers;
+    set<string> seen;
     while (true) {
         string ident = ParseIdentifier(table);
         transform(ident.begin(), ident.end(), ident.begin(), ::tolower);
-        if (identifiers.find(ident) != identifiers.end())
+        if (!seen.insert(ident).second)
             throw DuplicateIdentifier(*token, token->GetValue());
-        identifiers.insert(ident);
+        identifiers.push_back(ident);
         scanner->NextToken();
         if (token->GetState() != Comma)
             break;
@@ -802,6 +1151,7 @@ string Parser::ParseIdentifier(PSymbolTable table) {
     CheckTokenType(token, TK::Identifier);
     if (table->HaveSymbol(token->GetValue()))
         throw DuplicateIdentifier(*token, token->GetValue());
+    declarations.emplace_back(table, tableStack->Top(), *token);
     return token->GetValue();
 }
 
@@ -843,6 +1193,6 @@ void Parser::SetCorrectType(PNodeOp node, std::string type) {
     CheckNodeType(node, type);
 }
 
-void Parser::PrintStack() {
-    tableStack->Print();
+void Parser::PrintStack(std::ostream &out) {
+    tableStack->Print(out);
 }
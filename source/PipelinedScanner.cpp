@@ -0,0 +1,149 @@
+#include "PipelinedScanner.h"
+
+using namespace std;
+
+ScannedToken::ScannedToken() : endOfFile(false) {}
+
+ScannedToken::ScannedToken(const Token &token, const ScannerPosition &position, bool endOfFile) :
+        token(token), position(position), endOfFile(endOfFile) {}
+
+ScannedToken::ScannedToken(std::exception_ptr error) : endOfFile(false), error(error) {}
+
+const Token &ScannedToken::GetToken() const {
+    return token;
+}
+
+const ScannerPosition &ScannedToken::GetPosition() const {
+    return position;
+}
+
+bool ScannedToken::IsEndOfFile() const {
+    return endOfFile;
+}
+
+bool ScannedToken::IsFailed() const {
+    return error != nullptr;
+}
+
+void ScannedToken::Rethrow() const {
+    if (error != nullptr)
+        rethrow_exception(error);
+}
+
+// The capacity must be a power of two.
+TokenRing::TokenRing(int capacity) : entries(capacity), mask(capacity - 1), head(0), tail(0) {}
+
+bool TokenRing::Push(ScannedToken &entry) {
+    size_t position = tail.load(memory_order_relaxed);
+    if (position - head.load(memory_order_acquire) == entries.size())
+        return false;
+    entries[position & mask] = move(entry);
+    tail.store(position + 1, memory_order_release);
+    return true;
+}
+
+bool TokenRing::Pop(ScannedToken &entry) {
+    size_t position = head.load(memory_order_relaxed);
+    if (position == tail.load(memory_order_acquire))
+        return false;
+    entry = move(entries[position & mask]);
+    head.store(position + 1, memory_order_release);
+    return true;
+}
+
+PipelinedScanner::PipelinedScanner(const char* fileName) : scanner(new Scanner(fileName)), ring(ringCapacity),
+        finished(false), stopping(false), producer(&PipelinedScanner::Produce, this) {}
+
+PipelinedScanner::~PipelinedScanner() {
+    stopping = true;
+    producer.join();
+}
+
+// Scanning stops after the first token read at the end of the file, which a Scanner goes on
+// returning from then on, or at the first error.
+void PipelinedScanner::Produce() {
+    bool atEnd = false;
+    while (!atEnd) {
+        ScannedToken entry;
+        try {
+            atEnd = scanner->IsEndOfFile();
+            scanner->NextToken();
+            entry = ScannedToken(*scanner->GetToken(), scanner->GetPosition(), scanner->IsEndOfFile());
+        }
+        catch (...) {
+            entry = ScannedToken(current_exception());
+            atEnd = true;
+        }
+        while (!ring.Push(entry)) {
+            if (stopping)
+                return;
+            this_thread::yield();
+        }
+    }
+    finished = true;
+}
+
+// Takes the next token off the ring into current; false once the producer is done and the ring
+// is empty, leaving the last token in place.
+bool PipelinedScanner::Advance() {
+    while (!ring.Pop(current)) {
+        if (finished)
+            return ring.Pop(current);
+        this_thread::yield();
+    }
+    return true;
+}
+
+void PipelinedScanner::NextToken() {
+    if (!gettedToken)
+        Advance();
+    gettedToken = false;
+    current.Rethrow();
+    *token = current.GetToken();
+}
+
+bool PipelinedScanner::IsEndOfFile() {
+    return current.IsEndOfFile();
+}
+
+void PipelinedScanner::PrevToken() {
+    if (token->GetType() != TK::EOFF)
+        gettedToken = true;
+}
+
+// Leaves the matching end, or a token that failed to scan, to be read by the next NextToken.
+bool PipelinedScanner::SkipBlock() {
+    int depth = 1;
+    while (Advance()) {
+        if (current.IsFailed()) {
+            gettedToken = true;
+            return true;
+        }
+        State state = current.GetToken().GetState();
+        if (state == EOFF)
+            return false;
+        if (state == Begin)
+            depth++;
+        else if (state == End && --depth == 0) {
+            gettedToken = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PipelinedScanner::IsRangeChecking() const {
+    return current.GetPosition().IsRangeChecking();
+}
+
+bool PipelinedScanner::IsPackingRecords() const {
+    return current.GetPosition().IsPackingRecords();
+}
+
+bool PipelinedScanner::IsReorderingRecords() const {
+    return current.GetPosition().IsReorderingRecords();
+}
+
+ScannerPosition PipelinedScanner::GetPosition() const {
+    return current.GetPosition();
+}
@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <cmath>
+#include "RegisterAllocator.h"
+#include "Dominators.h"
+
+using namespace std;
+
+static const vector<Register> intRegisters = {
+        Register::R10, Register::R11, Register::Rbx, Register::R12, Register::R13, Register::R14, Register::R15
+};
+
+static const vector<Register> doubleRegisters = {
+        Register::Xmm8, Register::Xmm9, Register::Xmm10, Register::Xmm11,
+        Register::Xmm12, Register::Xmm13, Register::Xmm14, Register::Xmm15
+};
+
+LiveInterval::LiveInterval(IrInstruction *value, int start, int end) :
+        value(value), start(start), end(end), weight(0.0) {}
+
+IrInstruction *LiveInterval::GetValue() const {
+    return value;
+}
+
+int LiveInterval::GetStart() const {
+    return start;
+}
+
+int LiveInterval::GetEnd() const {
+    return end;
+}
+
+double LiveInterval::GetWeight() const {
+    return weight;
+}
+
+bool LiveInterval::IsDouble() const {
+    return value->GetType() == IrType::Double;
+}
+
+void LiveInterval::Cover(int position) {
+    start = min(start, position);
+    end = max(end, position);
+}
+
+void LiveInterval::AddWeight(double weight) {
+    this->weight += weight;
+}
+
+RegisterAllocator::RegisterAllocator(PIrFunction function) : function(function), spillSlotCount(0) {
+    Number();
+    BuildIntervals();
+    Allocate(false);
+    Allocate(true);
+    AssignSpillSlots();
+    for (const auto &reg: intRegisters)
+        for (const auto &assigned: registers)
+            if (assigned.second == reg && IsCalleeSaved(reg)) {
+                savedRegisters.push_back(reg);
+                break;
+            }
+}
+
+Register RegisterAllocator::GetRegister(IrInstruction *value) const {
+    auto assigned = registers.find(value);
+    return assigned != registers.end() ? assigned->second : Register::None;
+}
+
+const std::vector<Register> &RegisterAllocator::GetSavedRegisters() const {
+    return savedRegisters;
+}
+
+int RegisterAllocator::GetSpillSlot(IrInstruction *value) const {
+    auto slot = spillSlots.find(value);
+    return slot != spillSlots.end() ? slot->second : -1;
+}
+
+int RegisterAllocator::GetSpillSlotCount() const {
+    return spillSlotCount;
+}
+
+// Positions follow the order in which the code generator lays out the blocks.
+void RegisterAllocator::Number() {
+    int position = 0;
+    for (const auto &block: function->GetBlocks()) {
+        int start = position;
+        for (const auto &instruction: block->GetInstructions()) {
+            positions[instruction] = position;
+            if (instruction->GetOp() == IrOp::Call || instruction->GetOp() == IrOp::Write)
+                calls.push_back(position);
+            position++;
+        }
+        spans[block] = { start, position - 1 };
+    }
+}
+
+// Phi operands are used at the end of their predecessor, and the phi itself is written there
+// as well, so it must not share a register with anything live across that copy.
+void RegisterAllocator::BuildIntervals() {
+    vector<IrBlock*> blocks = function->GetBlocks();
+    map<IrBlock*, set<IrInstruction*>> uses, liveIn, liveOut;
+    map<IrBlock*, int> depths;
+    DominatorTree tree(function);
+    for (const auto &loop: tree.FindLoops())
+        for (const auto &block: loop.GetBlocks())
+            depths[block]++;
+    for (const auto &block: blocks) {
+        for (const auto &instruction: block->GetInstructions()) {
+            if (NeedsHome(instruction))
+                intervals[instruction] = LiveInterval(instruction, positions.at(instruction), positions.at(instruction));
+            if (instruction->GetOp() == IrOp::Phi) {
+                for (int i = 0; i < instruction->GetOperands().size(); i++)
+                    if (NeedsHome(instruction->GetOperand(i)))
+                        liveOut[instruction->GetTargets()[i]].insert(instruction->GetOperand(i));
+                continue;
+            }
+            for (const auto &operand: instruction->GetOperands())
+                if (NeedsHome(operand) && operand->GetBlock() != block)
+                    uses[block].insert(operand);
+        }
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto block = blocks.rbegin(); block != blocks.rend(); block++) {
+            set<IrInstruction*> &out = liveOut[*block];
+            for (const auto &successor: (*block)->GetSuccessors())
+                for (const auto &value: liveIn[successor])
+                    if (value->GetOp() != IrOp::Phi || value->GetBlock() != successor)
+                        out.insert(value);
+            set<IrInstruction*> in = uses[*block];
+            for (const auto &value: out)
+                if (value->GetBlock() != *block)
+                    in.insert(value);
+            if (in != liveIn[*block]) {
+                liveIn[*block] = in;
+                changed = true;
+            }
+        }
+    }
+    for (const auto &block: blocks) {
+        for (const auto &value: liveIn[block])
+            intervals.at(value).Cover(spans.at(block).first);
+        for (const auto &value: liveOut[block])
+            intervals.at(value).Cover(spans.at(block).second);
+        double weight = pow(10.0, min(depths[block], (int) maxLoopDepth));
+        for (const auto &instruction: block->GetInstructions()) {
+            if (instruction->GetOp() == IrOp::Param)
+                intervals.at(instruction).Cover(0);
+            for (int i = 0; i < instruction->GetOperands().size(); i++) {
+                IrInstruction *operand = instruction->GetOperand(i);
+                if (instruction->GetOp() != IrOp::Phi) {
+                    if (NeedsHome(operand)) {
+                        intervals.at(operand).Cover(positions.at(instruction));
+                        intervals.at(operand).AddWeight(weight);
+                    }
+                    continue;
+                }
+                IrBlock *predecessor = instruction->GetTargets()[i];
+                int end = spans.at(predecessor).second;
+                double predecessorWeight = pow(10.0, min(depths[predecessor], (int) maxLoopDepth));
+                intervals.at(instruction).Cover(end);
+                intervals.at(instruction).AddWeight(predecessorWeight);
+                if (NeedsHome(operand)) {
+                    intervals.at(operand).Cover(end);
+                    intervals.at(operand).AddWeight(predecessorWeight);
+                }
+            }
+        }
+    }
+}
+
+void RegisterAllocator::Allocate(bool isDouble) {
+    const vector<Register> &pool = isDouble ? doubleRegisters : intRegisters;
+    vector<LiveInterval*> sorted, active;
+    for (auto &interval: intervals)
+        if (interval.second.IsDouble() == isDouble)
+            sorted.push_back(&interval.second);
+    stable_sort(sorted.begin(), sorted.end(), [](const LiveInterval *first, const LiveInterval *second) {
+        return first->GetStart() < second->GetStart();
+    });
+    for (const auto &current: sorted) {
+        active.erase(remove_if(active.begin(), active.end(), [&](const LiveInterval *interval) {
+            return interval->GetEnd() < current->GetStart();
+        }), active.end());
+        bool crossing = CrossesCall(*current);
+        Register chosen = Register::None;
+        for (const auto &reg: pool) {
+            if (crossing && !IsCalleeSaved(reg))
+                continue;
+            bool used = false;
+            for (const auto &interval: active)
+                used = used || registers.at(interval->GetValue()) == reg;
+            if (!used) {
+                chosen = reg;
+                break;
+            }
+        }
+        if (chosen == Register::None) {
+            LiveInterval *victim = nullptr;
+            for (const auto &interval: active) {
+                Register reg = registers.at(interval->GetValue());
+                if ((!crossing || IsCalleeSaved(reg)) && (victim == nullptr || interval->GetWeight() < victim->GetWeight()))
+                    victim = interval;
+            }
+            if (victim == nullptr || victim->GetWeight() >= current->GetWeight())
+                continue;
+            chosen = registers.at(victim->GetValue());
+            registers.erase(victim->GetValue());
+            active.erase(find(active.begin(), active.end(), victim));
+        }
+        registers[current->GetValue()] = chosen;
+        active.push_back(current);
+    }
+}
+
+// The same scan as for registers, with as many slots as it takes.
+void RegisterAllocator::AssignSpillSlots() {
+    vector<const LiveInterval*> sorted, active;
+    for (const auto &interval: intervals)
+        if (registers.find(interval.first) == registers.end())
+            sorted.push_back(&interval.second);
+    stable_sort(sorted.begin(), sorted.end(), [](const LiveInterval *first, const LiveInterval *second) {
+        return first->GetStart() < second->GetStart();
+    });
+    vector<int> free;
+    for (const auto &current: sorted) {
+        for (auto interval = active.begin(); interval != active.end();) {
+            if ((*interval)->GetEnd() < current->GetStart()) {
+                free.push_back(spillSlots.at((*interval)->GetValue()));
+                interval = active.erase(interval);
+            } else
+                interval++;
+        }
+        if (free.empty())
+            free.push_back(spillSlotCount++);
+        spillSlots[current->GetValue()] = free.back();
+        free.pop_back();
+        active.push_back(current);
+    }
+}
+
+bool RegisterAllocator::CrossesCall(const LiveInterval &interval) const {
+    auto call = upper_bound(calls.begin(), calls.end(), interval.GetStart());
+    return call != calls.end() && *call < interval.GetEnd();
+}
+
+bool RegisterAllocator::NeedsHome(IrInstruction *value) {
+    IrOp op = value->GetOp();
+    return value->GetType() != IrType::Void && op != IrOp::Const && op != IrOp::SlotAddr && op != IrOp::GlobalAddr;
+}
+
+bool RegisterAllocator::IsCalleeSaved(Register reg) {
+    return reg == Register::Rbx || (reg >= Register::R12 && reg <= Register::R15);
+}
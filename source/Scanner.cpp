@@ -7,10 +7,24 @@
 
 using namespace std;
 
-Scanner::Scanner(const char* fileName) : line(1), column(0), token(new Token) {
+Scanner::Scanner(const char* fileName) : statesTable(GetStatesTable()), line(1), column(0), offset(0), tokenOffset(0), token(new Token),
+        gettedToken(false), rangeChecks(false), packRecords(false), reorderRecords(false) {
     fin.open(fileName);
-    InitStatesTable();
-    FillStatesTable();
+}
+
+// For scanners that take their tokens from elsewhere and only fill in the current one.
+Scanner::Scanner() : statesTable(GetStatesTable()), line(1), column(0), offset(0), tokenOffset(0), token(new Token),
+        gettedToken(false), rangeChecks(false), packRecords(false), reorderRecords(false) {}
+
+// Opens the file at a position taken from another scanner of it; the token there is read by the
+// next call to NextToken.
+Scanner::Scanner(const char* fileName, const ScannerPosition &position) : statesTable(GetStatesTable()),
+        line(position.GetLine()), column(position.GetColumn()), prevColumn(column), offset(position.GetOffset()),
+        tokenOffset(position.GetOffset()), token(new Token), gettedToken(false),
+        rangeChecks(position.IsRangeChecking()), packRecords(position.IsPackingRecords()),
+        reorderRecords(position.IsReorderingRecords()) {
+    fin.open(fileName);
+    fin.seekg(offset);
 }
 
 Scanner::~Scanner() {
@@ -29,6 +43,8 @@ char Scanner::ReadChar() {
     fin.get(symb);
     if (fin.eof())
         symb = '\0';
+    else
+        offset++;
     if (symb == '\n') {
         line++;
         prevColumn = column;
@@ -42,10 +58,12 @@ char Scanner::ReadChar() {
 
 void Scanner::UnGetChar(int count) {
     for (int i = 0; i < count; i++) {
-        if (fin.eof())
+        if (fin.eof()) {
             fin.clear();
-        else
+        } else {
             fin.unget();
+            offset--;
+        }
         if (column == 0) {
             line--;
             column = prevColumn;
@@ -56,13 +74,24 @@ void Scanner::UnGetChar(int count) {
     }
 }
 
-void Scanner::InitStatesTable() {
+// The transition table is built once and shared by every scanner.
+const StatesTable &Scanner::GetStatesTable() {
+    static const StatesTable table = []() {
+        StatesTable table;
+        InitStatesTable(table);
+        FillStatesTable(table);
+        return table;
+    }();
+    return table;
+}
+
+void Scanner::InitStatesTable(StatesTable &table) {
     for (auto const& state: states)
-        statesTable[state].resize(128, NotToken);
+        table[state].resize(128, NotToken);
 }
 
-void Scanner::SetState(State oldstate, int transition, State newstate) {
-    statesTable[oldstate][transition] = newstate;
+void Scanner::SetState(StatesTable &table, State oldstate, int transition, State newstate) {
+    table[oldstate][transition] = newstate;
 }
 
 void Scanner::CheckError(State state) {
@@ -79,6 +108,123 @@ bool Scanner::IsComment(State state) {
     return state == RightBrace || state == AsteriskRightParenthesis || state == SlashSlash;
 }
 
+// Compiler directives live in brace comments: {$R+} and {$R-} switch range checking on and off,
+// as do the long forms {$RANGECHECKS ON} and {$RANGECHECKS OFF}. {$PACKRECORDS 1} lays out the
+// records declared after it without padding until {$PACKRECORDS DEFAULT}, and
+// {$REORDERRECORDS ON} lets their fields be reordered to reduce padding.
+void Scanner::ApplyDirective(string comment) {
+    if (comment.size() < 4 || comment.substr(0, 2) != "{$")
+        return;
+    transform(comment.begin(), comment.end(), comment.begin(), ::toupper);
+    string directive = comment.substr(2, comment.size() - 3);
+    if (directive == "R+" || directive == "RANGECHECKS ON")
+        rangeChecks = true;
+    else if (directive == "R-" || directive == "RANGECHECKS OFF")
+        rangeChecks = false;
+    else if (directive.substr(0, 12) == "PACKRECORDS ")
+        packRecords = directive == "PACKRECORDS 1";
+    else if (directive == "REORDERRECORDS ON")
+        reorderRecords = true;
+    else if (directive == "REORDERRECORDS OFF")
+        reorderRecords = false;
+}
+
+// Skips the rest of the begin ... end block whose begin was just read, looking at characters rather
+// than tokens: only words, comments and strings matter for finding the matching end, and directives
+// in the comments still apply. The next call to NextToken reads the token after that end; false
+// means the file ended first.
+bool Scanner::SkipBlock() {
+    int depth = 1;
+    string word;
+    bool escaped = false;
+    while (true) {
+        char symb = ReadChar();
+        if (isalnum(symb) || symb == '_') {
+            word += (char) tolower(symb);
+            continue;
+        }
+        if (!escaped && word == "begin")
+            depth++;
+        else if (!escaped && word == "end" && --depth == 0) {
+            UnGetChar();
+            return true;
+        }
+        word.clear();
+        escaped = symb == '&';
+        if (symb == '\0')
+            return false;
+        if (symb == '{') {
+            string comment = "{";
+            do {
+                symb = ReadChar();
+                comment += symb;
+            } while (symb != '}' && symb != '\0');
+            ApplyDirective(comment);
+        } else if (symb == '(' && fin.peek() == '*') {
+            ReadChar();
+            char last = '\0';
+            do {
+                last = symb;
+                symb = ReadChar();
+            } while (!(last == '*' && symb == ')') && symb != '\0');
+        } else if (symb == '/' && fin.peek() == '/') {
+            do {
+                symb = ReadChar();
+            } while (symb != '\n' && symb != '\0');
+        } else if (symb == '\'') {
+            do {
+                symb = ReadChar();
+            } while (symb != '\'' && symb != '\n' && symb != '\0');
+        }
+    }
+}
+
+bool Scanner::IsRangeChecking() const {
+    return rangeChecks;
+}
+
+bool Scanner::IsPackingRecords() const {
+    return packRecords;
+}
+
+bool Scanner::IsReorderingRecords() const {
+    return reorderRecords;
+}
+
+ScannerPosition Scanner::GetPosition() const {
+    return ScannerPosition(tokenOffset, token->GetLine(), token->GetColumn() - 1, rangeChecks, packRecords,
+                           reorderRecords);
+}
+
+ScannerPosition::ScannerPosition(long offset, int line, int column, bool rangeChecks, bool packRecords,
+                                 bool reorderRecords) :
+        offset(offset), line(line), column(column), rangeChecks(rangeChecks), packRecords(packRecords),
+        reorderRecords(reorderRecords) {}
+
+long ScannerPosition::GetOffset() const {
+    return offset;
+}
+
+int ScannerPosition::GetLine() const {
+    return line;
+}
+
+int ScannerPosition::GetColumn() const {
+    return column;
+}
+
+bool ScannerPosition::IsRangeChecking() const {
+    return rangeChecks;
+}
+
+bool ScannerPosition::IsPackingRecords() const {
+    return packRecords;
+}
+
+bool ScannerPosition::IsReorderingRecords() const {
+    return reorderRecords;
+}
+
 void Scanner::CheckReservedWord() {
     string text = token->GetText();
     transform(text.begin(), text.end(), text.begin(), ::tolower);
@@ -95,12 +241,13 @@ void Scanner::NextToken() {
     bool isToken = false;
     while (!IsEndOfFile()) {
         char symb = ReadChar();
-        State state = statesTable[token->GetState()][symb];
+        State state = statesTable.at(token->GetState())[symb];
 
         if (!isToken && state != NotToken) {
             isToken = true;
             token->SetColumn(column);
             token->SetLine(line);
+            tokenOffset = offset - 1;
         }
 
         CheckError(state);
@@ -113,6 +260,7 @@ void Scanner::NextToken() {
 
             State lastState = token->GetState();
             if (IsComment(lastState)) {
+                ApplyDirective(token->GetText());
                 ClearToken();
                 isToken = false;
                 continue;
@@ -139,15 +287,15 @@ PToken Scanner::GetNextToken() {
     return GetToken();
 }
 
-void Scanner::PrintToken() {
+void Scanner::PrintToken(std::ostream &out) {
     if (token->GetType() == TK::EOFF)
         return;
 
-    cout << left << setw(lineWidth) <<  token->GetLine();
-    cout << setw(columnWidth) << token->GetColumn();
-    cout << setw(typeWidth) << tokenName[token->GetType()];
-    cout << setw(textWidth) << token->GetText();
-    cout << token->GetValue() << endl;
+    out << left << setw(lineWidth) <<  token->GetLine();
+    out << setw(columnWidth) << token->GetColumn();
+    out << setw(typeWidth) << tokenName.at(token->GetType());
+    out << setw(textWidth) << token->GetText();
+    out << token->GetValue() << endl;
 }
 
 bool Scanner::IsEndOfFile() {
@@ -165,24 +313,24 @@ bool Scanner::IsGettedToken() {
     return gettedToken;
 }
 
-void Scanner::SetStates(State state, std::vector<std::pair<char, State>> ts) {
+void Scanner::SetStates(StatesTable &table, State state, std::vector<std::pair<char, State>> ts) {
     for (auto const& i: ts)
-        SetState(state, i.first, i.second);
+        SetState(table, state, i.first, i.second);
 }
 
-void Scanner::SetStatesInRange(State state, std::vector<std::tuple<char, char, State>> ts) {
+void Scanner::SetStatesInRange(StatesTable &table, State state, std::vector<std::tuple<char, char, State>> ts) {
     for (int i = 0; i < ts.size(); i++)
         for (int j = get<0>(ts[i]); j <= (int)get<1>(ts[i]); j++)
-            SetState(state, j, get<2>(ts[i]));
+            SetState(table, state, j, get<2>(ts[i]));
 }
 
-void Scanner::FillStatesTable() {
-    SetStatesInRange(NotToken, {
+void Scanner::FillStatesTable(StatesTable &table) {
+    SetStatesInRange(table, NotToken, {
             { 'a', 'z', Identifier   },
             { 'A', 'Z', Identifier   },
             { '0', '9', IntegerValue },
     });
-    SetStates(NotToken, {
+    SetStates(table, NotToken, {
             { '*',  Pointer             },
             { ',',  Comma               },
             { '.',  Period              },
@@ -215,57 +363,57 @@ void Scanner::FillStatesTable() {
             { '\0', EOFF                }
     });
 
-    SetState(Period, '.', PeriodPeriod);
+    SetState(table, Period, '.', PeriodPeriod);
 
-    SetStates(LessThan, {
+    SetStates(table, LessThan, {
             { '=', LessThanEqual       },
             { '>', LessThanGreaterThan },
             { '<', LessThanLessThan    }
     });
 
-    SetStates(GreaterThan, {
+    SetStates(table, GreaterThan, {
             { '=', GreaterThanEqual       },
             { '<', GreaterThanLessThan    },
             { '>', GreaterThanGreaterThan }
     });
 
-    SetState(Colon, '=', ColonEqual);
+    SetState(table, Colon, '=', ColonEqual);
 
-    SetStates(Asterisk, {
+    SetStates(table, Asterisk, {
             { '=', AsteriskEqual       },
             { ')', ErrorInvalidComment }
     });
 
-    SetStates(Slash, {
+    SetStates(table, Slash, {
             { '/', SlashSlash },
             { '=', SlashEqual }
     });
 
-    SetStatesInRange(SlashSlash, {
+    SetStatesInRange(table, SlashSlash, {
             { 0, 127, SlashSlash }
     });
-    SetState(SlashSlash, '\n', NotToken);
+    SetState(table, SlashSlash, '\n', NotToken);
 
-    SetStatesInRange(Identifier, {
+    SetStatesInRange(table, Identifier, {
             { 'a', 'z', Identifier },
             { 'A', 'Z', Identifier },
             { '0', '9', Identifier }
     });
-    SetState(Identifier, '_', Identifier);
+    SetState(table, Identifier, '_', Identifier);
 
-    SetStatesInRange(IntegerValue, {
+    SetStatesInRange(table, IntegerValue, {
             { 'a', 'z', ErrorInvalidExpression },
             { 'A', 'Z', ErrorInvalidExpression },
             { '0', '9', IntegerValue           }
     });
-    SetStates(IntegerValue, {
+    SetStates(table, IntegerValue, {
             { '_', ErrorInvalidExpression },
             { '.', DoubleValue            },
             { 'E', DoubleValueDigitScale  },
             { 'e', DoubleValueDigitScale  }
     });
 
-    SetStatesInRange(Dollar, {
+    SetStatesInRange(table, Dollar, {
             { 'a', 'f', HexIntegerValue        },
             { 'g', 'a', ErrorInvalidExpression },
             { 'A', 'F', HexIntegerValue        },
@@ -273,147 +421,147 @@ void Scanner::FillStatesTable() {
             { '0', '9', HexIntegerValue        }
     });
 
-    SetStatesInRange(Ampersand, {
+    SetStatesInRange(table, Ampersand, {
             { 'a', 'z', Identifier             },
             { 'A', 'Z', Identifier             },
             { '0', '7', OctalIntegerValue      },
             { '8', '9', ErrorInvalidExpression }
     });
-    SetState(Ampersand, '_', Identifier);
+    SetState(table, Ampersand, '_', Identifier);
 
-    SetStatesInRange(Percent, {
+    SetStatesInRange(table, Percent, {
             { 'a', 'z', ErrorInvalidExpression },
             { 'A', 'Z', ErrorInvalidExpression },
             { '0', '1', BinIntegerValue        },
             { '2', '9', ErrorInvalidExpression }
     });
 
-    SetStatesInRange(HexIntegerValue, {
+    SetStatesInRange(table, HexIntegerValue, {
             { 'a', 'f', HexIntegerValue        },
             { 'g', 'a', ErrorInvalidExpression },
             { 'A', 'F', HexIntegerValue        },
             { 'G', 'Z', ErrorInvalidExpression },
             { '0', '9', HexIntegerValue        }
     });
-    SetState(HexIntegerValue, '_', ErrorInvalidExpression);
+    SetState(table, HexIntegerValue, '_', ErrorInvalidExpression);
 
-    SetStatesInRange(OctalIntegerValue, {
+    SetStatesInRange(table, OctalIntegerValue, {
             { 'a', 'z', ErrorInvalidExpression },
             { 'A', 'Z', ErrorInvalidExpression },
             { '0', '7', OctalIntegerValue      },
             { '8', '9', ErrorInvalidExpression }
     });
-    SetState(OctalIntegerValue, '_', ErrorInvalidExpression);
+    SetState(table, OctalIntegerValue, '_', ErrorInvalidExpression);
 
-    SetStatesInRange(BinIntegerValue, {
+    SetStatesInRange(table, BinIntegerValue, {
             { 'a', 'z', ErrorInvalidExpression },
             { 'A', 'Z', ErrorInvalidExpression },
             { '0', '1', BinIntegerValue        },
             { '2', '9', ErrorInvalidExpression }
     });
-    SetState(BinIntegerValue, '_', ErrorInvalidExpression);
+    SetState(table, BinIntegerValue, '_', ErrorInvalidExpression);
 
-    SetStatesInRange(DoubleValue, {
+    SetStatesInRange(table, DoubleValue, {
             { 'a', 'z', ErrorInvalidExpression },
             { 'A', 'Z', ErrorInvalidExpression },
             { '0', '9', DoubleValueDigit       }
     });
-    SetStates(DoubleValue, {
+    SetStates(table, DoubleValue, {
             { '_', ErrorInvalidExpression   },
             { '.', IntegerValuePeriodPeriod }
     });
 
-    SetStatesInRange(DoubleValueDigit, {
+    SetStatesInRange(table, DoubleValueDigit, {
             { 'a', 'z', ErrorInvalidExpression },
             { 'A', 'Z', ErrorInvalidExpression },
             { '0', '9', DoubleValueDigit       }
     });
-    SetStates(DoubleValueDigit, {
+    SetStates(table, DoubleValueDigit, {
             { '_', ErrorInvalidExpression },
             { '.', ErrorInvalidExpression },
             { 'E', DoubleValueDigitScale  },
             { 'e', DoubleValueDigitScale  }
     });
 
-    SetStatesInRange(DoubleValueDigitScale, {
+    SetStatesInRange(table, DoubleValueDigitScale, {
             { 0, 127,   ErrorInvalidExpression         },
             { '0', '9', DoubleValueDigitScaleSignDigit },
     });
-    SetStates(DoubleValueDigitScale, {
+    SetStates(table, DoubleValueDigitScale, {
             { '+', DoubleValueDigitScaleSign },
             { '-', DoubleValueDigitScaleSign }
     });
 
-    SetStatesInRange(DoubleValueDigitScaleSign, {
+    SetStatesInRange(table, DoubleValueDigitScaleSign, {
             { 0, 127,   ErrorInvalidExpression         },
             { '0', '9', DoubleValueDigitScaleSignDigit },
     });
 
-    SetStatesInRange(DoubleValueDigitScaleSignDigit, {
+    SetStatesInRange(table, DoubleValueDigitScaleSignDigit, {
             { 'a', 'z', ErrorInvalidExpression         },
             { 'A', 'Z', ErrorInvalidExpression         },
             { '0', '9', DoubleValueDigitScaleSignDigit },
     });
-    SetStates(DoubleValueDigitScaleSignDigit, {
+    SetStates(table, DoubleValueDigitScaleSignDigit, {
             { '.', ErrorInvalidExpression },
             { '_', ErrorInvalidExpression }
     });
 
-    SetState(Minus, '=', MinusEqual);
+    SetState(table, Minus, '=', MinusEqual);
 
-    SetState(Plus, '=', PlusEqual);
+    SetState(table, Plus, '=', PlusEqual);
 
-    SetStatesInRange(LeftBrace, {
+    SetStatesInRange(table, LeftBrace, {
             { 0, 127, LeftBrace }
     });
-    SetStates(LeftBrace, {
+    SetStates(table, LeftBrace, {
             { '}',  RightBrace          },
             { '\0', ErrorInvalidComment }
     });
 
-    SetState(LeftParenthesis, '*', LeftParenthesisAsterisk);
+    SetState(table, LeftParenthesis, '*', LeftParenthesisAsterisk);
 
-    SetStatesInRange(LeftParenthesisAsterisk, {
+    SetStatesInRange(table, LeftParenthesisAsterisk, {
             { 0, 127, LeftParenthesisAsterisk }
     });
-    SetStates(LeftParenthesisAsterisk, {
+    SetStates(table, LeftParenthesisAsterisk, {
             { '*',  LeftParenthesisAsteriskAsterisk },
             { '\0', ErrorInvalidComment              }
     });
 
-    SetStatesInRange(LeftParenthesisAsteriskAsterisk, {
+    SetStatesInRange(table, LeftParenthesisAsteriskAsterisk, {
             { 0, 127, LeftParenthesisAsterisk }
     });
-    SetStates(LeftParenthesisAsteriskAsterisk, {
+    SetStates(table, LeftParenthesisAsteriskAsterisk, {
             { '*',  LeftParenthesisAsteriskAsterisk },
             { ')',  AsteriskRightParenthesis        },
             { '\0', ErrorInvalidComment             }
     });
 
-    SetStatesInRange(Quote, {
+    SetStatesInRange(table, Quote, {
             { 0, 127, Quote }
     });
-    SetStates(Quote, {
+    SetStates(table, Quote, {
             { '\'', String             },
             { '\0', ErrorInvalidString },
             { '\n', ErrorInvalidString }
     });
 
-    SetStates(String, {
+    SetStates(table, String, {
             { '#',  StringHash },
             { '\'', Quote      }
     });
 
-    SetStatesInRange(StringHash, {
+    SetStatesInRange(table, StringHash, {
             { 0, 127,   ErrorInvalidExpression },
             { '0', '9', StringHashIntegerValue }
     });
 
-    SetStatesInRange(StringHashIntegerValue, {
+    SetStatesInRange(table, StringHashIntegerValue, {
             { 0, 127,   ErrorInvalidExpression },
             { '0', '9', StringHashIntegerValue }
     });
-    SetStates(StringHashIntegerValue, {
+    SetStates(table, StringHashIntegerValue, {
             { '#',  StringHash },
             { '\'', Quote      }
     });
@@ -2,11 +2,13 @@
 #include "Error.h"
 #include <string>
 #include <algorithm>
+#include <set>
 
 using namespace std;
 
 void SymbolTableStack::AddTable(PSymbolTable table) {
     tables.push_back(table);
+    limits.push_back(-1);
 }
 
 PSymbolTable SymbolTableStack::Top() {
@@ -15,6 +17,7 @@ PSymbolTable SymbolTableStack::Top() {
 
 void SymbolTableStack::Pop() {
     tables.pop_back();
+    limits.pop_back();
 }
 
 bool SymbolTableStack::HaveSymbol(std::string name) {
@@ -24,16 +27,43 @@ bool SymbolTableStack::HaveSymbol(std::string name) {
 PSymbolComplex SymbolTableStack::FindSymbol(std::string name) {
     transform(name.begin(), name.end(), name.begin(), ::tolower);
     for (int i = tables.size() - 1; i >= 0; i--) {
-        PSymbolComplex symb = tables[i]->FindSymbol(name);
+        PSymbolComplex symb = tables[i]->FindSymbol(name, limits[i]);
         if (symb != nullptr)
             return symb;
     }
     return nullptr;
 }
 
-void SymbolTableStack::Print(unsigned int depth) {
+void SymbolTableStack::Print(std::ostream &out, unsigned int depth) {
     for (int i = tables.size() - 1; i >= 0; i--)
-        tables[i]->Print(depth);
+        tables[i]->Print(out, depth);
+}
+
+// The snapshot sees the symbols declared so far and none of those added to the same tables later.
+PSymbolTableStack SymbolTableStack::Snapshot() const {
+    PSymbolTableStack snapshot(new SymbolTableStack());
+    for (const auto &table: tables) {
+        snapshot->tables.push_back(table);
+        snapshot->limits.push_back(table->Size());
+    }
+    return snapshot;
+}
+
+// Every symbol a name would find, innermost scopes first.
+std::vector<PSymbolComplex> SymbolTableStack::GetSymbols() const {
+    vector<PSymbolComplex> symbols;
+    set<string> names;
+    for (int i = tables.size() - 1; i >= 0; i--) {
+        const auto &table = tables[i]->GetSymbols();
+        int size = limits[i] < 0 ? table.size() : limits[i];
+        for (int j = 0; j < size; j++) {
+            string name = table[j]->GetName();
+            transform(name.begin(), name.end(), name.begin(), ::tolower);
+            if (names.insert(name).second)
+                symbols.push_back(table[j]);
+        }
+    }
+    return symbols;
 }
 
 void SymbolTable::AddSymbol(PSymbolComplex symbol) {
@@ -44,15 +74,20 @@ void SymbolTable::AddSymbol(PSymbolComplex symbol) {
 }
 
 PSymbolComplex SymbolTable::FindSymbol(std::string name) {
+    return FindSymbol(name, -1);
+}
+
+// Only the first limit symbols are looked at, unless limit is negative.
+PSymbolComplex SymbolTable::FindSymbol(std::string name, int limit) {
     auto it = symbolNames.find(name);
-    if (it == symbolNames.end())
+    if (it == symbolNames.end() || (limit >= 0 && it->second >= limit))
         return nullptr;
     return symbols[it->second];
 }
 
-void SymbolTable::Print(unsigned int depth) {
+void SymbolTable::Print(std::ostream &out, unsigned int depth) {
     for (auto &symbol: symbols)
-        symbol->Print(depth);
+        symbol->Print(out, depth);
 }
 
 const std::string SymbolTable::GetSymbolTypeNames() const {
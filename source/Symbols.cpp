@@ -25,15 +25,15 @@ const PSymbolBase SymbolComplex::GetType() const {
 SymbolComplexWithValue::SymbolComplexWithValue(std::string name, PSymbolBase type, std::any value) :
         SymbolComplex(name, type), value(value) {}
 
-void SymbolComplexWithValue::Print(unsigned int depth) {
-    cout << string(depth, ' ') << left << setw(nameWidth) << name << setw(symTypeWidth)
+void SymbolComplexWithValue::Print(std::ostream &out, unsigned int depth) {
+    out << string(depth, ' ') << left << setw(nameWidth) << name << setw(symTypeWidth)
          << symTypeName.at(GetSymType());
     if (type->GetSymType() == SymType::BaseType)
-        cout << setw(typeWidth);
-    PrintTypeName(depth + nameWidth + symTypeWidth);
+        out << setw(typeWidth);
+    PrintTypeName(out, depth + nameWidth + symTypeWidth);
     if (type->GetSymType() == SymType::BaseType)
-        cout << GetValueText();
-    cout << endl;
+        out << GetValueText();
+    out << endl;
 }
 
 const std::any SymbolComplexWithValue::GetValue() const {
@@ -54,15 +54,15 @@ const string SymbolComplex::GetTypeName() const {
     return type->GetTypeName();
 }
 
-void SymbolComplex::PrintTypeName(unsigned int depth) {
-    type->PrintTypeName(depth);
+void SymbolComplex::PrintTypeName(std::ostream &out, unsigned int depth) {
+    type->PrintTypeName(out, depth);
 }
 
-void SymbolComplex::Print(unsigned int depth) {
-    cout << string(depth, ' ') << left << setw(nameWidth) << name
+void SymbolComplex::Print(std::ostream &out, unsigned int depth) {
+    out << string(depth, ' ') << left << setw(nameWidth) << name
          << setw(symTypeWidth) << symTypeName.at(GetSymType());
-    PrintTypeName(depth + nameWidth + symTypeWidth);
-    cout << endl;
+    PrintTypeName(out, depth + nameWidth + symTypeWidth);
+    out << endl;
 }
 
 SymbolType::SymbolType(string name, PSymbolBase type) : SymbolComplex(name, type) {}
@@ -76,14 +76,22 @@ SymbolTypeAlias::SymbolTypeAlias(std::string name, PSymbolBase type) :
 
 SymbolSubRange::SymbolSubRange(int left, int right) : left(left), right(right) {}
 
-void SymbolSubRange::PrintTypeName(unsigned int depth) {
-    cout << "subrange " + GetValue();
+void SymbolSubRange::PrintTypeName(std::ostream &out, unsigned int depth) {
+    out << "subrange " + GetValue();
 }
 
 const std::string SymbolSubRange::GetValue() const {
     return to_string(left) + ".." + to_string(right);
 }
 
+int SymbolSubRange::GetLeft() const {
+    return left;
+}
+
+int SymbolSubRange::GetRight() const {
+    return right;
+}
+
 const std::string SymbolSubRange::GetTypeName() const {
     return "subrange " + GetValue();
 }
@@ -105,9 +113,13 @@ const PSymbolBase SymbolArray::GetType() const {
 SymbolStaticArray::SymbolStaticArray(PSymbolBase type, PSymbolSubRange subRange) :
         SymbolArray(type), subRange(subRange) {}
 
-void SymbolStaticArray::PrintTypeName(unsigned int depth) {
-    cout << "array [" + subRange->GetValue() + "] of ";
-    type->PrintTypeName(depth);
+void SymbolStaticArray::PrintTypeName(std::ostream &out, unsigned int depth) {
+    out << "array [" + subRange->GetValue() + "] of ";
+    type->PrintTypeName(out, depth);
+}
+
+const PSymbolSubRange SymbolStaticArray::GetSubRange() const {
+    return subRange;
 }
 
 const std::string SymbolStaticArray::GetTypeName() const {
@@ -116,9 +128,9 @@ const std::string SymbolStaticArray::GetTypeName() const {
 
 SymbolDynamicArray::SymbolDynamicArray(PSymbolBase type) : SymbolArray(type) {}
 
-void SymbolDynamicArray::PrintTypeName(unsigned int depth) {
-    cout << "array of ";
-    type->PrintTypeName(depth);
+void SymbolDynamicArray::PrintTypeName(std::ostream &out, unsigned int depth) {
+    out << "array of ";
+    type->PrintTypeName(out, depth);
 }
 
 const std::string SymbolDynamicArray::GetTypeName() const {
@@ -137,15 +149,15 @@ const std::string SymbolBaseType::GetTypeName() const {
     return baseType.at(type);
 }
 
-void SymbolBaseType::PrintTypeName(unsigned int depth) {
-    cout << baseType.at(type);
+void SymbolBaseType::PrintTypeName(std::ostream &out, unsigned int depth) {
+    out << baseType.at(type);
 }
 
 const any SymbolBaseType::GetInitValue() const {
     return baseTypeInitValue.at(type);
 }
 
-SymbolRecord::SymbolRecord() : fields(new SymbolTable) {}
+SymbolRecord::SymbolRecord() : fields(new SymbolTable), packing(RecordPacking::Aligned) {}
 
 void SymbolRecord::AddField(PSymbolRecordField field) {
     fields->AddSymbol(field);
@@ -157,17 +169,25 @@ const std::string SymbolRecord::GetTypeName() const {
     return str;
 }
 
-void SymbolRecord::PrintTypeName(unsigned int depth) {
-    cout << "record:" << endl;
-    fields->Print(depth);
-    cout << string(depth, ' ');
-    cout << "end";
+void SymbolRecord::PrintTypeName(std::ostream &out, unsigned int depth) {
+    out << "record:" << endl;
+    fields->Print(out, depth);
+    out << string(depth, ' ');
+    out << "end";
 }
 
 const PSymbolTable SymbolRecord::GetFields() const {
     return fields;
 }
 
+RecordPacking SymbolRecord::GetPacking() const {
+    return packing;
+}
+
+void SymbolRecord::SetPacking(RecordPacking packing) {
+    this->packing = packing;
+}
+
 SymbolRecordField::SymbolRecordField(std::string name, PSymbolBase type) : SymbolComplex(name, type) {}
 
 SymbolValueParameter::SymbolValueParameter(std::string name, PSymbolBase type) :
@@ -175,9 +195,9 @@ SymbolValueParameter::SymbolValueParameter(std::string name, PSymbolBase type) :
 
 SymbolOpenArray::SymbolOpenArray(PSymbolBase type) : SymbolArray(type) {}
 
-void SymbolOpenArray::PrintTypeName(unsigned int depth) {
-    cout << "{open} array of ";
-    type->PrintTypeName(depth);
+void SymbolOpenArray::PrintTypeName(std::ostream &out, unsigned int depth) {
+    out << "{open} array of ";
+    type->PrintTypeName(out, depth);
 }
 
 const std::string SymbolOpenArray::GetTypeName() const {
@@ -190,13 +210,13 @@ const std::string SymbolProcHeader::GetTypeName() const {
     return "args " + args->GetSymbolTypeNames();
 }
 
-void SymbolProcHeader::PrintTypeName(unsigned int depth) {
-    cout << "args:" << endl;
+void SymbolProcHeader::PrintTypeName(std::ostream &out, unsigned int depth) {
+    out << "args:" << endl;
     if (args->Size() < 1) {
-        cout << string(depth, ' ') << "none" << endl;
+        out << string(depth, ' ') << "none" << endl;
         return;
     }
-    args->Print(depth);
+    args->Print(out, depth);
 }
 
 const PSymbolTable SymbolProcHeader::GetArgs() const {
@@ -217,33 +237,45 @@ const std::string SymbolFuncHeader::GetTypeName() const {
     return "args " + args->GetSymbolTypeNames() + " " + returnType->GetTypeName();
 }
 
-void SymbolFuncHeader::PrintTypeName(unsigned int depth) {
-    cout << "return type: " << endl;
-    cout << string(depth, ' ');
-    returnType->PrintTypeName(depth);
-    cout << endl;
-    cout << string(depth, ' ') << "args:" << endl;
+void SymbolFuncHeader::PrintTypeName(std::ostream &out, unsigned int depth) {
+    out << "return type: " << endl;
+    out << string(depth, ' ');
+    returnType->PrintTypeName(out, depth);
+    out << endl;
+    out << string(depth, ' ') << "args:" << endl;
     if (args->Size() < 1) {
-        cout << string(depth, ' ') << "none" << endl;
+        out << string(depth, ' ') << "none" << endl;
         return;
     }
-    args->Print(depth);
+    args->Print(out, depth);
 }
 
 SymbolProcedure::SymbolProcedure(std::string name, PSymbolProcHeader type, PSymbolTable locals) :
         SymbolComplex(name, type), locals(locals) {}
 
-void SymbolProcedure::Print(unsigned int depth) {
-    cout << string(depth, ' ') << left << setw(nameWidth) << name << setw(symTypeWidth)
+void SymbolProcedure::Print(std::ostream &out, unsigned int depth) {
+    out << string(depth, ' ') << left << setw(nameWidth) << name << setw(symTypeWidth)
          << symTypeName.at(GetSymType());
     depth += nameWidth + symTypeWidth;
-    PrintTypeName(depth);
-    cout << string(depth, ' ') << "locals:" << endl;
+    PrintTypeName(out, depth);
+    out << string(depth, ' ') << "locals:" << endl;
     if (locals->Size() < 1) {
-        cout << string(depth, ' ') << "none" << endl;
+        out << string(depth, ' ') << "none" << endl;
         return;
     }
-    locals->Print(depth);
+    locals->Print(out, depth);
+}
+
+const PSymbolTable SymbolProcedure::GetLocals() const {
+    return locals;
+}
+
+void SymbolProcedure::SetBody(PNode body) {
+    this->body = body;
+}
+
+const PNode SymbolProcedure::GetBody() const {
+    return body;
 }
 
 SymbolFunction::SymbolFunction(std::string name, PSymbolFuncHeader type, PSymbolTable locals) :
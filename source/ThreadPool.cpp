@@ -0,0 +1,92 @@
+#include <algorithm>
+#include "ThreadPool.h"
+
+using namespace std;
+
+// The pool whose worker runs on this thread and the worker's index in it; no pool on any other
+// thread. A worker of one pool may submit to another, whose queues its index does not name.
+static thread_local struct {
+    ThreadPool *owner;
+    int index;
+} currentWorker = { nullptr, -1 };
+
+ThreadPool::ThreadPool(int threads) : queued(0), pending(0), next(0), stopping(false) {
+    // hardware_concurrency() may report 0, and tasks must have some worker to run them.
+    threads = max(threads, 1);
+    for (int i = 0; i < threads; i++)
+        queues.emplace_back(new WorkQueue());
+    for (int i = 0; i < threads; i++)
+        workers.emplace_back(&ThreadPool::Work, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready.notify_all();
+    for (auto &worker: workers)
+        worker.join();
+}
+
+// A task submitted by a worker of this pool goes to that worker's own queue, where it is likely to
+// find its data still in cache; tasks from other threads, other pools' workers among them, are
+// dealt out in turn.
+void ThreadPool::Submit(std::function<void()> task) {
+    int index = currentWorker.owner == this ? currentWorker.index : next++ % queues.size();
+    pending++;
+    {
+        lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(move(task));
+    }
+    {
+        lock_guard<std::mutex> lock(mutex);
+        queued++;
+    }
+    ready.notify_one();
+}
+
+// Blocks until every task submitted so far has finished.
+void ThreadPool::Wait() {
+    unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]() { return pending == 0; });
+}
+
+bool ThreadPool::Take(int index, std::function<void()> &task) {
+    for (int i = 0; i < queues.size(); i++) {
+        WorkQueue &queue = *queues[(index + i) % queues.size()];
+        lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+        if (i == 0) {
+            task = move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        queued--;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::Work(int index) {
+    currentWorker.owner = this;
+    currentWorker.index = index;
+    while (true) {
+        function<void()> task;
+        if (!Take(index, task)) {
+            unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this]() { return stopping || queued > 0; });
+            if (stopping && queued == 0)
+                return;
+            continue;
+        }
+        task();
+        if (--pending == 0) {
+            lock_guard<std::mutex> lock(mutex);
+            done.notify_all();
+        }
+    }
+}
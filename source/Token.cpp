@@ -6,6 +6,12 @@
 
 using namespace std;
 
+// Compiled once and only read afterwards: building a regex touches locale state that scanners on
+// other threads share.
+static const regex charCodes("\'((#[0-9]+)+)\'");
+static const regex charCode("#([0-9]+)");
+static const regex doubledQuote("\'\'");
+
 int Token::GetLine() const {
     return line;
 }
@@ -39,21 +45,27 @@ void Token::SetText(const string &text) {
 }
 
 void Token::CalcType() {
-    if (tokenType.find(GetState()) != tokenType.end())
-        type = tokenType[GetState()];
+    auto found = tokenType.find(GetState());
+    if (found != tokenType.end())
+        type = found->second;
 }
 
+// Looks the state up with find rather than operator[], which would insert missing states into the
+// shared table while other scanners read it.
 void Token::CalcValue() {
-    if (tokenType[state] == TK::Double)
+    auto found = tokenType.find(state);
+    if (found == tokenType.end())
+        return;
+    TK::TokenType type = found->second;
+    if (type == TK::Double)
         DoubleValue();
-    else if (tokenType[state] == TK::Identifier || tokenType[state] == TK::Operator ||
-            tokenType[state] == TK::Separator)
+    else if (type == TK::Identifier || type == TK::Operator || type == TK::Separator)
         IdentifierValue();
-    else if (tokenType[state] == TK::Integer)
+    else if (type == TK::Integer)
         IntegerValue();
-    else if (tokenType[state] == TK::String)
+    else if (type == TK::String)
         StringValue();
-    else if (tokenType[state] == TK::EOFF)
+    else if (type == TK::EOFF)
         EofValue();
 }
 
@@ -75,19 +87,16 @@ void Token::StringValue() {
     if (value == "")
         return;
 
-    regex rx1("\'((#[0-9]+)+)\'");
     smatch m1;
-    while (regex_search(value, m1, rx1)) {
-        regex rx2("#([0-9]+)");
+    while (regex_search(value, m1, charCodes)) {
         smatch m2;
         string tmp = m1[1].str();
-        while (regex_search(tmp, m2, rx2))
+        while (regex_search(tmp, m2, charCode))
             tmp = m2.prefix().str() + (char)atoi(m2[1].str().c_str()) + m2.suffix().str();
         value = m1.prefix().str() + tmp + m1.suffix().str();
     }
 
-    regex rx3("\'\'");
-    value = regex_replace(value, rx3, "'");
+    value = regex_replace(value, doubledQuote, "'");
 }
 
 void Token::IntegerValue() {
@@ -108,13 +117,8 @@ void Token::IdentifierValue() {
 
 string Token::IntToValue(int base) {
     char* tmp;
-    const char* buf;
-    if (base == 10)
-        buf = text.c_str();
-    else
-        buf = text.substr(1, text.size() - 1).c_str();
-
-    return to_string(strtol(buf, &tmp, base));
+    string digits = base == 10 ? text : text.substr(1, text.size() - 1);
+    return to_string(strtol(digits.c_str(), &tmp, base));
 }
 
 void Token::SetType(TK::TokenType type) {
@@ -0,0 +1,484 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "UnitInterface.h"
+#include "CompileCache.h"
+#include "Error.h"
+
+using namespace std;
+
+// Bumped whenever the layout changes; files of another layout are rejected.
+static const char interfaceMagic[] = "PPI1";
+
+enum class TypeKind : uint8_t {
+    Base,
+    SubRange,
+    StaticArray,
+    DynamicArray,
+    OpenArray,
+    Record,
+    ProcHeader,
+    FuncHeader
+};
+
+enum class ValueKind : uint8_t {
+    None,
+    Integer,
+    Double,
+    String
+};
+
+static void PutByte(std::string &out, uint8_t value) {
+    out.push_back((char) value);
+}
+
+static void PutInt(std::string &out, uint32_t value) {
+    out.append((const char*) &value, sizeof(value));
+}
+
+static void PutLong(std::string &out, uint64_t value) {
+    out.append((const char*) &value, sizeof(value));
+}
+
+static void PutString(std::string &out, const std::string &value) {
+    PutInt(out, value.size());
+    out.append(value);
+}
+
+static void PutValue(std::string &out, const std::any &value) {
+    if (value.type() == typeid(int)) {
+        PutByte(out, (uint8_t) ValueKind::Integer);
+        PutInt(out, any_cast<int>(value));
+    }
+    else if (value.type() == typeid(double)) {
+        double number = any_cast<double>(value);
+        PutByte(out, (uint8_t) ValueKind::Double);
+        out.append((const char*) &number, sizeof(number));
+    }
+    else if (value.type() == typeid(string)) {
+        PutByte(out, (uint8_t) ValueKind::String);
+        PutString(out, any_cast<string>(value));
+    }
+    else {
+        PutByte(out, (uint8_t) ValueKind::None);
+    }
+}
+
+// Types are numbered in the order they are written, each after the types it is made of, so that a
+// reader only ever refers back. A type shared by several symbols is written once.
+static uint32_t PutType(std::string &out, uint32_t &count, std::map<Symbol*, uint32_t> &numbers, PSymbolBase type) {
+    auto found = numbers.find(type.get());
+    if (found != numbers.end())
+        return found->second;
+    string entry;
+    switch (type->GetSymType()) {
+        case SymType::BaseType: {
+            BaseType base = BaseType::Untyped;
+            for (const auto &name: baseType)
+                if (name.second == type->GetTypeName())
+                    base = name.first;
+            PutByte(entry, (uint8_t) TypeKind::Base);
+            PutByte(entry, (uint8_t) base);
+            break;
+        }
+        case SymType::SubRange: {
+            PSymbolSubRange subRange = dynamic_pointer_cast<SymbolSubRange>(type);
+            PutByte(entry, (uint8_t) TypeKind::SubRange);
+            PutInt(entry, subRange->GetLeft());
+            PutInt(entry, subRange->GetRight());
+            break;
+        }
+        case SymType::Array:
+        case SymType::OpenArray: {
+            PSymbolArray array = dynamic_pointer_cast<SymbolArray>(type);
+            uint32_t element = PutType(out, count, numbers, array->GetType());
+            PSymbolStaticArray staticArray = dynamic_pointer_cast<SymbolStaticArray>(type);
+            if (staticArray != nullptr) {
+                uint32_t subRange = PutType(out, count, numbers, staticArray->GetSubRange());
+                PutByte(entry, (uint8_t) TypeKind::StaticArray);
+                PutInt(entry, element);
+                PutInt(entry, subRange);
+                break;
+            }
+            PutByte(entry, (uint8_t) (type->GetSymType() == SymType::OpenArray ? TypeKind::OpenArray :
+                                      TypeKind::DynamicArray));
+            PutInt(entry, element);
+            break;
+        }
+        case SymType::Record: {
+            PSymbolRecord record = dynamic_pointer_cast<SymbolRecord>(type);
+            const vector<PSymbolComplex> &fields = record->GetFields()->GetSymbols();
+            PutByte(entry, (uint8_t) TypeKind::Record);
+            PutByte(entry, (uint8_t) record->GetPacking());
+            PutInt(entry, fields.size());
+            for (const auto &field: fields) {
+                PutString(entry, field->GetName());
+                PutInt(entry, PutType(out, count, numbers, field->GetType()));
+            }
+            break;
+        }
+        case SymType::ProcHeader:
+        case SymType::FuncHeader: {
+            PSymbolProcHeader header = dynamic_pointer_cast<SymbolProcHeader>(type);
+            const vector<PSymbolComplex> &args = header->GetArgs()->GetSymbols();
+            bool function = type->GetSymType() == SymType::FuncHeader;
+            PutByte(entry, (uint8_t) (function ? TypeKind::FuncHeader : TypeKind::ProcHeader));
+            PutInt(entry, args.size());
+            for (const auto &arg: args) {
+                PutString(entry, arg->GetName());
+                PutInt(entry, PutType(out, count, numbers, arg->GetType()));
+            }
+            if (function)
+                PutInt(entry, PutType(out, count, numbers, header->GetReturnType()));
+            break;
+        }
+        default: {
+            throw runtime_error("type " + type->GetTypeName() + " cannot be exported");
+        }
+    }
+    out.append(entry);
+    return numbers[type.get()] = count++;
+}
+
+// Bounds-checked reads straight from the mapped file.
+class InterfaceReader {
+public:
+    InterfaceReader(const char *data, size_t size, const std::string &fileName) :
+            data(data), end(data + size), fileName(fileName) {}
+
+    const char *GetPosition() const {
+        return data;
+    }
+
+    void Read(void *value, size_t size) {
+        if (end - data < size)
+            throw InvalidInterface(fileName);
+        memcpy(value, data, size);
+        data += size;
+    }
+
+    uint8_t GetByte() {
+        uint8_t value;
+        Read(&value, sizeof(value));
+        return value;
+    }
+
+    uint32_t GetInt() {
+        uint32_t value;
+        Read(&value, sizeof(value));
+        return value;
+    }
+
+    uint64_t GetLong() {
+        uint64_t value;
+        Read(&value, sizeof(value));
+        return value;
+    }
+
+    std::string GetString() {
+        uint32_t size = GetInt();
+        if (end - data < size)
+            throw InvalidInterface(fileName);
+        data += size;
+        return string(data - size, size);
+    }
+
+    std::any GetValue() {
+        switch ((ValueKind) GetByte()) {
+            case ValueKind::None: {
+                return any();
+            }
+            case ValueKind::Integer: {
+                return make_any<int>(GetInt());
+            }
+            case ValueKind::Double: {
+                double value;
+                Read(&value, sizeof(value));
+                return make_any<double>(value);
+            }
+            case ValueKind::String: {
+                return make_any<string>(GetString());
+            }
+            default: {
+                throw InvalidInterface(fileName);
+            }
+        }
+    }
+
+    template<class T>
+    std::shared_ptr<T> GetType(const std::vector<PSymbolBase> &types) {
+        uint32_t number = GetInt();
+        shared_ptr<T> type = number < types.size() ? dynamic_pointer_cast<T>(types[number]) : nullptr;
+        if (type == nullptr)
+            throw InvalidInterface(fileName);
+        return type;
+    }
+
+    const std::string &GetFileName() const {
+        return fileName;
+    }
+private:
+    const char *data;
+    const char *end;
+    std::string fileName;
+};
+
+static PSymbolBase GetType(InterfaceReader &in, const std::vector<PSymbolBase> &types) {
+    switch ((TypeKind) in.GetByte()) {
+        case TypeKind::Base: {
+            BaseType base = (BaseType) in.GetByte();
+            if (baseType.find(base) == baseType.end())
+                throw InvalidInterface(in.GetFileName());
+            auto basic = basicSymbol.find(base);
+            return basic != basicSymbol.end() ? PSymbolBase(basic->second) : PSymbolBase(new SymbolBaseType(base));
+        }
+        case TypeKind::SubRange: {
+            int left = in.GetInt();
+            return PSymbolBase(new SymbolSubRange(left, in.GetInt()));
+        }
+        case TypeKind::StaticArray: {
+            PSymbolBase element = in.GetType<SymbolBase>(types);
+            return PSymbolBase(new SymbolStaticArray(element, in.GetType<SymbolSubRange>(types)));
+        }
+        case TypeKind::DynamicArray: {
+            return PSymbolBase(new SymbolDynamicArray(in.GetType<SymbolBase>(types)));
+        }
+        case TypeKind::OpenArray: {
+            return PSymbolBase(new SymbolOpenArray(in.GetType<SymbolBase>(types)));
+        }
+        case TypeKind::Record: {
+            PSymbolRecord record(new SymbolRecord());
+            record->SetPacking((RecordPacking) in.GetByte());
+            for (uint32_t count = in.GetInt(); count > 0; count--) {
+                string name = in.GetString();
+                record->AddField(PSymbolRecordField(new SymbolRecordField(name, in.GetType<SymbolBase>(types))));
+            }
+            return record;
+        }
+        case TypeKind::ProcHeader: {
+            PSymbolProcHeader header(new SymbolProcHeader());
+            for (uint32_t count = in.GetInt(); count > 0; count--) {
+                string name = in.GetString();
+                header->GetArgs()->AddSymbol(PSymbolComplex(new SymbolValueParameter(name, in.GetType<SymbolBase>(types))));
+            }
+            return header;
+        }
+        case TypeKind::FuncHeader: {
+            PSymbolFuncHeader header(new SymbolFuncHeader());
+            for (uint32_t count = in.GetInt(); count > 0; count--) {
+                string name = in.GetString();
+                header->GetArgs()->AddSymbol(PSymbolComplex(new SymbolValueParameter(name, in.GetType<SymbolBase>(types))));
+            }
+            header->SetReturnType(in.GetType<SymbolBase>(types));
+            return header;
+        }
+        default: {
+            throw InvalidInterface(in.GetFileName());
+        }
+    }
+}
+
+// Procedures and functions go out as headings: their bodies and locals stay in the implementation.
+UnitInterface::UnitInterface(std::string name, const std::string &sourceFileName, PSymbolTable symbols,
+                             const std::vector<PUnitInterface> &uses) :
+        name(name), symbols(symbols), sourceHash(HashFile(sourceFileName)) {
+    for (const auto &unit: uses)
+        this->uses.emplace_back(unit->GetName(), unit->GetHash());
+    string types, entries;
+    uint32_t count = 0;
+    map<Symbol*, uint32_t> numbers;
+    for (const auto &symbol: symbols->GetSymbols()) {
+        uint32_t type = PutType(types, count, numbers, symbol->GetType());
+        PutByte(entries, (uint8_t) symbol->GetSymType());
+        PutString(entries, symbol->GetName());
+        PutInt(entries, type);
+        PSymbolComplexWithValue withValue = dynamic_pointer_cast<SymbolComplexWithValue>(symbol);
+        if (withValue != nullptr)
+            PutValue(entries, withValue->GetValue());
+    }
+    PutInt(encoded, count);
+    encoded += types;
+    PutInt(encoded, symbols->Size());
+    encoded += entries;
+    hash = CompileCache::Hash(encoded.data(), encoded.size());
+}
+
+// The file is mapped rather than read; only the symbols are copied out of it.
+UnitInterface::UnitInterface(const std::string &fileName) : symbols(new SymbolTable()), sourceHash(0), hash(0) {
+    int file = open(fileName.c_str(), O_RDONLY);
+    struct stat info;
+    if (file < 0 || fstat(file, &info) != 0 || info.st_size == 0) {
+        if (file >= 0)
+            close(file);
+        throw InvalidInterface(fileName);
+    }
+    void *data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED)
+        throw InvalidInterface(fileName);
+    try {
+        Decode((const char*) data, info.st_size, fileName);
+    }
+    catch (...) {
+        munmap(data, info.st_size);
+        throw;
+    }
+    munmap(data, info.st_size);
+}
+
+void UnitInterface::Decode(const char *data, size_t size, const std::string &fileName) {
+    InterfaceReader in(data, size, fileName);
+    char magic[sizeof(interfaceMagic)];
+    in.Read(magic, sizeof(magic));
+    if (memcmp(magic, interfaceMagic, sizeof(magic)) != 0)
+        throw InvalidInterface(fileName);
+    name = in.GetString();
+    sourceHash = in.GetLong();
+    hash = in.GetLong();
+    for (uint32_t count = in.GetInt(); count > 0; count--) {
+        string unit = in.GetString();
+        uses.emplace_back(unit, in.GetLong());
+    }
+    const char *section = in.GetPosition();
+    vector<PSymbolBase> types;
+    for (uint32_t count = in.GetInt(); count > 0; count--)
+        types.push_back(GetType(in, types));
+    for (uint32_t count = in.GetInt(); count > 0; count--) {
+        SymType symType = (SymType) in.GetByte();
+        string symbol = in.GetString();
+        switch (symType) {
+            case SymType::Const: {
+                PSymbolBase type = in.GetType<SymbolBase>(types);
+                symbols->AddSymbol(PSymbolComplex(new SymbolConst(symbol, type, in.GetValue())));
+                break;
+            }
+            case SymType::Var: {
+                PSymbolBase type = in.GetType<SymbolBase>(types);
+                symbols->AddSymbol(PSymbolComplex(new SymbolVar(symbol, type, in.GetValue())));
+                break;
+            }
+            case SymType::Type: {
+                symbols->AddSymbol(PSymbolComplex(new SymbolTypeAlias(symbol, in.GetType<SymbolBase>(types))));
+                break;
+            }
+            case SymType::Procedure: {
+                PSymbolProcHeader header = in.GetType<SymbolProcHeader>(types);
+                symbols->AddSymbol(PSymbolComplex(new SymbolProcedure(symbol, header, PSymbolTable(new SymbolTable()))));
+                break;
+            }
+            case SymType::Function: {
+                PSymbolFuncHeader header = in.GetType<SymbolFuncHeader>(types);
+                symbols->AddSymbol(PSymbolComplex(new SymbolFunction(symbol, header, PSymbolTable(new SymbolTable()))));
+                break;
+            }
+            default: {
+                throw InvalidInterface(fileName);
+            }
+        }
+    }
+    encoded.assign(section, in.GetPosition() - section);
+    if (CompileCache::Hash(encoded.data(), encoded.size()) != hash)
+        throw InvalidInterface(fileName);
+}
+
+// Written aside and renamed into place, so that a build running next to this one never maps half
+// a file.
+void UnitInterface::Save(const std::string &fileName) const {
+    string header(interfaceMagic, sizeof(interfaceMagic));
+    PutString(header, name);
+    PutLong(header, sourceHash);
+    PutLong(header, hash);
+    PutInt(header, uses.size());
+    for (const auto &unit: uses) {
+        PutString(header, unit.first);
+        PutLong(header, unit.second);
+    }
+    string temporary = fileName + ".tmp" + to_string(getpid());
+    {
+        ofstream file(temporary, ios::binary | ios::trunc);
+        file << header << encoded;
+        if (!file) {
+            unlink(temporary.c_str());
+            throw FileNotWritten(fileName);
+        }
+    }
+    if (rename(temporary.c_str(), fileName.c_str()) != 0) {
+        unlink(temporary.c_str());
+        throw FileNotWritten(fileName);
+    }
+}
+
+const std::string &UnitInterface::GetName() const {
+    return name;
+}
+
+const PSymbolTable UnitInterface::GetSymbols() const {
+    return symbols;
+}
+
+unsigned long long UnitInterface::GetSourceHash() const {
+    return sourceHash;
+}
+
+unsigned long long UnitInterface::GetHash() const {
+    return hash;
+}
+
+const std::vector<std::pair<std::string, unsigned long long>> &UnitInterface::GetUses() const {
+    return uses;
+}
+
+// A unit's interface is looked for beside the source that uses it, named after the unit.
+std::string UnitInterface::GetFileName(const std::string &sourceFileName, const std::string &unitName) {
+    string name = unitName;
+    transform(name.begin(), name.end(), name.begin(), ::tolower);
+    size_t slash = sourceFileName.rfind('/');
+    return (slash == string::npos ? "" : sourceFileName.substr(0, slash + 1)) + name + ".ppi";
+}
+
+unsigned long long UnitInterface::HashFile(const std::string &fileName) {
+    ifstream file(fileName, ios::binary | ios::ate);
+    if (!file.is_open())
+        return 0;
+    string bytes(file.tellg(), '\0');
+    file.seekg(0);
+    file.read(&bytes[0], bytes.size());
+    return CompileCache::Hash(bytes.data(), bytes.size());
+}
+
+// Identifies every interface a source could use, by name, size and modification time, so that
+// cached output for the source is dropped when any of them is rebuilt.
+unsigned long long UnitInterface::GetStamp(const std::string &sourceFileName) {
+    size_t slash = sourceFileName.rfind('/');
+    string directory = slash == string::npos ? "." : sourceFileName.substr(0, slash + 1);
+    DIR *dir = opendir(directory.c_str());
+    if (dir == nullptr)
+        return 0;
+    vector<string> names;
+    while (dirent *entry = readdir(dir)) {
+        string name = entry->d_name;
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".ppi") == 0)
+            names.push_back(name);
+    }
+    closedir(dir);
+    sort(names.begin(), names.end());
+    unsigned long long stamp = 0;
+    for (const auto &name: names) {
+        struct stat info;
+        if (stat((directory + "/" + name).c_str(), &info) != 0)
+            continue;
+        long long identity[] = { (long long) info.st_size, (long long) info.st_mtim.tv_sec,
+                                 (long long) info.st_mtim.tv_nsec };
+        stamp = CompileCache::Hash(name.data(), name.size(), stamp);
+        stamp = CompileCache::Hash((const char*) identity, sizeof(identity), stamp);
+    }
+    return stamp;
+}
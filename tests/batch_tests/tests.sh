@@ -0,0 +1,31 @@
+#!/bin/bash 
+
+stuff="$PWD/../../stuff"
+make -C $stuff
+
+echo "Batch tests:"
+for suite in scanner_tests:-s parser_expression_tests:-pe parser_declaration_tests:-pd parser_statement_tests:-ps
+do
+	dir=${suite%%:*}
+	mode=${suite##*:}
+	echo -n "$dir "
+
+	results=$(mktemp -d)
+	$stuff/Compiler -j 4 -batch $mode $PWD/../$dir $results > /dev/null
+	test=""
+	for file in $PWD/../$dir/*.in
+	do
+		file=${file##*/}
+		file=${file%.*}
+		test="$test$(diff $results/$file.out $PWD/../$dir/$file.out)"
+	done
+	rm -rf $results
+	if [ "$test" != "" ]
+	then	
+		echo "FAIL"
+	else
+		echo "OK"
+	fi
+done
+
+exit 0
@@ -0,0 +1,19 @@
+unit base;
+
+interface
+
+const
+    limit = 10;
+
+function Clamp(v: integer): integer;
+
+implementation
+
+function Clamp(v: integer): integer;
+begin
+    Clamp := v;
+    if v > limit then
+        Clamp := limit;
+end;
+
+end.
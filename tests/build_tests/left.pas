@@ -0,0 +1,12 @@
+unit left;
+
+interface
+
+uses base;
+
+var
+    low: integer = limit;
+
+implementation
+
+end.
@@ -0,0 +1,19 @@
+unit right;
+
+interface
+
+uses base;
+
+procedure Store(v: integer);
+
+implementation
+
+var
+    kept: integer;
+
+procedure Store(v: integer);
+begin
+    kept := Clamp(v);
+end;
+
+end.
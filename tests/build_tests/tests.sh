@@ -0,0 +1,59 @@
+#!/bin/bash 
+
+stuff="$PWD/../../stuff"
+make -C $stuff
+
+# Builds the program in top.pas, which uses two units that both use a third, in a scratch
+# directory, and edits the sources between builds. Each build must compile exactly the units
+# that changed or use an interface that did.
+work=$(mktemp -d)
+cp $PWD/*.pas $work
+
+# What was done to each unit, in build order, then the units on the critical path. Either unit
+# in the middle may be the slower one.
+build() {
+	output=$($stuff/Compiler -j 4 -build $work/top.pas)
+	echo "$output" | grep -v "^build: \|^critical path: " | tr '\n' ' '
+	echo
+	echo "$output" | grep "^critical path: " | sed 's/ [0-9.]*s//g; s/,.*//; s/left\|right/side/'
+}
+
+check() {
+	echo -n "$1 "
+	if [ "$2" != "$3" ]
+	then
+		echo "FAIL"
+	else
+		echo "OK"
+	fi
+}
+
+echo "Build tests:"
+check "cold" "$(build)" "compiled base compiled left compiled right compiled top 
+critical path: base -> side -> top"
+
+check "warm" "$(build)" "up to date base up to date left up to date right compiled top 
+critical path: base -> side -> top"
+
+sed -i 's/Clamp := limit;/Clamp := limit - 1;/' $work/base.pas
+check "implementation edited" "$(build)" "compiled base up to date left up to date right compiled top 
+critical path: base -> side -> top"
+
+sed -i 's/limit = 10;/limit = 20;/' $work/base.pas
+check "interface edited" "$(build)" "compiled base compiled left compiled right compiled top 
+critical path: base -> side -> top"
+
+rm $work/right.ppi
+check "interface removed" "$(build)" "up to date base up to date left compiled right compiled top 
+critical path: base -> side -> top"
+
+sed -i 's/kept := Clamp(v);/kept := Clamp(v, v);/' $work/right.pas
+check "failed" "$(build)" "up to date base up to date left failed right right.pas(16,13) Error: Wrong number of parameters specified for call to \"Clamp\" skipped top 
+critical path: base -> side -> top"
+
+sed -i 's/uses base;/uses top;/' $work/left.pas
+sed -i 's/^uses left, right;/unit top; interface uses left, right; implementation/' $work/top.pas
+check "cycle" "$(build)" "circular unit reference: top -> left -> top "
+
+rm -rf $work
+exit 0
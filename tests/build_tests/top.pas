@@ -0,0 +1,5 @@
+uses left, right;
+
+begin
+    Store(low);
+end.
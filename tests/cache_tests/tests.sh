@@ -0,0 +1,94 @@
+#!/bin/bash 
+
+stuff="$PWD/../../stuff"
+make -C $stuff
+
+# Each suite runs twice against the same cache: the first run fills it and the second is
+# answered from it. Both must print what the suite expects.
+cache=$(mktemp -d)
+
+echo "Cache tests:"
+for pass in cold warm
+do
+	for suite in parser_declaration_tests:-pd parser_statement_tests:-ps
+	do
+		dir=${suite%%:*}
+		mode=${suite##*:}
+		echo -n "$pass $dir "
+
+		test=""
+		for file in $PWD/../$dir/*.in
+		do
+			test="$test$($stuff/Compiler -cache $cache $mode $file | diff - ${file%.*}.out)"
+		done
+		if [ "$test" != "" ]
+		then	
+			echo "FAIL"
+		else
+			echo "OK"
+		fi
+	done
+
+	echo -n "$pass codegen_tests "
+	test=""
+	for file in $PWD/../codegen_tests/*.in
+	do
+		program=$(mktemp -u)
+		output=$($stuff/Compiler -cache $cache -c $file $program)
+		if [ "$output" == "" ]
+		then
+			output=$($program)
+			rm $program
+		fi
+		test="$test$(diff <(echo "$output") <(echo "$(cat ${file%.*}.out)"))"
+	done
+	if [ "$test" != "" ]
+	then	
+		echo "FAIL"
+	else
+		echo "OK"
+	fi
+done
+
+echo -n "edited "
+source=$(mktemp)
+echo "a + b" > $source
+first=$($stuff/Compiler -cache $cache -pe $source)
+echo "a * b" > $source
+second=$($stuff/Compiler -cache $cache -pe $source)
+if [ "$second" != "$($stuff/Compiler -pe $source)" ] || [ "$first" == "$second" ]
+then
+	echo "FAIL"
+else
+	echo "OK"
+fi
+rm $source
+
+echo -n "failed "
+source=$(mktemp)
+echo "x := 1;" > $source
+status=""
+for pass in cold warm
+do
+	$stuff/Compiler -cache $cache -c $source $source.out > /dev/null
+	status="$status $?"
+done
+if [ "$status" != " 1 1" ] || [ -e $source.out ]
+then
+	echo "FAIL"
+else
+	echo "OK"
+fi
+rm -f $source $source.out
+
+echo -n "evicted "
+$stuff/Compiler -cache $cache -cache-limit 0 -s $PWD/../scanner_tests/test000.in > /dev/null
+if [ "$(ls $cache)" != "" ]
+then
+	echo "FAIL"
+else
+	echo "OK"
+fi
+
+rm -rf $cache
+exit 0
@@ -0,0 +1,16 @@
+#!/bin/bash 
+
+file="$1"
+
+stuff="$PWD/../../stuff"
+make -C $stuff
+echo -n "file name - "
+echo $file
+$stuff/Compiler -c $PWD/$file.in $PWD/$file && $PWD/$file
+echo ""
+echo "-----------------------------"
+echo "pascal:"
+fpc $PWD/$file.in && $PWD/$file
+
+rm $file
+rm $file.o
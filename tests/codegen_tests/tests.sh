@@ -0,0 +1,53 @@
+#!/bin/bash 
+
+stuff="$PWD/../../stuff"
+make -C $stuff
+
+echo "Code generator tests:"
+for file in $PWD/*.in
+do
+	file=${file##*/}
+	file=${file%.*}
+	echo -n "$file "
+
+	output=$($stuff/Compiler -c $PWD/$file.in $PWD/$file)
+	if [ "$output" == "" ]
+	then
+		output=$($PWD/$file)
+		rm $PWD/$file
+	fi
+	test=$(diff <(echo "$output") <(echo "$(cat $PWD/$file.out)"))
+	jit=$(diff <(echo "$($stuff/Compiler -jit $PWD/$file.in)") <(echo "$(cat $PWD/$file.out)"))
+	parallel=$(diff <(echo "$($stuff/Compiler -j 4 -jit $PWD/$file.in)") <(echo "$(cat $PWD/$file.out)"))
+
+	output=$($stuff/Compiler -cc $PWD/$file.in $PWD/$file)
+	if [ "$output" == "" ]
+	then
+		output=$($PWD/$file)
+		rm $PWD/$file
+	fi
+	c=$(diff <(echo "$output") <(echo "$(cat $PWD/$file.out)"))
+
+	# The sections of -obj must be those GNU as makes of the -S output, byte for byte.
+	object=""
+	if $stuff/Compiler -S $PWD/$file.in | as -o $PWD/$file.as.o 2> /dev/null
+	then
+		$stuff/Compiler -obj $PWD/$file.in $PWD/$file.o
+		for section in .text .rodata .data
+		do
+			objcopy -O binary -j $section $PWD/$file.as.o $PWD/$file.as.bin
+			objcopy -O binary -j $section $PWD/$file.o $PWD/$file.bin
+			object="$object$(cmp $PWD/$file.as.bin $PWD/$file.bin 2>&1)"
+		done
+		rm $PWD/$file.o $PWD/$file.bin $PWD/$file.as.bin
+	fi
+	rm -f $PWD/$file.as.o
+	if [ "$test" != "" ] || [ "$jit" != "" ] || [ "$parallel" != "" ] || [ "$c" != "" ] || [ "$object" != "" ]
+	then	
+		echo "FAIL"
+	else
+		echo "OK"
+	fi
+done
+
+exit 0
@@ -0,0 +1,40 @@
+const
+    scale = 2;
+
+type
+    point = record
+        x, y: integer;
+    end;
+
+var
+    origin: point;
+    points: array [1..3] of point;
+    total: integer;
+
+function Area(w, h: integer): integer;
+begin
+    Area := w * h * scale;
+end;
+
+procedure Move(dx, dy: integer);
+begin
+    origin.x := origin.x + dx;
+    origin.y := origin.y + dy;
+end;
+
+procedure Report;
+var
+    i: integer;
+begin
+    for i := 1 to 3 do
+    begin
+        points[i].x := i;
+        total := total + Area(i, points[i].y);
+    end;
+    writeln(total);
+end;
+
+begin
+    Move(1, 2);
+    Report;
+end.
@@ -0,0 +1,80 @@
+#!/bin/bash 
+
+stuff="$PWD/../../stuff"
+make -C $stuff
+
+# Talks to the language server over a pipe as an editor would: opens shapes.pas, asks about it,
+# breaks it with an edit and shuts down. The server's messages are checked one per line.
+work=$(mktemp -d)
+uri="file://$work/shapes.pas"
+cp $PWD/shapes.pas $work
+
+message() {
+	printf 'Content-Length: %d\r\n\r\n%s' ${#1} "$1"
+}
+
+# The file as a JSON string.
+text() {
+	sed 's/\\/\\\\/g; s/"/\\"/g' $1 | awk '{ printf "%s\\n", $0 }'
+}
+
+request() {
+	message "{\"jsonrpc\":\"2.0\",\"id\":$1,\"method\":\"$2\",\"params\":{\"textDocument\":{\"uri\":\"$uri\"},\"position\":{\"line\":$3,\"character\":$4}}}"
+}
+
+sed 's/total := total + Area/total := totl + Area/' $work/shapes.pas > $work/broken.pas
+{
+	message '{"jsonrpc":"2.0","id":1,"method":"initialize","params":{}}'
+	message '{"jsonrpc":"2.0","method":"initialized","params":{}}'
+	message "{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/didOpen\",\"params\":{\"textDocument\":{\"uri\":\"$uri\",\"languageId\":\"pascal\",\"version\":1,\"text\":\"$(text $work/shapes.pas)\"}}}"
+	request 2 textDocument/hover 20 6
+	request 3 textDocument/hover 20 11
+	request 4 textDocument/hover 15 20
+	request 5 textDocument/definition 31 27
+	request 6 textDocument/definition 30 15
+	request 7 textDocument/completion 21 6
+	request 8 textDocument/completion 30 18
+	request 9 textDocument/completion 31 44
+	message "{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/didChange\",\"params\":{\"textDocument\":{\"uri\":\"$uri\",\"version\":2},\"contentChanges\":[{\"text\":\"$(text $work/broken.pas)\"}]}}"
+	request 10 textDocument/hover 15 20
+	request 11 textDocument/rename 0 0
+	message '{"jsonrpc":"2.0","id":12,"method":"shutdown"}'
+	message '{"jsonrpc":"2.0","method":"exit"}'
+} | $stuff/Compiler -lsp > $work/out 2> $work/err
+status=$?
+output=$(tr -d '\r' < $work/out | sed 's/Content-Length: [0-9]*$//' | grep -v '^$')
+
+# The server's n-th message.
+reply() {
+	echo "$output" | sed -n "$1p"
+}
+
+check() {
+	echo -n "$1 "
+	if [ "$2" != "$3" ]
+	then
+		echo "FAIL"
+	else
+		echo "OK"
+	fi
+}
+
+echo "Language server tests:"
+check "initialize" "$(reply 1)" '{"id":1,"jsonrpc":"2.0","result":{"capabilities":{"completionProvider":{"triggerCharacters":["."]},"definitionProvider":true,"hoverProvider":true,"textDocumentSync":{"change":1,"openClose":true}},"serverInfo":{"name":"Compiler"}}}'
+check "opened" "$(reply 2)" "{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/publishDiagnostics\",\"params\":{\"diagnostics\":[],\"uri\":\"$uri\"}}"
+check "hover" "$(reply 3)" '{"id":2,"jsonrpc":"2.0","result":{"contents":{"kind":"plaintext","value":"var origin: record <x: integer> <y: integer>"},"range":{"end":{"character":10,"line":20},"start":{"character":4,"line":20}}}}'
+check "hover field" "$(reply 4)" '{"id":3,"jsonrpc":"2.0","result":{"contents":{"kind":"plaintext","value":"recordfield x: integer"},"range":{"end":{"character":12,"line":20},"start":{"character":11,"line":20}}}}'
+check "hover constant" "$(reply 5)" '{"id":4,"jsonrpc":"2.0","result":{"contents":{"kind":"plaintext","value":"const scale: integer = 2"},"range":{"end":{"character":25,"line":15},"start":{"character":20,"line":15}}}}'
+check "definition" "$(reply 6)" "{\"id\":5,\"jsonrpc\":\"2.0\",\"result\":{\"range\":{\"end\":{\"character\":13,\"line\":13},\"start\":{\"character\":9,\"line\":13}},\"uri\":\"$uri\"}}"
+check "definition local" "$(reply 7)" "{\"id\":6,\"jsonrpc\":\"2.0\",\"result\":{\"range\":{\"end\":{\"character\":5,\"line\":26},\"start\":{\"character\":4,\"line\":26}},\"uri\":\"$uri\"}}"
+check "completion" "$(reply 8)" '{"id":7,"jsonrpc":"2.0","result":{"isIncomplete":false,"items":[{"detail":"var origin: record <x: integer> <y: integer>","kind":6,"label":"origin"}]}}'
+check "completion field" "$(reply 9)" '{"id":8,"jsonrpc":"2.0","result":{"isIncomplete":false,"items":[{"detail":"recordfield x: integer","kind":5,"label":"x"},{"detail":"recordfield y: integer","kind":5,"label":"y"}]}}'
+check "completion element" "$(reply 10)" '{"id":9,"jsonrpc":"2.0","result":{"isIncomplete":false,"items":[{"detail":"recordfield y: integer","kind":5,"label":"y"}]}}'
+check "changed" "$(reply 11)" "{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/publishDiagnostics\",\"params\":{\"diagnostics\":[{\"message\":\"Identifier not found \\\"totl\\\"\",\"range\":{\"end\":{\"character\":21,\"line\":31},\"start\":{\"character\":17,\"line\":31}},\"severity\":1,\"source\":\"Compiler\"}],\"uri\":\"$uri\"}}"
+check "hover after error" "$(reply 12)" "$(reply 5 | sed 's/"id":4/"id":10/')"
+check "unknown method" "$(reply 13)" '{"error":{"code":-32601,"message":"method not found: textDocument/rename"},"id":11,"jsonrpc":"2.0"}'
+check "shutdown" "$(reply 14) $status" '{"id":12,"jsonrpc":"2.0","result":null} 0'
+check "latency" "$(sed 's/[0-9.]* ms/T ms/g' $work/err)" "lsp: 12 requests, p50 T ms, p99 T ms, max T ms"
+
+rm -rf $work
+exit 0
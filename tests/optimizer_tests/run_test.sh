@@ -0,0 +1,13 @@
+#!/bin/bash 
+
+file="$1"
+
+stuff="$PWD/../../stuff"
+make -C $stuff
+echo -n "file name - "
+echo $file
+$stuff/Compiler -stats $PWD/$file.in
+echo "-----------------------------"
+echo "expected:"
+cat $PWD/$file.out
+echo ""
@@ -0,0 +1,21 @@
+#!/bin/bash 
+
+stuff="$PWD/../../stuff"
+make -C $stuff
+
+echo "Optimizer tests:"
+for file in $PWD/*.in
+do
+	file=${file##*/}
+	file=${file%.*}
+	echo -n "$file "
+	test=$(diff <(echo "$($stuff/Compiler -stats $PWD/$file.in)") <(echo "$(cat $PWD/$file.out)"))
+	if [ "$test" != "" ]
+	then	
+		echo "FAIL"
+	else
+		echo "OK"
+	fi
+done
+
+exit 0
@@ -11,7 +11,8 @@ do
 	echo -n "$file "
 
 	test=$($stuff/Compiler -pd $PWD/$file.in | diff - $PWD/$file.out)
-	if [ "$test" != "" ] 
+	parallel=$($stuff/Compiler -j 4 -pd $PWD/$file.in | diff - $PWD/$file.out)
+	if [ "$test" != "" ] || [ "$parallel" != "" ]
 	then	
 		echo "FAIL"
 	else
@@ -11,7 +11,9 @@ do
 	echo -n "$file "
 
 	test=$($stuff/Compiler -ps $PWD/$file.in | diff - $PWD/$file.out)
-	if [ "$test" != "" ] 
+	parallel=$($stuff/Compiler -j 4 -ps $PWD/$file.in | diff - $PWD/$file.out)
+	pipelined=$($stuff/Compiler -pipe -j 4 -ps $PWD/$file.in | diff - $PWD/$file.out)
+	if [ "$test" != "" ] || [ "$parallel" != "" ] || [ "$pipelined" != "" ]
 	then	
 		echo "FAIL"
 	else
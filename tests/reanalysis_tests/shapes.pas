@@ -0,0 +1,42 @@
+const
+    scale = 2;
+
+type
+    point = record
+        x, y: integer;
+    end;
+
+var
+    origin: point;
+    total: integer;
+
+function Area(w, h: integer): integer;
+begin
+    Area := w * h * scale;
+end;
+
+procedure Move(dx, dy: integer);
+begin
+    origin.x := origin.x + dx;
+    origin.y := origin.y + dy;
+end;
+
+procedure Report;
+var
+    i: integer;
+begin
+    for i := 1 to 3 do
+        total := total + Area(i, i);
+    writeln(total);
+end;
+
+procedure Reset;
+begin
+    total := 0;
+end;
+
+begin
+    Reset;
+    Move(1, 2);
+    Report;
+end.
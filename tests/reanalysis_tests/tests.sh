@@ -0,0 +1,48 @@
+#!/bin/bash 
+
+stuff="$PWD/../../stuff"
+make -C $stuff
+
+# Parses versions of shapes.pas, each an edit of the one before, in a single run that keeps the
+# procedure bodies it parsed. Each version must parse again exactly the bodies that were edited or
+# use a declaration that changed, and end up with the tree a parse from scratch gives.
+work=$(mktemp -d)
+cp $PWD/shapes.pas $work/v1.pas
+cp $work/v1.pas $work/v2.pas
+sed 's/origin.y + dy/origin.y - dy/' $work/v2.pas > $work/v3.pas
+sed 's/^\(    scale = 2;\)/\1\n    extra = 1;/' $work/v3.pas > $work/v4.pas
+sed 's/    scale = 2;/    scale = 3;/' $work/v4.pas > $work/v5.pas
+sed 's/        x, y: integer;/        x: integer;\n        y: double;/' $work/v5.pas > $work/v6.pas
+sed 's/total := 0;/total := none;/' $work/v6.pas > $work/v7.pas
+cp $work/v6.pas $work/v8.pas
+output=$($stuff/Compiler -reanalyze $work/v{1..8}.pas)
+
+# What was parsed again for the n-th version.
+recomputed() {
+	echo "$output" | grep "^recomputed:\|Error" | sed -n "$1p"
+}
+
+check() {
+	echo -n "$1 "
+	if [ "$2" != "$3" ]
+	then
+		echo "FAIL"
+	else
+		echo "OK"
+	fi
+}
+
+echo "Reanalysis tests:"
+check "cold" "$(recomputed 1)" "recomputed: Area Move Report Reset"
+check "unchanged" "$(recomputed 2)" "recomputed:"
+check "body edited" "$(recomputed 3)" "recomputed: Move"
+check "lines inserted" "$(recomputed 4)" "recomputed:"
+check "constant changed" "$(recomputed 5)" "recomputed: Area"
+check "field changed" "$(recomputed 6)" "recomputed: Move"
+check "error" "$(recomputed 7)" "(37,14) Error: Identifier not found \"none\""
+check "error fixed" "$(recomputed 8)" "recomputed:"
+check "tree" "$(echo "$output" | grep -v "^recomputed:\|Error" | tail -n $($stuff/Compiler -ps $work/v8.pas | wc -l))" \
+	"$($stuff/Compiler -ps $work/v8.pas)"
+
+rm -rf $work
+exit 0
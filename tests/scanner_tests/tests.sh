@@ -10,7 +10,8 @@ do
 	file=${file%.*}
 	echo -n "$file "
 	test=$($stuff/Compiler -s $PWD/$file.in | diff - $PWD/$file.out)
-	if [ "$test" != "" ] 
+	pipelined=$($stuff/Compiler -pipe -s $PWD/$file.in | diff - $PWD/$file.out)
+	if [ "$test" != "" ] || [ "$pipelined" != "" ] 
 	then	
 		echo "FAIL"
 	else
@@ -0,0 +1,78 @@
+#!/bin/bash 
+
+stuff="$PWD/../../stuff"
+make -C $stuff
+
+# Every front-end suite goes through CompilerClient twice: once to fill the server's cache and
+# once to be answered from it. An edited file must be compiled again, and requests asking for
+# threads of their own must be answered side by side.
+export COMPILER_SOCKET=$(mktemp -u)
+$stuff/Compiler -j 8 -serve $COMPILER_SOCKET &
+while [ ! -S $COMPILER_SOCKET ]
+do
+	sleep 0.1
+done
+
+echo "Server tests:"
+for pass in cold warm
+do
+	for suite in scanner_tests:-s parser_expression_tests:-pe parser_declaration_tests:-pd parser_statement_tests:-ps
+	do
+		dir=${suite%%:*}
+		mode=${suite##*:}
+		echo -n "$pass $dir "
+
+		test=""
+		for file in $PWD/../$dir/*.in
+		do
+			test="$test$($stuff/CompilerClient $mode $file | diff - ${file%.*}.out)"
+		done
+		if [ "$test" != "" ]
+		then	
+			echo "FAIL"
+		else
+			echo "OK"
+		fi
+	done
+done
+
+echo -n "concurrent -j 2 "
+results=$(mktemp -d)
+for file in $PWD/../codegen_tests/*.in
+do
+	name=${file##*/}
+	$stuff/CompilerClient -j 2 -ps $file > $results/${name%.*}.out &
+done
+wait $(jobs -p | tail -n +2)
+test=""
+for file in $PWD/../codegen_tests/*.in
+do
+	name=${file##*/}
+	test="$test$($stuff/Compiler -ps $file | diff - $results/${name%.*}.out)"
+done
+rm -rf $results
+if [ "$test" != "" ]
+then
+	echo "FAIL"
+else
+	echo "OK"
+fi
+
+echo -n "edited "
+source=$(mktemp)
+echo "a + b" > $source
+first=$($stuff/CompilerClient -pe $source)
+echo "a * b" > $source
+touch -d "+1 second" $source
+second=$($stuff/CompilerClient -pe $source)
+if [ "$second" != "$($stuff/Compiler -pe $source)" ] || [ "$first" == "$second" ]
+then
+	echo "FAIL"
+else
+	echo "OK"
+fi
+rm $source
+
+$stuff/CompilerClient -stop
+wait
+exit 0
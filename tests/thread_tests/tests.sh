@@ -0,0 +1,82 @@
+#!/bin/bash 
+
+# Builds the compiler under ThreadSanitizer and runs scanners and parsers concurrently: batch
+# mode over every front-end suite, and procedure bodies parsed on several threads, with and
+# without the scanner on a thread of its own. Any report from the sanitizer fails the suite.
+root="$PWD/../.."
+build=$(mktemp -d)
+g++ -std=c++17 -w -O1 -g -pthread -fsanitize=thread -I$root/include $root/main.cpp $root/source/*.cpp -o $build/Compiler
+export TSAN_OPTIONS="halt_on_error=1 exitcode=66"
+
+echo "Thread tests:"
+for suite in scanner_tests:-s parser_expression_tests:-pe parser_declaration_tests:-pd parser_statement_tests:-ps
+do
+	dir=${suite%%:*}
+	mode=${suite##*:}
+	echo -n "$dir "
+
+	$build/Compiler -j 4 -batch $mode $root/tests/$dir $build/$dir > /dev/null 2> $build/report
+	status=$?
+	test=""
+	for file in $root/tests/$dir/*.in
+	do
+		file=${file##*/}
+		file=${file%.*}
+		test="$test$(diff $build/$dir/$file.out $root/tests/$dir/$file.out 2>&1)"
+	done
+	if [ $status != 0 ] || [ "$test" != "" ]
+	then	
+		echo "FAIL"
+	else
+		echo "OK"
+	fi
+done
+
+for file in $root/tests/parser_statement_tests/*.in $root/tests/codegen_tests/*.in
+do
+	dir=${file%/*}
+	name=${file##*/}
+	echo -n "${dir##*/}/${name%.*} "
+
+	test=$($build/Compiler -j 4 -ps $file 2> $build/report | diff - <($build/Compiler -ps $file 2> /dev/null))
+	status=$?
+	pipelined=$($build/Compiler -pipe -j 4 -ps $file 2>> $build/report | diff - <($build/Compiler -ps $file 2> /dev/null))
+	if [ $status != 0 ] || [ "$pipelined" != "" ] || [ -s $build/report ]
+	then	
+		echo "FAIL"
+	else
+		echo "OK"
+	fi
+done
+
+# Every worker of a wide pool fills a narrow pool of its own, as a server worker does when a
+# request is parsed on several threads.
+echo -n "nested pools "
+cat > $build/nested.cpp << END
+#include <atomic>
+#include "ThreadPool.h"
+
+int main() {
+    std::atomic<int> count(0);
+    ThreadPool outer(8);
+    for (int i = 0; i < 64; i++)
+        outer.Submit([&count]() {
+            ThreadPool inner(2);
+            for (int j = 0; j < 16; j++)
+                inner.Submit([&count]() { count++; });
+            inner.Wait();
+        });
+    outer.Wait();
+    return count == 64 * 16 ? 0 : 1;
+}
+END
+g++ -std=c++17 -w -O1 -g -pthread -fsanitize=thread -I$root/include $build/nested.cpp $root/source/ThreadPool.cpp -o $build/nested
+if ! $build/nested 2> $build/report
+then
+	echo "FAIL"
+else
+	echo "OK"
+fi
+
+rm -rf $build
+exit 0
@@ -0,0 +1,14 @@
+unit Geo;
+interface
+uses Shapes;
+var
+    corner: point;
+procedure Reset(v: integer);
+implementation
+procedure Reset(v: integer);
+begin
+    corner.x := v + origin;
+end;
+begin
+    corner.y := 1;
+end.
@@ -0,0 +1,40 @@
+unit Shapes;
+
+interface
+
+type
+    point = record
+        x, y: integer;
+    end;
+    row = array [1..3] of double;
+
+const
+    origin = 0;
+    scale = 2.5;
+
+var
+    count: integer = 3;
+    names: array [1..2] of char;
+
+function Area(w, h: integer): integer;
+procedure Move(dx: integer);
+
+implementation
+
+var
+    hidden: integer;
+
+function Area(w, h: integer): integer;
+begin
+    Area := w * h;
+end;
+
+procedure Move(dx: integer);
+var
+    step: integer;
+begin
+    step := dx * 2;
+    hidden := step;
+end;
+
+end.
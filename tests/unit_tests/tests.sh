@@ -0,0 +1,69 @@
+#!/bin/bash 
+
+stuff="$PWD/../../stuff"
+make -C $stuff
+
+# The units are compiled into a scratch directory with the tests, each test is parsed against
+# their interface files, and then the units' sources are removed: "uses" must still work from the
+# interface files alone.
+work=$(mktemp -d)
+cp $PWD/*.in $PWD/shapes.pas $PWD/geo.pas $work
+$stuff/Compiler -unit $work/shapes.pas
+$stuff/Compiler -unit $work/geo.pas
+
+echo "Unit tests:"
+for file in $PWD/*.in
+do
+	file=${file##*/}
+	file=${file%.*}
+	echo -n "$file "
+
+	test=$($stuff/Compiler -pd $work/$file.in | diff - $PWD/$file.out)
+	parallel=$($stuff/Compiler -pipe -j 4 -pd $work/$file.in | diff - $PWD/$file.out)
+	if [ "$test" != "" ] || [ "$parallel" != "" ]
+	then	
+		echo "FAIL"
+	else
+		echo "OK"
+	fi
+done
+
+echo -n "interfaces only "
+rm $work/shapes.pas $work/geo.pas
+if [ "$($stuff/Compiler -pd $work/test001.in | diff - $PWD/test001.out)" != "" ]
+then
+	echo "FAIL"
+else
+	echo "OK"
+fi
+
+echo -n "interface file "
+if [ "$($stuff/Compiler -unit $work/test000.in)" == "" ] || [ -e $work/test000.ppi ] ||
+   [ "$($stuff/Compiler -unit $work/test009.in)" != "" ] || [ ! -e $work/test009.ppi ]
+then
+	echo "FAIL"
+else
+	echo "OK"
+fi
+
+# Units are not compiled to code yet, so a program that reads one of their variables is refused.
+echo -n "unit variable "
+printf "uses shapes;\nvar n: integer;\nbegin\n  n := count + 1;\nend.\n" > $work/reader.pas
+if [ "$($stuff/Compiler -S $work/reader.pas)" != "(4,8) Error: Not supported by code generator: access to variable of unit" ]
+then
+	echo "FAIL"
+else
+	echo "OK"
+fi
+
+echo -n "invalid interface "
+printf "PPI1" > $work/shapes.ppi
+if [ "$($stuff/Compiler -pd $work/test000.in)" != "Error: Invalid interface file: $work/shapes.ppi" ]
+then
+	echo "FAIL"
+else
+	echo "OK"
+fi
+
+rm -rf $work
+exit 0